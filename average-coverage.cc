@@ -0,0 +1,162 @@
+#include "average-coverage.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <thread>
+
+#include "vec.h"
+
+namespace {
+// Don't bother spawning threads for less than this many entries.
+constexpr size_t kMinEntriesPerThread = 1 << 16;
+
+void ComputeCoverageRange(absl::Span<const double> solution,
+                          absl::Span<const CoverConstraint> constraints,
+                          size_t begin, size_t end,
+                          absl::Span<double> coverage) {
+  for (size_t c = begin; c < end; ++c) {
+    const absl::Span<const uint32_t> sets = constraints[c].potential_tours();
+    const size_t n = sets.size();
+    // Independent accumulators for the gathers.
+    double acc[4] = {0, 0, 0, 0};
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4) {
+      acc[0] += solution[sets[i]];
+      acc[1] += solution[sets[i + 1]];
+      acc[2] += solution[sets[i + 2]];
+      acc[3] += solution[sets[i + 3]];
+    }
+
+    for (; i < n; ++i) {
+      acc[0] += solution[sets[i]];
+    }
+
+    coverage[c] = (acc[0] + acc[1]) + (acc[2] + acc[3]);
+  }
+}
+}  // namespace
+
+void ComputeCoverage(absl::Span<const double> solution,
+                     absl::Span<const CoverConstraint> constraints,
+                     size_t num_threads, absl::Span<double> coverage) {
+  assert(coverage.size() == constraints.size());
+
+  size_t num_entries = 0;
+  for (const CoverConstraint& constraint : constraints) {
+    num_entries += constraint.potential_tours().size();
+  }
+
+  if (num_threads == 0) {
+    num_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  const size_t num_chunks = std::max<size_t>(
+      1, std::min(num_threads, num_entries / kMinEntriesPerThread));
+
+  // Chunk boundaries, with about the same number of entries per chunk.
+  std::vector<size_t> boundaries;
+  boundaries.push_back(0);
+  size_t prefix = 0;
+  for (size_t c = 0; c < constraints.size() && boundaries.size() < num_chunks;
+       ++c) {
+    prefix += constraints[c].potential_tours().size();
+    if (prefix * num_chunks >= boundaries.size() * num_entries) {
+      boundaries.push_back(c + 1);
+    }
+  }
+  boundaries.push_back(constraints.size());
+
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i + 1 < boundaries.size(); ++i) {
+    workers.emplace_back([=] {
+      ComputeCoverageRange(solution, constraints, boundaries[i],
+                           boundaries[i + 1], coverage);
+    });
+  }
+
+  ComputeCoverageRange(solution, constraints, boundaries[0], boundaries[1],
+                       coverage);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+}
+
+void AverageCoverage::SetInstance(absl::Span<const CoverConstraint> constraints,
+                                  size_t num_sets) {
+  assert(sum_coverage_.empty() || sum_coverage_.size() == constraints.size());
+  sum_coverage_.resize(constraints.size(), 0.0);
+  num_sets_ = num_sets;
+
+  // Counting sort of the entries by set; each set's values are
+  // sorted, since we scan the constraints in order.
+  set_offsets_.assign(num_sets + 1, 0);
+  for (const CoverConstraint& constraint : constraints) {
+    for (const uint32_t set : constraint.potential_tours()) {
+      assert(set < num_sets);
+      ++set_offsets_[set + 1];
+    }
+  }
+
+  for (size_t j = 0; j < num_sets; ++j) {
+    set_offsets_[j + 1] += set_offsets_[j];
+  }
+
+  set_values_.resize(set_offsets_.back());
+  std::vector<size_t> next(set_offsets_.begin(), set_offsets_.end() - 1);
+  for (size_t c = 0, n = constraints.size(); c < n; ++c) {
+    for (const uint32_t set : constraints[c].potential_tours()) {
+      set_values_[next[set]++] = c;
+    }
+  }
+}
+
+void AverageCoverage::Reset(absl::Span<const CoverConstraint> constraints,
+                            absl::Span<const double> sum_solutions,
+                            size_t num_solutions, size_t num_threads) {
+  sum_coverage_.resize(constraints.size());
+  ComputeCoverage(sum_solutions, constraints, num_threads,
+                  absl::MakeSpan(sum_coverage_));
+  num_solutions_ = num_solutions;
+  min_sum_coverage_lb_ = 0;
+}
+
+void AverageCoverage::AddSolution(absl::Span<const double> solution) {
+  assert(solution.empty() || solution.size() == num_sets_);
+  for (size_t j = 0, n = solution.size(); j < n; ++j) {
+    const double value = solution[j];
+    if (value == 0) {
+      continue;
+    }
+
+    for (size_t k = set_offsets_[j], end = set_offsets_[j + 1]; k < end;
+         ++k) {
+      sum_coverage_[set_values_[k]] += value;
+    }
+  }
+
+  ++num_solutions_;
+}
+
+bool AverageCoverage::IsFeasible(double eps) {
+  if (num_solutions_ == 0) {
+    return false;
+  }
+
+  const double threshold = (1 - eps) * num_solutions_;
+  if (min_sum_coverage_lb_ >= threshold) {
+    return true;
+  }
+
+  min_sum_coverage_lb_ = internal::MinValue(sum_coverage_);
+  return min_sum_coverage_lb_ >= threshold;
+}
+
+double AverageCoverage::MaxViolation() {
+  if (sum_coverage_.empty() || num_solutions_ == 0) {
+    return sum_coverage_.empty() ? 0.0 : 1.0;
+  }
+
+  min_sum_coverage_lb_ = internal::MinValue(sum_coverage_);
+  return 1.0 - min_sum_coverage_lb_ / num_solutions_;
+}
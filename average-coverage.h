@@ -0,0 +1,81 @@
+#ifndef AVERAGE_COVERAGE_H
+#define AVERAGE_COVERAGE_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+
+// Overwrites `coverage[c]` with the sum of `solution` over the sets
+// in `constraints[c]`, i.e., how well `solution` covers each value.
+// Splits the constraints in chunks of similar numbers of entries,
+// and processes them on up to `num_threads` threads (0 for all
+// hardware threads).
+void ComputeCoverage(absl::Span<const double> solution,
+                     absl::Span<const CoverConstraint> constraints,
+                     size_t num_threads, absl::Span<double> coverage);
+
+// Tracks how well the average of a sequence of solutions (e.g., the
+// driver's iterates) covers each value, without recomputing the
+// coverage from scratch after each solution.
+//
+// The solver's solutions are sparse, so `AddSolution` only touches
+// the values covered by non-zero sets, through a transposed (set ->
+// values) copy of the instance.  Coverage only increases, so the
+// last minimum coverage is a lower bound that usually answers
+// `IsFeasible` once the average is feasible; otherwise, it's a
+// vectorised pass over the values, not over the instance.
+//
+// This class is thread-compatible.
+class AverageCoverage {
+ public:
+  AverageCoverage() = default;
+
+  AverageCoverage(const AverageCoverage&) = delete;
+  AverageCoverage& operator=(const AverageCoverage&) = delete;
+
+  // Rebuilds the transposed instance for `constraints`, over
+  // `num_sets` sets, e.g., after sets are added or removed.  The
+  // coverage accumulated so far is preserved.
+  void SetInstance(absl::Span<const CoverConstraint> constraints,
+                   size_t num_sets);
+
+  // Recomputes the coverage for the average of `num_solutions`
+  // solutions that sum to `sum_solutions`, e.g., after restoring a
+  // checkpoint.  See `ComputeCoverage` for `num_threads`.
+  void Reset(absl::Span<const CoverConstraint> constraints,
+             absl::Span<const double> sum_solutions, size_t num_solutions,
+             size_t num_threads = 0);
+
+  // Adds `solution` to the average.  An empty `solution` (e.g., for
+  // an infeasible knapsack) counts as all zeros.
+  void AddSolution(absl::Span<const double> solution);
+
+  // Returns whether the average solution covers every value to at
+  // least 1 - eps.  Always false before the first solution.
+  bool IsFeasible(double eps);
+
+  // Returns the maximum violation of the average solution, 1 - the
+  // minimum coverage, or 0 if there is no value.  Always a pass over
+  // the values.
+  double MaxViolation();
+
+  size_t num_sets() const { return num_sets_; }
+  size_t num_solutions() const { return num_solutions_; }
+  // The sum of the coverage for all solutions, one entry per value.
+  absl::Span<const double> sum_coverage() const { return sum_coverage_; }
+
+ private:
+  size_t num_sets_{0};
+  size_t num_solutions_{0};
+  std::vector<double> sum_coverage_;
+  // A lower bound on `sum_coverage_`, from its last minimum.
+  double min_sum_coverage_lb_{0};
+
+  // The values covered by set `j` are
+  // `set_values_[set_offsets_[j], set_offsets_[j + 1])`.
+  std::vector<size_t> set_offsets_;
+  std::vector<uint32_t> set_values_;
+};
+#endif /* !AVERAGE_COVERAGE_H */
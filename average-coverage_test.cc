@@ -0,0 +1,102 @@
+#include "average-coverage.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+#include "solution-stats.h"
+
+using ::testing::DoubleEq;
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+using ::testing::Pointwise;
+
+namespace {
+TEST(ComputeCoverage, MatchesComputeCoverInfeasibility) {
+  const RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/5000, /*num_values=*/2000,
+                             /*min_set_per_value=*/5,
+                             /*max_set_per_value=*/200, /*seed=*/7);
+  std::vector<double> solution(instance.obj_values.size());
+  for (size_t i = 0; i < solution.size(); ++i) {
+    solution[i] = (i % 7) / 7.0;
+  }
+
+  std::vector<double> expected;
+  std::tie(std::ignore, expected) =
+      ComputeCoverInfeasibility(solution, instance.sets_per_value);
+  for (double& infeasibility : expected) {
+    infeasibility = 1 - infeasibility;
+  }
+
+  // Enough entries for several threads.
+  for (const size_t num_threads : {1, 4}) {
+    std::vector<double> coverage(instance.constraints.size(), -1.0);
+    ComputeCoverage(solution, instance.constraints, num_threads,
+                    absl::MakeSpan(coverage));
+    EXPECT_THAT(coverage, Pointwise(DoubleNear(1e-9), expected));
+  }
+}
+
+TEST(AverageCoverage, Incremental) {
+  const CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({1, 2}),
+  };
+
+  AverageCoverage coverage;
+  coverage.SetInstance(constraints, 3);
+  EXPECT_FALSE(coverage.IsFeasible(0.1));
+
+  const double first[] = {1.0, 0.0, 0.0};
+  coverage.AddSolution(first);
+  EXPECT_THAT(coverage.sum_coverage(), ElementsAre(1.0, 0.0));
+  EXPECT_FALSE(coverage.IsFeasible(0.1));
+  EXPECT_EQ(coverage.MaxViolation(), 1.0);
+
+  const double second[] = {0.0, 0.5, 1.0};
+  coverage.AddSolution(second);
+  EXPECT_THAT(coverage.sum_coverage(), ElementsAre(1.5, 1.5));
+  EXPECT_EQ(coverage.MaxViolation(), 0.25);
+  EXPECT_FALSE(coverage.IsFeasible(0.1));
+  EXPECT_TRUE(coverage.IsFeasible(0.25));
+
+  // Infeasible knapsacks count as empty solutions.
+  coverage.AddSolution({});
+  EXPECT_EQ(coverage.num_solutions(), 3);
+  EXPECT_THAT(coverage.MaxViolation(), DoubleEq(0.5));
+
+  // Recomputing from scratch agrees.
+  const double sum_solutions[] = {1.0, 0.5, 1.0};
+  AverageCoverage reset;
+  reset.SetInstance(constraints, 3);
+  reset.Reset(constraints, sum_solutions, 3);
+  EXPECT_THAT(reset.sum_coverage(), ElementsAre(1.5, 1.5));
+  EXPECT_EQ(reset.num_solutions(), 3);
+}
+
+TEST(AverageCoverage, SetInstancePreservesCoverage) {
+  CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({1, 2}),
+  };
+
+  AverageCoverage coverage;
+  coverage.SetInstance(constraints, 3);
+  const double solution[] = {1.0, 0.0, 1.0};
+  coverage.AddSolution(solution);
+
+  // Drop set 1; set 2 becomes set 1.
+  const uint32_t new_index[] = {0, CoverConstraint::kRemovedTour, 1};
+  for (CoverConstraint& constraint : constraints) {
+    constraint.RemapTours(new_index);
+  }
+
+  coverage.SetInstance(constraints, 2);
+  EXPECT_EQ(coverage.num_sets(), 2);
+  const double next[] = {0.0, 1.0};
+  coverage.AddSolution(next);
+  EXPECT_THAT(coverage.sum_coverage(), ElementsAre(1.0, 2.0));
+  EXPECT_TRUE(coverage.IsFeasible(0.5));
+  EXPECT_FALSE(coverage.IsFeasible(0.25));
+}
+}  // namespace
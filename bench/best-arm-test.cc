@@ -0,0 +1,186 @@
+#include "bench/best-arm-test.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "csm.h"
+#include "martingale-cs.h"
+
+namespace bench {
+BestArmTest::BestArmTest(size_t num_arms, TestParams params)
+    // 2 one-sided martingales on the mean of each arm, and N - 1
+    // outlier rate comparisons against the best arm.  That's the same
+    // 5 tests as `BoundedMeanTest` for 2 arms.
+    : params_(
+          params.SetLogEpsForNTests(3 * std::max<size_t>(1, num_arms) - 1)),
+      sums_(num_arms, 0.0),
+      outliers_(num_arms, 0) {}
+
+void BestArmTest::Observe(absl::Span<const std::vector<double>> cycles) {
+  const double outlier_limit = params_.outlier_limit;
+  const size_t num_arms = sums_.size();
+
+  n_obs_ += cycles.size();
+  for (const std::vector<double>& entry : cycles) {
+    bool any_outlier = false;
+    for (size_t i = 0; i < num_arms; ++i) {
+      if (entry[i] > outlier_limit) {
+        ++outliers_[i];
+        any_outlier = true;
+      }
+    }
+
+    // Same as `BoundedMeanTest`: only sum observations where all arms
+    // are in bounds, so the means are over the same instances.
+    if (!any_outlier) {
+      for (size_t i = 0; i < num_arms; ++i) {
+        sums_[i] += entry[i];
+      }
+
+      ++num_summands_;
+    }
+  }
+}
+
+bool BestArmTest::Done() const {
+  const Result result = Summary();
+  if (params_.stop_on_first.has_value()) {
+    const ComparisonResult wanted = params_.stop_on_first.value();
+    if (wanted == ComparisonResult::kTie) {
+      if (result.mean_result == ComparisonResult::kTie) {
+        return true;
+      }
+    } else if (result.mean_result == wanted ||
+               result.outlier_result == wanted) {
+      return true;
+    }
+  }
+
+  return result.mean_result != ComparisonResult::kInconclusive &&
+         result.outlier_result != ComparisonResult::kInconclusive;
+}
+
+BestArmTest::Result BestArmTest::Summary(std::ostream* out) const {
+  Result ret;
+  const size_t num_arms = sums_.size();
+
+  const double inv_num_summands = 1.0 / std::max<uint64_t>(1, num_summands_);
+  for (double sum : sums_) {
+    ret.means.push_back(sum * inv_num_summands);
+  }
+
+  ret.best = std::min_element(ret.means.begin(), ret.means.end()) -
+             ret.means.begin();
+  ret.n_mean_obs = num_summands_;
+
+  if (num_summands_ == 0 || num_arms == 0) {
+    ret.best = 0;
+    ret.mean_result = ComparisonResult::kInconclusive;
+    ret.mean_slop = params_.outlier_limit;
+    for (size_t i = 0; i < num_arms; ++i) {
+      ret.contenders.push_back(i);
+    }
+  } else {
+    // All arms have the same number of summands, so they share the
+    // same confidence interval width on their mean.
+    const double threshold =
+        martingale_cs_threshold_span(num_summands_, params_.min_count,
+                                     params_.outlier_limit, params_.log_eps);
+    const double slop = threshold * inv_num_summands;
+    ret.mean_slop = slop;
+
+    const double min_diff = params_.min_effect;
+    const double best_mean = ret.means[ret.best];
+    double max_contender_mean = best_mean;
+    for (size_t i = 0; i < num_arms; ++i) {
+      if (best_mean + slop < ret.means[i] - min_diff - slop) {
+        continue;
+      }
+
+      ret.contenders.push_back(i);
+      max_contender_mean = std::max(max_contender_mean, ret.means[i]);
+    }
+
+    if (ret.contenders.size() == 1) {
+      ret.mean_result = ret.best == 0 ? ComparisonResult::kALower
+                                      : ComparisonResult::kAHigher;
+    } else if (max_contender_mean - best_mean + 2 * slop < min_diff) {
+      ret.mean_result = ComparisonResult::kTie;
+    } else {
+      ret.mean_result = ComparisonResult::kInconclusive;
+    }
+  }
+
+  {
+    const double inv_n_obs = 1.0 / std::max<uint64_t>(1, n_obs_);
+    for (uint64_t outliers : outliers_) {
+      ret.outlier_ratios.push_back(inv_n_obs * outliers);
+    }
+
+    ret.total_obs = n_obs_;
+  }
+
+  // Compare the best arm's outlier rate with every other arm's: any
+  // arm with definitely fewer outliers is a reason to doubt the winner.
+  bool any_higher = false;
+  bool any_inconclusive = false;
+  bool any_lower = false;
+  for (size_t i = 0; i < num_arms; ++i) {
+    if (i == ret.best) {
+      continue;
+    }
+
+    const uint64_t best_outliers = outliers_[ret.best];
+    if (ret.outlier_ratios[ret.best] <= params_.min_outlier_ratio &&
+        ret.outlier_ratios[i] <= params_.min_outlier_ratio) {
+      continue;
+    } else if (csm(best_outliers + outliers_[i], 0.5, best_outliers,
+                   params_.log_eps, nullptr) == 0) {
+      any_inconclusive = true;
+    } else if (best_outliers < outliers_[i]) {
+      any_lower = true;
+    } else {
+      any_higher = true;
+    }
+  }
+
+  if (any_higher) {
+    ret.outlier_result = ComparisonResult::kAHigher;
+  } else if (any_inconclusive) {
+    ret.outlier_result = ComparisonResult::kInconclusive;
+  } else if (any_lower) {
+    ret.outlier_result = ComparisonResult::kALower;
+  } else {
+    ret.outlier_result = ComparisonResult::kTie;
+  }
+
+  ret.level = params_.eps;
+  if (out != nullptr) {
+    *out << ret << ".\n";
+  }
+
+  return ret;
+}
+
+std::ostream& operator<<(std::ostream& out, const BestArmTest::Result& result) {
+  out << "BestArmTest " << result.mean_result << ": best=" << result.best
+      << ", means=[";
+  for (size_t i = 0; i < result.means.size(); ++i) {
+    out << (i == 0 ? "" : ", ") << result.means[i];
+  }
+
+  out << "] +/- " << result.mean_slop << ", contenders=[";
+  for (size_t i = 0; i < result.contenders.size(); ++i) {
+    out << (i == 0 ? "" : ", ") << result.contenders[i];
+  }
+
+  out << "] (n=" << result.n_mean_obs << ") -- outliers "
+      << result.outlier_result << ":";
+  for (double ratio : result.outlier_ratios) {
+    out << " " << 100 * ratio << "%";
+  }
+
+  out << " (n=" << result.total_obs << " p < " << result.level << ")";
+  return out;
+}
+}  // namespace bench
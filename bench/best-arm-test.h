@@ -0,0 +1,119 @@
+#ifndef BENCH_BEST_ARM_TEST_H
+#define BENCH_BEST_ARM_TEST_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <tuple>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "bench/test-params.h"
+
+namespace bench {
+// Best-arm identification for `CompareArms`: the N-arm counterpart of
+// `BoundedMeanTest`.
+//
+// Each arm's in-bounds mean (0 <= value <= outlier_limit) gets its own
+// confidence sequence, and an arm is eliminated once its mean is
+// definitely higher than the best arm's, by more than `min_effect`.
+// Once only the best arm remains, the mean result compares arm 0 with
+// it, like A in `BoundedMeanTest`: `kALower` if arm 0 is the winner,
+// and `kAHigher` if arm 0 was eliminated (`best` is the winner).  The
+// mean result is `kTie` if all remaining arms are within `min_effect`
+// of each other.
+// `eps` is split over all arms (Bonferroni), so the false positive
+// rate for the whole comparison is still at most `eps`.
+//
+// Like `BoundedMeanTest`, outliers are compared separately: the
+// outlier result compares the best arm's out of bounds rate with the
+// other arms', and is `kAHigher` if the best arm has definitely more
+// outliers than some other arm.
+//
+// The comparator applies `params.Transform` to the first arm's cycle
+// counts, e.g., to check that a new arm 0 beats the others by 10%.
+//
+// This class is thread-compatible.
+class BestArmTest {
+ public:
+  class Comparator;
+
+  explicit BestArmTest(size_t num_arms, TestParams params = TestParams());
+
+  Comparator comparator() const;
+
+  TestParams params() const { return params_; }
+
+  size_t num_arms() const { return sums_.size(); }
+
+  // Each observation has one value per arm.
+  void Observe(absl::Span<const std::vector<double>> cycles);
+  bool Done() const;
+
+  struct Result {
+    ComparisonResult mean_result;
+    // Index of the arm with the lowest empirical mean.
+    size_t best;
+    // Arms that aren't definitely slower than `best`, including `best`.
+    std::vector<size_t> contenders;
+    std::vector<double> means;
+    double mean_slop;
+    uint64_t n_mean_obs;
+    ComparisonResult outlier_result;
+    std::vector<double> outlier_ratios;
+    uint64_t total_obs;
+    double level;
+
+    bool operator==(const Result& other) const {
+      return std::tie(mean_result, best, contenders, means, mean_slop,
+                      n_mean_obs, outlier_result, outlier_ratios, total_obs,
+                      level) ==
+             std::tie(other.mean_result, other.best, other.contenders,
+                      other.means, other.mean_slop, other.n_mean_obs,
+                      other.outlier_result, other.outlier_ratios,
+                      other.total_obs, other.level);
+    }
+  };
+
+  Result Summary(std::ostream* out = nullptr) const;
+
+ private:
+  const TestParams params_;
+  std::vector<double> sums_;
+  uint64_t num_summands_{0};
+  std::vector<uint64_t> outliers_;
+  uint64_t n_obs_{0};
+};
+
+std::ostream& operator<<(std::ostream& out, const BestArmTest::Result& result);
+
+class BestArmTest::Comparator {
+ public:
+  explicit Comparator(const TestParams& params) : params_(params) {}
+
+  template <typename... T, typename... V>
+  std::vector<double> operator()(
+      const std::vector<std::tuple<uint64_t, T...>>& arms,
+      const V&...) const {
+    std::vector<double> ret;
+    ret.reserve(arms.size());
+    for (const auto& arm : arms) {
+      ret.push_back(std::get<0>(arm));
+    }
+
+    // Like A in `BoundedMeanTest`, the first arm is transformed.
+    if (!ret.empty()) {
+      ret[0] = params_.Transform(ret[0]);
+    }
+
+    return ret;
+  }
+
+ private:
+  const TestParams& params_;
+};
+
+inline BestArmTest::Comparator BestArmTest::comparator() const {
+  return Comparator(params_);
+}
+}  // namespace bench
+#endif /* !BENCH_BEST_ARM_TEST_H */
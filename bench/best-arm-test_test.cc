@@ -0,0 +1,119 @@
+#include "bench/best-arm-test.h"
+
+#include <cstdint>
+#include <iostream>
+#include <random>
+#include <tuple>
+#include <vector>
+
+#include "bench/test-params.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace bench {
+namespace {
+using ::testing::ElementsAre;
+
+// Feeds `test` with observations where arm `i` is uniform in
+// `[lows[i], lows[i] + 98]`, until `test.Done()`.
+void Drive(const std::vector<uint64_t>& lows, BestArmTest* test) {
+  std::random_device dev;
+  std::mt19937 rng(dev());
+
+  std::vector<std::uniform_int_distribution<uint64_t>> dists;
+  for (uint64_t low : lows) {
+    dists.emplace_back(low, low + 98);
+  }
+
+  const auto comparator = test->comparator();
+  for (size_t i = 0; i < 10000; ++i) {
+    for (size_t j = 0; j < 100; ++j) {
+      std::vector<std::tuple<uint64_t>> arms;
+      for (auto& dist : dists) {
+        arms.emplace_back(dist(rng));
+      }
+
+      const std::vector<double> cmps[] = {comparator(arms)};
+      test->Observe(cmps);
+    }
+
+    if (test->Done()) {
+      break;
+    }
+  }
+}
+
+TEST(BestArmTest, Equal) {
+  BestArmTest test(4, TestParams().SetMinEffect(1).SetOutlierLimit(100));
+  Drive({1, 1, 1, 1}, &test);
+
+  EXPECT_TRUE(test.Done());
+  const auto result = test.Summary(&std::cout);
+  EXPECT_EQ(result.mean_result, ComparisonResult::kTie);
+  EXPECT_EQ(result.contenders.size(), 4);
+  EXPECT_EQ(result.outlier_result, ComparisonResult::kTie);
+}
+
+TEST(BestArmTest, ArmZeroWins) {
+  BestArmTest test(4, TestParams().SetMinEffect(1).SetOutlierLimit(100));
+  Drive({0, 2, 2, 2}, &test);
+
+  EXPECT_TRUE(test.Done());
+  const auto result = test.Summary(&std::cout);
+  EXPECT_EQ(result.mean_result, ComparisonResult::kALower);
+  EXPECT_EQ(result.best, 0);
+  EXPECT_THAT(result.contenders, ElementsAre(0));
+  EXPECT_EQ(result.outlier_result, ComparisonResult::kTie);
+}
+
+// Arm 0 is eliminated, so it's definitely higher than the winner.
+TEST(BestArmTest, OtherArmWins) {
+  BestArmTest test(4, TestParams().SetMinEffect(1).SetOutlierLimit(100));
+  Drive({2, 2, 0, 2}, &test);
+
+  EXPECT_TRUE(test.Done());
+  const auto result = test.Summary(&std::cout);
+  EXPECT_EQ(result.mean_result, ComparisonResult::kAHigher);
+  EXPECT_EQ(result.best, 2);
+  EXPECT_THAT(result.contenders, ElementsAre(2));
+  EXPECT_EQ(result.outlier_result, ComparisonResult::kTie);
+}
+
+TEST(BestArmTest, TiedWinners) {
+  BestArmTest test(3, TestParams().SetMinEffect(1).SetOutlierLimit(100));
+  Drive({0, 2, 0}, &test);
+
+  EXPECT_TRUE(test.Done());
+  const auto result = test.Summary(&std::cout);
+  EXPECT_EQ(result.mean_result, ComparisonResult::kTie);
+  EXPECT_THAT(result.contenders, ElementsAre(0, 2));
+}
+
+// The best mean isn't good enough if it comes with many more outliers.
+TEST(BestArmTest, OutliersHigher) {
+  BestArmTest test(3, TestParams().SetMinEffect(1).SetOutlierLimit(100, 0.01));
+  Drive({2, 0, 2}, &test);
+  for (size_t i = 0; i < 100000; ++i) {
+    const std::vector<double> cmps[] = {{50, 1000, 50}, {52, 48, 52}};
+    test.Observe(cmps);
+  }
+
+  EXPECT_TRUE(test.Done());
+  const auto result = test.Summary(&std::cout);
+  EXPECT_EQ(result.best, 1);
+  EXPECT_EQ(result.outlier_result, ComparisonResult::kAHigher);
+}
+
+TEST(BestArmTest, Transform) {
+  // Arm 0 is 2 cycles faster, but we only want it if it's 20% faster.
+  BestArmTest test(
+      3, TestParams().SetMinEffect(3).SetOutlierLimit(150).SetScale(1.2));
+  Drive({0, 2, 2}, &test);
+
+  EXPECT_TRUE(test.Done());
+  const auto result = test.Summary(&std::cout);
+  EXPECT_NE(result.best, 0);
+  EXPECT_THAT(result.contenders, ElementsAre(1, 2));
+}
+}  // namespace
+}  // namespace bench
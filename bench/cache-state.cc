@@ -0,0 +1,118 @@
+#include "bench/cache-state.h"
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <sstream>
+#include <vector>
+
+#include "bench/environment.h"
+
+namespace bench {
+namespace {
+// Used when sysconf doesn't know the cache sizes.
+constexpr size_t kDefaultCacheSize = 32 << 20;
+
+// Co-runners check for cancellation after each chunk of this many
+// words.
+constexpr size_t kWordsPerChunk = 1 << 16;
+
+const std::vector<char>& EvictionBuffer() {
+  // Leaked, like the rest of the harness's global state: pooled
+  // threads may still evict during shutdown.
+  static const auto& buffer =
+      *new std::vector<char>(2 * LastLevelCacheSize(), 1);
+  return buffer;
+}
+
+void StreamUntilCancelled(int cpu, size_t buffer_size) {
+  std::vector<int> saved_affinity;
+  if (cpu >= 0) {
+    saved_affinity = GetThreadAffinity();
+    SetThreadAffinity({cpu});
+  }
+
+  {
+    std::vector<uint64_t> buffer(
+        std::max<size_t>(kWordsPerChunk, buffer_size / sizeof(uint64_t)));
+    size_t begin = 0;
+    while (!internal::PooledThread::Cancelled()) {
+      const size_t end = std::min(begin + kWordsPerChunk, buffer.size());
+      for (size_t i = begin; i < end; ++i) {
+        ++buffer[i];
+      }
+
+      begin = (end == buffer.size()) ? 0 : end;
+    }
+  }
+
+  // Pooled threads are reused: don't leave them pinned.
+  if (!saved_affinity.empty()) {
+    SetThreadAffinity(saved_affinity);
+  }
+}
+}  // namespace
+
+absl::optional<CacheState> ParseCacheState(absl::string_view name) {
+  for (CacheState state : {CacheState::kHot, CacheState::kEvictLlc}) {
+    std::ostringstream out;
+    out << state;
+    if (out.str() == name) {
+      return state;
+    }
+  }
+
+  return absl::nullopt;
+}
+
+size_t LastLevelCacheSize() {
+  for (int name : {_SC_LEVEL4_CACHE_SIZE, _SC_LEVEL3_CACHE_SIZE,
+                   _SC_LEVEL2_CACHE_SIZE}) {
+    const long size = sysconf(name);
+    if (size > 0) {
+      return size;
+    }
+  }
+
+  return kDefaultCacheSize;
+}
+
+void EvictLastLevelCache() {
+  const std::vector<char>& buffer = EvictionBuffer();
+  char sum = 0;
+  for (size_t i = 0; i < buffer.size(); i += ABSL_CACHELINE_SIZE) {
+    sum += buffer[i];
+  }
+
+  // Make sure the reads happen.
+  asm volatile("" ::"r"(sum));
+}
+
+void ApplyCacheState(CacheState state) {
+  switch (state) {
+    case CacheState::kHot:
+      break;
+    case CacheState::kEvictLlc:
+      EvictLastLevelCache();
+      break;
+  }
+}
+
+BandwidthPressure::BandwidthPressure(absl::Span<const int> cpus,
+                                     size_t buffer_size) {
+  threads_.reserve(cpus.size());
+  for (int cpu : cpus) {
+    threads_.emplace_back(
+        [cpu, buffer_size] { StreamUntilCancelled(cpu, buffer_size); });
+  }
+}
+
+BandwidthPressure::~BandwidthPressure() {
+  for (internal::PooledThread& thread : threads_) {
+    thread.Cancel();
+  }
+
+  // `~PooledThread` waits for the co-runners.
+  threads_.clear();
+}
+}  // namespace bench
@@ -0,0 +1,76 @@
+#ifndef BENCH_CACHE_STATE_H
+#define BENCH_CACHE_STATE_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "bench/internal/pooled-thread.h"
+#include "bench/test-params.h"
+
+// Cache and memory bandwidth conditions for comparisons of code that
+// works on inputs far bigger than the last level cache.
+namespace bench {
+// Parses a `CacheState` as printed by `operator<<`, e.g., "evict_llc".
+absl::optional<CacheState> ParseCacheState(absl::string_view name);
+
+// Returns the size of the last level cache, in bytes, or a guess if
+// the C library doesn't know.
+size_t LastLevelCacheSize();
+
+// Reads a buffer twice the size of the last level cache, which evicts
+// most (not necessarily all, with adaptive replacement policies) of
+// the lines cached before the call.  The buffer is shared by all
+// threads, and allocated on the first call.
+void EvictLastLevelCache();
+
+// Brings the caches to `state`; `kHot` does nothing.
+void ApplyCacheState(CacheState state);
+
+// Flushes the cache lines that overlap `[data, data + size)` out of
+// the whole cache hierarchy, and waits for the flushes to complete.
+//
+// This function is inline so that `Prep` functions in shared objects
+// can flush their instance without linking in the harness.
+inline void FlushRange(const void* data, size_t size) {
+#ifdef __x86_64__
+  const uintptr_t end = reinterpret_cast<uintptr_t>(data) + size;
+  for (uintptr_t line = reinterpret_cast<uintptr_t>(data) &
+                        ~uintptr_t{ABSL_CACHELINE_SIZE - 1};
+       line < end; line += ABSL_CACHELINE_SIZE) {
+    asm volatile("clflush (%0)" ::"r"(line) : "memory");
+  }
+
+  asm volatile("mfence" ::: "memory");
+#endif
+}
+
+// Generates background memory bandwidth pressure: each co-runner
+// thread increments every word of its own buffer, in a loop, until
+// the `BandwidthPressure` object is destroyed.
+//
+// This class is thread-compatible.
+class BandwidthPressure {
+ public:
+  // Starts one co-runner for each element of `cpus`, pinned to that
+  // CPU if non-negative.  Each co-runner streams over `buffer_size`
+  // bytes, by default four times the last level cache.
+  explicit BandwidthPressure(absl::Span<const int> cpus,
+                             size_t buffer_size = 4 * LastLevelCacheSize());
+
+  // Stops the co-runners.
+  ~BandwidthPressure();
+
+  BandwidthPressure(const BandwidthPressure&) = delete;
+  BandwidthPressure& operator=(const BandwidthPressure&) = delete;
+
+  size_t num_threads() const { return threads_.size(); }
+
+ private:
+  std::vector<internal::PooledThread> threads_;
+};
+}  // namespace bench
+#endif /* !BENCH_CACHE_STATE_H */
@@ -0,0 +1,79 @@
+#include "bench/cache-state.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "bench/time.h"
+#include "gtest/gtest.h"
+
+namespace bench {
+namespace {
+TEST(CacheState, ParseRoundTrip) {
+  for (CacheState state : {CacheState::kHot, CacheState::kEvictLlc}) {
+    std::ostringstream name;
+    name << state;
+    EXPECT_EQ(ParseCacheState(name.str()), state);
+  }
+
+  EXPECT_FALSE(ParseCacheState("lukewarm").has_value());
+}
+
+TEST(CacheState, LastLevelCacheSize) {
+  std::cout << "LLC " << LastLevelCacheSize() << " bytes" << std::endl;
+  EXPECT_GE(LastLevelCacheSize(), 1 << 16);
+}
+
+// Returns the median number of cycles to load `*x` after calling
+// `setup`.
+template <typename Setup>
+uint64_t MedianLoadCycles(const volatile int* x, Setup setup) {
+  std::vector<uint64_t> cycles;
+  for (size_t i = 0; i < 101; ++i) {
+    setup();
+    const uint64_t begin = GetTicksBegin();
+    *x;
+    const uint64_t end = GetTicksEnd();
+    cycles.push_back(end - begin);
+  }
+
+  std::nth_element(cycles.begin(), cycles.begin() + cycles.size() / 2,
+                   cycles.end());
+  return cycles[cycles.size() / 2];
+}
+
+// Quality of implementation: loading flushed data should take longer
+// than loading hot data.
+TEST(CacheState, FlushRangeIsCold) {
+  std::vector<int> data(1024, 42);
+  const uint64_t hot = MedianLoadCycles(&data[500], [] {});
+  const uint64_t flushed = MedianLoadCycles(
+      &data[500], [&data] { FlushRange(&data[400], 1000); });
+
+  std::cout << "Hot " << hot << ", flushed " << flushed << std::endl;
+  EXPECT_GT(flushed, hot);
+  EXPECT_EQ(std::count(data.begin(), data.end(), 42), data.size());
+}
+
+TEST(CacheState, EvictAndApply) {
+  // Allocates the eviction buffer.
+  EvictLastLevelCache();
+  ApplyCacheState(CacheState::kHot);
+  ApplyCacheState(CacheState::kEvictLlc);
+}
+
+TEST(CacheState, BandwidthPressureStops) {
+  {
+    BandwidthPressure pressure({-1, -1}, /*buffer_size=*/1 << 20);
+    EXPECT_EQ(pressure.num_threads(), 2);
+    absl::SleepFor(absl::Milliseconds(10));
+  }
+
+  BandwidthPressure none({});
+  EXPECT_EQ(none.num_threads(), 0);
+}
+}  // namespace
+}  // namespace bench
@@ -0,0 +1,428 @@
+#ifndef BENCH_COMPARE_ARMS_H
+#define BENCH_COMPARE_ARMS_H
+// The `CompareArms` overloads defined in this header generalise
+// `CompareFunctions` from an A/B comparison to N "arms," e.g., the
+// scalar, AVX2, and fused versions of a kernel:
+//
+//  1. Generate an input `instance` with the `generator()`
+//  2. Call the timing function for every arm on that instance, in a
+//     fresh random order.
+//  3. Compare the results with `comparator(arms, instance...)`, where
+//     `arms` is a `std::vector<std::tuple<uint64_t, fn_result...>>`
+//     indexed by arm, and the first element of each tuple is the
+//     cycle timing.
+//
+// Timing every arm on the same instances avoids the O(N^2) pairwise
+// A/B runs, each with its own instances.  See `BestArmTest` in
+// best-arm-test.h for an analysis that stops as soon as one arm is
+// definitely the fastest.
+//
+// Everything else (worker threads, pinning, cache states, dropping
+// data points after preemption) works as in `CompareFunctions`.
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "absl/base/optimization.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/types/span.h"
+#include "absl/utility/utility.h"
+#include "bench/cache-state.h"
+#include "bench/compare-functions.h"
+#include "bench/internal/meta.h"
+#include "bench/internal/pooled-thread.h"
+#include "bench/test-params.h"
+#include "bench/time.h"
+#include "prng.h"
+
+namespace bench {
+// General case: `params` specify the behaviour of the harness,
+// `generator` generates instances, and each of the `arms` (timing
+// functions of the same type, e.g., from `MakeTimingFunction` or
+// `ExtractTimingFunction`) accepts the instances and returns a
+// processing time and a return value.  `comparator` converts the arms'
+// results to the format expected by `analysis`.
+//
+// Any ABI mismatch in the arms will cause an immediate `abort()`.
+template <typename Generator, typename TimingFn, typename Comparator,
+          typename Analysis>
+auto CompareArms(const TestParams& params, Generator generator,
+                 std::vector<TimingFn> arms, Comparator comparator,
+                 Analysis* analysis) ->
+    typename std::enable_if<
+        internal::IsTimingFunctionForGenerator<Generator, TimingFn>::value,
+        decltype(analysis->Done(),
+                 analysis->Summary(std::declval<std::ostream*>()))>::type;
+
+// In this overload, `analysis->params()` provides the test parameters,
+// and `analysis->comparator()` the comparator.
+template <typename Generator, typename TimingFn, typename Analysis>
+auto CompareArms(Generator generator, std::vector<TimingFn> arms,
+                 Analysis* analysis) ->
+    typename std::enable_if<
+        internal::IsTimingFunctionForGenerator<Generator, TimingFn>::value,
+        decltype(analysis->params(), analysis->comparator(),
+                 analysis->Done(),
+                 analysis->Summary(std::declval<std::ostream*>()))>::type {
+  return CompareArms(analysis->params(), std::move(generator),
+                     std::move(arms), analysis->comparator(), analysis);
+}
+
+namespace internal {
+// The N-arm counterpart of `StatisticGenerator`.
+template <typename Generator, typename TimingFn, typename Comparator>
+class ArmStatisticGenerator {
+  using GenResult =
+      decltype(CallAndTuplify()(std::declval<Generator>(), std::make_tuple()));
+  using FnResult = decltype(CallAndTuplify()(std::declval<TimingFn>(),
+                                             std::tuple<const GenResult*>()));
+
+  static_assert(
+      IsValidResult<FnResult>::value,
+      "The result of timing functions must be a TimedResult<tuple<...>>.");
+
+  // The timing function's return value, and the tuple we pass to the
+  // comparator for each arm.
+  using Timed = typename std::tuple_element<0, FnResult>::type;
+  using ArmResult = typename IsValidResult<FnResult>::ResultTuple;
+
+  using Result = decltype(absl::apply(
+      std::declval<Comparator>(),
+      std::tuple_cat(std::make_tuple(std::declval<std::vector<ArmResult>>()),
+                     std::declval<GenResult>())));
+
+ public:
+  // Same targets as `StatisticGenerator`.
+  static constexpr uint64_t kTargetCyclePerRun = 1000 * 1000 * 1000ULL;
+  static constexpr size_t kMaxBufferSize = 200;
+  static constexpr uint64_t kMinObservations = 500;
+
+  explicit ArmStatisticGenerator(Generator generator,
+                                 std::vector<TimingFn> arms,
+                                 Comparator comparator);
+
+  // Sets the state of the caches before each call to an arm.  Only
+  // takes effect in the next call to `Start()`.
+  void SetCacheState(CacheState state) { context_.cache_state = state; }
+
+  // (Re)creates internal worker threads.  If `cpus` is non-empty,
+  // worker `i` (the calling thread is thread 0) is pinned to `cpus[i]`.
+  void Start(size_t num_threads, absl::Span<const int> cpus = {});
+
+  // Notifies all worker threads to stop and waits for them to
+  // publish what they have.
+  void Stop();
+
+  // Returns the accumulated `Result`s, after generating a buffer in
+  // the calling thread if there were none.
+  std::vector<std::vector<Result>> Consume();
+
+  // The thread-private state of each worker thread.
+  struct Context {
+    explicit Context(Generator generator_, std::vector<TimingFn> arms_,
+                     Comparator comparator_)
+        : generator(std::move(generator_)),
+          arms(std::move(arms_)),
+          comparator(std::move(comparator_)) {
+      for (size_t i = 0; i < arms.size(); ++i) {
+        order.push_back(i);
+      }
+
+      position.resize(arms.size());
+      timed.reserve(arms.size());
+    }
+
+    Generator generator;
+    std::vector<TimingFn> arms;
+    Comparator comparator;
+    xs256 prng;
+    CacheState cache_state{CacheState::kHot};
+
+    // Scratch space for `WorkImpl`: `order[i]` is the i-th arm we
+    // call, and `timed[position[arm]]` its result.
+    std::vector<size_t> order;
+    std::vector<size_t> position;
+    std::vector<Timed> timed;
+
+    ResultBuffer<Result> buffer;
+  };
+
+ private:
+  // Generates one full buffer's worth of comparison `Result`s in
+  // `context`.
+  static void Work(Context* context);
+
+  // Times every arm on one instance, and returns the last cycle
+  // timestamp observed.
+  static uint64_t WorkImpl(Context* context);
+
+  // Adds the results in `context->timed` to `context->buffer`, unless
+  // they're tainted.
+  static void Publish(GenResult&& work_unit, bool interrupted,
+                      Context* context);
+
+  // Repeatedly calls `Work` and `Flush` until `Stop()` is called,
+  // pinned to `cpu` if non-negative.
+  static void WorkerFn(Context context, Accumulator<Result>* acc, int cpu);
+
+  std::vector<internal::PooledThread> workers_;
+
+  Context context_;
+  Accumulator<Result> acc_;
+};
+
+template <typename Generator, typename TimingFn, typename Comparator>
+constexpr uint64_t
+    ArmStatisticGenerator<Generator, TimingFn, Comparator>::kTargetCyclePerRun;
+
+template <typename Generator, typename TimingFn, typename Comparator>
+constexpr size_t
+    ArmStatisticGenerator<Generator, TimingFn, Comparator>::kMaxBufferSize;
+
+template <typename Generator, typename TimingFn, typename Comparator>
+constexpr uint64_t
+    ArmStatisticGenerator<Generator, TimingFn, Comparator>::kMinObservations;
+
+template <typename Generator, typename TimingFn, typename Comparator>
+__attribute__((__noinline__))
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::ArmStatisticGenerator(
+    Generator generator, std::vector<TimingFn> arms, Comparator comparator)
+    : context_(std::move(generator), std::move(arms), std::move(comparator)) {}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+__attribute__((__noinline__)) void
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::Start(
+    size_t num_threads, absl::Span<const int> cpus) {
+  workers_.clear();
+  if (num_threads <= 1) {
+    return;
+  }
+
+  workers_.reserve(num_threads - 1);
+  for (size_t i = 1; i < num_threads; ++i) {
+    Context context(context_);
+    auto* acc_ptr = &acc_;
+    const int cpu = (i < cpus.size()) ? cpus[i] : -1;
+    workers_.emplace_back(
+        [context, acc_ptr, cpu] { WorkerFn(context, acc_ptr, cpu); });
+  }
+}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+__attribute__((__noinline__)) void
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::Stop() {
+  for (auto& worker : workers_) {
+    worker.Cancel();
+  }
+
+  workers_.clear();
+}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+__attribute__((__noinline__)) auto
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::Consume()
+    -> std::vector<std::vector<Result>> {
+  using std::swap;
+
+  std::vector<std::vector<Result>> ret;
+  {
+    absl::MutexLock ml(&acc_.mu);
+    if (!acc_.buffers.empty()) {
+      swap(ret, acc_.buffers);
+      return ret;
+    }
+  }
+
+  Work(&context_);
+  Flush(&context_.buffer, &acc_);
+
+  {
+    absl::MutexLock ml(&acc_.mu);
+    swap(ret, acc_.buffers);
+  }
+
+  return ret;
+}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+/*static*/ __attribute__((__noinline__)) void
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::Work(
+    Context* context) {
+  context->buffer.buffer.reserve(context->buffer.buffer.size() +
+                                 kMaxBufferSize);
+  // Always drop the first set of values, they're potentially
+  // tainted by the rest of the framework.
+  context->buffer.tainted = true;
+
+  const uint64_t actual_cycle_limit = GetTicksBegin() + kTargetCyclePerRun;
+  // Only apply the cycle limit after the first set of values, which is
+  // always dropped.
+  uint64_t cycle_limit = std::numeric_limits<uint64_t>::max();
+  while (context->buffer.buffer.size() < kMaxBufferSize) {
+    if (WorkImpl(context) > cycle_limit) {
+      return;
+    }
+
+    cycle_limit = actual_cycle_limit;
+  }
+}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+/*static*/ __attribute__((__noinline__)) uint64_t
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::WorkImpl(
+    Context* context) {
+  using std::swap;
+
+  const CallAndTuplify apply;
+  const size_t num_arms = context->arms.size();
+  auto work_unit = apply(context->generator, std::make_tuple());
+
+  // A fresh random order for each instance averages out the effect of
+  // call order on each arm.  This also covers the codegen accidents
+  // that `StatisticGenerator` evens out with two `WorkImpl`s.
+  std::vector<size_t>& order = context->order;
+  for (size_t i = num_arms; i > 1; --i) {
+    swap(order[i - 1], order[context->prng.Uniform(i)]);
+  }
+
+  context->timed.clear();
+
+  const bool cold =
+      ABSL_PREDICT_FALSE(context->cache_state != CacheState::kHot);
+  if (cold) {
+    ApplyCacheState(context->cache_state);
+  }
+
+  SetupInterruptDetection();
+
+  bool interrupted = false;
+  for (size_t i = 0; i < num_arms; ++i) {
+    if (cold && i > 0) {
+      interrupted =
+          ResetCacheStateBetweenCalls(context->cache_state) || interrupted;
+    }
+
+    context->timed.push_back(context->arms[order[i]](&work_unit));
+  }
+
+  uint64_t ret = 0;
+  for (const Timed& timed : context->timed) {
+    ret = std::max(ret, timed.end);
+  }
+
+  Publish(std::move(work_unit), interrupted, context);
+  return ret;
+}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+/*static*/ __attribute__((__noinline__)) void
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::Publish(
+    GenResult&& work_unit, bool interrupted, Context* context) {
+  interrupted = InterruptDetected() || interrupted;
+
+  // The calls happened in `order`: their timestamps must increase.
+  bool in_order = true;
+  uint64_t previous = 0;
+  for (const Timed& timed : context->timed) {
+    in_order = in_order && previous <= timed.begin && timed.begin <= timed.end;
+    previous = timed.end;
+  }
+
+  ResultBuffer<Result>* buffer = &context->buffer;
+  ++buffer->total;
+  if (interrupted || !in_order) {
+    ++buffer->dropped;
+    buffer->tainted = true;
+    return;
+  }
+
+  if (buffer->tainted) {
+    buffer->tainted = false;
+    return;
+  }
+
+  const size_t num_arms = context->arms.size();
+  for (size_t i = 0; i < num_arms; ++i) {
+    context->position[context->order[i]] = i;
+  }
+
+  std::vector<ArmResult> arms;
+  arms.reserve(num_arms);
+  for (size_t arm = 0; arm < num_arms; ++arm) {
+    Timed& timed = context->timed[context->position[arm]];
+    arms.push_back(std::tuple_cat(std::make_tuple(timed.end - timed.begin),
+                                  std::move(timed.result)));
+  }
+
+  buffer->buffer.push_back(absl::apply(
+      context->comparator,
+      std::tuple_cat(std::make_tuple(std::move(arms)), std::move(work_unit))));
+}
+
+template <typename Generator, typename TimingFn, typename Comparator>
+/*static*/ __attribute__((__noinline__)) void
+ArmStatisticGenerator<Generator, TimingFn, Comparator>::WorkerFn(
+    Context context, Accumulator<Result>* acc, int cpu) {
+  std::vector<int> saved_affinity;
+  if (cpu >= 0) {
+    saved_affinity = GetThreadAffinity();
+    SetThreadAffinity({cpu});
+  }
+
+  while (!PooledThread::Cancelled()) {
+    Work(&context);
+    Flush(&context.buffer, acc);
+  }
+
+  // Pooled threads outlive the comparison: don't leave them pinned.
+  if (!saved_affinity.empty()) {
+    SetThreadAffinity(saved_affinity);
+  }
+}
+}  // namespace internal
+
+template <typename Generator, typename TimingFn, typename Comparator,
+          typename Analysis>
+auto CompareArms(const TestParams& params, Generator generator,
+                 std::vector<TimingFn> arms, Comparator comparator,
+                 Analysis* analysis) ->
+    typename std::enable_if<
+        internal::IsTimingFunctionForGenerator<Generator, TimingFn>::value,
+        decltype(analysis->Done(),
+                 analysis->Summary(std::declval<std::ostream*>()))>::type {
+  // Initialize the overhead estimate so it's fast to acquire, and
+  // to trigger side effects like warning in non-release builds.
+  GetTicksOverhead();
+
+  // Noisily stop the analysis on obvious ABI mismatches.
+  bool all_valid = !arms.empty();
+  if (arms.empty()) {
+    std::cerr << "CompareArms needs at least one arm." << std::endl;
+  }
+
+  for (size_t i = 0; i < arms.size(); ++i) {
+    if (!arms[i].IsValid()) {
+      std::cerr << "ABI mismatch between harness and arm " << i << "."
+                << std::endl;
+      all_valid = false;
+    }
+  }
+
+  if (!all_valid) {
+    abort();
+    return analysis->Summary(&std::clog);
+  }
+
+  internal::ArmStatisticGenerator<Generator, TimingFn, Comparator> stat_gen(
+      std::move(generator), std::move(arms), std::move(comparator));
+
+  return internal::DriveComparison(params, &stat_gen, analysis);
+}
+}  // namespace bench
+#endif /* !BENCH_COMPARE_ARMS_H */
@@ -0,0 +1,120 @@
+#include "bench/compare-arms.h"
+
+#include <cstdint>
+#include <iostream>
+#include <tuple>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "bench/best-arm-test.h"
+#include "bench/test-params.h"
+#include "bench/timing-function.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+namespace bench {
+namespace {
+using ::testing::Contains;
+using ::testing::Not;
+
+class DummyAnalysis {
+ public:
+  bool Done() const { return false; }
+
+  void Observe(absl::Span<const std::vector<double>> cycles) {
+    for (const auto& arms : cycles) {
+      EXPECT_EQ(arms.size(), 3);
+      if (++count_ < 10) {
+        std::cout << "Arms " << arms[0] << " " << arms[1] << " " << arms[2]
+                  << "\n";
+      }
+    }
+  }
+
+  void Summary(std::ostream*) {}
+
+ private:
+  size_t count_{0};
+};
+
+const auto Generator = [] { return std::vector<int>{1, 2, 3}; };
+using TimingFn = TimingFunction<std::tuple<size_t>, decltype(Generator)>;
+
+std::vector<TimingFn> MakeArms() {
+  return {
+      MakeTimingFunction<decltype(Generator)>(
+          [](const std::vector<int>& x) -> size_t { return 0; }),
+      MakeTimingFunction<decltype(Generator)>(
+          [](const std::vector<int>& x) -> size_t { return x.size() - 1; }),
+      MakeTimingFunction<decltype(Generator)>(
+          [](const std::vector<int>& x) -> size_t { return x[0]; }),
+  };
+}
+
+// The comparator sees each arm's result, in the arms' order, even
+// though they're called in a random order.
+std::vector<double> CheckResults(
+    const std::vector<std::tuple<uint64_t, size_t>>& arms,
+    const std::vector<int>& x) {
+  EXPECT_EQ(std::get<1>(arms[0]), 0);
+  EXPECT_EQ(std::get<1>(arms[1]), x.size() - 1);
+  EXPECT_EQ(std::get<1>(arms[2]), x[0]);
+
+  std::vector<double> ret;
+  for (const auto& arm : arms) {
+    ret.push_back(std::get<0>(arm));
+  }
+
+  return ret;
+}
+
+TEST(CompareArms, SmokeTest) {
+  DummyAnalysis analysis;
+  CompareArms(TestParams().SetMaxComparisons(10).SetNumThreads(1), Generator,
+              MakeArms(), CheckResults, &analysis);
+}
+
+TEST(CompareArms, WithThreads) {
+  DummyAnalysis analysis;
+  CompareArms(TestParams().SetMaxComparisons(200).SetNumThreads(4), Generator,
+              MakeArms(), CheckResults, &analysis);
+}
+
+TEST(CompareArms, ColdCacheWithPressure) {
+  DummyAnalysis analysis;
+  CompareArms(TestParams()
+                  .SetMaxComparisons(20)
+                  .SetNumThreads(2)
+                  .SetPinThreads(true)
+                  .SetCacheState(CacheState::kEvictLlc)
+                  .SetBandwidthPressure(1),
+              Generator, MakeArms(), CheckResults, &analysis);
+}
+
+const auto FastNop = [] {};
+
+TEST(CompareArms, BestArmEliminatesSlowArm) {
+  using NopFn = TimingFunction<std::tuple<>, decltype(FastNop)>;
+  const NopFn fast = MakeTimingFunction<decltype(FastNop)>(FastNop);
+  const NopFn slow = MakeTimingFunction<decltype(FastNop)>(
+      []() __attribute__((__noinline__)) {
+        long rax = 42;
+        long rdx = 45;
+        long rcx = 100000;
+        asm volatile("divq %2" : "+a"(rax), "+d"(rdx), "+c"(rcx));
+      });
+
+  BestArmTest test(3, StrictTestParams()
+                          .SetMaxComparisons(10000000)
+                          .SetMinEffect(3)
+                          .SetOutlierLimit(200, 1e-4)
+                          .SetNumThreads(1));
+
+  const auto result = CompareArms(
+      FastNop, std::vector<NopFn>{slow, fast, fast}, &test);
+  EXPECT_EQ(result, test.Summary());
+  EXPECT_NE(result.best, 0);
+  EXPECT_THAT(result.contenders, Not(Contains(0)));
+}
+}  // namespace
+}  // namespace bench
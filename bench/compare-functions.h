@@ -46,17 +46,26 @@
 //     noinline, and code alignment.
 //
 // The test harness thus offers a consistent "hot" execution
-// environment. When we're interested in the behaviour of cold code,
-// the `Prep` functions must actively setup a cold
-// (micro)architectural state.
+// environment by default. `TestParams::SetCacheState` instead evicts
+// the last level cache before each call to a timing function, and
+// `TestParams::SetBandwidthPressure` runs co-runners that compete for
+// memory bandwidth.  For any other cold (micro)architectural state,
+// the `Prep` functions must actively set it up, e.g., with
+// `FlushRange` in cache-state.h.
 //
 // The analysis is called in the thread that called `CompareFunctions`,
 // with `Observe()` on a list of results returned by `comparator`,
-// until `Done()` returns true. `CompareFunctions` then finally returns the
-// value returned by `analysis->Summary(&std::clog)`.
+// until `Done()` returns true. `CompareFunctions` then logs an
+// `EnvironmentReport` (pinning, governor, turbo, and frequency
+// stability) to `std::clog`, and finally returns the value returned by
+// `analysis->Summary(&std::clog)`.
+//
+// On shared hosts, `TestParams::SetPinThreads` reduces noise by
+// pinning each data generation thread to its own physical core.
 
 #include <assert.h>
 
+#include <algorithm>
 #include <cstddef>
 #include <cstdint>
 #include <cstdlib>
@@ -76,6 +85,8 @@
 #include "absl/time/clock.h"
 #include "absl/time/time.h"
 #include "absl/types/span.h"
+#include "bench/cache-state.h"
+#include "bench/environment.h"
 #include "bench/internal/constructable-array.h"
 #include "bench/internal/meta.h"
 #include "bench/internal/pooled-thread.h"
@@ -279,8 +290,13 @@ class StatisticGenerator {
   explicit StatisticGenerator(Generator generator, FnA fn_a, FnB fn_b,
                               Comparator comparator);
 
-  // (Re)creates internal worker threads.
-  void Start(size_t num_threads);
+  // Sets the state of the caches before each call to A or B.  Only
+  // takes effect in the next call to `Start()`.
+  void SetCacheState(CacheState state) { context_.cache_state = state; }
+
+  // (Re)creates internal worker threads.  If `cpus` is non-empty,
+  // worker `i` (the calling thread is thread 0) is pinned to `cpus[i]`.
+  void Start(size_t num_threads, absl::Span<const int> cpus = {});
 
   // Notifies all worker threads to stop and waits for them to
   // publish what they have.
@@ -306,6 +322,7 @@ class StatisticGenerator {
     FnB fn_b;
     Comparator comparator;
     xs256 prng;
+    CacheState cache_state{CacheState::kHot};
 
     ResultBuffer<Result> buffer;
   };
@@ -332,8 +349,8 @@ class StatisticGenerator {
   static uint64_t WorkImpl(Context* context);
 
   // Repeatedly calls `Work` and `Flush` until `Stop()` is called and
-  // notifies `done`.
-  static void WorkerFn(Context context, Accumulator<Result>* acc);
+  // notifies `done`, pinned to `cpu` if non-negative.
+  static void WorkerFn(Context context, Accumulator<Result>* acc, int cpu);
 
   std::vector<internal::PooledThread> workers_;
 
@@ -362,7 +379,8 @@ StatisticGenerator<Generator, FnA, FnB, Comparator>::StatisticGenerator(
 
 template <typename Generator, typename FnA, typename FnB, typename Comparator>
 __attribute__((__noinline__)) void
-StatisticGenerator<Generator, FnA, FnB, Comparator>::Start(size_t num_threads) {
+StatisticGenerator<Generator, FnA, FnB, Comparator>::Start(
+    size_t num_threads, absl::Span<const int> cpus) {
   workers_.clear();
   if (num_threads <= 1) {
     return;
@@ -372,7 +390,9 @@ StatisticGenerator<Generator, FnA, FnB, Comparator>::Start(size_t num_threads) {
   for (size_t i = 1; i < num_threads; ++i) {
     Context context(context_);
     auto* acc_ptr = &acc_;
-    workers_.emplace_back([context, acc_ptr] { WorkerFn(context, acc_ptr); });
+    const int cpu = (i < cpus.size()) ? cpus[i] : -1;
+    workers_.emplace_back(
+        [context, acc_ptr, cpu] { WorkerFn(context, acc_ptr, cpu); });
   }
 }
 
@@ -409,16 +429,28 @@ __attribute__((__noinline__)) void Flush(ResultBuffer<Result>* buffer,
   acc->buffers.push_back(std::move(new_buffer));
 }
 
+// Resets the caches to a cold `state` between the calls to A and B.
+// A reset takes milliseconds, so it happens outside interrupt
+// detection: returns whether the first call was interrupted.
+__attribute__((__noinline__)) inline bool ResetCacheStateBetweenCalls(
+    CacheState state) {
+  const bool interrupted = InterruptDetected();
+  ApplyCacheState(state);
+  SetupInterruptDetection();
+  return interrupted;
+}
+
 // Shared tail-end of WorkImpl.  We assume there's only one result
-// in each ConstructableArray.
+// in each ConstructableArray.  `interrupted` is true if we already
+// know the first call was interrupted.
 template <typename GenResult, typename Comparator, typename FnAResult,
           typename FnBResult, typename Result>
 __attribute__((__noinline__)) uint64_t PublishResults(
     GenResult&& work_unit,
     ConstructableArray<std::tuple<internal::TimedResult<FnAResult>>, 1>* as,
     ConstructableArray<std::tuple<internal::TimedResult<FnBResult>>, 1>* bs,
-    Comparator* comparator, ResultBuffer<Result>* buffer) {
-  const bool interrupted = InterruptDetected();
+    Comparator* comparator, ResultBuffer<Result>* buffer, bool interrupted) {
+  interrupted = InterruptDetected() || interrupted;
   const uint64_t ret =
       std::max(std::get<0>(as->back()).end, std::get<0>(bs->back()).end);
 
@@ -542,77 +574,98 @@ StatisticGenerator<Generator, FnA, FnB, Comparator>::WorkImpl(
 
   auto work_unit = apply(context->generator, std::make_tuple());
 
+  // Cold cache states are the rare case: keep the hot path tight.
+  const bool cold =
+      ABSL_PREDICT_FALSE(context->cache_state != CacheState::kHot);
+  if (cold) {
+    ApplyCacheState(context->cache_state);
+  }
+
   SetupInterruptDetection();
 
+  bool interrupted = false;
   if (kCallAFirst) {
     // `ExplicitFunction::operator()` is always_inline and already
     // includes padding before the indirect call to make sure they get
     // their own cache line, and thus prediction slot (hopefully).
     results.a.EmplaceAt(0, context->fn_a(&work_unit));
+    if (cold) {
+      interrupted = ResetCacheStateBetweenCalls(context->cache_state);
+    }
     results.b.EmplaceAt(0, context->fn_b(&work_unit));
     static_assert(kResultsPerCall == 1,
                   "kResultsPerCall must match number of results exactly.");
   } else {
     // Same thing, but mirrored.
     results.b.EmplaceAt(0, context->fn_b(&work_unit));
+    if (cold) {
+      interrupted = ResetCacheStateBetweenCalls(context->cache_state);
+    }
     results.a.EmplaceAt(0, context->fn_a(&work_unit));
     static_assert(kResultsPerCall == 1,
                   "kResultsPerCall must match number of results exactly.");
   }
 
   return PublishResults(std::move(work_unit), &results.a, &results.b,
-                        &context->comparator, &context->buffer);
+                        &context->comparator, &context->buffer, interrupted);
 }
 
 template <typename Generator, typename FnA, typename FnB, typename Comparator>
 /*static*/ __attribute__((__noinline__)) void
 StatisticGenerator<Generator, FnA, FnB, Comparator>::WorkerFn(
-    Context context, Accumulator<Result>* acc) {
+    Context context, Accumulator<Result>* acc, int cpu) {
+  std::vector<int> saved_affinity;
+  if (cpu >= 0) {
+    saved_affinity = GetThreadAffinity();
+    SetThreadAffinity({cpu});
+  }
+
   while (!PooledThread::Cancelled()) {
     Work(&context);
     Flush(&context.buffer, acc);
   }
-}
-}  // namespace internal
 
-template <typename Generator, typename TimingFnA, typename TimingFnB,
-          typename Comparator, typename Analysis>
-auto CompareFunctions(const TestParams& params, Generator generator,
-                      TimingFnA timing_a, TimingFnB timing_b,
-                      Comparator comparator, Analysis* analysis) ->
-    typename std::enable_if<
-        internal::IsTimingFunctionForGenerator<Generator, TimingFnA>::value &&
-            internal::IsTimingFunctionForGenerator<Generator, TimingFnB>::value,
-        decltype(analysis->Done(),
-                 analysis->Summary(std::declval<std::ostream*>()))>::type {
-  // Initialize the overhead estimate so it's fast to acquire, and
-  // to trigger side effects like warning in non-release builds.
-  GetTicksOverhead();
+  // Pooled threads outlive the comparison: don't leave them pinned.
+  if (!saved_affinity.empty()) {
+    SetThreadAffinity(saved_affinity);
+  }
+}
 
-  // Noisily stop the analysis on obvious ABI mismatches.
-  const bool a_is_valid = timing_a.IsValid();
-  const bool b_is_valid = timing_b.IsValid();
-  if (!a_is_valid || !b_is_valid) {
-    std::cerr << "ABI mismatch between harness";
-    if (!a_is_valid) {
-      std::cerr << " and version A";
-    }
-    if (!b_is_valid) {
-      std::cerr << " and version B";
+// Pins threads, runs `stat_gen`'s workers and feeds their data to
+// `analysis` until `analysis->Done()` (or until the limits in
+// `params`), then logs the environment and returns
+// `analysis->Summary(&std::clog)`.
+//
+// `StatGen` has the interface of `StatisticGenerator`.
+template <typename StatGen, typename Analysis>
+auto DriveComparison(const TestParams& params, StatGen* stat_gen,
+                     Analysis* analysis)
+    -> decltype(analysis->Summary(std::declval<std::ostream*>())) {
+  // The calling thread generates data too, on the first core;
+  // bandwidth co-runners get the cores after the data generators'.
+  const uint32_t num_threads = std::max<uint32_t>(1, params.num_threads);
+  std::vector<int> cpus;
+  std::vector<int> pressure_cpus(params.bandwidth_pressure, -1);
+  std::vector<int> saved_affinity;
+  if (params.pin_threads) {
+    cpus = PickPinnedCpus(num_threads + params.bandwidth_pressure,
+                          params.cpuset);
+    if (!cpus.empty()) {
+      pressure_cpus.assign(cpus.begin() + num_threads, cpus.end());
+      cpus.resize(num_threads);
+      saved_affinity = GetThreadAffinity();
+      SetThreadAffinity({cpus[0]});
     }
-    std::cerr << "." << std::endl;
-    abort();
-    return analysis->Summary(&std::clog);
   }
 
-  internal::StatisticGenerator<Generator, decltype(timing_a),
-                               decltype(timing_b), Comparator>
-      stat_gen(std::move(generator), std::move(timing_a), std::move(timing_b),
-               std::move(comparator));
+  stat_gen->SetCacheState(params.cache_state);
+  auto pressure = absl::make_unique<BandwidthPressure>(pressure_cpus);
 
+  FrequencyMonitor monitor(cpus.empty() ? -1 : cpus[0]);
   uint64_t num_comparisons = 0;
-  const auto consume = [analysis, &stat_gen, &num_comparisons] {
-    auto stat_chunks = stat_gen.Consume();
+  const auto consume = [analysis, stat_gen, &monitor, &num_comparisons] {
+    auto stat_chunks = stat_gen->Consume();
+    monitor.Sample();
     for (auto& chunk : stat_chunks) {
       num_comparisons += chunk.size();
       analysis->Observe(absl::MakeSpan(chunk));
@@ -622,7 +675,7 @@ auto CompareFunctions(const TestParams& params, Generator generator,
   const absl::Time deadline = absl::Now() + params.timeout;
   const uint64_t max_comparisons = params.max_comparisons;
   const uint64_t min_comparisons =
-      std::max(params.min_count, stat_gen.kMinObservations);
+      std::max(params.min_count, StatGen::kMinObservations);
 
   // Each inner loop runs an analysis until `Done()` returns true
   // enough times in a row.
@@ -633,7 +686,7 @@ auto CompareFunctions(const TestParams& params, Generator generator,
   for (;;) {
     uint32_t consecutive_done = 0;
 
-    stat_gen.Start(params.num_threads);
+    stat_gen->Start(params.num_threads, cpus);
     while (num_comparisons < max_comparisons) {
       if (deadline != absl::InfiniteFuture() && absl::Now() > deadline) {
         break;
@@ -651,7 +704,7 @@ auto CompareFunctions(const TestParams& params, Generator generator,
       consume();
     }
 
-    stat_gen.Stop();
+    stat_gen->Stop();
     consume();
     if (analysis->Done()) {
       break;
@@ -665,7 +718,61 @@ auto CompareFunctions(const TestParams& params, Generator generator,
     }
   }
 
+  pressure.reset();
+
+  EnvironmentReport environment;
+  environment.pinned_cpus = cpus;
+  ReadFrequencyPolicy(cpus.empty() ? 0 : cpus[0], &environment);
+  monitor.Report(params.max_frequency_drift, &environment);
+  if (!saved_affinity.empty()) {
+    SetThreadAffinity(saved_affinity);
+  }
+
+  std::clog << environment << "." << std::endl;
+  if (params.environment != nullptr) {
+    *params.environment = std::move(environment);
+  }
+
   return analysis->Summary(&std::clog);
 }
+}  // namespace internal
+
+template <typename Generator, typename TimingFnA, typename TimingFnB,
+          typename Comparator, typename Analysis>
+auto CompareFunctions(const TestParams& params, Generator generator,
+                      TimingFnA timing_a, TimingFnB timing_b,
+                      Comparator comparator, Analysis* analysis) ->
+    typename std::enable_if<
+        internal::IsTimingFunctionForGenerator<Generator, TimingFnA>::value &&
+            internal::IsTimingFunctionForGenerator<Generator, TimingFnB>::value,
+        decltype(analysis->Done(),
+                 analysis->Summary(std::declval<std::ostream*>()))>::type {
+  // Initialize the overhead estimate so it's fast to acquire, and
+  // to trigger side effects like warning in non-release builds.
+  GetTicksOverhead();
+
+  // Noisily stop the analysis on obvious ABI mismatches.
+  const bool a_is_valid = timing_a.IsValid();
+  const bool b_is_valid = timing_b.IsValid();
+  if (!a_is_valid || !b_is_valid) {
+    std::cerr << "ABI mismatch between harness";
+    if (!a_is_valid) {
+      std::cerr << " and version A";
+    }
+    if (!b_is_valid) {
+      std::cerr << " and version B";
+    }
+    std::cerr << "." << std::endl;
+    abort();
+    return analysis->Summary(&std::clog);
+  }
+
+  internal::StatisticGenerator<Generator, decltype(timing_a),
+                               decltype(timing_b), Comparator>
+      stat_gen(std::move(generator), std::move(timing_a), std::move(timing_b),
+               std::move(comparator));
+
+  return internal::DriveComparison(params, &stat_gen, analysis);
+}
 }  // namespace bench
 #endif /* !BENCH_COMPARE_FUNCTIONS_H */
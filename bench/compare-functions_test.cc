@@ -161,5 +161,24 @@ TEST(CompareFunctions, WithYield) {
         return 1.0 * std::get<0>(x) - std::get<0>(y);
       });
 }
+
+TEST(CompareFunctions, ColdCacheWithPressure) {
+  CompareFunctions<DummyAnalysis>(
+      TestParams()
+          .SetMaxComparisons(20)
+          .SetNumThreads(2)
+          .SetPinThreads(true)
+          .SetCacheState(CacheState::kEvictLlc)
+          .SetBandwidthPressure(1),
+      [] {
+        return std::vector<int>{1, 2, 3};
+      },
+      [](const std::vector<int>& x) -> size_t { return 0; },
+      [](const std::vector<int>& x) -> size_t { return x.size() - 1; },
+      [](std::tuple<uint64_t, size_t> x, std::tuple<uint64_t, size_t> y,
+         const std::vector<int>&) {
+        return 1.0 * std::get<0>(x) - std::get<0>(y);
+      });
+}
 }  // namespace
 }  // namespace bench
@@ -5,7 +5,9 @@
 #include <tuple>
 #include <type_traits>
 #include <utility>
+#include <vector>
 
+#include "bench/compare-arms.h"
 #include "bench/compare-functions.h"
 #include "bench/extract-timing-function.h"
 #include "bench/internal/dynamic-loading.h"
@@ -19,6 +21,9 @@
 // See `compare-functions.h` for more details.  The only difference is
 // that the comparison in this header grabs the functions to time from
 // shared objects that may have been built arbitrarily.
+//
+// The overloads that accept a vector of `path_fun` pairs compare any
+// number of libraries with `CompareArms` (see `compare-arms.h`).
 namespace bench {
 // General case: the functions to time return `ResultType`,
 // we call `generator()` to generate new inputs, get timing
@@ -122,5 +127,53 @@ auto CompareLibraries(const TestParams& params, Generator generator,
                           std::move(fun_b.first), analysis.comparator(),
                           &analysis);
 }
+
+// N-arm comparison: each `path_funs[i]` is a shared object and the name
+// of its nullary timing function factory, as above.  The `comparator`
+// receives the arms' results in the same order as `path_funs`.
+template <typename ResultType = std::tuple<>, typename Generator,
+          typename Comparator, typename Analysis>
+auto CompareLibraries(
+    const TestParams& params, Generator generator,
+    const std::vector<std::pair<std::string, std::string>>& path_funs,
+    Comparator comparator, Analysis* analysis)
+    -> decltype(analysis->Summary(std::declval<std::ostream*>())) {
+  using GenResult =
+      decltype(internal::CallAndTuplify()(generator, std::make_tuple()));
+  using Extracted =
+      decltype(ExtractTimingFunction<ResultType, GenResult>("", ""));
+
+  // Keep the closers alive until the comparison is done.  The arms
+  // are moved out of `extracted`: each pair would otherwise destroy
+  // its closer before its timing function.
+  std::vector<Extracted> extracted;
+  std::vector<typename Extracted::first_type> arms;
+  extracted.reserve(path_funs.size());
+  arms.reserve(path_funs.size());
+  for (const auto& path_fun : path_funs) {
+    extracted.push_back(ExtractTimingFunction<ResultType, GenResult>(
+        path_fun.first, path_fun.second));
+    arms.push_back(std::move(extracted.back().first));
+  }
+
+  return CompareArms(params, std::move(generator), std::move(arms),
+                     std::move(comparator), analysis);
+}
+
+// In this overload, `analysis->params()` provides the test parameters,
+// and `analysis->comparator()` the comparator.
+template <typename ResultType = std::tuple<>, typename Generator,
+          typename Analysis>
+auto CompareLibraries(
+    Generator generator,
+    const std::vector<std::pair<std::string, std::string>>& path_funs,
+    Analysis* analysis) ->
+    typename std::enable_if<
+        !std::is_same<Generator, TestParams>::value,
+        decltype(analysis->Summary(std::declval<std::ostream*>()))>::type {
+  return CompareLibraries<ResultType>(analysis->params(), std::move(generator),
+                                      path_funs, analysis->comparator(),
+                                      analysis);
+}
 }  // namespace bench
 #endif /*!BENCH_COMPARE_LIBRARIES_H */
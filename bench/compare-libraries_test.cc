@@ -1,5 +1,6 @@
 #include "bench/compare-libraries.h"
 
+#include "bench/best-arm-test.h"
 #include "bench/bounded-mean-test.h"
 #include "bench/kolmogorov-smirnov-test.h"
 #include "bench/quantile-test.h"
@@ -42,6 +43,25 @@ TEST(CompareLibraries, BoundedMeanSlowAA) {
   EXPECT_EQ(result.mean_result, ComparisonResult::kTie);
 }
 
+TEST(CompareLibraries, BestArmSlowAAA) {
+  BestArmTest test(3, StrictTestParams()
+                          .SetMaxComparisons(10000000)
+                          .SetStopOnFirst(ComparisonResult::kTie)
+                          .SetMinEffect(3)
+                          .SetOutlierLimit(100, 1e-4)
+                          .SetNumThreads(1));
+
+  const auto result = CompareLibraries(FastNop,
+                                       {{"bench/libslownop.so", "MakeNop"},
+                                        {"bench/libslownop.so", "MakeNop"},
+                                        {"bench/libfastnop.so", "MakeNop"}},
+                                       &test);
+  EXPECT_EQ(result, test.Summary());
+  EXPECT_THAT(result.mean_result,
+              AnyOf(ComparisonResult::kTie, ComparisonResult::kAHigher));
+  EXPECT_EQ(result.means.size(), 3);
+}
+
 TEST(CompareLibraries, QuantileFastAAWithMinEffect) {
   QuantileTest quantiles({0.2, 0.5, 0.99},
                          StrictTestParams()
@@ -0,0 +1,338 @@
+#include "bench/environment.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <set>
+
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "bench/time.h"
+
+namespace bench {
+namespace {
+// MSR addresses for the actual and maximum performance clock counts.
+constexpr off_t kMsrMperf = 0xE7;
+constexpr off_t kMsrAperf = 0xE8;
+
+// Shorter intervals are dominated by the cost of sampling.
+constexpr int64_t kMinIntervalNs = 1000 * 1000;
+
+// Returns the first line of `path`, without surrounding whitespace,
+// or nullopt if the file can't be read.
+absl::optional<std::string> ReadSysfsLine(const std::string& path) {
+  std::ifstream in(path);
+  std::string line;
+  if (!std::getline(in, line)) {
+    return absl::nullopt;
+  }
+
+  return std::string(absl::StripAsciiWhitespace(line));
+}
+
+int64_t MonotonicNs() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return int64_t{ts.tv_sec} * 1000 * 1000 * 1000 + ts.tv_nsec;
+}
+
+bool ReadMsr(int fd, off_t msr, uint64_t* value) {
+  return pread(fd, value, sizeof(*value), msr) == sizeof(*value);
+}
+
+// Returns (max - min) / max, or 0 if max isn't positive.
+double Drift(double min, double max) {
+  return (max > 0) ? (max - min) / max : 0;
+}
+}  // namespace
+
+absl::optional<std::vector<int>> ParseCpuList(absl::string_view list) {
+  std::set<int> cpus;
+  for (absl::string_view range :
+       absl::StrSplit(list, ',', absl::SkipWhitespace())) {
+    range = absl::StripAsciiWhitespace(range);
+    const std::pair<absl::string_view, absl::string_view> bounds =
+        absl::StrSplit(range, absl::MaxSplits('-', 1));
+    int begin, end;
+    if (!absl::SimpleAtoi(bounds.first, &begin) || begin < 0) {
+      return absl::nullopt;
+    }
+
+    end = begin;
+    if (range.find('-') != absl::string_view::npos &&
+        (!absl::SimpleAtoi(bounds.second, &end) || end < begin)) {
+      return absl::nullopt;
+    }
+
+    for (int cpu = begin; cpu <= end; ++cpu) {
+      cpus.insert(cpu);
+    }
+  }
+
+  return std::vector<int>(cpus.begin(), cpus.end());
+}
+
+std::string FormatCpuList(absl::Span<const int> cpus) {
+  std::string ret;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t j = i + 1;
+    while (j < cpus.size() && cpus[j] == cpus[j - 1] + 1) {
+      ++j;
+    }
+
+    absl::StrAppend(&ret, ret.empty() ? "" : ",", cpus[i]);
+    if (j - i > 1) {
+      absl::StrAppend(&ret, "-", cpus[j - 1]);
+    }
+
+    i = j;
+  }
+
+  return ret;
+}
+
+std::vector<int> GetThreadAffinity() {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  std::vector<int> ret;
+  if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+    perror("sched_getaffinity");
+    return ret;
+  }
+
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &set)) {
+      ret.push_back(cpu);
+    }
+  }
+
+  return ret;
+}
+
+bool SetThreadAffinity(absl::Span<const int> cpus) {
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  for (int cpu : cpus) {
+    if (cpu >= 0 && cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &set);
+    }
+  }
+
+  if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+    std::cerr << "Failed to set affinity to CPUs " << FormatCpuList(cpus)
+              << ": " << strerror(errno) << ".\n";
+    return false;
+  }
+
+  return true;
+}
+
+std::vector<int> PhysicalCores(absl::Span<const int> cpus) {
+  std::set<int> seen;
+  std::vector<int> ret;
+  for (int cpu : cpus) {
+    if (seen.count(cpu) != 0) {
+      continue;
+    }
+
+    ret.push_back(cpu);
+    seen.insert(cpu);
+    const absl::optional<std::string> siblings =
+        ReadSysfsLine(absl::StrCat("/sys/devices/system/cpu/cpu", cpu,
+                                   "/topology/thread_siblings_list"));
+    if (!siblings.has_value()) {
+      continue;
+    }
+
+    const absl::optional<std::vector<int>> sibling_cpus =
+        ParseCpuList(*siblings);
+    if (sibling_cpus.has_value()) {
+      seen.insert(sibling_cpus->begin(), sibling_cpus->end());
+    }
+  }
+
+  return ret;
+}
+
+std::vector<int> PickPinnedCpus(size_t num_threads,
+                                absl::string_view cpuset) {
+  std::vector<int> allowed = GetThreadAffinity();
+  if (!cpuset.empty()) {
+    const absl::optional<std::vector<int>> requested = ParseCpuList(cpuset);
+    if (!requested.has_value()) {
+      std::cerr << "Invalid CPU list \"" << cpuset << "\".\n";
+      return {};
+    }
+
+    std::vector<int> intersection;
+    std::set_intersection(allowed.begin(), allowed.end(), requested->begin(),
+                          requested->end(), std::back_inserter(intersection));
+    allowed = std::move(intersection);
+  }
+
+  // The first CPU of a core may be outside `allowed`, so compute
+  // cores over all the allowed CPUs before picking.
+  const std::vector<int> cores = PhysicalCores(allowed);
+  if (cores.empty()) {
+    std::cerr << "No CPU available for pinning in \"" << cpuset << "\".\n";
+    return {};
+  }
+
+  if (cores.size() < num_threads) {
+    std::cerr << "Only " << cores.size() << " physical cores for "
+              << num_threads << " threads; some threads will share a core.\n";
+  }
+
+  std::vector<int> ret;
+  for (size_t i = 0; i < num_threads; ++i) {
+    ret.push_back(cores[i % cores.size()]);
+  }
+
+  return ret;
+}
+
+std::ostream& operator<<(std::ostream& out, const EnvironmentReport& report) {
+  out << "Environment: ";
+  if (report.pinned_cpus.empty()) {
+    out << "unpinned";
+  } else {
+    out << "pinned to CPUs ";
+    const char* separator = "";
+    for (int cpu : report.pinned_cpus) {
+      out << separator << cpu;
+      separator = ",";
+    }
+  }
+
+  if (!report.governor.empty()) {
+    out << ", governor " << report.governor;
+  }
+
+  if (report.turbo.has_value()) {
+    out << ", turbo " << (*report.turbo ? "on" : "off");
+  }
+
+  out << ", " << report.num_intervals << " intervals";
+  if (report.num_intervals > 0) {
+    out << ", TSC " << report.min_tsc_ghz << "-" << report.max_tsc_ghz
+        << " GHz";
+  }
+
+  if (report.min_aperf_mperf.has_value()) {
+    out << ", APERF/MPERF " << *report.min_aperf_mperf << "-"
+        << *report.max_aperf_mperf;
+  } else {
+    out << ", no APERF/MPERF";
+  }
+
+  return out << (report.frequency_stable ? ", stable frequency"
+                                         : ", UNSTABLE FREQUENCY");
+}
+
+FrequencyMonitor::FrequencyMonitor(int cpu) {
+  if (cpu >= 0) {
+    msr_fd_ = open(absl::StrCat("/dev/cpu/", cpu, "/msr").c_str(), O_RDONLY);
+    uint64_t value;
+    if (msr_fd_ >= 0 && !ReadMsr(msr_fd_, kMsrAperf, &value)) {
+      close(msr_fd_);
+      msr_fd_ = -1;
+    }
+  }
+
+  last_ = Read();
+}
+
+FrequencyMonitor::~FrequencyMonitor() {
+  if (msr_fd_ >= 0) {
+    close(msr_fd_);
+  }
+}
+
+FrequencyMonitor::Counters FrequencyMonitor::Read() const {
+  Counters ret;
+  ret.ns = MonotonicNs();
+  ret.tsc = GetTicksBegin();
+  if (msr_fd_ >= 0) {
+    ReadMsr(msr_fd_, kMsrAperf, &ret.aperf);
+    ReadMsr(msr_fd_, kMsrMperf, &ret.mperf);
+  }
+
+  return ret;
+}
+
+void FrequencyMonitor::Sample() {
+  const Counters now = Read();
+  const int64_t ns = now.ns - last_.ns;
+  if (ns < kMinIntervalNs) {
+    return;
+  }
+
+  const double tsc_ghz = double(now.tsc - last_.tsc) / ns;
+  if (num_intervals_++ == 0) {
+    min_tsc_ghz_ = max_tsc_ghz_ = tsc_ghz;
+  } else {
+    min_tsc_ghz_ = std::min(min_tsc_ghz_, tsc_ghz);
+    max_tsc_ghz_ = std::max(max_tsc_ghz_, tsc_ghz);
+  }
+
+  if (msr_fd_ >= 0 && now.mperf > last_.mperf) {
+    const double ratio =
+        double(now.aperf - last_.aperf) / (now.mperf - last_.mperf);
+    if (num_msr_intervals_++ == 0) {
+      min_aperf_mperf_ = max_aperf_mperf_ = ratio;
+    } else {
+      min_aperf_mperf_ = std::min(min_aperf_mperf_, ratio);
+      max_aperf_mperf_ = std::max(max_aperf_mperf_, ratio);
+    }
+  }
+
+  last_ = now;
+}
+
+void FrequencyMonitor::Report(double max_drift,
+                              EnvironmentReport* report) const {
+  report->num_intervals = num_intervals_;
+  report->min_tsc_ghz = min_tsc_ghz_;
+  report->max_tsc_ghz = max_tsc_ghz_;
+  report->frequency_stable = Drift(min_tsc_ghz_, max_tsc_ghz_) <= max_drift;
+  if (num_msr_intervals_ > 0) {
+    report->min_aperf_mperf = min_aperf_mperf_;
+    report->max_aperf_mperf = max_aperf_mperf_;
+    report->frequency_stable =
+        report->frequency_stable &&
+        Drift(min_aperf_mperf_, max_aperf_mperf_) <= max_drift;
+  } else {
+    report->min_aperf_mperf.reset();
+    report->max_aperf_mperf.reset();
+  }
+}
+
+void ReadFrequencyPolicy(int cpu, EnvironmentReport* report) {
+  report->governor =
+      ReadSysfsLine(absl::StrCat("/sys/devices/system/cpu/cpu",
+                                 std::max(cpu, 0),
+                                 "/cpufreq/scaling_governor"))
+          .value_or("");
+
+  // intel_pstate exposes the opposite of the generic boost knob.
+  if (const absl::optional<std::string> no_turbo =
+          ReadSysfsLine("/sys/devices/system/cpu/intel_pstate/no_turbo")) {
+    report->turbo = (*no_turbo == "0");
+  } else if (const absl::optional<std::string> boost =
+                 ReadSysfsLine("/sys/devices/system/cpu/cpufreq/boost")) {
+    report->turbo = (*boost == "1");
+  } else {
+    report->turbo.reset();
+  }
+}
+}  // namespace bench
@@ -0,0 +1,124 @@
+#ifndef BENCH_ENVIRONMENT_H
+#define BENCH_ENVIRONMENT_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+
+// Controls on, and observations of, the environment in which we
+// generate comparison data: pinning threads to distinct physical
+// cores, and detecting frequency changes while they run.
+//
+// Everything degrades gracefully: without sysfs topology, every CPU
+// is its own core, and without access to the APERF/MPERF MSRs (root
+// and the msr module), we only compare the TSC with
+// `CLOCK_MONOTONIC`.
+namespace bench {
+// Parses a Linux CPU list, e.g., "0-3,8,10-11", into sorted CPU
+// indices.  Returns nullopt on syntax errors.
+absl::optional<std::vector<int>> ParseCpuList(absl::string_view list);
+
+// Formats sorted CPU indices as a CPU list.
+std::string FormatCpuList(absl::Span<const int> cpus);
+
+// Returns the calling thread's affinity mask, sorted.
+std::vector<int> GetThreadAffinity();
+
+// Restricts the calling thread to `cpus`.  Returns false (and logs to
+// stderr) on failure.
+bool SetThreadAffinity(absl::Span<const int> cpus);
+
+// Returns one CPU for each physical core in `cpus`: the first of
+// each set of SMT siblings.
+std::vector<int> PhysicalCores(absl::Span<const int> cpus);
+
+// Returns `num_threads` CPUs on distinct physical cores, in the
+// calling thread's affinity mask and, if non-empty, in `cpuset` (a
+// CPU list).  If there are fewer cores than threads, logs a warning
+// and assigns cores round-robin.  Returns an empty vector (and logs)
+// if no CPU is available.
+std::vector<int> PickPinnedCpus(size_t num_threads, absl::string_view cpuset);
+
+// What we know about the environment of a comparison; `CompareFunctions`
+// logs it with the analysis summary.
+struct EnvironmentReport {
+  // The CPU for each data generation thread, starting with the
+  // calling thread, or empty if threads weren't pinned.
+  std::vector<int> pinned_cpus;
+  // The first pinned CPU's cpufreq governor, and whether turbo (or
+  // boost) is enabled, if known.
+  std::string governor;
+  absl::optional<bool> turbo;
+
+  // TSC ticks per nanosecond of `CLOCK_MONOTONIC`, over the sampled
+  // intervals.  The ratio only moves if the TSC isn't invariant, or
+  // the host migrated us.
+  size_t num_intervals{0};
+  double min_tsc_ghz{0};
+  double max_tsc_ghz{0};
+
+  // APERF / MPERF (the effective frequency, relative to the nominal
+  // frequency) on the first pinned CPU, if readable: it moves with
+  // turbo, frequency scaling and throttling.
+  absl::optional<double> min_aperf_mperf;
+  absl::optional<double> max_aperf_mperf;
+
+  // False if either ratio varied by more than the tolerance.
+  bool frequency_stable{true};
+};
+
+std::ostream& operator<<(std::ostream& out, const EnvironmentReport& report);
+
+// Samples the TSC, `CLOCK_MONOTONIC` and, if possible, APERF / MPERF,
+// to detect frequency changes between calls to `Sample`.
+//
+// This class is thread-compatible.
+class FrequencyMonitor {
+ public:
+  // Reads APERF / MPERF on `cpu` if non-negative and permitted; the
+  // calling thread should be pinned there.
+  explicit FrequencyMonitor(int cpu = -1);
+  ~FrequencyMonitor();
+
+  FrequencyMonitor(const FrequencyMonitor&) = delete;
+  FrequencyMonitor& operator=(const FrequencyMonitor&) = delete;
+
+  // Records the interval since the last sample (or construction).
+  // Intervals shorter than a millisecond are too noisy, and merged
+  // with the next one.
+  void Sample();
+
+  // Stores the ratios' ranges in `report`, and flags them as unstable
+  // if they varied by more than `max_drift` (relative to their max).
+  void Report(double max_drift, EnvironmentReport* report) const;
+
+ private:
+  struct Counters {
+    uint64_t tsc{0};
+    int64_t ns{0};
+    uint64_t aperf{0};
+    uint64_t mperf{0};
+  };
+
+  Counters Read() const;
+
+  int msr_fd_{-1};
+  Counters last_;
+
+  size_t num_intervals_{0};
+  double min_tsc_ghz_{0};
+  double max_tsc_ghz_{0};
+  size_t num_msr_intervals_{0};
+  double min_aperf_mperf_{0};
+  double max_aperf_mperf_{0};
+};
+
+// Fills in the governor and turbo state for `cpu`.
+void ReadFrequencyPolicy(int cpu, EnvironmentReport* report);
+}  // namespace bench
+#endif /* !BENCH_ENVIRONMENT_H */
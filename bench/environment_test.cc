@@ -0,0 +1,121 @@
+#include "bench/environment.h"
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "gtest/gtest.h"
+
+namespace bench {
+namespace {
+TEST(Environment, ParseCpuList) {
+  EXPECT_EQ(ParseCpuList(""), std::vector<int>());
+  EXPECT_EQ(ParseCpuList("3"), std::vector<int>({3}));
+  EXPECT_EQ(ParseCpuList("0-3,8,10-11"),
+            std::vector<int>({0, 1, 2, 3, 8, 10, 11}));
+  EXPECT_EQ(ParseCpuList("8, 1-2,2\n"), std::vector<int>({1, 2, 8}));
+
+  EXPECT_FALSE(ParseCpuList("a").has_value());
+  EXPECT_FALSE(ParseCpuList("3-1").has_value());
+  EXPECT_FALSE(ParseCpuList("-1").has_value());
+  EXPECT_FALSE(ParseCpuList("1-").has_value());
+}
+
+TEST(Environment, FormatCpuList) {
+  EXPECT_EQ(FormatCpuList({}), "");
+  EXPECT_EQ(FormatCpuList({4}), "4");
+  EXPECT_EQ(FormatCpuList({0, 1, 2, 3, 8, 10, 11}), "0-3,8,10-11");
+  EXPECT_EQ(ParseCpuList(FormatCpuList({1, 3, 4, 5})),
+            std::vector<int>({1, 3, 4, 5}));
+}
+
+TEST(Environment, PhysicalCoresSubset) {
+  const std::vector<int> allowed = GetThreadAffinity();
+  ASSERT_FALSE(allowed.empty());
+
+  const std::vector<int> cores = PhysicalCores(allowed);
+  ASSERT_FALSE(cores.empty());
+  EXPECT_LE(cores.size(), allowed.size());
+  EXPECT_EQ(cores.front(), allowed.front());
+  for (int cpu : cores) {
+    EXPECT_NE(std::find(allowed.begin(), allowed.end(), cpu), allowed.end());
+  }
+}
+
+TEST(Environment, PickPinnedCpus) {
+  const std::vector<int> allowed = GetThreadAffinity();
+  ASSERT_FALSE(allowed.empty());
+
+  EXPECT_EQ(PickPinnedCpus(3, "").size(), 3);
+  EXPECT_EQ(PickPinnedCpus(2, FormatCpuList({allowed.front()})),
+            std::vector<int>(2, allowed.front()));
+  EXPECT_TRUE(PickPinnedCpus(1, "garbage").empty());
+}
+
+TEST(Environment, PinAndRestore) {
+  const std::vector<int> allowed = GetThreadAffinity();
+  ASSERT_FALSE(allowed.empty());
+
+  ASSERT_TRUE(SetThreadAffinity({allowed.back()}));
+  EXPECT_EQ(GetThreadAffinity(), std::vector<int>({allowed.back()}));
+  ASSERT_TRUE(SetThreadAffinity(allowed));
+  EXPECT_EQ(GetThreadAffinity(), allowed);
+}
+
+TEST(Environment, FrequencyMonitor) {
+  const std::vector<int> allowed = GetThreadAffinity();
+  const int cpu = allowed.front();
+  ASSERT_TRUE(SetThreadAffinity({cpu}));
+
+  FrequencyMonitor monitor(cpu);
+  // Too short to count.
+  monitor.Sample();
+  for (size_t i = 0; i < 5; ++i) {
+    const absl::Time deadline = absl::Now() + absl::Milliseconds(5);
+    while (absl::Now() < deadline) {
+    }
+
+    monitor.Sample();
+  }
+
+  EnvironmentReport report;
+  report.pinned_cpus = {cpu};
+  ReadFrequencyPolicy(cpu, &report);
+  monitor.Report(/*max_drift=*/1.0, &report);
+  std::cout << report << std::endl;
+  ASSERT_TRUE(SetThreadAffinity(allowed));
+
+  EXPECT_GE(report.num_intervals, 1);
+  EXPECT_GT(report.min_tsc_ghz, 0);
+  EXPECT_LE(report.min_tsc_ghz, report.max_tsc_ghz);
+  EXPECT_TRUE(report.frequency_stable);
+
+  // A zero tolerance flags any variation at all.
+  monitor.Report(/*max_drift=*/0, &report);
+  EXPECT_EQ(report.frequency_stable,
+            report.min_tsc_ghz == report.max_tsc_ghz &&
+                report.min_aperf_mperf == report.max_aperf_mperf);
+}
+
+TEST(Environment, ReportFormat) {
+  EnvironmentReport report;
+  report.pinned_cpus = {2, 4};
+  report.governor = "performance";
+  report.turbo = false;
+  report.num_intervals = 3;
+  report.min_tsc_ghz = 2.5;
+  report.max_tsc_ghz = 2.5;
+  report.frequency_stable = false;
+
+  std::ostringstream out;
+  out << report;
+  EXPECT_EQ(out.str(),
+            "Environment: pinned to CPUs 2,4, governor performance, turbo "
+            "off, 3 intervals, TSC 2.5-2.5 GHz, no APERF/MPERF, UNSTABLE "
+            "FREQUENCY");
+}
+}  // namespace
+}  // namespace bench
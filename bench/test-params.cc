@@ -25,6 +25,19 @@ std::ostream& operator<<(std::ostream& out, ComparisonResult result) {
   return out;
 }
 
+std::ostream& operator<<(std::ostream& out, CacheState state) {
+  switch (state) {
+    case CacheState::kHot:
+      out << "hot";
+      break;
+    case CacheState::kEvictLlc:
+      out << "evict_llc";
+      break;
+  }
+
+  return out;
+}
+
 TestParams StrictTestParams() {
   TestParams ret;
   ret.confirm_done = 0;
@@ -4,11 +4,14 @@
 #include <cstdint>
 #include <limits>
 #include <ostream>
+#include <string>
+#include <utility>
 
 #include "absl/time/time.h"
 #include "absl/types/optional.h"
 
 namespace bench {
+struct EnvironmentReport;
 struct TestParams;
 
 // Result for one statistical test.
@@ -33,6 +36,21 @@ enum class ComparisonResult {
 
 std::ostream& operator<<(std::ostream& out, ComparisonResult result);
 
+// The state of the caches when the harness calls a timing function.
+enum class CacheState {
+  // Whatever the previous calls left behind: hot, for inputs that fit
+  // in cache.
+  kHot = 0,
+
+  // Evict the last level cache before each call, by streaming over a
+  // buffer twice its size, as if each instance were far bigger than
+  // the cache.  `Prep` functions can also `FlushRange` (see
+  // cache-state.h) exactly the data they pass to the timed function.
+  kEvictLlc = 1,
+};
+
+std::ostream& operator<<(std::ostream& out, CacheState state);
+
 // Returns a TestParams that is suitable for testing statistical tests.
 // confirm_done is 0, and retry_after_thread_cancel false.
 TestParams StrictTestParams();
@@ -187,6 +205,49 @@ struct TestParams {
     return *this;
   }
 
+  // Pins the calling thread and each worker thread to its own
+  // physical core (never two SMT siblings), among the CPUs in the
+  // calling thread's affinity mask and, if non-empty, in `cpuset_` (a
+  // CPU list like "2-7,10").  Threads share cores round-robin when
+  // there aren't enough.
+  TestParams& SetPinThreads(bool pin_threads_, std::string cpuset_ = "") {
+    pin_threads = pin_threads_;
+    cpuset = std::move(cpuset_);
+    return *this;
+  }
+
+  // Flags the comparison's environment as unstable when the TSC rate
+  // or the APERF / MPERF ratio varies by more than this fraction
+  // between samples, e.g., because the host changed turbo state.
+  TestParams& SetMaxFrequencyDrift(double max_frequency_drift_) {
+    max_frequency_drift = max_frequency_drift_;
+    return *this;
+  }
+
+  // If non-null, `CompareFunctions` stores what it observed about the
+  // execution environment in `*environment_`.
+  TestParams& SetEnvironmentReport(EnvironmentReport* environment_) {
+    environment = environment_;
+    return *this;
+  }
+
+  // Sets the state of the caches before each call to a timing
+  // function.
+  TestParams& SetCacheState(CacheState cache_state_) {
+    cache_state = cache_state_;
+    return *this;
+  }
+
+  // Runs `num_threads_` co-runner threads that stream through private
+  // buffers (several times the size of the last level cache) while
+  // we generate data, to compare functions under background memory
+  // bandwidth pressure.  With `SetPinThreads`, co-runners get their
+  // own cores, after those of the data generation threads.
+  TestParams& SetBandwidthPressure(uint32_t num_threads_) {
+    bandwidth_pressure = num_threads_;
+    return *this;
+  }
+
   // Set `log_eps` to `ln(eps)` after a Bonferroni correction for `n`
   // tests.
   TestParams& SetLogEpsForNTests(size_t n);
@@ -217,6 +278,13 @@ struct TestParams {
   uint64_t min_count{1000};
   double outlier_limit{std::numeric_limits<double>::infinity()};
   double min_outlier_ratio{0};
+
+  bool pin_threads{false};
+  std::string cpuset;
+  double max_frequency_drift{0.01};
+  EnvironmentReport* environment{nullptr};
+  CacheState cache_state{CacheState::kHot};
+  uint32_t bandwidth_pressure{0};
 };
 }  // namespace bench
 #endif /*!BENCH_TEST_PARAMS_H */
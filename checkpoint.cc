@@ -0,0 +1,469 @@
+#include "checkpoint.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+#include <iterator>
+#include <utility>
+
+#include "prng.h"
+
+namespace {
+// The header size for versions 1 and 2.
+constexpr size_t kShortHeaderSize = 4 * kCheckpointAlignment;
+
+uint64_t AlignUp(uint64_t x) {
+  return kCheckpointAlignment *
+         ((x + kCheckpointAlignment - 1) / kCheckpointAlignment);
+}
+
+// Returns whether the `count` elements of `size` bytes at `offset`
+// fit in a file of `file_size` bytes, and start at an aligned offset.
+bool SectionFits(uint64_t offset, uint64_t count, size_t size,
+                 uint64_t file_size) {
+  if (offset % kCheckpointAlignment != 0 || offset > file_size) {
+    return false;
+  }
+
+  return count <= (file_size - offset) / size;
+}
+
+template <typename T>
+void CopySection(absl::Span<const T> src, uint64_t offset,
+                 std::vector<char>* out) {
+  if (!src.empty()) {
+    memcpy(out->data() + offset, src.data(), sizeof(T) * src.size());
+  }
+}
+
+template <typename T>
+absl::Span<const T> GetSection(const char* base, uint64_t offset,
+                               uint64_t count) {
+  return absl::MakeConstSpan(reinterpret_cast<const T*>(base + offset),
+                             count);
+}
+
+bool WriteCheckpointData(const std::string& path,
+                         const std::vector<char>& data) {
+  const std::string tmp_path = path + ".tmp";
+  FILE* file = fopen(tmp_path.c_str(), "wb");
+  if (file == nullptr) {
+    perror("fopen");
+    return false;
+  }
+
+  bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+  ok = ok && fflush(file) == 0 && fsync(fileno(file)) == 0;
+  if (!ok) {
+    perror("write");
+  }
+
+  if (fclose(file) != 0) {
+    perror("fclose");
+    ok = false;
+  }
+
+  if (ok && rename(tmp_path.c_str(), path.c_str()) != 0) {
+    perror("rename");
+    ok = false;
+  }
+
+  return ok;
+}
+
+// Copies the header of the `size` bytes at `base` to `header`.
+// Older versions have a shorter header, and leave the fields they lack
+// zero.  Returns false if there's no header for a known version.
+bool ReadHeader(const char* base, size_t size, CheckpointHeader* header) {
+  *header = CheckpointHeader{};
+  if (size < kShortHeaderSize) {
+    return false;
+  }
+
+  memcpy(header, base, kShortHeaderSize);
+  if (memcmp(header->magic, kCheckpointMagic, sizeof(header->magic)) != 0 ||
+      header->version < 1 || header->version > kCheckpointVersion) {
+    return false;
+  }
+
+  const size_t header_size =
+      header->version < 3 ? kShortHeaderSize : sizeof(CheckpointHeader);
+  if (size < header_size) {
+    return false;
+  }
+
+  memcpy(header, base, header_size);
+  return true;
+}
+
+// Checks that `header` describes a valid checkpoint of `size` bytes
+// at `base` for `constraints` and `state`.
+bool ValidateCheckpoint(const CheckpointHeader& header, const char* base,
+                        size_t size,
+                        absl::Span<const CoverConstraint> constraints,
+                        const DriverState& state) {
+  uint32_t known_flags = kCheckpointFeasible;
+  if (header.version >= 2) {
+    known_flags |= kCheckpointKnapsackPrng;
+  }
+
+  if (header.version >= 3) {
+    known_flags |= kCheckpointPipelinedStep;
+  }
+
+  if ((header.flags & ~known_flags) != 0 || header.file_size != size) {
+    return false;
+  }
+
+  if (header.num_sets != state.obj_values.size() ||
+      header.num_constraints != constraints.size()) {
+    std::cerr << "Checkpoint has " << header.num_sets << " sets and "
+              << header.num_constraints << " constraints, instance has "
+              << state.obj_values.size() << " and " << constraints.size()
+              << ".\n";
+    return false;
+  }
+
+  if ((header.last_solution_size != 0 &&
+       header.last_solution_size != header.num_sets) ||
+      !SectionFits(header.sum_solutions_offset, header.num_sets,
+                   sizeof(double), size) ||
+      !SectionFits(header.last_solution_offset, header.last_solution_size,
+                   sizeof(double), size) ||
+      !SectionFits(header.last_choices_offset, header.num_constraints,
+                   sizeof(uint64_t), size) ||
+      !SectionFits(header.loss_offsets_offset, header.num_constraints + 1,
+                   sizeof(uint64_t), size) ||
+      !SectionFits(header.losses_offset, header.num_losses, sizeof(double),
+                   size)) {
+    return false;
+  }
+
+  const auto loss_offsets = GetSection<uint64_t>(
+      base, header.loss_offsets_offset, header.num_constraints + 1);
+  if (loss_offsets.front() != 0 || loss_offsets.back() != header.num_losses) {
+    return false;
+  }
+
+  for (size_t i = 0; i < constraints.size(); ++i) {
+    if (loss_offsets[i + 1] < loss_offsets[i] ||
+        loss_offsets[i + 1] - loss_offsets[i] !=
+            constraints[i].potential_tours().size()) {
+      std::cerr << "Checkpoint losses for constraint " << i
+                << " do not match the instance.\n";
+      return false;
+    }
+  }
+
+  return true;
+}
+}  // namespace
+
+void SerializeCheckpoint(const DriverState& state,
+                         absl::Span<const CoverConstraint> constraints,
+                         std::vector<char>* out) {
+  const size_t num_sets = state.obj_values.size();
+  const size_t last_solution_size =
+      (state.last_solution.size() == num_sets) ? num_sets : 0;
+
+  std::vector<uint64_t> last_choices;
+  std::vector<uint64_t> loss_offsets;
+  last_choices.reserve(constraints.size());
+  loss_offsets.reserve(constraints.size() + 1);
+  loss_offsets.push_back(0);
+  for (const CoverConstraint& constraint : constraints) {
+    last_choices.push_back(constraint.last_solution());
+    loss_offsets.push_back(loss_offsets.back() + constraint.loss().size());
+  }
+
+  CheckpointHeader header{};
+  memcpy(header.magic, kCheckpointMagic, sizeof(header.magic));
+  header.version = kCheckpointVersion;
+  header.flags = state.feasible ? kCheckpointFeasible : 0u;
+  if (state.knapsack_prng.has_value()) {
+    header.flags |= kCheckpointKnapsackPrng;
+    const xs256::State& prng_state = state.knapsack_prng->state();
+    std::copy(prng_state.begin(), prng_state.end(),
+              header.knapsack_prng_state);
+  }
+
+  if (state.pipelined_step.has_value() &&
+      state.pipelined_step->iteration == state.num_iterations) {
+    header.flags |= kCheckpointPipelinedStep;
+    header.pipelined_eta = state.pipelined_step->eta;
+    header.pipelined_min_loss = state.pipelined_step->min_loss;
+  }
+
+  header.num_sets = num_sets;
+  header.num_constraints = constraints.size();
+  header.num_losses = loss_offsets.back();
+  header.last_solution_size = last_solution_size;
+
+  header.num_iterations = state.num_iterations;
+  header.prev_num_non_zero = state.prev_num_non_zero;
+  header.normal_hedge_inv_2scale = state.normal_hedge_inv_2scale;
+  header.sum_mix_gap = state.sum_mix_gap;
+  header.prev_min_loss = state.prev_min_loss;
+  header.prev_max_loss = state.prev_max_loss;
+  header.best_bound = state.best_bound;
+  header.sum_solution_value = state.sum_solution_value;
+  header.sum_solution_feasibility = state.sum_solution_feasibility;
+  header.max_last_solution_infeasibility =
+      state.max_last_solution_infeasibility;
+  header.last_solution_value = state.last_solution_value;
+
+  header.total_time_ns = absl::ToInt64Nanoseconds(state.total_time);
+  header.prepare_time_ns = absl::ToInt64Nanoseconds(state.prepare_time);
+  header.knapsack_time_ns = absl::ToInt64Nanoseconds(state.knapsack_time);
+  header.observe_time_ns = absl::ToInt64Nanoseconds(state.observe_time);
+  header.update_time_ns = absl::ToInt64Nanoseconds(state.update_time);
+
+  uint64_t offset = sizeof(header);
+  const auto section = [&offset](uint64_t size) {
+    const uint64_t ret = AlignUp(offset);
+    offset = ret + size;
+    return ret;
+  };
+
+  header.sum_solutions_offset = section(sizeof(double) * num_sets);
+  header.last_solution_offset = section(sizeof(double) * last_solution_size);
+  header.last_choices_offset =
+      section(sizeof(uint64_t) * header.num_constraints);
+  header.loss_offsets_offset =
+      section(sizeof(uint64_t) * (header.num_constraints + 1));
+  header.losses_offset = section(sizeof(double) * header.num_losses);
+  header.file_size = offset;
+
+  // Zero-fill to keep the padding deterministic.
+  out->assign(header.file_size, 0);
+  memcpy(out->data(), &header, sizeof(header));
+  CopySection(absl::MakeConstSpan(state.sum_solutions),
+              header.sum_solutions_offset, out);
+  CopySection(absl::MakeConstSpan(state.last_solution.data(),
+                                  last_solution_size),
+              header.last_solution_offset, out);
+  CopySection(absl::MakeConstSpan(last_choices), header.last_choices_offset,
+              out);
+  CopySection(absl::MakeConstSpan(loss_offsets), header.loss_offsets_offset,
+              out);
+  for (size_t i = 0; i < constraints.size(); ++i) {
+    CopySection(constraints[i].loss(),
+                header.losses_offset + sizeof(double) * loss_offsets[i], out);
+  }
+}
+
+bool WriteCheckpoint(const std::string& path, const DriverState& state,
+                     absl::Span<const CoverConstraint> constraints) {
+  std::vector<char> data;
+  SerializeCheckpoint(state, constraints, &data);
+  return WriteCheckpointData(path, data);
+}
+
+bool DeserializeCheckpoint(absl::Span<const char> data,
+                           absl::Span<CoverConstraint> constraints,
+                           DriverState* state) {
+  const char* const base = data.data();
+  CheckpointHeader header;
+  if (!ReadHeader(base, data.size(), &header) ||
+      !ValidateCheckpoint(header, base, data.size(), constraints, *state)) {
+    return false;
+  }
+
+  state->num_iterations = header.num_iterations;
+  state->sum_mix_gap = header.sum_mix_gap;
+  state->prev_num_non_zero = header.prev_num_non_zero;
+  state->normal_hedge_inv_2scale = header.normal_hedge_inv_2scale;
+  state->prev_min_loss = header.prev_min_loss;
+  state->prev_max_loss = header.prev_max_loss;
+  state->best_bound = header.best_bound;
+  state->sum_solution_value = header.sum_solution_value;
+  state->sum_solution_feasibility = header.sum_solution_feasibility;
+  state->max_last_solution_infeasibility =
+      header.max_last_solution_infeasibility;
+  state->last_solution_value = header.last_solution_value;
+  state->feasible = (header.flags & kCheckpointFeasible) != 0;
+  if ((header.flags & kCheckpointKnapsackPrng) != 0) {
+    xs256::State prng_state;
+    std::copy(std::begin(header.knapsack_prng_state),
+              std::end(header.knapsack_prng_state), prng_state.begin());
+    state->knapsack_prng.emplace(prng_state);
+  } else {
+    state->knapsack_prng.reset();
+  }
+
+  if ((header.flags & kCheckpointPipelinedStep) != 0) {
+    state->pipelined_step = PipelinedStep{
+        header.num_iterations, header.pipelined_eta, header.pipelined_min_loss};
+  } else {
+    state->pipelined_step.reset();
+  }
+
+  state->total_time = absl::Nanoseconds(header.total_time_ns);
+  state->prepare_time = absl::Nanoseconds(header.prepare_time_ns);
+  state->knapsack_time = absl::Nanoseconds(header.knapsack_time_ns);
+  state->observe_time = absl::Nanoseconds(header.observe_time_ns);
+  state->update_time = absl::Nanoseconds(header.update_time_ns);
+
+  {
+    const auto sum_solutions = GetSection<double>(
+        base, header.sum_solutions_offset, header.num_sets);
+    state->sum_solutions = state->arena.CreateUninit<double>(header.num_sets);
+    std::copy(sum_solutions.begin(), sum_solutions.end(),
+              state->sum_solutions.begin());
+
+    const auto last_solution = GetSection<double>(
+        base, header.last_solution_offset, header.last_solution_size);
+    state->last_solution =
+        state->arena.CreateUninit<double>(header.last_solution_size);
+    std::copy(last_solution.begin(), last_solution.end(),
+              state->last_solution.begin());
+  }
+
+  const auto last_choices = GetSection<uint64_t>(
+      base, header.last_choices_offset, header.num_constraints);
+  const auto loss_offsets = GetSection<uint64_t>(
+      base, header.loss_offsets_offset, header.num_constraints + 1);
+  const auto losses =
+      GetSection<double>(base, header.losses_offset, header.num_losses);
+  for (size_t i = 0; i < constraints.size(); ++i) {
+    constraints[i].RestoreState(
+        last_choices[i],
+        losses.subspan(loss_offsets[i], loss_offsets[i + 1] - loss_offsets[i]));
+  }
+
+  return true;
+}
+
+bool RestoreCheckpoint(const std::string& path,
+                       absl::Span<CoverConstraint> constraints,
+                       DriverState* state) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror("open");
+    return false;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    perror("fstat");
+    close(fd);
+    return false;
+  }
+
+  const size_t size = st.st_size;
+  void* const map = (size == 0)
+                        ? MAP_FAILED
+                        : mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    std::cerr << path << ": failed to map checkpoint.\n";
+    return false;
+  }
+
+  const bool ok = DeserializeCheckpoint(
+      absl::MakeConstSpan(static_cast<const char*>(map), size), constraints,
+      state);
+  if (!ok) {
+    std::cerr << path << ": invalid checkpoint.\n";
+  }
+
+  munmap(map, size);
+  return ok;
+}
+
+CheckpointWriter::CheckpointWriter(std::string path, Options options)
+    : path_(std::move(path)),
+      options_(options),
+      last_time_(absl::Now()),
+      worker_([this] { WorkerLoop(); }) {}
+
+CheckpointWriter::~CheckpointWriter() {
+  {
+    absl::MutexLock ml(&mu_);
+    shutdown_ = true;
+  }
+
+  worker_.join();
+}
+
+bool CheckpointWriter::MaybeWrite(
+    const DriverState& state, absl::Span<const CoverConstraint> constraints) {
+  const bool due_iterations =
+      options_.every_iterations > 0 &&
+      state.num_iterations >= last_iteration_ + options_.every_iterations;
+  if (!due_iterations && absl::Now() - last_time_ < options_.every) {
+    return false;
+  }
+
+  {
+    absl::MutexLock ml(&mu_);
+    if (has_pending_) {
+      return false;
+    }
+  }
+
+  Enqueue(state, constraints);
+  return true;
+}
+
+bool CheckpointWriter::WriteNow(
+    const DriverState& state, absl::Span<const CoverConstraint> constraints) {
+  Flush();
+  Enqueue(state, constraints);
+  return Flush();
+}
+
+bool CheckpointWriter::Flush() {
+  absl::MutexLock ml(&mu_);
+  const auto idle = [this]() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return !has_pending_;
+  };
+  mu_.Await(absl::Condition(&idle));
+  return ok_;
+}
+
+void CheckpointWriter::Enqueue(const DriverState& state,
+                               absl::Span<const CoverConstraint> constraints) {
+  SerializeCheckpoint(state, constraints, &buffer_);
+  last_iteration_ = state.num_iterations;
+  last_time_ = absl::Now();
+
+  absl::MutexLock ml(&mu_);
+  assert(!has_pending_);
+  pending_.swap(buffer_);
+  has_pending_ = true;
+}
+
+void CheckpointWriter::WorkerLoop() {
+  const auto has_work = [this]() EXCLUSIVE_LOCKS_REQUIRED(mu_) {
+    return has_pending_ || shutdown_;
+  };
+
+  std::vector<char> data;
+  for (;;) {
+    {
+      absl::MutexLock ml(&mu_);
+      mu_.Await(absl::Condition(&has_work));
+      if (!has_pending_) {
+        return;
+      }
+
+      data.swap(pending_);
+    }
+
+    const bool ok = WriteCheckpointData(path_, data);
+
+    absl::MutexLock ml(&mu_);
+    // Hand the buffer back for reuse by the next `Enqueue`.
+    pending_.swap(data);
+    ok_ = ok_ && ok;
+    has_pending_ = false;
+  }
+}
@@ -0,0 +1,196 @@
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "driver.h"
+
+// Checkpoint files capture everything needed to resume a solve: the
+// `DriverState` scalars and vectors, and each constraint's cumulative
+// losses.  The instance itself (costs and tours) is not included.
+//
+// Like instance files, checkpoints are little-endian, and consist of
+// a fixed-size header followed by sections that all start at a
+// multiple of `kCheckpointAlignment` bytes, so they can be mapped
+// directly:
+//
+//  1. sum_solutions: double[num_sets]
+//  2. last_solution: double[last_solution_size] (0 or num_sets)
+//  3. last_choices: uint64_t[num_constraints], each constraint's last
+//     subproblem solution.
+//  4. loss_offsets: uint64_t[num_constraints + 1], the CSR offsets
+//     into losses.
+//  5. losses: double[num_losses], each constraint's cumulative losses,
+//     concatenated.
+//
+// Floating point values are stored bit-for-bit, and the header holds
+// the knapsack's pivot stream (`DriverState::knapsack_prng`) and the
+// weight updates' warm starts and schedules, so a restored solve
+// continues exactly as the original one would have, as long as the
+// iterations themselves are deterministic.
+//
+// Versions 1 and 2 have a 256-byte header, without the pipelined step;
+// version 1 also predates the pivot stream.  They restore without
+// those.
+constexpr char kCheckpointMagic[8] = {'S', 'C', 'C', 'H', 'E', 'C', 'K', 'P'};
+constexpr uint32_t kCheckpointVersion = 3;
+constexpr size_t kCheckpointAlignment = 64;
+
+// Bits in `CheckpointHeader::flags`.
+constexpr uint32_t kCheckpointFeasible = 1;
+// `CheckpointHeader::knapsack_prng_state` holds the pivot stream.
+constexpr uint32_t kCheckpointKnapsackPrng = 2;
+// `CheckpointHeader::pipelined_*` hold `DriverState::pipelined_step`,
+// for the checkpointed iteration.
+constexpr uint32_t kCheckpointPipelinedStep = 4;
+
+struct CheckpointHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t num_sets;
+  uint64_t num_constraints;
+  uint64_t num_losses;
+  uint64_t last_solution_size;
+
+  uint64_t num_iterations;
+  uint64_t prev_num_non_zero;
+  double sum_mix_gap;
+  double prev_min_loss;
+  double prev_max_loss;
+  double best_bound;
+  double sum_solution_value;
+  double sum_solution_feasibility;
+  double max_last_solution_infeasibility;
+  double last_solution_value;
+
+  int64_t total_time_ns;
+  int64_t prepare_time_ns;
+  int64_t knapsack_time_ns;
+  int64_t observe_time_ns;
+  int64_t update_time_ns;
+
+  uint64_t sum_solutions_offset;
+  uint64_t last_solution_offset;
+  uint64_t last_choices_offset;
+  uint64_t loss_offsets_offset;
+  uint64_t losses_offset;
+  uint64_t file_size;
+  uint64_t knapsack_prng_state[4];
+  // 0 in checkpoints that predate it, i.e., a cold start.
+  double normal_hedge_inv_2scale;
+
+  double pipelined_eta;
+  double pipelined_min_loss;
+  uint8_t reserved[48];
+};
+
+static_assert(sizeof(CheckpointHeader) == 5 * kCheckpointAlignment,
+              "The header must preserve section alignment.");
+
+// Serialises `state` and the constraints' losses to `out`, in the
+// checkpoint file format.  `out`'s storage is reused when possible.
+void SerializeCheckpoint(const DriverState& state,
+                         absl::Span<const CoverConstraint> constraints,
+                         std::vector<char>* out);
+
+// Writes a checkpoint for `state` to `path`, atomically: the
+// checkpoint goes to a temporary file, which is then renamed to
+// `path`.  Returns false (and logs to stderr) on failure.
+bool WriteCheckpoint(const std::string& path, const DriverState& state,
+                     absl::Span<const CoverConstraint> constraints);
+
+// Restores `state` and `constraints` from the serialised checkpoint
+// in `data`, which must be at least 8-byte aligned (e.g., the output
+// of `SerializeCheckpoint`).  Same preconditions and failure
+// semantics as `RestoreCheckpoint`, below.
+bool DeserializeCheckpoint(absl::Span<const char> data,
+                           absl::Span<CoverConstraint> constraints,
+                           DriverState* state);
+
+// Restores `state` and `constraints` from the checkpoint at `path`.
+// `state` must have been constructed for the same costs, and
+// `constraints` must have the same tours as when the checkpoint was
+// written.
+//
+// `state->knapsack_prng` is replaced with the checkpointed stream, or
+// reset if the checkpointed state had none.
+//
+// Returns false (and logs to stderr) on failure, without modifying
+// `state` or `constraints`.
+bool RestoreCheckpoint(const std::string& path,
+                       absl::Span<CoverConstraint> constraints,
+                       DriverState* state);
+
+// Writes checkpoints from a background thread, so the iteration loop
+// only pays for a copy of the state.
+//
+// This class is thread-compatible: public methods must be called
+// from the solver's thread.
+class CheckpointWriter {
+ public:
+  struct Options {
+    // Checkpoint at least every `every_iterations` iterations (0
+    // to disable)...
+    size_t every_iterations{1000};
+    // ... or every `every` wall-clock time.
+    absl::Duration every{absl::Minutes(5)};
+  };
+
+  CheckpointWriter(std::string path, Options options);
+
+  // Waits for the last checkpoint to be written.
+  ~CheckpointWriter();
+
+  CheckpointWriter(const CheckpointWriter&) = delete;
+  CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+  // If a checkpoint is due, and the previous one has been written,
+  // serialises the state and queues it for the background thread.
+  // Returns whether a checkpoint was queued.
+  //
+  // Checkpoints that are due while the previous one is still being
+  // written are delayed rather than stalling the caller.
+  bool MaybeWrite(const DriverState& state,
+                  absl::Span<const CoverConstraint> constraints);
+
+  // Waits for any pending checkpoint, then writes one for `state`
+  // and waits for it.  Returns whether all writes so far succeeded.
+  bool WriteNow(const DriverState& state,
+                absl::Span<const CoverConstraint> constraints);
+
+  // Waits for pending checkpoints.  Returns whether all writes so far
+  // succeeded.
+  bool Flush();
+
+ private:
+  void Enqueue(const DriverState& state,
+               absl::Span<const CoverConstraint> constraints);
+  void WorkerLoop();
+
+  const std::string path_;
+  const Options options_;
+
+  size_t last_iteration_{0};
+  absl::Time last_time_;
+  // Serialisation buffer for the next checkpoint, swapped with
+  // `pending_`.
+  std::vector<char> buffer_;
+
+  absl::Mutex mu_;
+  std::vector<char> pending_ GUARDED_BY(mu_);
+  bool has_pending_ GUARDED_BY(mu_){false};
+  bool shutdown_ GUARDED_BY(mu_){false};
+  bool ok_ GUARDED_BY(mu_){true};
+
+  std::thread worker_;
+};
+#endif /* !CHECKPOINT_H */
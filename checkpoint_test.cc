@@ -0,0 +1,268 @@
+#include "checkpoint.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "pipelined-driver.h"
+#include "random-set-cover-instance.h"
+#include "weight-update.h"
+
+namespace {
+std::string TempPath(const std::string& name) {
+  const char* dir = getenv("TEST_TMPDIR");
+  return std::string(dir != nullptr ? dir : "/tmp") + "/" + name;
+}
+
+void ExpectSameState(const DriverState& x, const DriverState& y,
+                     absl::Span<const CoverConstraint> x_constraints,
+                     absl::Span<const CoverConstraint> y_constraints) {
+  EXPECT_EQ(x.num_iterations, y.num_iterations);
+  EXPECT_EQ(x.sum_mix_gap, y.sum_mix_gap);
+  EXPECT_EQ(x.prev_num_non_zero, y.prev_num_non_zero);
+  EXPECT_EQ(x.normal_hedge_inv_2scale, y.normal_hedge_inv_2scale);
+  EXPECT_EQ(x.prev_min_loss, y.prev_min_loss);
+  EXPECT_EQ(x.prev_max_loss, y.prev_max_loss);
+  EXPECT_EQ(x.best_bound, y.best_bound);
+  EXPECT_EQ(x.sum_solution_value, y.sum_solution_value);
+  EXPECT_EQ(x.sum_solution_feasibility, y.sum_solution_feasibility);
+  EXPECT_EQ(x.max_last_solution_infeasibility,
+            y.max_last_solution_infeasibility);
+  EXPECT_EQ(x.last_solution_value, y.last_solution_value);
+  EXPECT_EQ(x.feasible, y.feasible);
+  EXPECT_TRUE(x.sum_solutions == y.sum_solutions);
+  EXPECT_TRUE(x.last_solution == y.last_solution);
+
+  ASSERT_EQ(x_constraints.size(), y_constraints.size());
+  for (size_t i = 0; i < x_constraints.size(); ++i) {
+    EXPECT_EQ(x_constraints[i].last_solution(),
+              y_constraints[i].last_solution());
+    EXPECT_EQ(std::vector<double>(x_constraints[i].loss().begin(),
+                                  x_constraints[i].loss().end()),
+              std::vector<double>(y_constraints[i].loss().begin(),
+                                  y_constraints[i].loss().end()));
+  }
+}
+
+// Restoring a checkpoint must reproduce the state exactly, and, with
+// a seeded pivot stream, so must the continuation.
+TEST(Checkpoint, ResumeIsIdentical) {
+  constexpr uint64_t kSeed = 42;
+  const std::string path = TempPath("checkpoint-resume");
+  RandomSetCoverInstance instance = GenerateRandomInstance(200, 50, 1, 20);
+  std::vector<CoverConstraint> fresh = instance.constraints;
+
+  DriverState state(instance.obj_values);
+  state.knapsack_prng.emplace(kSeed);
+  for (size_t i = 0; i < 20; ++i) {
+    DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+  }
+
+  ASSERT_TRUE(WriteCheckpoint(path, state, instance.constraints));
+
+  DriverState restored(instance.obj_values);
+  restored.knapsack_prng.emplace(kSeed);
+  ASSERT_TRUE(RestoreCheckpoint(path, absl::MakeSpan(fresh), &restored));
+  ExpectSameState(state, restored, instance.constraints, fresh);
+  EXPECT_EQ(state.total_time, restored.total_time);
+
+  for (size_t i = 0; i < 20; ++i) {
+    DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+    DriveOneIteration(absl::MakeSpan(fresh), &restored);
+  }
+
+  EXPECT_EQ(state.num_iterations, restored.num_iterations);
+  EXPECT_EQ(restored.sum_solution_value, state.sum_solution_value);
+  EXPECT_EQ(restored.prev_min_loss, state.prev_min_loss);
+  EXPECT_EQ(restored.sum_mix_gap, state.sum_mix_gap);
+  for (size_t i = 0; i < fresh.size(); ++i) {
+    EXPECT_EQ(std::vector<double>(fresh[i].loss().begin(),
+                                  fresh[i].loss().end()),
+              std::vector<double>(instance.constraints[i].loss().begin(),
+                                  instance.constraints[i].loss().end()))
+        << i;
+  }
+
+  remove(path.c_str());
+}
+
+// NormalHedge's scale search depends on its warm start, which must
+// survive the checkpoint for a fresh `NormalHedge` to continue exactly.
+TEST(Checkpoint, NormalHedgeResumeIsIdentical) {
+  constexpr uint64_t kSeed = 43;
+  const std::string path = TempPath("checkpoint-normal-hedge");
+  RandomSetCoverInstance instance = GenerateRandomInstance(200, 50, 1, 20);
+  std::vector<CoverConstraint> fresh = instance.constraints;
+
+  DriverState state(instance.obj_values);
+  state.knapsack_prng.emplace(kSeed);
+  NormalHedge normal_hedge;
+  for (size_t i = 0; i < 20; ++i) {
+    DriveOneIteration(absl::MakeSpan(instance.constraints), &normal_hedge,
+                      &state);
+  }
+
+  ASSERT_TRUE(WriteCheckpoint(path, state, instance.constraints));
+  DriverState restored(instance.obj_values);
+  ASSERT_TRUE(RestoreCheckpoint(path, absl::MakeSpan(fresh), &restored));
+  ExpectSameState(state, restored, instance.constraints, fresh);
+
+  NormalHedge restored_normal_hedge;
+  for (size_t i = 0; i < 20; ++i) {
+    DriveOneIteration(absl::MakeSpan(instance.constraints), &normal_hedge,
+                      &state);
+    DriveOneIteration(absl::MakeSpan(fresh), &restored_normal_hedge,
+                      &restored);
+  }
+
+  ExpectSameState(state, restored, instance.constraints, fresh);
+  remove(path.c_str());
+}
+
+// The pipelined driver's step size lags by one iteration, and its
+// fused passes prepare weights relative to a lower bound on the minimum
+// loss: a fresh driver must pick that schedule up from the checkpoint.
+void ExpectPipelinedResumeIsIdentical(bool fuse_observe) {
+  constexpr uint64_t kSeed = 44;
+  const std::string path = TempPath("checkpoint-pipelined");
+  RandomSetCoverInstance instance = GenerateRandomInstance(200, 50, 1, 20);
+  std::vector<CoverConstraint> fresh = instance.constraints;
+
+  DriverState state(instance.obj_values);
+  state.knapsack_prng.emplace(kSeed);
+  PipelinedDriver driver(/*tours_per_block=*/100, fuse_observe);
+  for (size_t i = 0; i < 20; ++i) {
+    driver.DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+  }
+
+  ASSERT_TRUE(WriteCheckpoint(path, state, instance.constraints));
+  DriverState restored(instance.obj_values);
+  ASSERT_TRUE(RestoreCheckpoint(path, absl::MakeSpan(fresh), &restored));
+  ExpectSameState(state, restored, instance.constraints, fresh);
+
+  PipelinedDriver restored_driver(/*tours_per_block=*/100, fuse_observe);
+  for (size_t i = 0; i < 20; ++i) {
+    driver.DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+    restored_driver.DriveOneIteration(absl::MakeSpan(fresh), &restored);
+  }
+
+  ExpectSameState(state, restored, instance.constraints, fresh);
+  remove(path.c_str());
+}
+
+TEST(Checkpoint, PipelinedResumeIsIdentical) {
+  ExpectPipelinedResumeIsIdentical(/*fuse_observe=*/false);
+}
+
+TEST(Checkpoint, FusedResumeIsIdentical) {
+  ExpectPipelinedResumeIsIdentical(/*fuse_observe=*/true);
+}
+
+// The knapsack's pivot stream round-trips, and restoring a checkpoint
+// without one drops the current stream.
+TEST(Checkpoint, KnapsackPrng) {
+  const std::string path = TempPath("checkpoint-prng");
+  const double costs[] = {1.0, 1.0, 1.0};
+  std::vector<CoverConstraint> constraints = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+
+  DriverState state(costs);
+  state.knapsack_prng.emplace(42);
+  DriveOneIteration(absl::MakeSpan(constraints), &state);
+  ASSERT_TRUE(WriteCheckpoint(path, state, constraints));
+
+  DriverState restored(costs);
+  ASSERT_TRUE(RestoreCheckpoint(path, absl::MakeSpan(constraints), &restored));
+  ASSERT_TRUE(restored.knapsack_prng.has_value());
+  EXPECT_EQ(restored.knapsack_prng->state(), state.knapsack_prng->state());
+
+  state.knapsack_prng.reset();
+  ASSERT_TRUE(WriteCheckpoint(path, state, constraints));
+  ASSERT_TRUE(RestoreCheckpoint(path, absl::MakeSpan(constraints), &restored));
+  EXPECT_FALSE(restored.knapsack_prng.has_value());
+  remove(path.c_str());
+}
+
+TEST(Checkpoint, RejectMismatch) {
+  const std::string path = TempPath("checkpoint-mismatch");
+  const double costs[] = {1.0, 1.0, 3.0};
+  std::vector<CoverConstraint> constraints = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+
+  DriverState state(costs);
+  DriveOneIteration(absl::MakeSpan(constraints), &state);
+  ASSERT_TRUE(WriteCheckpoint(path, state, constraints));
+
+  {
+    DriverState other(absl::MakeConstSpan(costs, 2));
+    EXPECT_FALSE(RestoreCheckpoint(path, absl::MakeSpan(constraints), &other));
+  }
+
+  {
+    std::vector<CoverConstraint> other_constraints = {
+        CoverConstraint({0, 1, 2}), CoverConstraint({1, 2}),
+    };
+    DriverState other(costs);
+    EXPECT_FALSE(
+        RestoreCheckpoint(path, absl::MakeSpan(other_constraints), &other));
+    EXPECT_EQ(other.num_iterations, 0);
+  }
+
+  {
+    DriverState other(costs);
+    EXPECT_FALSE(RestoreCheckpoint(path + ".missing",
+                                   absl::MakeSpan(constraints), &other));
+  }
+
+  remove(path.c_str());
+}
+
+TEST(Checkpoint, BackgroundWriter) {
+  const std::string path = TempPath("checkpoint-background");
+  remove(path.c_str());
+
+  const double costs[] = {1.0, 1.0, 1.0};
+  std::vector<CoverConstraint> constraints = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+
+  DriverState state(costs);
+  {
+    CheckpointWriter::Options options;
+    options.every_iterations = 2;
+    options.every = absl::InfiniteDuration();
+    CheckpointWriter writer(path, options);
+
+    DriveOneIteration(absl::MakeSpan(constraints), &state);
+    EXPECT_FALSE(writer.MaybeWrite(state, constraints));
+    DriveOneIteration(absl::MakeSpan(constraints), &state);
+    EXPECT_TRUE(writer.MaybeWrite(state, constraints));
+    ASSERT_TRUE(writer.Flush());
+
+    std::vector<CoverConstraint> restored_constraints = {
+        CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+    };
+    DriverState restored(costs);
+    ASSERT_TRUE(RestoreCheckpoint(
+        path, absl::MakeSpan(restored_constraints), &restored));
+    EXPECT_EQ(restored.num_iterations, 2);
+
+    DriveOneIteration(absl::MakeSpan(constraints), &state);
+    EXPECT_TRUE(writer.WriteNow(state, constraints));
+  }
+
+  std::vector<CoverConstraint> restored_constraints = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+  DriverState restored(costs);
+  ASSERT_TRUE(
+      RestoreCheckpoint(path, absl::MakeSpan(restored_constraints), &restored));
+  ExpectSameState(state, restored, constraints, restored_constraints);
+  remove(path.c_str());
+}
+}  // namespace
@@ -0,0 +1,165 @@
+#include "column-fixing.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <limits>
+#include <utility>
+
+namespace {
+// Pads the optimality gap to absorb rounding errors in the bounds.
+constexpr double kRelativeSlack = 1e-9;
+}  // namespace
+
+LagrangianBound ComputeLagrangianBound(absl::Span<const double> obj_values,
+                                       absl::Span<const double> weights,
+                                       double rhs) {
+  assert(obj_values.size() == weights.size());
+
+  // The bound is concave in lambda, and maximised when the sets
+  // whose ratio of cost to surrogate coverage is less than lambda
+  // just cover the rhs: that's the fractional knapsack's break item.
+  const double required = -rhs;
+  double lambda = 0;
+  if (required > 0) {
+    std::vector<std::pair<double, double>> ratios;
+    for (size_t i = 0, n = weights.size(); i < n; ++i) {
+      if (weights[i] < 0) {
+        ratios.emplace_back(obj_values[i] / -weights[i], -weights[i]);
+      }
+    }
+
+    std::sort(ratios.begin(), ratios.end());
+    double covered = 0;
+    bool feasible = false;
+    for (const auto& ratio : ratios) {
+      covered += ratio.second;
+      if (covered >= required) {
+        lambda = std::max(0.0, ratio.first);
+        feasible = true;
+        break;
+      }
+    }
+
+    if (!feasible) {
+      return {0.0, std::numeric_limits<double>::infinity()};
+    }
+  }
+
+  double lower_bound = lambda * required;
+  for (size_t i = 0, n = weights.size(); i < n; ++i) {
+    lower_bound += std::min(0.0, obj_values[i] + lambda * weights[i]);
+  }
+
+  return {lambda, lower_bound};
+}
+
+double ComputeCoverUpperBound(absl::Span<const double> obj_values,
+                              absl::Span<const double> sum_solutions,
+                              double scale,
+                              absl::Span<const CoverConstraint> constraints) {
+  assert(obj_values.size() == sum_solutions.size());
+
+  std::vector<double> solution(sum_solutions.size());
+  for (size_t i = 0, n = solution.size(); i < n; ++i) {
+    // Sets with a negative cost belong in every optimal cover.
+    solution[i] = (obj_values[i] < 0) ? 1.0
+                                      : std::min(1.0, scale * sum_solutions[i]);
+  }
+
+  for (const auto& constraint : constraints) {
+    const absl::Span<const uint32_t> tours = constraint.potential_tours();
+    if (tours.empty()) {
+      return std::numeric_limits<double>::infinity();
+    }
+
+    double coverage = 0;
+    uint32_t cheapest = tours[0];
+    for (const uint32_t tour : tours) {
+      coverage += solution[tour];
+      cheapest = (obj_values[tour] < obj_values[cheapest]) ? tour : cheapest;
+    }
+
+    if (coverage < 1) {
+      solution[cheapest] = std::min(1.0, solution[cheapest] + (1 - coverage));
+    }
+  }
+
+  double ret = 0;
+  for (size_t i = 0, n = solution.size(); i < n; ++i) {
+    ret += obj_values[i] * solution[i];
+  }
+
+  return ret;
+}
+
+FixedColumns FindFixedColumns(absl::Span<const double> obj_values,
+                              absl::Span<const double> weights,
+                              const LagrangianBound& bound, double upper_bound,
+                              absl::Span<const CoverConstraint> constraints,
+                              double budget) {
+  assert(obj_values.size() == weights.size());
+  assert(budget >= 0 && budget < 1);
+
+  FixedColumns ret;
+  if (!std::isfinite(upper_bound) || !std::isfinite(bound.lower_bound)) {
+    return ret;
+  }
+
+  const double gap =
+      std::max(0.0, upper_bound - bound.lower_bound) +
+      kRelativeSlack *
+          (1 + std::abs(upper_bound) + std::abs(bound.lower_bound));
+
+  // Upper bounds on each set's value in an optimal cover; infinity
+  // for sets that aren't candidates.
+  const double kNotCandidate = std::numeric_limits<double>::infinity();
+  std::vector<double> max_value(obj_values.size(), kNotCandidate);
+  for (size_t i = 0, n = obj_values.size(); i < n; ++i) {
+    const double reduced_cost = obj_values[i] + bound.lambda * weights[i];
+    if (reduced_cost > 0 && gap <= budget * reduced_cost) {
+      max_value[i] = gap / reduced_cost;
+    }
+  }
+
+  // Vetoing a candidate only decreases the sums for constraints that
+  // were already checked, so one pass suffices.
+  std::vector<std::pair<double, uint32_t>> candidates;
+  for (const auto& constraint : constraints) {
+    candidates.clear();
+    double uncovered = 0;
+    for (const uint32_t tour : constraint.potential_tours()) {
+      if (max_value[tour] != kNotCandidate) {
+        candidates.emplace_back(max_value[tour], tour);
+        uncovered += max_value[tour];
+      }
+    }
+
+    const bool all_candidates =
+        candidates.size() == constraint.potential_tours().size();
+    if (uncovered > budget || (all_candidates && !candidates.empty())) {
+      std::sort(candidates.begin(), candidates.end(),
+                std::greater<std::pair<double, uint32_t>>());
+      size_t num_vetoed = 0;
+      // Always keep at least one set, even if rounding errors make
+      // the budget look sufficient for all of them.
+      do {
+        uncovered -= candidates[num_vetoed].first;
+        max_value[candidates[num_vetoed].second] = kNotCandidate;
+        ++num_vetoed;
+      } while (num_vetoed < candidates.size() && uncovered > budget);
+    }
+
+    ret.max_uncovered = std::max(ret.max_uncovered, std::max(0.0, uncovered));
+  }
+
+  for (size_t i = 0, n = max_value.size(); i < n; ++i) {
+    if (max_value[i] != kNotCandidate) {
+      ret.sets.push_back(i);
+    }
+  }
+
+  return ret;
+}
@@ -0,0 +1,69 @@
+#ifndef COLUMN_FIXING_H
+#define COLUMN_FIXING_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+
+// Reduced-cost column fixing for the fractional set cover.
+//
+// Any surrogate knapsack `g'x >= r` (with `g = -knapsack_weights`
+// and `r = -knapsack_rhs`) is a relaxation of the cover, and so is
+// its Lagrangian relaxation for any multiplier `lambda >= 0`:
+//
+//   c'x >= lambda r + sum_j min(0, d_j) + sum_{d_j > 0} d_j x_j,
+//
+// with reduced costs `d_j = c_j - lambda g_j`.  The first two terms
+// form a lower bound `L`.  Given an upper bound `U` on the optimal
+// value, every optimal cover satisfies `x_j <= (U - L) / d_j`.
+//
+// That's not enough to prove `x_j = 0` in a fractional cover, unless
+// `U <= L`.  However, forcing a set of columns to 0 can only
+// uncover each constraint by the sum of their upper bounds.  If that
+// sum is at most `budget < 1` for every constraint, scaling up the
+// rest of an optimal cover by 1 / (1 - budget) restores feasibility:
+// the reduced instance's optimal value is within a factor of
+// 1 / (1 - budget) of the original.
+
+struct LagrangianBound {
+  double lambda{0};
+  double lower_bound{0};
+};
+
+// Returns the multiplier that maximises the Lagrangian bound for the
+// surrogate knapsack `sum_j weights_j x_j <= rhs`, with non-positive
+// `weights` and `rhs`, and that bound.  The bound is infinite if the
+// knapsack is infeasible.
+LagrangianBound ComputeLagrangianBound(absl::Span<const double> obj_values,
+                                       absl::Span<const double> weights,
+                                       double rhs);
+
+// Returns the cost of a feasible fractional cover derived from the
+// average solution `scale * sum_solutions`: constraints that aren't
+// fully covered are completed with their cheapest set.  Returns
+// infinity if some constraint has no set at all.
+double ComputeCoverUpperBound(absl::Span<const double> obj_values,
+                              absl::Span<const double> sum_solutions,
+                              double scale,
+                              absl::Span<const CoverConstraint> constraints);
+
+struct FixedColumns {
+  // The sets that can be fixed at 0, in increasing order.
+  std::vector<uint32_t> sets;
+  // The maximum, over all constraints, of the sum of the fixed sets'
+  // upper bounds.
+  double max_uncovered{0};
+};
+
+// Finds sets to fix at 0, given the reduced costs for `bound` and an
+// upper bound on the optimal value, without uncovering any constraint
+// by more than `budget`.  Candidates with larger upper bounds are
+// dropped first when a constraint exceeds the budget.
+FixedColumns FindFixedColumns(absl::Span<const double> obj_values,
+                              absl::Span<const double> weights,
+                              const LagrangianBound& bound, double upper_bound,
+                              absl::Span<const CoverConstraint> constraints,
+                              double budget);
+#endif /* !COLUMN_FIXING_H */
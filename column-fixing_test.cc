@@ -0,0 +1,142 @@
+#include "column-fixing.h"
+
+#include <cmath>
+#include <vector>
+
+#include "driver.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "weight-update.h"
+
+using ::testing::DoubleEq;
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+TEST(ComputeLagrangianBound, BreakItem) {
+  const double costs[] = {1.0, 2.0, 3.0};
+  const double weights[] = {-1.0, -1.0, -1.0};
+
+  // The fractional knapsack takes set 0 and half of set 1, and the
+  // multiplier is set 1's cost per unit of weight.
+  const LagrangianBound bound = ComputeLagrangianBound(costs, weights, -1.5);
+  EXPECT_EQ(bound.lambda, 2.0);
+  EXPECT_EQ(bound.lower_bound, 2.0);
+
+  EXPECT_TRUE(
+      std::isinf(ComputeLagrangianBound(costs, weights, -5.0).lower_bound));
+}
+
+TEST(ComputeCoverUpperBound, ScalesAverageSolution) {
+  const CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({1, 2}),
+  };
+  const double costs[] = {1.0, 2.0, 3.0};
+
+  // The second constraint is only half covered, and set 1 is the
+  // cheapest way to complete it.
+  const double sum_solutions[] = {2.0, 1.0, 0.0};
+  EXPECT_EQ(ComputeCoverUpperBound(costs, sum_solutions, 0.5, constraints),
+            1.0 + 2.0);
+
+  const CoverConstraint empty[] = {CoverConstraint({})};
+  EXPECT_TRUE(std::isinf(ComputeCoverUpperBound(costs, sum_solutions, 1.0,
+                                                empty)));
+}
+
+TEST(FindFixedColumns, RespectsBudget) {
+  const CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({0, 2}),
+  };
+  const double costs[] = {1.0, 10.0, 10.0};
+  const double weights[] = {-2.0, -1.0, -1.0};
+
+  // lambda = 0.5, and the bound is 1, like the optimal cover.
+  const LagrangianBound bound = ComputeLagrangianBound(costs, weights, -2.0);
+  ASSERT_EQ(bound.lambda, 0.5);
+  ASSERT_EQ(bound.lower_bound, 1.0);
+
+  // A closed gap fixes both expensive sets.
+  {
+    const FixedColumns fixed = FindFixedColumns(
+        costs, weights, bound, /*upper_bound=*/1.0, constraints, 1e-3);
+    EXPECT_THAT(fixed.sets, ElementsAre(1, 2));
+    EXPECT_LT(fixed.max_uncovered, 1e-6);
+  }
+
+  // With a gap of 1, each expensive set is at most 1 / 9.5 in an
+  // optimal cover.
+  EXPECT_THAT(FindFixedColumns(costs, weights, bound, /*upper_bound=*/2.0,
+                               constraints, 1e-3)
+                  .sets,
+              IsEmpty());
+  {
+    const FixedColumns fixed = FindFixedColumns(
+        costs, weights, bound, /*upper_bound=*/2.0, constraints, 0.5);
+    EXPECT_THAT(fixed.sets, ElementsAre(1, 2));
+    EXPECT_THAT(fixed.max_uncovered, DoubleNear(1 / 9.5, 1e-6));
+  }
+}
+
+TEST(FindFixedColumns, KeepsOneSetPerConstraint) {
+  const CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({2}),
+  };
+  const double costs[] = {1.0, 10.0, 10.0};
+  const double weights[] = {-2.0, -1.0, 0.0};
+
+  // Set 2 has a positive reduced cost, but it's the only way to
+  // cover the second constraint.
+  const LagrangianBound bound = ComputeLagrangianBound(costs, weights, -2.0);
+  const FixedColumns fixed =
+      FindFixedColumns(costs, weights, bound, bound.lower_bound, constraints,
+                       1e-3);
+  EXPECT_THAT(fixed.sets, ElementsAre(1));
+}
+
+// Set 0 covers everything for 1; the others each cover one value for
+// 100, and can't be in an optimal cover.
+TEST(FixColumns, ExpensiveSets) {
+  CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({0, 2}),
+      CoverConstraint({0, 3}),
+  };
+  const double costs[] = {1.0, 100.0, 100.0, 100.0};
+  DriverState state(costs);
+  AdaHedge ada_hedge;
+
+  for (size_t i = 0; i < 20; ++i) {
+    DriveOneIteration(absl::MakeSpan(constraints), &ada_hedge, &state);
+  }
+
+  const double upper_bound =
+      ComputeCoverUpperBound(costs, state.sum_solutions,
+                             1.0 / state.num_iterations, constraints);
+  ASSERT_THAT(upper_bound, DoubleEq(1.0));
+
+  const PrepareWeightsState prepare_weights =
+      ada_hedge.PrepareWeights(absl::MakeSpan(constraints), &state);
+  const LagrangianBound bound =
+      ComputeLagrangianBound(costs, prepare_weights.knapsack_weights,
+                             prepare_weights.knapsack_rhs);
+  const FixedColumns fixed =
+      FindFixedColumns(costs, prepare_weights.knapsack_weights, bound,
+                       upper_bound, constraints, 1e-3);
+  EXPECT_THAT(fixed.sets, ElementsAre(1, 2, 3));
+
+  const double reduced_costs[] = {1.0};
+  const uint32_t new_index[] = {0, CoverConstraint::kRemovedTour,
+                                CoverConstraint::kRemovedTour,
+                                CoverConstraint::kRemovedTour};
+  RemoveSets(reduced_costs, new_index, absl::MakeSpan(constraints), &state);
+  EXPECT_THAT(state.sum_solutions, ElementsAre(DoubleEq(20.0)));
+  for (const CoverConstraint& constraint : constraints) {
+    EXPECT_THAT(constraint.potential_tours(), ElementsAre(0));
+  }
+
+  DriveOneIteration(absl::MakeSpan(constraints), &ada_hedge, &state);
+  EXPECT_THAT(state.last_solution, ElementsAre(1.0));
+  EXPECT_EQ(state.num_iterations, 21);
+}
+}  // namespace
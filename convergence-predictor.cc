@@ -0,0 +1,91 @@
+#include "convergence-predictor.h"
+
+#include <assert.h>
+
+#include <cmath>
+#include <limits>
+
+namespace {
+// Keep a sample every time the iteration count grows by this factor.
+constexpr double kSampleSpacing = 1.05;
+// Fit over samples in the last `1 / kWindow` of the iterations.
+constexpr double kWindow = 4.0;
+constexpr size_t kMinSamples = 4;
+}  // namespace
+
+void ConvergencePredictor::AddSample(size_t iteration, double value) {
+  assert(iteration > 0);
+  if (!(value > 0)) {
+    return;
+  }
+
+  // Predictions extrapolate from the latest value, sampled or not.
+  latest_iteration_ = iteration;
+  latest_value_ = value;
+  if (!samples_.empty() && iteration < kSampleSpacing * last_sample_) {
+    return;
+  }
+
+  last_sample_ = iteration;
+  samples_.push_back({std::log(static_cast<double>(iteration)),
+                      std::log(value)});
+}
+
+double ConvergencePredictor::PredictRemaining(double target) const {
+  assert(target > 0);
+  constexpr double kInfinity = std::numeric_limits<double>::infinity();
+  if (samples_.empty()) {
+    return kInfinity;
+  }
+
+  if (latest_value_ <= target) {
+    return 0;
+  }
+
+  const double min_log_iteration =
+      samples_.back().log_iteration - std::log(kWindow);
+  size_t n = 0;
+  double sum_x = 0;
+  double sum_y = 0;
+  for (const Sample& sample : samples_) {
+    if (sample.log_iteration >= min_log_iteration) {
+      ++n;
+      sum_x += sample.log_iteration;
+      sum_y += sample.log_value;
+    }
+  }
+
+  if (n < kMinSamples) {
+    return kInfinity;
+  }
+
+  const double mean_x = sum_x / n;
+  const double mean_y = sum_y / n;
+  double cov = 0;
+  double var = 0;
+  for (const Sample& sample : samples_) {
+    if (sample.log_iteration >= min_log_iteration) {
+      const double dx = sample.log_iteration - mean_x;
+      cov += dx * (sample.log_value - mean_y);
+      var += dx * dx;
+    }
+  }
+
+  const double slope = cov / var;
+  if (!(slope < 0)) {
+    return kInfinity;
+  }
+
+  // target = latest_value * (t / latest_iteration)^slope.
+  const double log_ratio =
+      (std::log(target) - std::log(latest_value_)) / slope;
+  const double remaining = latest_iteration_ * std::expm1(log_ratio);
+  return std::isfinite(remaining) ? remaining : kInfinity;
+}
+
+void ConvergencePredictor::Clear() {
+  last_sample_ = 0;
+  latest_iteration_ = 0;
+  latest_value_ = 0;
+  samples_.clear();
+}
@@ -0,0 +1,42 @@
+#ifndef CONVERGENCE_PREDICTOR_H
+#define CONVERGENCE_PREDICTOR_H
+#include <cstddef>
+#include <vector>
+
+// Predicts when a metric that decays polynomially in the iteration
+// count, e.g., the average solution's violation, which is roughly
+// `c * t^-alpha`, will fall to a target.  Fits `log value` against
+// `log t` by least squares over the recent samples, so the estimate
+// tracks changes in the convergence rate.
+//
+// This class is thread-compatible.
+class ConvergencePredictor {
+ public:
+  ConvergencePredictor() = default;
+
+  // Records `value` after `iteration` (> 0) iterations.  Only keeps
+  // samples at geometrically spaced iterations, so memory grows
+  // logarithmically with the iteration count.  Ignores non-positive
+  // values.
+  void AddSample(size_t iteration, double value);
+
+  // Returns the predicted number of iterations after the latest
+  // sample until the value falls to `target` (> 0): 0 if it's already there,
+  // and infinity if the recent samples don't decrease, or are too few.
+  double PredictRemaining(double target) const;
+
+  void Clear();
+
+ private:
+  struct Sample {
+    double log_iteration;
+    double log_value;
+  };
+
+  // The iteration of the last element of `samples_`.
+  size_t last_sample_{0};
+  size_t latest_iteration_{0};
+  double latest_value_{0.0};
+  std::vector<Sample> samples_;
+};
+#endif /* !CONVERGENCE_PREDICTOR_H */
@@ -0,0 +1,51 @@
+#include "convergence-predictor.h"
+
+#include <cmath>
+#include <limits>
+
+#include "gtest/gtest.h"
+
+namespace {
+TEST(ConvergencePredictor, InverseSquareRoot) {
+  ConvergencePredictor predictor;
+  EXPECT_EQ(predictor.PredictRemaining(0.1),
+            std::numeric_limits<double>::infinity());
+
+  for (size_t t = 1; t <= 1000; ++t) {
+    predictor.AddSample(t, 1 / std::sqrt(t));
+  }
+
+  // 1 / sqrt(t) = 0.01 at t = 10000.
+  EXPECT_NEAR(predictor.PredictRemaining(0.01), 9000, 1);
+  EXPECT_EQ(predictor.PredictRemaining(0.5), 0);
+}
+
+TEST(ConvergencePredictor, FollowsRecentRate) {
+  ConvergencePredictor predictor;
+  // Slow at first, then 1 / t from iteration 100 on.
+  for (size_t t = 1; t < 100; ++t) {
+    predictor.AddSample(t, 1.0);
+  }
+
+  for (size_t t = 100; t <= 1000; ++t) {
+    predictor.AddSample(t, 100.0 / t);
+  }
+
+  EXPECT_NEAR(predictor.PredictRemaining(0.01), 9000, 1);
+}
+
+TEST(ConvergencePredictor, Stalled) {
+  ConvergencePredictor predictor;
+  for (size_t t = 1; t <= 1000; ++t) {
+    predictor.AddSample(t, 0.5);
+  }
+
+  EXPECT_EQ(predictor.PredictRemaining(0.1),
+            std::numeric_limits<double>::infinity());
+
+  predictor.Clear();
+  predictor.AddSample(1, 0.5);
+  EXPECT_EQ(predictor.PredictRemaining(0.1),
+            std::numeric_limits<double>::infinity());
+}
+}  // namespace
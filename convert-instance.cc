@@ -0,0 +1,111 @@
+// Converts an OR-Library text instance to the binary instance file
+// format in `instance-file.h`, and compares the time it takes to load
+// the instance from either representation.
+#include <cstdint>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "cover-constraint.h"
+#include "instance-file.h"
+#include "parse-instance.h"
+#include "random-set-cover-instance.h"
+
+ABSL_FLAG(std::string, input, "", "Path to the OR-Library text instance.");
+ABSL_FLAG(std::string, format, "orlib",
+          "Format of the text instance: orlib (scp*) or rail.");
+ABSL_FLAG(std::string, output, "", "Path to the binary instance file.");
+ABSL_FLAG(bool, values_per_set, false,
+          "Whether to also write the set -> values CSR.");
+ABSL_FLAG(bool, compare_load_time, true,
+          "Whether to time loading the instance from text and from the "
+          "binary file.");
+
+namespace {
+bool Convert(const std::string& input, InstanceFormat format,
+             const std::string& output) {
+  absl::optional<RandomSetCoverInstance> instance =
+      ParseInstanceFile(input, format);
+  if (!instance.has_value()) {
+    std::cerr << input << ": failed to parse instance.\n";
+    return false;
+  }
+
+  auto writer =
+      InstanceFileWriter::Create(output, absl::GetFlag(FLAGS_values_per_set));
+  if (writer == nullptr || !writer->AddCosts(instance->obj_values)) {
+    return false;
+  }
+
+  for (const std::vector<uint32_t>& sets : instance->sets_per_value) {
+    if (!writer->AddValue(sets)) {
+      return false;
+    }
+  }
+
+  return writer->Finish();
+}
+
+// Loads the text instance in memory, up to the constraint vector.
+bool LoadText(const std::string& input, InstanceFormat format) {
+  return ParseInstanceFile(input, format).has_value();
+}
+
+bool LoadBinary(const std::string& output) {
+  auto instance = MappedInstance::Open(output, /*verify=*/false);
+  if (instance == nullptr) {
+    return false;
+  }
+
+  std::vector<CoverConstraint> constraints = instance->MakeConstraints();
+  std::cout << "Loaded " << instance->num_sets() << " sets, "
+            << instance->num_values() << " values, "
+            << instance->num_entries() << " entries.\n";
+  return true;
+}
+
+template <typename Fn>
+bool Time(const char* what, Fn fn) {
+  const absl::Time begin = absl::Now();
+  const bool ok = fn();
+  std::cout << what << ": " << (absl::Now() - begin)
+            << (ok ? "" : " (FAILED)") << "\n";
+  return ok;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const std::string input = absl::GetFlag(FLAGS_input);
+  const std::string output = absl::GetFlag(FLAGS_output);
+  if (input.empty() || output.empty()) {
+    std::cerr << "Both --input and --output must be provided.\n";
+    return 1;
+  }
+
+  InstanceFormat format;
+  if (!ParseInstanceFormat(absl::GetFlag(FLAGS_format), &format)) {
+    std::cerr << "Unknown --format " << absl::GetFlag(FLAGS_format) << ".\n";
+    return 1;
+  }
+
+  if (!Time("Convert", [&] { return Convert(input, format, output); })) {
+    return 1;
+  }
+
+  if (absl::GetFlag(FLAGS_compare_load_time)) {
+    if (!Time("Load text", [&] { return LoadText(input, format); }) ||
+        !Time("Load binary", [&] { return LoadBinary(output); })) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
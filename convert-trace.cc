@@ -0,0 +1,49 @@
+// Converts a binary trace file written by `TraceRecorder` (e.g., with
+// random-set-cover --trace_file) to the Chrome trace event JSON
+// format, for chrome://tracing or https://ui.perfetto.dev.
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/types/optional.h"
+#include "trace-recorder.h"
+
+ABSL_FLAG(std::string, input, "", "Path to the binary trace file.");
+ABSL_FLAG(std::string, output, "",
+          "Path to the JSON trace (defaults to stdout).");
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const std::string input = absl::GetFlag(FLAGS_input);
+  if (input.empty()) {
+    std::cerr << "--input is required.\n";
+    return 1;
+  }
+
+  const absl::optional<TraceFile> trace = ReadTraceFile(input);
+  if (!trace.has_value()) {
+    return 1;
+  }
+
+  std::cerr << trace->records.size() << " records, " << trace->num_dropped
+            << " dropped; " << trace->ticks_per_us << " ticks/us.\n";
+
+  const std::string output = absl::GetFlag(FLAGS_output);
+  if (output.empty()) {
+    WriteChromeTrace(*trace, &std::cout);
+    return std::cout.good() ? 0 : 1;
+  }
+
+  std::ofstream out(output);
+  WriteChromeTrace(*trace, &out);
+  out.close();
+  if (!out) {
+    std::cerr << output << ": failed to write.\n";
+    return 1;
+  }
+
+  return 0;
+}
@@ -11,14 +11,17 @@
 #define PREFETCH_DISTANCE 32
 
 namespace {
-double dsum(absl::Span<const double> vec) {
-  double acc = 0;
-  for (double x : vec) {
-    acc += x;
-  }
-
-  return acc;
-}
+// Hedge weights are exactly 0 once eta * (loss - min_loss) reaches
+// this value: `exp256_ps` flushes anything below exp(-87.7) to 0.
+#ifdef NO_VECTORIZE
+constexpr double kUnderflowExponent = 746;
+#else
+constexpr double kUnderflowExponent = 88;
+#endif
+// Extra slack, in the same units, when refreshing the active set.
+constexpr double kActiveSetMargin = 16;
+// Refresh the active set at least this often.
+constexpr size_t kActiveSetRefreshPeriod = 64;
 
 void vinc(absl::Span<const double> src, absl::Span<double> dst) {
   for (size_t i = 0; i < src.size(); ++i) {
@@ -26,22 +29,45 @@ void vinc(absl::Span<const double> src, absl::Span<double> dst) {
   }
 }
 
-void sdec(absl::Span<const uint32_t> indices, absl::Span<const double> weights,
-          absl::Span<double> dst) {
-  for (size_t i = 0, n = indices.size(); i < n; ++i) {
-#ifdef PREFETCH_DISTANCE
-    __builtin_prefetch(&dst[indices[std::min(n - 1, i + PREFETCH_DISTANCE)]]);
-#endif
-    dst[indices[i]] -= weights[i];
+std::shared_ptr<const absl::FixedArray<uint32_t, 0>> usorted(
+    absl::Span<const uint32_t> tours_in) {
+  auto ret = std::make_shared<absl::FixedArray<uint32_t, 0>>(tours_in.begin(),
+                                                             tours_in.end());
+  absl::c_sort(*ret);
+  return ret;
+}
+}  // namespace
+
+double HedgeWeights::Apply(absl::Span<const double> losses,
+                           absl::Span<double> weights) const {
+#ifdef NO_VECTORIZE
+  return ApplyWithForEach(
+      losses, [](size_t, double) {}, weights);
+#else
+  if (std::isinf(eta)) {
+    return ApplyWithForEach(
+        losses, [](size_t, double) {}, weights);
   }
+
+  return internal::ApplyHedgeLoss(losses, min_loss, eta, weights);
+#endif
 }
 
-absl::FixedArray<uint32_t, 0> usorted(absl::Span<const uint32_t> tours_in) {
-  absl::FixedArray<uint32_t, 0> ret(tours_in.begin(), tours_in.end());
-  absl::c_sort(ret);
-  return ret;
+double NormalHedgeWeights::Apply(absl::Span<const double> losses,
+                                 absl::Span<double> weights) const {
+#ifdef NO_VECTORIZE
+  return ApplyWithForEach(
+      losses, [](size_t, double) {}, weights);
+#else
+  if (inv_2scale <= 0) {
+    return ApplyWithForEach(
+        losses, [](size_t, double) {}, weights);
+  }
+
+  return internal::ApplyNormalHedgeLoss(losses, learner_loss, inv_2scale,
+                                        weights);
+#endif
 }
-}  // namespace
 
 void MixLossInfo::Merge(const MixLossInfo& in) {
   num_weights += in.num_weights;
@@ -67,19 +93,113 @@ void UpdateMixLossState::Merge(const UpdateMixLossState& in) {
 }
 
 CoverConstraint::CoverConstraint(absl::Span<const uint32_t> tours_in)
-    : potential_tours_(usorted(tours_in)),
+    : tours_backing_(usorted(tours_in)),
+      potential_tours_(*static_cast<const absl::FixedArray<uint32_t, 0>*>(
+          tours_backing_.get())),
       loss_(potential_tours_.size(), 0.0) {}
 
+CoverConstraint::CoverConstraint(absl::Span<const uint32_t> sorted_tours,
+                                 std::shared_ptr<const void> backing)
+    : tours_backing_(std::move(backing)),
+      potential_tours_(sorted_tours),
+      loss_(potential_tours_.size(), 0.0) {}
+
+CoverConstraint CoverConstraint::BorrowSorted(
+    absl::Span<const uint32_t> sorted_tours) {
+  assert(absl::c_is_sorted(sorted_tours));
+  return CoverConstraint(sorted_tours, nullptr);
+}
+
+void CoverConstraint::AddTours(absl::Span<const uint32_t> new_tours,
+                               double initial_loss) {
+  assert(absl::c_is_sorted(new_tours));
+  assert(new_tours.empty() || potential_tours_.empty() ||
+         new_tours.front() > potential_tours_.back());
+  if (new_tours.empty()) {
+    return;
+  }
+
+  auto tours = std::make_shared<absl::FixedArray<uint32_t, 0>>(
+      potential_tours_.size() + new_tours.size());
+  std::copy(new_tours.begin(), new_tours.end(),
+            std::copy(potential_tours_.begin(), potential_tours_.end(),
+                      tours->begin()));
+
+  potential_tours_ = absl::MakeConstSpan(*tours);
+  tours_backing_ = std::move(tours);
+  loss_.resize(potential_tours_.size(), initial_loss);
+  pruned_ = false;
+  refresh_countdown_ = 0;
+}
+
+size_t CoverConstraint::RemapTours(absl::Span<const uint32_t> new_index) {
+  auto tours = std::make_shared<absl::FixedArray<uint32_t, 0>>(
+      potential_tours_.size());
+  size_t num_kept = 0;
+  size_t new_last_solution = 0;
+  for (size_t i = 0, n = potential_tours_.size(); i < n; ++i) {
+    const uint32_t index = new_index[potential_tours_[i]];
+    if (index == kRemovedTour) {
+      continue;
+    }
+
+    assert(num_kept == 0 || index > (*tours)[num_kept - 1]);
+    if (i == last_solution_) {
+      new_last_solution = num_kept;
+    }
+
+    (*tours)[num_kept] = index;
+    loss_[num_kept] = loss_[i];
+    ++num_kept;
+  }
+
+  loss_.resize(num_kept);
+  potential_tours_ = absl::MakeConstSpan(tours->data(), num_kept);
+  tours_backing_ = std::move(tours);
+  last_solution_ = new_last_solution;
+  pruned_ = false;
+  refresh_countdown_ = 0;
+  return num_kept;
+}
+
+void CoverConstraint::RestoreState(size_t last_solution,
+                                   absl::Span<const double> loss) {
+  assert(loss.size() == loss_.size());
+  last_solution_ = last_solution;
+  std::copy(loss.begin(), loss.end(), loss_.begin());
+  pruned_ = false;
+  refresh_countdown_ = 0;
+}
+
 void CoverConstraint::PrepareWeights(PrepareWeightsState* state) {
+  PrepareWeights(HedgeWeights{state->mix_loss.min_loss, state->mix_loss.eta},
+                 state);
+}
+
+template <typename Weights>
+void CoverConstraint::PrepareWeights(const Weights& weight_fn,
+                                     PrepareWeightsState* state) {
   std::vector<double>& scratch = state->scratch;
 
   if (potential_tours_.empty()) {
     return;
   }
 
-  PopulateWeights(&state->mix_loss, &scratch,
-                  absl::MakeSpan(state->knapsack_weights));
-  state->knapsack_rhs -= SolveSubproblem(scratch);
+  if (refresh_countdown_ == 0 || (pruned_ && !ActiveSetCovers(weight_fn))) {
+    RefreshActiveSet(weight_fn);
+  } else {
+    --refresh_countdown_;
+  }
+
+  const bool active_only =
+      PopulateWeights(weight_fn, &state->mix_loss, &scratch,
+                      &state->active_losses,
+                      absl::MakeSpan(state->knapsack_weights));
+  if (active_only) {
+    state->knapsack_rhs -= SolveActiveSubproblem(scratch);
+  } else {
+    state->knapsack_rhs -= SolveSubproblem(scratch);
+  }
 
   assert(state->knapsack_weights.size() > potential_tours_.back());
 }
@@ -103,6 +223,10 @@ void CoverConstraint::ObserveLoss(ObserveLossState* state) {
     max_loss = (max_loss > cur_loss) ? max_loss : cur_loss;
   }
 
+  if (pruned_ && last_solution_inactive_) {
+    inactive_loss_lb_ = std::min(inactive_loss_lb_, loss_[last_solution_]);
+  }
+
   ObserveLossState current_loss(state->knapsack_solution);
   current_loss.min_loss = min_loss;
   current_loss.max_loss = max_loss;
@@ -112,78 +236,153 @@ void CoverConstraint::ObserveLoss(ObserveLossState* state) {
 }
 
 void CoverConstraint::UpdateMixLoss(UpdateMixLossState* state) const {
+  UpdateMixLoss(HedgeWeights{state->mix_loss.min_loss, state->mix_loss.eta},
+                state);
+}
+
+template <typename Weights>
+void CoverConstraint::UpdateMixLoss(const Weights& weight_fn,
+                                    UpdateMixLossState* state) const {
   std::vector<double>& scratch = state->scratch;
 
   if (potential_tours_.empty()) {
     return;
   }
 
-  PopulateWeights(&state->mix_loss, &scratch);
+  PopulateWeights(weight_fn, &state->mix_loss, &scratch,
+                  &state->active_losses);
 }
 
-void CoverConstraint::PopulateWeights(
-    MixLossInfo* info, std::vector<double>* weights,
+template <typename Weights>
+bool CoverConstraint::PopulateWeights(
+    const Weights& weight_fn, MixLossInfo* info, std::vector<double>* weights,
+    std::vector<double>* active_losses,
     absl::optional<absl::Span<double>> to_decrement) const {
+  const bool active_only = ActiveSetCovers(weight_fn);
+  absl::Span<const double> losses = loss_;
+  if (active_only) {
+    active_losses->resize(active_.size());
+    for (size_t j = 0, m = active_.size(); j < m; ++j) {
+      (*active_losses)[j] = loss_[active_[j]];
+    }
+
+    losses = *active_losses;
+  }
+
   // Ensure geometric growth works despite repeated `resize` calls.
-  const size_t padded_size = potential_tours_.size() + 7;
+  const size_t padded_size = losses.size() + 7;
   if (padded_size > weights->capacity()) {
     weights->reserve(std::max(2 * weights->capacity(), padded_size));
   }
 
   weights->resize(padded_size);
-  const double eta = info->eta;
-  const double min_loss = info->min_loss;
   double sum_weights = 0;
-  if (std::isinf(eta)) {
-    for (size_t i = 0, n = loss_.size(); i < n; ++i) {
-      (*weights)[i] = (loss_[i] == min_loss) ? 1.0 : 0.0;
-    }
-
-    sum_weights = dsum(*weights);
-    if (to_decrement.has_value()) {
-      sdec(potential_tours_, *weights, to_decrement.value());
-    }
-  } else {
-#ifdef NO_VECTORIZE
-    for (size_t i = 0, n = loss_.size(); i < n; ++i) {
-      (*weights)[i] = std::exp(-eta * (loss_[i] - min_loss));
-    }
-
-    sum_weights = dsum(*weights);
-    if (to_decrement.has_value()) {
-      sdec(potential_tours_, *weights, to_decrement.value());
-    }
-#else
-
-    if (to_decrement.has_value()) {
-      const auto dst = to_decrement.value();
-      const size_t n = potential_tours_.size();
-      sum_weights = internal::ApplyHedgeLossWithForEach(
-          loss_, min_loss, eta,
+  if (to_decrement.has_value()) {
+    const auto dst = to_decrement.value();
+    const auto scatter = [&](auto tour) {
+      const size_t n = losses.size();
+      return weight_fn.ApplyWithForEach(
+          losses,
           [&](size_t i, double value) {
 #ifdef PREFETCH_DISTANCE
             __builtin_prefetch(
-                &dst[potential_tours_[std::min(n - 1, i + PREFETCH_DISTANCE)]]);
+                &dst[tour(std::min(n - 1, i + PREFETCH_DISTANCE))]);
 #endif
-            dst[potential_tours_[i]] -= value;
+            dst[tour(i)] -= value;
           },
           absl::MakeSpan(*weights));
+    };
+
+    if (active_only) {
+      sum_weights = scatter(
+          [this](size_t j) { return potential_tours_[active_[j]]; });
     } else {
-      sum_weights = internal::ApplyHedgeLoss(loss_, min_loss, eta,
-                                             absl::MakeSpan(*weights));
+      sum_weights = scatter([this](size_t i) { return potential_tours_[i]; });
     }
-#endif
+  } else {
+    sum_weights = weight_fn.Apply(losses, absl::MakeSpan(*weights));
   }
 
-  weights->resize(potential_tours_.size());
-  info->num_weights += weights->size();
+  weights->resize(losses.size());
+  // Inactive experts still count, with weight 0.
+  info->num_weights += potential_tours_.size();
   info->sum_weights += sum_weights;
+  return active_only;
 }
 
+bool CoverConstraint::ActiveSetCovers(const HedgeWeights& weight_fn) const {
+  return pruned_ && std::isfinite(weight_fn.eta) &&
+         weight_fn.eta * (inactive_loss_lb_ - weight_fn.min_loss) >=
+             kUnderflowExponent;
+}
+
+void CoverConstraint::RefreshActiveSet(const HedgeWeights& weight_fn) {
+  refresh_countdown_ = kActiveSetRefreshPeriod;
+  pruned_ = false;
+  active_.clear();
+  if (!std::isfinite(weight_fn.eta) || !(weight_fn.eta > 0)) {
+    return;
+  }
+
+  const size_t n = loss_.size();
+  const double band = (kUnderflowExponent + kActiveSetMargin) / weight_fn.eta;
+  double inactive_loss_lb = std::numeric_limits<double>::infinity();
+  size_t first_inactive = n;
+  for (size_t i = 0; i < n; ++i) {
+    const double delta = loss_[i] - weight_fn.min_loss;
+    if (delta < band) {
+      active_.push_back(i);
+    } else {
+      inactive_loss_lb = std::min(inactive_loss_lb, loss_[i]);
+      first_inactive = std::min(first_inactive, i);
+    }
+  }
+
+  // Gathering and scattering through `active_` isn't worth it when
+  // most experts are active.
+  if (2 * active_.size() > n) {
+    active_.clear();
+    return;
+  }
+
+  pruned_ = true;
+  first_inactive_ = first_inactive;
+  inactive_loss_lb_ = inactive_loss_lb;
+}
+
+template void CoverConstraint::PrepareWeights(const HedgeWeights&,
+                                              PrepareWeightsState*);
+template void CoverConstraint::PrepareWeights(const NormalHedgeWeights&,
+                                              PrepareWeightsState*);
+template void CoverConstraint::UpdateMixLoss(const HedgeWeights&,
+                                             UpdateMixLossState*) const;
+template void CoverConstraint::UpdateMixLoss(const NormalHedgeWeights&,
+                                             UpdateMixLossState*) const;
+
 // The weight vector is never empty nor negative, so we're looking for (any)
 // min-value weight.
 double CoverConstraint::SolveSubproblem(absl::Span<const double> weights) {
   double ret;
   std::tie(last_solution_, ret) = internal::FindMinValue(weights);
+  last_solution_inactive_ = false;
   return ret;
 }
+
+// Same as `SolveSubproblem`, for weights computed on the active set
+// only: inactive entries have weight 0, so the first of them is a
+// minimum, unless an active entry with weight 0 comes earlier.
+double CoverConstraint::SolveActiveSubproblem(
+    absl::Span<const double> weights) {
+  if (!weights.empty()) {
+    const auto min = internal::FindMinValue(weights);
+    if (min.second <= 0 && active_[min.first] < first_inactive_) {
+      last_solution_ = active_[min.first];
+      last_solution_inactive_ = false;
+      return min.second;
+    }
+  }
+
+  last_solution_ = first_inactive_;
+  last_solution_inactive_ = true;
+  return 0;
+}
@@ -2,6 +2,8 @@
 #define COVER_CONSTRAINT_H
 #include <assert.h>
 
+#include <algorithm>
+#include <cmath>
 #include <cstddef>
 #include <cstdint>
 #include <limits>
@@ -12,12 +14,129 @@
 #include "absl/memory/memory.h"
 #include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "vec.h"
+
+// Weight functions map the experts' cumulative losses to
+// un-normalised weights.  `CoverConstraint`'s weight computations are
+// templated on the weight function, so each weight update algorithm
+// (see weight-update.h) gets its own inlined hot loop.  A weight
+// function has
+//
+//   // Overwrites `weights` (padded to a multiple of 8 entries) with
+//   // the weights for `losses`, and returns their sum.
+//   double Apply(absl::Span<const double> losses,
+//                absl::Span<double> weights) const;
+//
+//   // Same, but also calls `fn(i, weights[i])` for each weight.
+//   template <typename Fn>
+//   double ApplyWithForEach(absl::Span<const double> losses,
+//                           const Fn& fn, absl::Span<double> weights) const;
+
+// Hedge weights: exp(-eta (loss - min_loss)).  An infinite `eta`
+// only assigns (unit) weights to experts with loss `min_loss`.
+struct HedgeWeights {
+  double min_loss;
+  double eta;
+
+  double Apply(absl::Span<const double> losses,
+               absl::Span<double> weights) const;
+  template <typename Fn>
+  double ApplyWithForEach(absl::Span<const double> losses, const Fn& fn,
+                          absl::Span<double> weights) const;
+};
+
+// NormalHedge weights: (r / c) exp(r^2 / 2c), for the regret
+// r = max(0, learner_loss - loss).  `inv_2scale` is 1 / 2c; 0
+// denotes the initial uniform distribution, when no expert has
+// positive regret.
+struct NormalHedgeWeights {
+  double learner_loss;
+  double inv_2scale;
+
+  double Apply(absl::Span<const double> losses,
+               absl::Span<double> weights) const;
+  template <typename Fn>
+  double ApplyWithForEach(absl::Span<const double> losses, const Fn& fn,
+                          absl::Span<double> weights) const;
+};
+
+template <typename Fn>
+double HedgeWeights::ApplyWithForEach(absl::Span<const double> losses,
+                                      const Fn& fn,
+                                      absl::Span<double> weights) const {
+  const size_t n = losses.size();
+  if (std::isinf(eta)) {
+    double sum_weights = 0;
+    for (size_t i = 0; i < n; ++i) {
+      weights[i] = (losses[i] == min_loss) ? 1.0 : 0.0;
+      sum_weights += weights[i];
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      fn(i, weights[i]);
+    }
+
+    return sum_weights;
+  }
+
+#ifdef NO_VECTORIZE
+  double sum_weights = 0;
+  for (size_t i = 0; i < n; ++i) {
+    weights[i] = std::exp(-eta * (losses[i] - min_loss));
+    sum_weights += weights[i];
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    fn(i, weights[i]);
+  }
+
+  return sum_weights;
+#else
+  return internal::ApplyHedgeLossWithForEach(losses, min_loss, eta, fn,
+                                             weights);
+#endif
+}
+
+template <typename Fn>
+double NormalHedgeWeights::ApplyWithForEach(absl::Span<const double> losses,
+                                            const Fn& fn,
+                                            absl::Span<double> weights) const {
+  const size_t n = losses.size();
+  if (inv_2scale <= 0) {
+    std::fill(weights.begin(), weights.begin() + n, 1.0);
+    for (size_t i = 0; i < n; ++i) {
+      fn(i, weights[i]);
+    }
+
+    return n;
+  }
+
+#ifdef NO_VECTORIZE
+  double sum_weights = 0;
+  for (size_t i = 0; i < n; ++i) {
+    const double regret = std::max(0.0, learner_loss - losses[i]);
+    weights[i] =
+        2 * inv_2scale * regret * std::exp(inv_2scale * regret * regret);
+    sum_weights += weights[i];
+  }
+
+  for (size_t i = 0; i < n; ++i) {
+    fn(i, weights[i]);
+  }
+
+  return sum_weights;
+#else
+  return internal::ApplyNormalHedgeLossWithForEach(losses, learner_loss,
+                                                   inv_2scale, fn, weights);
+#endif
+}
 
 struct MixLossInfo {
   explicit MixLossInfo(double min_loss_in, double eta_in)
       : min_loss(min_loss_in), eta(eta_in) {}
 
   const double min_loss;
+  // The Hedge step size; ignored by other weight functions.
   const double eta;
   size_t num_weights{0};
   double sum_weights{0};
@@ -51,6 +170,8 @@ struct PrepareWeightsState {
 
   MixLossInfo mix_loss;
   std::vector<double> scratch;
+  // Cumulative losses for the active experts, gathered contiguously.
+  std::vector<double> active_losses;
 
   absl::Span<double> knapsack_weights;
   double knapsack_rhs{0};
@@ -83,6 +204,8 @@ struct UpdateMixLossState {
 
   MixLossInfo mix_loss;
   std::vector<double> scratch;
+  // Cumulative losses for the active experts, gathered contiguously.
+  std::vector<double> active_losses;
 
   void Merge(const UpdateMixLossState& in);
 };
@@ -93,6 +216,12 @@ class CoverConstraint {
  public:
   explicit CoverConstraint(absl::Span<const uint32_t> tours_in);
 
+  // Returns a constraint that refers to `sorted_tours` directly,
+  // without copying the indices.  The tours must be sorted in
+  // increasing order, and the backing storage must outlive the
+  // constraint and all its copies.
+  static CoverConstraint BorrowSorted(absl::Span<const uint32_t> sorted_tours);
+
   // Copyable and movable, but not assignable.
   CoverConstraint(const CoverConstraint&) = default;
   CoverConstraint(CoverConstraint&&) = default;
@@ -102,7 +231,12 @@ class CoverConstraint {
   // `state->sum_weights` is updated with the sum of un-normalised
   // weights, and so are the entries corresponding to `potential_tours`
   // in `state->knapsack_Weights`.
+  //
+  // The weights are Hedge weights with `state->mix_loss`'s `min_loss`
+  // and `eta`, unless a weight function is passed explicitly.
   void PrepareWeights(PrepareWeightsState* state);
+  template <typename Weights>
+  void PrepareWeights(const Weights& weight_fn, PrepareWeightsState* state);
 
   // Updates the cover constraint's internal loss accumulator, and
   // updates `state` accordingly.
@@ -114,24 +248,94 @@ class CoverConstraint {
   // Recomputes the posterior mix loss given the end-of-iteration `state`.
   // Increments `sum_weights` with the un-normalised posterior weights.
   void UpdateMixLoss(UpdateMixLossState* state) const;
+  template <typename Weights>
+  void UpdateMixLoss(const Weights& weight_fn,
+                     UpdateMixLossState* state) const;
+
+  // Appends `new_tours` to the potential tours, with cumulative loss
+  // `initial_loss`.  The new tours must be sorted, and greater than
+  // all existing tours (i.e., new sets are appended at the end of the
+  // instance).  Existing losses are preserved, so the weights for old
+  // tours only change through normalisation.
+  //
+  // The tour indices are copied to fresh storage owned by this
+  // constraint; copies made before the call are unaffected.
+  void AddTours(absl::Span<const uint32_t> new_tours, double initial_loss);
+
+  // Marks tours removed by `RemapTours`.
+  static constexpr uint32_t kRemovedTour = ~uint32_t{0};
+
+  // Renumbers each potential tour `t` to `new_index[t]`, and drops
+  // those mapped to `kRemovedTour`, along with their losses.  The
+  // mapping must preserve the order of the remaining tours.  Returns
+  // the number of remaining tours.
+  //
+  // Like `AddTours`, the new indices are stored in fresh storage.
+  size_t RemapTours(absl::Span<const uint32_t> new_index);
+
+  // Overwrites the cumulative losses and last subproblem solution,
+  // e.g., when restoring from a checkpoint.  `loss` must have one
+  // entry per potential tour.
+  void RestoreState(size_t last_solution, absl::Span<const double> loss);
+
+  // The cumulative losses are also read by weight update algorithms
+  // that need a global pass over all experts, e.g., NormalHedge's
+  // scale search.
+  absl::Span<const double> loss() const { return loss_; }
 
   // These getters are only exposed for testing.
   size_t last_solution() const { return last_solution_; }
-  absl::Span<const double> loss() const { return loss_; }
+  // The number of experts whose weights are computed explicitly.
+  size_t num_active() const {
+    return pruned_ ? active_.size() : potential_tours_.size();
+  }
+  absl::Span<const uint32_t> potential_tours() const {
+    return potential_tours_;
+  }
 
  private:
+  CoverConstraint(absl::Span<const uint32_t> sorted_tours,
+                  std::shared_ptr<const void> backing);
+
   // Populates `weights` with the un-normalised weights for this iteration, and
   // updates the accumulators in `info`.
   //
   // If `to_decrement` is provided, to_decerement[potential_tours_[i]] -=
   // (*weights)[i];
-  void PopulateWeights(
-      MixLossInfo* info, std::vector<double>* weights,
+  //
+  // Returns true if the weights were only computed for the active
+  // set, in which case `weights[j]` is the weight for
+  // `potential_tours_[active_[j]]`, and all other weights are 0.
+  // `active_losses` is scratch space for that case.
+  template <typename Weights>
+  bool PopulateWeights(
+      const Weights& weight_fn, MixLossInfo* info,
+      std::vector<double>* weights, std::vector<double>* active_losses,
       absl::optional<absl::Span<double>> to_decrement = absl::nullopt) const;
 
+  // Returns whether the active set is valid for `weight_fn`, i.e.,
+  // whether all inactive experts get a weight of exactly 0.  Only
+  // Hedge weights use an active set.
+  bool ActiveSetCovers(const HedgeWeights& weight_fn) const;
+  template <typename Weights>
+  bool ActiveSetCovers(const Weights&) const {
+    return false;
+  }
+
+  // Recomputes the active set for `weight_fn`, with some slack for
+  // `min_loss` to increase and `eta` to decrease before the next
+  // refresh.
+  void RefreshActiveSet(const HedgeWeights& weight_fn);
+  template <typename Weights>
+  void RefreshActiveSet(const Weights&) {
+    pruned_ = false;
+  }
+
   // Finds the min weight solution to this covering constraint, and
   // stores it in `last_solution`.
   double SolveSubproblem(absl::Span<const double> weights);
+  // Same, for weights computed on the active set.
+  double SolveActiveSubproblem(absl::Span<const double> weights);
 
   // The cloning constraints are of the form [x_clone - x_orig <= 0].
   // The loss corresponds to the satisfaction of this constraint,
@@ -139,13 +343,34 @@ class CoverConstraint {
   //
   // Given weight w for this constraint, the surrogate subproblem's
   // linear constraint gains [-w x_orig <= - w x_clone].
-  const absl::FixedArray<uint32_t, 0> potential_tours_;
+  //
+  // The indices are sorted, and live in `tours_backing_` when owned
+  // by the constraint (copies share the same immutable storage), or
+  // in some external storage (e.g., a memory-mapped instance file).
+  std::shared_ptr<const void> tours_backing_;
+  absl::Span<const uint32_t> potential_tours_;
 
   size_t last_solution_{-1ULL};
   // Loss tracks satisfaction for the cloning constraints, i.e., how
   // often the master picks a variable that we didn't.
   //
   // The values in this array are cumulative.
-  absl::FixedArray<double, 0> loss_;
+  std::vector<double> loss_;
+
+  // Once losses have spread out, most Hedge weights underflow to
+  // exactly 0.  When `pruned_` is true, weights are only computed for
+  // the sorted indices in `active_`; every other entry has a weight
+  // of 0 as long as `ActiveSetCovers` holds.  `inactive_loss_lb_` is
+  // a lower bound on the losses of inactive entries; losses only
+  // decrease when the entry is picked by the subproblem, so the bound
+  // is only updated when `last_solution_` is inactive.
+  bool pruned_{false};
+  bool last_solution_inactive_{false};
+  size_t first_inactive_{0};
+  double inactive_loss_lb_{0};
+  // Iterations until the next periodic refresh, which picks up newly
+  // negligible entries.
+  size_t refresh_countdown_{0};
+  std::vector<uint32_t> active_;
 };
 #endif /* !COVER_CONSTRAINT_H */
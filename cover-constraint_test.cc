@@ -210,3 +210,85 @@ TEST(CoverConstraint, SecondInfinityIteration) {
                 DoubleNear(0.5 + std::exp(0.9 - 1.0) + 1.0 + 1.0, 1e-5));
   }
 }
+
+TEST(CoverConstraint, AddTours) {
+  CoverConstraint constraint({0, 3, 1});
+
+  std::vector<double> knapsack_solution = {0.1, 1.0, 1.0, 0.0, 0.0, 0.0};
+  {
+    PrepareWeightsState prep_state(4, 0.0,
+                                   std::numeric_limits<double>::infinity());
+    constraint.PrepareWeights(&prep_state);
+    ObserveLossState loss_state(knapsack_solution);
+    constraint.ObserveLoss(&loss_state);
+    ASSERT_THAT(constraint.loss(), ElementsAre(-0.9, 1.0, 0));
+  }
+
+  // Copies keep the old tours.
+  const CoverConstraint copy(constraint);
+  const uint32_t new_tours[] = {4, 5};
+  constraint.AddTours(new_tours, -0.5);
+  EXPECT_THAT(constraint.potential_tours(), ElementsAre(0, 1, 3, 4, 5));
+  EXPECT_THAT(constraint.loss(), ElementsAre(-0.9, 1.0, 0, -0.5, -0.5));
+  EXPECT_THAT(copy.potential_tours(), ElementsAre(0, 1, 3));
+  EXPECT_THAT(copy.loss(), ElementsAre(-0.9, 1.0, 0));
+
+  // The new tours participate in the next iteration.
+  PrepareWeightsState prep_state(6, -0.9,
+                                 std::numeric_limits<double>::infinity());
+  constraint.PrepareWeights(&prep_state);
+  EXPECT_EQ(prep_state.mix_loss.num_weights, 5);
+  EXPECT_EQ(prep_state.mix_loss.sum_weights, 1.0);
+  EXPECT_THAT(prep_state.knapsack_weights,
+              ElementsAre(-1.0, 0.0, 0.0, 0.0, 0.0, 0.0));
+}
+
+TEST(CoverConstraint, ActiveSet) {
+  CoverConstraint constraint({0, 1, 2, 3, 4, 5});
+  const double losses[] = {0.0, 110.0, 0.5, 200.0, 300.0, 150.0};
+  constraint.RestoreState(0, losses);
+
+  // With eta = 1, the weights for tours 1, 3, 4 and 5 underflow to 0,
+  // so only tours 0 and 2 are active.
+  PrepareWeightsState prep_state(6, 0.0, 1.0);
+  constraint.PrepareWeights(&prep_state);
+  EXPECT_EQ(constraint.num_active(), 2);
+  EXPECT_EQ(prep_state.mix_loss.num_weights, 6);
+  EXPECT_THAT(prep_state.mix_loss.sum_weights,
+              DoubleNear(1.0 + std::exp(-0.5), 1e-5));
+  EXPECT_THAT(prep_state.knapsack_weights,
+              ElementsAre(-1.0, 0.0, DoubleNear(-std::exp(-0.5), 1e-5), 0.0,
+                          0.0, 0.0));
+  // The first inactive tour has the min (zero) weight.
+  EXPECT_EQ(constraint.last_solution(), 1);
+  EXPECT_EQ(prep_state.knapsack_rhs, 0.0);
+
+  std::vector<double> knapsack_solution(6, 0.0);
+  ObserveLossState loss_state(knapsack_solution);
+  constraint.ObserveLoss(&loss_state);
+  EXPECT_THAT(constraint.loss(),
+              ElementsAre(0.0, 109.0, 0.5, 200.0, 300.0, 150.0));
+
+  // Halving eta brings tours 1, 3 and 5 back, and then most tours are
+  // active, so the constraint stops pruning.
+  PrepareWeightsState next_state(6, 0.0, 0.5);
+  constraint.PrepareWeights(&next_state);
+  EXPECT_EQ(constraint.num_active(), 6);
+  EXPECT_EQ(next_state.knapsack_weights[0], -1.0);
+  EXPECT_THAT(next_state.knapsack_weights[1],
+              DoubleNear(-std::exp(-54.5), 1e-25));
+}
+
+TEST(CoverConstraint, RemapTours) {
+  CoverConstraint constraint({0, 1, 3, 4});
+  const double losses[] = {1.0, 2.0, 3.0, 4.0};
+  constraint.RestoreState(2, losses);
+
+  const uint32_t kRemoved = CoverConstraint::kRemovedTour;
+  const uint32_t new_index[] = {0, kRemoved, kRemoved, 1, 2};
+  EXPECT_EQ(constraint.RemapTours(new_index), 3);
+  EXPECT_THAT(constraint.potential_tours(), ElementsAre(0, 1, 2));
+  EXPECT_THAT(constraint.loss(), ElementsAre(1.0, 3.0, 4.0));
+  // Tour 3 is still the last solution.
+  EXPECT_EQ(constraint.last_solution(), 1);
+}
@@ -1,10 +1,13 @@
 #include "driver.h"
 
+#include <algorithm>
 #include <cmath>
 #include <limits>
+#include <vector>
 
 #include "cover-constraint.h"
 #include "knapsack.h"
+#include "weight-update.h"
 
 namespace {
 constexpr double kEps = 1e-8;
@@ -20,9 +23,28 @@ double LowerBoundObjectiveValue(absl::Span<const double> values) {
   return acc;
 }
 
-double ComputeMixLoss(const MixLossInfo& info) {
-  return info.min_loss -
-         std::log(info.sum_weights / info.num_weights) / info.eta;
+// Returns the entries of `src` that are not removed by `new_index`.
+BigVec<double> Compact(const BigVec<double>& src,
+                       absl::Span<const uint32_t> new_index, size_t size,
+                       BigVecArena* arena) {
+  assert(src.size() == new_index.size());
+  BigVec<double> ret = arena->CreateUninit<double>(size);
+  for (size_t i = 0, n = src.size(); i < n; ++i) {
+    if (new_index[i] != CoverConstraint::kRemovedTour) {
+      ret[new_index[i]] = src[i];
+    }
+  }
+
+  return ret;
+}
+
+// Returns a copy of `src` padded with zeros to `size` entries.
+BigVec<double> ZeroExtend(const BigVec<double>& src, size_t size,
+                          BigVecArena* arena) {
+  assert(size >= src.size());
+  BigVec<double> ret = arena->CreateUninit<double>(size, /*zero_fill=*/true);
+  std::copy(src.begin(), src.end(), ret.begin());
+  return ret;
 }
 
 void dxpy(absl::Span<const double> src, absl::Span<double> acc) {
@@ -33,26 +55,6 @@ void dxpy(absl::Span<const double> src, absl::Span<double> acc) {
   }
 }
 
-PrepareWeightsState PrepareAllWeights(absl::Span<CoverConstraint> constraints,
-                                      DriverState* state) {
-  // Step size.
-  double eta = std::numeric_limits<double>::infinity();
-  if (state->sum_mix_gap > 0) {
-    eta = std::log(std::max<size_t>(2, state->prev_num_non_zero)) /
-          state->sum_mix_gap;
-  }
-
-  PrepareWeightsState ret(
-      state->arena.CreateUninit<double>(state->obj_values.size(),
-                                        /*zero_fill=*/true),
-      state->prev_min_loss, eta);
-  for (auto& constraint : constraints) {
-    constraint.PrepareWeights(&ret);
-  }
-
-  return ret;
-}
-
 double ComputeTargetObjectiveValue(const DriverState& state) {
   const double best_bound = state.best_bound;
   const double sum_value = state.sum_solution_value;
@@ -60,8 +62,8 @@ double ComputeTargetObjectiveValue(const DriverState& state) {
   assert(std::isfinite(best_bound));
   assert(std::isfinite(sum_value));
 
+  // The sum may exceed the target after `AddSets` resets the bound.
   double sum_best_bound = best_bound * (state.num_iterations + 1);
-  assert(sum_best_bound + kEps >= sum_value);
   sum_best_bound = std::max(sum_best_bound, sum_value);
   // If the objective value hits target_objective_value, the new sum
   // of solution values will yield an average of exactly
@@ -69,11 +71,11 @@ double ComputeTargetObjectiveValue(const DriverState& state) {
   return sum_best_bound - sum_value;
 }
 
-// Finds a solution for the new knapsack master problem, and updates
-// all the counters related to the master knapsack solutions, and
-// returns the observed loss (rescaled for probabilities).
-//
-// Stores the master solution in `state->last_solution`
+xs256* KnapsackPrng(DriverState* state) {
+  return state->knapsack_prng.has_value() ? &*state->knapsack_prng : nullptr;
+}
+}  // namespace
+
 double UpdateStateWithNewRelaxedSolution(
     const PrepareWeightsState& prepare_weights, DriverState* state) {
   const double target_objective_value = ComputeTargetObjectiveValue(*state);
@@ -81,11 +83,29 @@ double UpdateStateWithNewRelaxedSolution(
   // Borrow storage for the solution, and move it back into place
   // before returning.
   state->last_solution.clear();
-  KnapsackSolution master_sol =
-      SolveKnapsack(state->obj_values, prepare_weights.knapsack_weights,
-                    prepare_weights.knapsack_rhs, kEps, target_objective_value,
-                    &state->arena);
+  KnapsackSolution master_sol = SolveKnapsack(
+      state->obj_values, prepare_weights.knapsack_weights,
+      prepare_weights.knapsack_rhs, kEps, target_objective_value,
+      &state->arena, KnapsackPrng(state));
+  return RecordRelaxedSolution(std::move(master_sol),
+                               prepare_weights.mix_loss.sum_weights, state);
+}
 
+double SolveRelaxedKnapsack(KnapsackBuilder knapsack, double rhs,
+                            double sum_weights, double weight_scale,
+                            DriverState* state) {
+  assert(weight_scale > 0);
+  const double target_objective_value = ComputeTargetObjectiveValue(*state);
+  state->last_solution.clear();
+  KnapsackSolution master_sol = std::move(knapsack).Solve(
+      rhs, kEps / weight_scale, target_objective_value, KnapsackPrng(state));
+  master_sol.feasibility *= weight_scale;
+  return RecordRelaxedSolution(std::move(master_sol),
+                               weight_scale * sum_weights, state);
+}
+
+double RecordRelaxedSolution(KnapsackSolution master_sol, double sum_weights,
+                             DriverState* state) {
   dxpy(master_sol.solution, absl::MakeSpan(state->sum_solutions));
   state->sum_solution_value += master_sol.objective_value;
   state->num_iterations++;
@@ -96,9 +116,10 @@ double UpdateStateWithNewRelaxedSolution(
   }
 
   state->last_solution_value = master_sol.objective_value;
+  state->last_solution_feasibility = master_sol.feasibility;
+  state->last_sum_weights = sum_weights;
 
-  const double observed_loss =
-      master_sol.feasibility / prepare_weights.mix_loss.sum_weights;
+  const double observed_loss = master_sol.feasibility / sum_weights;
   state->sum_solution_feasibility += observed_loss;
 
   state->last_solution = std::move(master_sol.solution);
@@ -106,7 +127,6 @@ double UpdateStateWithNewRelaxedSolution(
   return observed_loss;
 }
 
-// Observes losses for all constraints and updates the loss trackers in state.
 ObserveLossState ObserveAllLosses(absl::Span<CoverConstraint> constraints,
                                   DriverState* state) {
   ObserveLossState observe_state(state->last_solution);
@@ -114,26 +134,16 @@ ObserveLossState ObserveAllLosses(absl::Span<CoverConstraint> constraints,
     constraint.ObserveLoss(&observe_state);
   }
 
-  state->prev_min_loss = observe_state.min_loss;
-  state->prev_max_loss = observe_state.max_loss;
-  state->max_last_solution_infeasibility = observe_state.max_infeasibility;
+  RecordObservedLosses(observe_state, state);
   return observe_state;
 }
 
-UpdateMixLossState UpdateAllMixLosses(
-    absl::Span<CoverConstraint> constraints,
-    const PrepareWeightsState& prepare_weights,
-    const ObserveLossState& observe_state, DriverState* state) {
-  UpdateMixLossState update_state(observe_state.min_loss,
-                                  prepare_weights.mix_loss.eta);
-  for (auto& constraint : constraints) {
-    constraint.UpdateMixLoss(&update_state);
-  }
-
-  state->prev_num_non_zero = update_state.mix_loss.num_weights;
-  return update_state;
+void RecordObservedLosses(const ObserveLossState& observe_state,
+                          DriverState* state) {
+  state->prev_min_loss = observe_state.min_loss;
+  state->prev_max_loss = observe_state.max_loss;
+  state->max_last_solution_infeasibility = observe_state.max_infeasibility;
 }
-}  // namespace
 
 DriverState::DriverState(absl::Span<const double> obj_values_in)
     : obj_values(obj_values_in),
@@ -142,51 +152,186 @@ DriverState::DriverState(absl::Span<const double> obj_values_in)
       arena.CreateUninit<double>(obj_values.size(), /*zero_fill=*/true);
 }
 
-void DriveOneIteration(absl::Span<CoverConstraint> constraints,
-                       DriverState* state) {
-  const absl::Time begin = absl::Now();
-  absl::Time last_time = begin;
-  const auto track = [&last_time](absl::Duration* instant,
-                                  absl::Duration* acc) {
-    absl::Time end = absl::Now();
-    absl::Duration elapsed = end - last_time;
-    *instant = elapsed;
-    *acc += elapsed;
-    last_time = end;
-  };
+PerfCounts PhasePerfCounts::Total() const {
+  PerfCounts ret = prepare;
+  ret += knapsack;
+  ret += observe;
+  ret += update;
+  return ret;
+}
 
-  const PrepareWeightsState prepare_weights =
-      PrepareAllWeights(constraints, state);
-  track(&state->last_prepare_time, &state->prepare_time);
+PhaseTracker::PhaseTracker(DriverState* state)
+    : state_(state), begin_(absl::Now()), last_time_(begin_) {
+  if (state_->perf_counters != nullptr) {
+    state_->last_perf_counts = PhasePerfCounts();
+    last_counts_ = state_->perf_counters->Read();
+  }
+
+  if (state_->trace != nullptr) {
+    iteration_ = state_->num_iterations;
+    begin_tsc_ = last_tsc_ = TraceRecorder::Now();
+  }
+}
+
+void PhaseTracker::Track(TraceSpan span, absl::Duration* instant,
+                         absl::Duration* acc, PerfCounts* instant_counts,
+                         PerfCounts* acc_counts) {
+  // Read the counters first, so they don't count `absl::Now()`.
+  if (state_->perf_counters != nullptr) {
+    const PerfCounts counts = state_->perf_counters->Read();
+    *instant_counts = counts - last_counts_;
+    *acc_counts += *instant_counts;
+    last_counts_ = counts;
+  }
 
-  const double prev_mix_loss = ComputeMixLoss(prepare_weights.mix_loss);
+  if (state_->trace != nullptr) {
+    const uint64_t now = TraceRecorder::Now();
+    state_->trace->RecordSpan(span, iteration_, last_tsc_, now);
+    last_tsc_ = now;
+  }
+
+  const absl::Time end = absl::Now();
+  const absl::Duration elapsed = end - last_time_;
+  *instant = elapsed;
+  *acc += elapsed;
+  last_time_ = end;
+}
+
+void PhaseTracker::Finish() {
+  if (state_->trace != nullptr) {
+    state_->trace->RecordSpan(TraceSpan::kIteration, iteration_, begin_tsc_,
+                              TraceRecorder::Now());
+  }
+
+  const absl::Duration elapsed = absl::Now() - begin_;
+  state_->last_iteration_time = elapsed;
+  state_->total_time += elapsed;
+}
+
+template <typename WeightUpdateAlgorithm>
+void DriveOneIteration(absl::Span<CoverConstraint> constraints,
+                       WeightUpdateAlgorithm* algorithm, DriverState* state) {
+  PhaseTracker tracker(state);
+  const PrepareWeightsState prepare_weights =
+      algorithm->PrepareWeights(constraints, state);
+  tracker.Prepare();
 
   const double observed_loss =
       UpdateStateWithNewRelaxedSolution(prepare_weights, state);
-  track(&state->last_knapsack_time, &state->knapsack_time);
+  tracker.Knapsack();
 
   // Nothing to do here: we have an infeasible problem!
   if (!state->feasible) {
-    const absl::Duration elapsed = absl::Now() - begin;
-    state->last_iteration_time = elapsed;
-    state->total_time += elapsed;
+    tracker.Finish();
     return;
   }
 
   const ObserveLossState observe_state = ObserveAllLosses(constraints, state);
-  track(&state->last_observe_time, &state->observe_time);
+  tracker.Observe();
+
+  algorithm->UpdateWeights(constraints, prepare_weights, observe_state,
+                           observed_loss, state);
+  tracker.Update();
+  tracker.Finish();
+}
+
+template void DriveOneIteration(absl::Span<CoverConstraint>, AdaHedge*,
+                                DriverState*);
+template void DriveOneIteration(absl::Span<CoverConstraint>, NormalHedge*,
+                                DriverState*);
 
-  const UpdateMixLossState update_state =
-      UpdateAllMixLosses(constraints, prepare_weights, observe_state, state);
-  track(&state->last_update_time, &state->update_time);
+void DriveOneIteration(absl::Span<CoverConstraint> constraints,
+                       DriverState* state) {
+  AdaHedge ada_hedge;
+  DriveOneIteration(constraints, &ada_hedge, state);
+}
+
+void AddSets(absl::Span<const double> obj_values,
+             absl::Span<const std::vector<uint32_t>> values_per_new_set,
+             absl::Span<CoverConstraint> constraints, DriverState* state,
+             absl::Span<const double> initial_loss) {
+  assert(initial_loss.empty() || initial_loss.size() == constraints.size());
+  const size_t old_num_sets = state->obj_values.size();
+  assert(obj_values.size() == old_num_sets + values_per_new_set.size());
+
+  // Transpose the new sets into the new tours for each constraint.
+  // Tours are generated in increasing order, so each list is sorted.
+  std::vector<std::vector<uint32_t>> new_tours(constraints.size());
+  bool any_new_tour = false;
+  for (size_t i = 0; i < values_per_new_set.size(); ++i) {
+    const uint32_t set = old_num_sets + i;
+    for (const uint32_t value : values_per_new_set[i]) {
+      assert(value < constraints.size());
+      std::vector<uint32_t>& tours = new_tours[value];
+      if (tours.empty() || tours.back() != set) {
+        tours.push_back(set);
+        any_new_tour = true;
+      }
+    }
+  }
 
-  const double mix_loss = ComputeMixLoss(update_state.mix_loss);
-  state->sum_mix_gap +=
-      std::max(0.0, observed_loss - (mix_loss - prev_mix_loss));
+  double min_new_loss = std::numeric_limits<double>::max();
+  double max_new_loss = std::numeric_limits<double>::lowest();
+  for (size_t i = 0; i < constraints.size(); ++i) {
+    if (new_tours[i].empty()) {
+      continue;
+    }
+
+    const double loss = initial_loss.empty() ? kNewTourLoss : initial_loss[i];
+    constraints[i].AddTours(new_tours[i], loss);
+    min_new_loss = std::min(min_new_loss, loss);
+    max_new_loss = std::max(max_new_loss, loss);
+  }
+
+  state->obj_values = obj_values;
+  state->sum_solutions =
+      ZeroExtend(state->sum_solutions, obj_values.size(), &state->arena);
+  if (state->last_solution.size() == old_num_sets && old_num_sets > 0) {
+    state->last_solution =
+        ZeroExtend(state->last_solution, obj_values.size(), &state->arena);
+  }
+
+  if (!values_per_new_set.empty()) {
+    state->best_bound = LowerBoundObjectiveValue(obj_values);
+  }
+
+  if (any_new_tour) {
+    state->prev_min_loss = std::min(state->prev_min_loss, min_new_loss);
+    state->prev_max_loss = std::max(state->prev_max_loss, max_new_loss);
+  }
+}
+
+void RemoveSets(absl::Span<const double> obj_values,
+                absl::Span<const uint32_t> new_index,
+                absl::Span<CoverConstraint> constraints, DriverState* state) {
+  assert(new_index.size() == state->obj_values.size());
+
+  double min_loss = std::numeric_limits<double>::max();
+  double max_loss = std::numeric_limits<double>::lowest();
+  for (auto& constraint : constraints) {
+    constraint.RemapTours(new_index);
+    for (const double loss : constraint.loss()) {
+      min_loss = std::min(min_loss, loss);
+      max_loss = std::max(max_loss, loss);
+    }
+  }
+
+  const size_t old_num_sets = state->obj_values.size();
+  state->obj_values = obj_values;
+  state->sum_solutions = Compact(state->sum_solutions, new_index,
+                                 obj_values.size(), &state->arena);
+  if (state->last_solution.size() == old_num_sets && old_num_sets > 0) {
+    state->last_solution = Compact(state->last_solution, new_index,
+                                   obj_values.size(), &state->arena);
+  }
 
-  {
-    const absl::Duration elapsed = absl::Now() - begin;
-    state->total_time += elapsed;
-    state->last_iteration_time = elapsed;
+  // The extreme losses may have belonged to removed tours.  Removing
+  // sets can only raise the optimal value, so `best_bound` remains a
+  // bound for the reduced instance; later bounds may exceed the
+  // original instance's optimal value, and callers that report them
+  // for it must scale them down (see `SetCoverSolver`).
+  if (min_loss <= max_loss) {
+    state->prev_min_loss = min_loss;
+    state->prev_max_loss = max_loss;
   }
 }
@@ -1,14 +1,39 @@
 #ifndef DRIVER_H
 #define DRIVER_H
 #include <cstddef>
+#include <cstdint>
 #include <limits>
 #include <vector>
 
 #include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 
 #include "big-vec.h"
 #include "cover-constraint.h"
+#include "knapsack.h"
+#include "perf-counters.h"
+#include "prng.h"
+#include "trace-recorder.h"
+
+// Hardware event counts for each phase of an iteration.
+struct PhasePerfCounts {
+  PerfCounts Total() const;
+
+  PerfCounts prepare;
+  PerfCounts knapsack;
+  PerfCounts observe;
+  PerfCounts update;
+};
+
+// How `PipelinedDriver` prepared the weights for iteration
+// `iteration`: its step size lags by one iteration, and fused passes
+// make the weights relative to a lower bound on the minimum loss.
+struct PipelinedStep {
+  size_t iteration;
+  double eta;
+  double min_loss;
+};
 
 struct DriverState {
   explicit DriverState(absl::Span<const double> obj_values_in);
@@ -22,6 +47,9 @@ struct DriverState {
   double sum_mix_gap{0};
 
   size_t prev_num_non_zero{0};
+  // NormalHedge's 1 / 2c for the last iteration, the warm start for
+  // the next scale search (see weight-update.h); 0 for none.
+  double normal_hedge_inv_2scale{0};
   double prev_min_loss{0};
   double prev_max_loss{-std::numeric_limits<double>::infinity()};
   double best_bound{0.0};
@@ -33,10 +61,24 @@ struct DriverState {
   double max_last_solution_infeasibility{
       std::numeric_limits<double>::infinity()};
   double last_solution_value{-std::numeric_limits<double>::infinity()};
+  // The last knapsack solution's infeasibility in the surrogate
+  // constraint, and the sum of the weights it was solved for.
+  double last_solution_feasibility{0};
+  double last_sum_weights{0};
   BigVec<double> last_solution;
 
   bool feasible{true};
 
+  // If set, the knapsack draws its pivots from this stream, rather
+  // than from a fresh one for each solve, so that two runs from the
+  // same state and seed do the same work, e.g., in A/B benchmarks.
+  absl::optional<xs256> knapsack_prng;
+
+  // Set by `PipelinedDriver`, so that a fresh instance (e.g., after a
+  // checkpoint restore) prepares the next iteration's weights the same
+  // way.
+  absl::optional<PipelinedStep> pipelined_step;
+
   absl::Duration total_time;
   absl::Duration prepare_time;
   absl::Duration knapsack_time;
@@ -48,8 +90,140 @@ struct DriverState {
   absl::Duration last_knapsack_time;
   absl::Duration last_observe_time;
   absl::Duration last_update_time;
+
+  // If non-null, iterations also count hardware events for each
+  // phase, on the calling thread; see perf-counters.h.  Not owned.
+  PerfCounterGroup* perf_counters{nullptr};
+  PhasePerfCounts perf_counts;
+  PhasePerfCounts last_perf_counts;
+
+  // If non-null, iterations also record their phases' spans; see
+  // trace-recorder.h.  Not owned.
+  TraceRecorder* trace{nullptr};
 };
 
+// Runs one iteration: computes the weights with `algorithm` (see
+// weight-update.h for the interface, and the available algorithms),
+// solves the surrogate knapsack, and observes the constraints'
+// losses.
+template <typename WeightUpdateAlgorithm>
+void DriveOneIteration(absl::Span<CoverConstraint> constraints,
+                       WeightUpdateAlgorithm* algorithm, DriverState* state);
+
+// Runs one iteration with AdaHedge weights.
 void DriveOneIteration(absl::Span<CoverConstraint> constraints,
                        DriverState* state);
+
+// Tracks the wall-clock time (and hardware events and trace spans, if
+// enabled) of each phase of an iteration into `state`'s `last_*` and
+// cumulative fields.  Each phase is charged the time since the last call, or
+// since construction.
+class PhaseTracker {
+ public:
+  explicit PhaseTracker(DriverState* state);
+
+  void Prepare() {
+    Track(TraceSpan::kPrepare, &state_->last_prepare_time,
+          &state_->prepare_time, &state_->last_perf_counts.prepare,
+          &state_->perf_counts.prepare);
+  }
+  void Knapsack() {
+    Track(TraceSpan::kKnapsack, &state_->last_knapsack_time,
+          &state_->knapsack_time, &state_->last_perf_counts.knapsack,
+          &state_->perf_counts.knapsack);
+  }
+  void Observe() {
+    Track(TraceSpan::kObserve, &state_->last_observe_time,
+          &state_->observe_time, &state_->last_perf_counts.observe,
+          &state_->perf_counts.observe);
+  }
+  void Update() {
+    Track(TraceSpan::kUpdate, &state_->last_update_time,
+          &state_->update_time, &state_->last_perf_counts.update,
+          &state_->perf_counts.update);
+  }
+
+  // Charges the whole iteration, including early returns.
+  void Finish();
+
+ private:
+  void Track(TraceSpan span, absl::Duration* instant, absl::Duration* acc,
+             PerfCounts* instant_counts, PerfCounts* acc_counts);
+
+  DriverState* const state_;
+  const absl::Time begin_;
+  absl::Time last_time_;
+  PerfCounts last_counts_;
+  // Only read when tracing.
+  uint64_t iteration_{0};
+  uint64_t begin_tsc_{0};
+  uint64_t last_tsc_{0};
+};
+
+// Building blocks for iteration schedules other than
+// `DriveOneIteration`'s (e.g., pipelined-driver.h), and for
+// benchmarks that time each phase of an iteration separately (see
+// perf-test/drive-iteration.h).
+//
+// Accumulates the knapsack master solution `master_sol` into
+// `state`, and returns the observed loss, i.e., the solution's
+// infeasibility normalised by `sum_weights`.
+double RecordRelaxedSolution(KnapsackSolution master_sol, double sum_weights,
+                             DriverState* state);
+// Solves the knapsack master problem in `knapsack`, with right-hand
+// side `rhs`, and records its solution as above.  The actual weights
+// (and `rhs` and `sum_weights`) are `weight_scale` times those in
+// the knapsack.
+double SolveRelaxedKnapsack(KnapsackBuilder knapsack, double rhs,
+                            double sum_weights, double weight_scale,
+                            DriverState* state);
+// Same, for the knapsack in `prepare_weights`: this is
+// `DriveOneIteration`'s knapsack phase.
+double UpdateStateWithNewRelaxedSolution(
+    const PrepareWeightsState& prepare_weights, DriverState* state);
+// Observes losses for all constraints, for `state->last_solution`,
+// and updates the loss trackers in `state`.
+ObserveLossState ObserveAllLosses(absl::Span<CoverConstraint> constraints,
+                                  DriverState* state);
+// Updates the loss trackers in `state` once all constraints have
+// observed their losses into `observe_state`.
+void RecordObservedLosses(const ObserveLossState& observe_state,
+                          DriverState* state);
+
+// Appends new sets to the instance, e.g., after a column generation
+// pricing step.  `obj_values` is the extended cost vector: it must
+// start with `state->obj_values`, and outlive `state`.  The new set
+// `state->obj_values.size() + i` covers the values (indices in
+// `constraints`) in `values_per_new_set[i]`.
+//
+// Cumulative losses are preserved, so the next iteration continues
+// from the current weights.  New tours start with a cumulative loss
+// of `kNewTourLoss`, the loss they would have accumulated had they
+// existed all along without ever being picked.  The average solution
+// treats new sets as 0 in all previous iterations, and the bound is
+// reset since new sets may improve the optimal value.
+//
+// If `initial_loss` isn't empty, the new tours in `constraints[i]`
+// start with a cumulative loss of `initial_loss[i]` instead, e.g., to
+// give sets that re-enter a restricted instance the weight of their
+// constraint's best expert.
+constexpr double kNewTourLoss = 0.0;
+void AddSets(absl::Span<const double> obj_values,
+             absl::Span<const std::vector<uint32_t>> values_per_new_set,
+             absl::Span<CoverConstraint> constraints, DriverState* state,
+             absl::Span<const double> initial_loss = {});
+
+// Removes sets from the instance, e.g., once they are provably
+// useless.  Set `j` becomes set `new_index[j]`, or is removed if
+// `new_index[j]` is `CoverConstraint::kRemovedTour`; the mapping must
+// preserve the order of the remaining sets.  `obj_values` is the
+// compacted cost vector, and must outlive `state`.
+//
+// The removed sets' entries in `state->sum_solutions` are dropped, so
+// callers that need the average solution for the original instance
+// must save them first.  Cumulative losses for the remaining tours
+// are preserved.
+void RemoveSets(absl::Span<const double> obj_values,
+                absl::Span<const uint32_t> new_index,
+                absl::Span<CoverConstraint> constraints, DriverState* state);
 #endif /* !DRIVER_H */
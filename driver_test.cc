@@ -224,3 +224,50 @@ TEST(Driver, TwoIterationsWithExactLowerBound) {
                      (1 + 2.0 / 3 * kWeight - 2 * kWeight) / (1 + 3 * kWeight),
                  1e-6));
 }
+
+// Solve
+//
+//   min x0 + x1 + 3 x2
+// s.t.
+//   x0    + x2 >= 1
+//      x1 + x2 >= 1
+//
+// for one iteration, and add a new set x3 with cost 1 that covers
+// both values.
+TEST(Driver, AddSets) {
+  CoverConstraint constraints[] = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+
+  const double costs[] = {1.0, 1.0, 3.0, 1.0};
+  DriverState state(absl::MakeConstSpan(costs, 3));
+
+  DriveOneIteration(absl::MakeSpan(constraints), &state);
+  ASSERT_EQ(state.best_bound, 2.0);
+  ASSERT_THAT(state.sum_solutions,
+              ElementsAre(DoubleEq(1.0), DoubleEq(1.0), 0.0));
+
+  const std::vector<uint32_t> values_per_new_set[] = {{0, 1}};
+  AddSets(costs, values_per_new_set, absl::MakeSpan(constraints), &state);
+  EXPECT_EQ(state.obj_values.size(), 4);
+  EXPECT_EQ(state.num_iterations, 1);
+  EXPECT_THAT(state.sum_solutions,
+              ElementsAre(DoubleEq(1.0), DoubleEq(1.0), 0.0, 0.0));
+  EXPECT_THAT(state.last_solution, ElementsAre(1.0, 1.0, 0.0, 0.0));
+  // The new set invalidates the old bound.
+  EXPECT_EQ(state.best_bound, 0.0);
+
+  EXPECT_THAT(constraints[0].potential_tours(), ElementsAre(0, 2, 3));
+  EXPECT_THAT(constraints[1].potential_tours(), ElementsAre(1, 2, 3));
+  EXPECT_THAT(constraints[0].loss().back(), 0.0);
+  EXPECT_THAT(constraints[1].loss().back(), 0.0);
+
+  for (size_t i = 0; i < 100; ++i) {
+    DriveOneIteration(absl::MakeSpan(constraints), &state);
+  }
+
+  // The bound remains valid for the new optimum, x3 = 1.
+  EXPECT_LE(state.best_bound, 1.0 + 1e-6);
+  EXPECT_EQ(state.last_solution.size(), 4);
+  EXPECT_GT(state.sum_solutions[3], state.sum_solutions[2]);
+}
@@ -0,0 +1,399 @@
+#include "instance-file.h"
+
+#include <assert.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <iostream>
+
+#include "absl/algorithm/container.h"
+
+namespace {
+constexpr size_t kWriteBufferSize = 1 << 20;
+
+uint64_t AlignUp(uint64_t x) {
+  return kInstanceFileAlignment * ((x + kInstanceFileAlignment - 1) /
+                                   kInstanceFileAlignment);
+}
+
+// Returns whether the `count` elements of `size` bytes at `offset`
+// fit in a file of `file_size` bytes, and start at an aligned offset.
+bool SectionFits(uint64_t offset, uint64_t count, size_t size,
+                 uint64_t file_size) {
+  if (offset % kInstanceFileAlignment != 0 || offset > file_size) {
+    return false;
+  }
+
+  return count <= (file_size - offset) / size;
+}
+
+// Checks that `offsets` is a valid CSR offset array for `num_entries`
+// indices.  If `indices` is non-empty, also checks that each row is
+// sorted, and that all indices are less than `limit`.
+bool ValidateCSR(absl::Span<const uint64_t> offsets, uint64_t num_entries,
+                 absl::Span<const uint32_t> indices, uint64_t limit) {
+  if (offsets.empty() || offsets.front() != 0 ||
+      offsets.back() != num_entries) {
+    return false;
+  }
+
+  for (size_t i = 1; i < offsets.size(); ++i) {
+    if (offsets[i] < offsets[i - 1]) {
+      return false;
+    }
+
+    if (indices.empty()) {
+      continue;
+    }
+
+    const auto row =
+        indices.subspan(offsets[i - 1], offsets[i] - offsets[i - 1]);
+    if (!absl::c_is_sorted(row) || (!row.empty() && row.back() >= limit)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+}  // namespace
+
+std::unique_ptr<InstanceFileWriter> InstanceFileWriter::Create(
+    const std::string& path, bool with_values_per_set) {
+  FILE* file = fopen(path.c_str(), "w+b");
+  if (file == nullptr) {
+    perror("fopen");
+    return nullptr;
+  }
+
+  std::unique_ptr<InstanceFileWriter> ret(
+      new InstanceFileWriter(file, with_values_per_set));
+
+  // Reserve room for the header; `Finish` will overwrite it in place.
+  const InstanceFileHeader placeholder{};
+  if (!ret->Write(&placeholder, sizeof(placeholder))) {
+    return nullptr;
+  }
+
+  return ret;
+}
+
+InstanceFileWriter::InstanceFileWriter(FILE* file, bool with_values_per_set)
+    : file_(file), with_values_per_set_(with_values_per_set) {
+  setvbuf(file_, nullptr, _IOFBF, kWriteBufferSize);
+  value_offsets_.push_back(0);
+}
+
+InstanceFileWriter::~InstanceFileWriter() {
+  if (file_ != nullptr) {
+    fclose(file_);
+  }
+}
+
+bool InstanceFileWriter::Write(const void* data, size_t size) {
+  if (!ok_) {
+    return false;
+  }
+
+  if (size > 0 && fwrite(data, 1, size, file_) != size) {
+    perror("fwrite");
+    ok_ = false;
+    return false;
+  }
+
+  offset_ += size;
+  return true;
+}
+
+bool InstanceFileWriter::PadToAlignment() {
+  static const char kZeros[kInstanceFileAlignment] = {0};
+  return Write(kZeros, AlignUp(offset_) - offset_);
+}
+
+bool InstanceFileWriter::AddCosts(absl::Span<const double> costs) {
+  if (values_started_) {
+    std::cerr << "InstanceFileWriter: costs must precede values.\n";
+    ok_ = false;
+    return false;
+  }
+
+  num_sets_ += costs.size();
+  return Write(costs.data(), costs.size() * sizeof(double));
+}
+
+bool InstanceFileWriter::StartValues() {
+  if (values_started_) {
+    return ok_;
+  }
+
+  values_started_ = true;
+  if (!PadToAlignment()) {
+    return false;
+  }
+
+  value_sets_offset_ = offset_;
+  if (with_values_per_set_) {
+    set_counts_.resize(num_sets_, 0);
+  }
+
+  return true;
+}
+
+bool InstanceFileWriter::AddValue(absl::Span<const uint32_t> sets) {
+  if (!StartValues()) {
+    return false;
+  }
+
+  scratch_.assign(sets.begin(), sets.end());
+  absl::c_sort(scratch_);
+  if (!scratch_.empty() && scratch_.back() >= num_sets_) {
+    std::cerr << "InstanceFileWriter: set index " << scratch_.back()
+              << " out of range for " << num_sets_ << " sets.\n";
+    ok_ = false;
+    return false;
+  }
+
+  if (with_values_per_set_) {
+    for (const uint32_t set : scratch_) {
+      ++set_counts_[set];
+    }
+  }
+
+  value_offsets_.push_back(value_offsets_.back() + scratch_.size());
+  return Write(scratch_.data(), scratch_.size() * sizeof(uint32_t));
+}
+
+bool InstanceFileWriter::Finish() {
+  if (!StartValues()) {
+    return false;
+  }
+
+  InstanceFileHeader header{};
+  memcpy(header.magic, kInstanceFileMagic, sizeof(header.magic));
+  header.version = kInstanceFileVersion;
+  header.num_sets = num_sets_;
+  header.num_values = value_offsets_.size() - 1;
+  header.num_entries = value_offsets_.back();
+  header.costs_offset = sizeof(InstanceFileHeader);
+  header.value_sets_offset = value_sets_offset_;
+
+  if (!PadToAlignment()) {
+    return false;
+  }
+
+  header.value_offsets_offset = offset_;
+  if (!Write(value_offsets_.data(), value_offsets_.size() * sizeof(uint64_t))) {
+    return false;
+  }
+
+  if (with_values_per_set_) {
+    header.flags |= kInstanceFileHasValuesPerSet;
+    if (!PadToAlignment()) {
+      return false;
+    }
+
+    // We'll fill set_values in place once the file is mapped.
+    header.set_values_offset = offset_;
+    offset_ += header.num_entries * sizeof(uint32_t);
+    offset_ = AlignUp(offset_);
+    if (fseeko(file_, offset_, SEEK_SET) != 0) {
+      perror("fseeko");
+      ok_ = false;
+      return false;
+    }
+
+    header.set_offsets_offset = offset_;
+    std::vector<uint64_t> set_offsets;
+    set_offsets.reserve(num_sets_ + 1);
+    set_offsets.push_back(0);
+    for (const uint64_t count : set_counts_) {
+      set_offsets.push_back(set_offsets.back() + count);
+    }
+
+    set_counts_.clear();
+    if (!Write(set_offsets.data(), set_offsets.size() * sizeof(uint64_t))) {
+      return false;
+    }
+  }
+
+  header.file_size = offset_;
+  if (!ok_ || fflush(file_) != 0 ||
+      ftruncate(fileno(file_), header.file_size) != 0) {
+    perror("InstanceFileWriter::Finish");
+    ok_ = false;
+    return false;
+  }
+
+  void* map = mmap(nullptr, header.file_size, PROT_READ | PROT_WRITE,
+                   MAP_SHARED, fileno(file_), 0);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    ok_ = false;
+    return false;
+  }
+
+  char* const base = static_cast<char*>(map);
+  if (with_values_per_set_) {
+    const auto* value_sets =
+        reinterpret_cast<const uint32_t*>(base + header.value_sets_offset);
+    auto* set_values =
+        reinterpret_cast<uint32_t*>(base + header.set_values_offset);
+    const auto* set_offsets =
+        reinterpret_cast<const uint64_t*>(base + header.set_offsets_offset);
+
+    // Scan values in order, so each set's values are sorted.
+    std::vector<uint64_t> cursor(set_offsets, set_offsets + num_sets_);
+    for (size_t value = 0; value < header.num_values; ++value) {
+      for (uint64_t i = value_offsets_[value]; i < value_offsets_[value + 1];
+           ++i) {
+        set_values[cursor[value_sets[i]]++] = value;
+      }
+    }
+  }
+
+  memcpy(base, &header, sizeof(header));
+  const bool unmapped = munmap(map, header.file_size) == 0;
+  const bool closed = fclose(file_) == 0;
+  file_ = nullptr;
+  ok_ = unmapped && closed;
+  return ok_;
+}
+
+bool WriteInstanceFile(const std::string& path,
+                       absl::Span<const double> obj_values,
+                       absl::Span<const std::vector<uint32_t>> sets_per_value,
+                       bool with_values_per_set) {
+  auto writer = InstanceFileWriter::Create(path, with_values_per_set);
+  if (writer == nullptr || !writer->AddCosts(obj_values)) {
+    return false;
+  }
+
+  for (const std::vector<uint32_t>& sets : sets_per_value) {
+    if (!writer->AddValue(sets)) {
+      return false;
+    }
+  }
+
+  return writer->Finish();
+}
+
+std::unique_ptr<MappedInstance> MappedInstance::Open(const std::string& path,
+                                                     bool verify) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror("open");
+    return nullptr;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    perror("fstat");
+    close(fd);
+    return nullptr;
+  }
+
+  const size_t size = st.st_size;
+  if (size < sizeof(InstanceFileHeader)) {
+    std::cerr << path << ": too short for an instance file.\n";
+    close(fd);
+    return nullptr;
+  }
+
+  void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return nullptr;
+  }
+
+  std::unique_ptr<MappedInstance> ret(new MappedInstance(map, size));
+  if (!ret->Init(verify)) {
+    std::cerr << path << ": invalid instance file.\n";
+    return nullptr;
+  }
+
+  return ret;
+}
+
+MappedInstance::MappedInstance(const void* base, size_t size)
+    : base_(base),
+      size_(size),
+      header_(static_cast<const InstanceFileHeader*>(base)) {}
+
+MappedInstance::~MappedInstance() {
+  int r = munmap(const_cast<void*>(base_), size_);
+  (void)r;
+  assert(r == 0);
+}
+
+bool MappedInstance::Init(bool verify) {
+  const InstanceFileHeader& header = *header_;
+  if (memcmp(header.magic, kInstanceFileMagic, sizeof(header.magic)) != 0 ||
+      header.version != kInstanceFileVersion ||
+      (header.flags & ~kInstanceFileHasValuesPerSet) != 0 ||
+      header.file_size != size_ || header.num_sets > UINT32_MAX ||
+      header.num_values > UINT32_MAX) {
+    return false;
+  }
+
+  const char* const base = static_cast<const char*>(base_);
+  if (!SectionFits(header.costs_offset, header.num_sets, sizeof(double),
+                   size_) ||
+      !SectionFits(header.value_sets_offset, header.num_entries,
+                   sizeof(uint32_t), size_) ||
+      !SectionFits(header.value_offsets_offset, header.num_values + 1,
+                   sizeof(uint64_t), size_)) {
+    return false;
+  }
+
+  obj_values_ = absl::MakeConstSpan(
+      reinterpret_cast<const double*>(base + header.costs_offset),
+      header.num_sets);
+  value_sets_ = absl::MakeConstSpan(
+      reinterpret_cast<const uint32_t*>(base + header.value_sets_offset),
+      header.num_entries);
+  value_offsets_ = absl::MakeConstSpan(
+      reinterpret_cast<const uint64_t*>(base + header.value_offsets_offset),
+      header.num_values + 1);
+  if (!ValidateCSR(value_offsets_, header.num_entries,
+                   verify ? value_sets_ : absl::Span<const uint32_t>(),
+                   header.num_sets)) {
+    return false;
+  }
+
+  if ((header.flags & kInstanceFileHasValuesPerSet) != 0) {
+    if (!SectionFits(header.set_values_offset, header.num_entries,
+                     sizeof(uint32_t), size_) ||
+        !SectionFits(header.set_offsets_offset, header.num_sets + 1,
+                     sizeof(uint64_t), size_)) {
+      return false;
+    }
+
+    set_values_ = absl::MakeConstSpan(
+        reinterpret_cast<const uint32_t*>(base + header.set_values_offset),
+        header.num_entries);
+    set_offsets_ = absl::MakeConstSpan(
+        reinterpret_cast<const uint64_t*>(base + header.set_offsets_offset),
+        header.num_sets + 1);
+    if (!ValidateCSR(set_offsets_, header.num_entries,
+                     verify ? set_values_ : absl::Span<const uint32_t>(),
+                     header.num_values)) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+std::vector<CoverConstraint> MappedInstance::MakeConstraints() const {
+  std::vector<CoverConstraint> ret;
+  ret.reserve(num_values());
+  for (size_t i = 0, n = num_values(); i < n; ++i) {
+    ret.push_back(CoverConstraint::BorrowSorted(sets_for_value(i)));
+  }
+
+  return ret;
+}
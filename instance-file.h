@@ -0,0 +1,183 @@
+#ifndef INSTANCE_FILE_H
+#define INSTANCE_FILE_H
+#include <stdio.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+
+// Binary set cover instance files are little-endian, and consist of
+// a fixed-size header followed by sections that all start at a
+// multiple of `kInstanceFileAlignment` bytes:
+//
+//  1. costs: double[num_sets]
+//  2. value_sets: uint32_t[num_entries], the sorted set indices that
+//     cover each value, concatenated.
+//  3. value_offsets: uint64_t[num_values + 1], the CSR offsets into
+//     value_sets.
+//  4. (optional) set_values: uint32_t[num_entries], the sorted value
+//     indices covered by each set, concatenated.
+//  5. (optional) set_offsets: uint64_t[num_sets + 1], the CSR offsets
+//     into set_values.
+//
+// The index arrays precede their offsets so that a writer can stream
+// value_sets without knowing the total number of entries ahead of time.
+//
+// Readers reject unknown versions; new optional sections must be
+// signaled with a new flag bit.
+constexpr char kInstanceFileMagic[8] = {'S', 'E', 'T', 'C', 'O', 'V', 'E', 'R'};
+constexpr uint32_t kInstanceFileVersion = 1;
+constexpr size_t kInstanceFileAlignment = 64;
+
+enum InstanceFileFlags : uint32_t {
+  kInstanceFileHasValuesPerSet = 1,
+};
+
+struct InstanceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t flags;
+  uint64_t num_sets;
+  uint64_t num_values;
+  uint64_t num_entries;
+  uint64_t costs_offset;
+  uint64_t value_sets_offset;
+  uint64_t value_offsets_offset;
+  uint64_t set_values_offset;
+  uint64_t set_offsets_offset;
+  uint64_t file_size;
+  uint8_t reserved[40];
+};
+
+static_assert(sizeof(InstanceFileHeader) == 2 * kInstanceFileAlignment,
+              "The header must preserve section alignment.");
+static_assert(__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__,
+              "Instance files are little-endian, and we assume a matching "
+              "in-memory representation.");
+
+// Streams an instance to a binary file: first all the costs, with
+// one or more calls to `AddCosts`, then the sets that cover each
+// value, with one call to `AddValue` per value, and finally `Finish`.
+//
+// All methods return false (and log to stderr) on failure; the
+// writer is then unusable.
+//
+// This class is thread-compatible.
+class InstanceFileWriter {
+ public:
+  // Returns nullptr on failure. If `with_values_per_set` is true,
+  // `Finish()` also transposes the instance to populate the optional
+  // set -> values sections.
+  static std::unique_ptr<InstanceFileWriter> Create(
+      const std::string& path, bool with_values_per_set = false);
+
+  ~InstanceFileWriter();
+
+  InstanceFileWriter(const InstanceFileWriter&) = delete;
+  InstanceFileWriter& operator=(const InstanceFileWriter&) = delete;
+
+  // Appends `costs` to the cost vector. Must be called before `AddValue`.
+  bool AddCosts(absl::Span<const double> costs);
+
+  // Appends a new value covered by `sets`, in any order.
+  bool AddValue(absl::Span<const uint32_t> sets);
+
+  // Writes the offset sections and the header, and closes the file.
+  bool Finish();
+
+ private:
+  InstanceFileWriter(FILE* file, bool with_values_per_set);
+
+  bool Write(const void* data, size_t size);
+  bool PadToAlignment();
+  // Closes the cost section on the first call.
+  bool StartValues();
+
+  FILE* file_;
+  const bool with_values_per_set_;
+  bool ok_{true};
+  bool values_started_{false};
+
+  uint64_t offset_{0};
+  uint64_t num_sets_{0};
+  uint64_t value_sets_offset_{0};
+  std::vector<uint64_t> value_offsets_;
+  // Number of values covered by each set, only populated when
+  // `with_values_per_set_` is true.
+  std::vector<uint64_t> set_counts_;
+  std::vector<uint32_t> scratch_;
+};
+
+// Convenience wrapper to write an in-memory instance.
+bool WriteInstanceFile(const std::string& path,
+                       absl::Span<const double> obj_values,
+                       absl::Span<const std::vector<uint32_t>> sets_per_value,
+                       bool with_values_per_set = false);
+
+// A read-only, memory-mapped, instance file. The spans returned by
+// accessors point directly in the mapping, and are valid for the
+// lifetime of this object.
+//
+// This class is thread-safe.
+class MappedInstance {
+ public:
+  // Returns nullptr (and logs to stderr) on failure.
+  //
+  // If `verify` is true, also checks that all indices are in range
+  // and sorted; that's linear in the number of entries.  Header and
+  // offset validation is always performed.
+  static std::unique_ptr<MappedInstance> Open(const std::string& path,
+                                              bool verify = true);
+
+  ~MappedInstance();
+
+  MappedInstance(const MappedInstance&) = delete;
+  MappedInstance& operator=(const MappedInstance&) = delete;
+
+  size_t num_sets() const { return header_->num_sets; }
+  size_t num_values() const { return header_->num_values; }
+  size_t num_entries() const { return header_->num_entries; }
+
+  absl::Span<const double> obj_values() const { return obj_values_; }
+
+  absl::Span<const uint32_t> sets_for_value(size_t value) const {
+    return value_sets_.subspan(value_offsets_[value],
+                               value_offsets_[value + 1] -
+                                   value_offsets_[value]);
+  }
+
+  bool has_values_per_set() const { return !set_offsets_.empty(); }
+
+  // Must only be called if `has_values_per_set()`.
+  absl::Span<const uint32_t> values_for_set(size_t set) const {
+    return set_values_.subspan(set_offsets_[set],
+                               set_offsets_[set + 1] - set_offsets_[set]);
+  }
+
+  // Returns one constraint per value.  The constraints refer to the
+  // index arrays in the mapping, and must not outlive `this`.
+  std::vector<CoverConstraint> MakeConstraints() const;
+
+ private:
+  MappedInstance(const void* base, size_t size);
+
+  // Validates the header and populates the spans. Returns false on
+  // failure.
+  bool Init(bool verify);
+
+  const void* const base_;
+  const size_t size_;
+  const InstanceFileHeader* const header_;
+
+  absl::Span<const double> obj_values_;
+  absl::Span<const uint32_t> value_sets_;
+  absl::Span<const uint64_t> value_offsets_;
+  absl::Span<const uint32_t> set_values_;
+  absl::Span<const uint64_t> set_offsets_;
+};
+#endif /* !INSTANCE_FILE_H */
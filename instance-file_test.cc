@@ -0,0 +1,130 @@
+#include "instance-file.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+using ::testing::IsEmpty;
+
+namespace {
+std::string TempPath(const std::string& name) {
+  const char* dir = getenv("TEST_TMPDIR");
+  return std::string(dir != nullptr ? dir : "/tmp") + "/" + name;
+}
+
+TEST(InstanceFile, RoundTrip) {
+  const std::string path = TempPath("instance-file-round-trip");
+  const std::vector<double> costs = {1.0, 2.0, 3.0, 4.0};
+  const std::vector<std::vector<uint32_t>> sets_per_value = {
+      {3, 0}, {1}, {}, {2, 1, 0}};
+
+  ASSERT_TRUE(WriteInstanceFile(path, costs, sets_per_value));
+
+  auto instance = MappedInstance::Open(path);
+  ASSERT_NE(instance, nullptr);
+  EXPECT_EQ(instance->num_sets(), 4);
+  EXPECT_EQ(instance->num_values(), 4);
+  EXPECT_EQ(instance->num_entries(), 6);
+  EXPECT_THAT(instance->obj_values(), ElementsAre(1.0, 2.0, 3.0, 4.0));
+  EXPECT_THAT(instance->sets_for_value(0), ElementsAre(0, 3));
+  EXPECT_THAT(instance->sets_for_value(1), ElementsAre(1));
+  EXPECT_THAT(instance->sets_for_value(2), IsEmpty());
+  EXPECT_THAT(instance->sets_for_value(3), ElementsAre(0, 1, 2));
+  EXPECT_FALSE(instance->has_values_per_set());
+
+  // Sections are aligned.
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(instance->obj_values().data()) %
+                kInstanceFileAlignment,
+            0);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(instance->sets_for_value(0).data()) %
+                kInstanceFileAlignment,
+            0);
+
+  // Constraints point directly in the mapping.
+  const std::vector<CoverConstraint> constraints =
+      instance->MakeConstraints();
+  ASSERT_EQ(constraints.size(), 4);
+  EXPECT_EQ(constraints[3].potential_tours().data(),
+            instance->sets_for_value(3).data());
+  EXPECT_THAT(constraints[3].loss(), ElementsAre(0.0, 0.0, 0.0));
+
+  remove(path.c_str());
+}
+
+TEST(InstanceFile, ValuesPerSet) {
+  const std::string path = TempPath("instance-file-values-per-set");
+  const std::vector<double> costs = {1.0, 2.0, 3.0, 4.0};
+  const std::vector<std::vector<uint32_t>> sets_per_value = {
+      {3, 0}, {1}, {}, {2, 1, 0}};
+
+  ASSERT_TRUE(WriteInstanceFile(path, costs, sets_per_value,
+                                /*with_values_per_set=*/true));
+
+  auto instance = MappedInstance::Open(path);
+  ASSERT_NE(instance, nullptr);
+  ASSERT_TRUE(instance->has_values_per_set());
+  EXPECT_THAT(instance->values_for_set(0), ElementsAre(0, 3));
+  EXPECT_THAT(instance->values_for_set(1), ElementsAre(1, 3));
+  EXPECT_THAT(instance->values_for_set(2), ElementsAre(3));
+  EXPECT_THAT(instance->values_for_set(3), ElementsAre(0));
+
+  remove(path.c_str());
+}
+
+TEST(InstanceFile, Empty) {
+  const std::string path = TempPath("instance-file-empty");
+  ASSERT_TRUE(WriteInstanceFile(path, {}, {}, /*with_values_per_set=*/true));
+
+  auto instance = MappedInstance::Open(path);
+  ASSERT_NE(instance, nullptr);
+  EXPECT_EQ(instance->num_sets(), 0);
+  EXPECT_EQ(instance->num_values(), 0);
+  EXPECT_THAT(instance->MakeConstraints(), IsEmpty());
+
+  remove(path.c_str());
+}
+
+TEST(InstanceFile, RejectOutOfRange) {
+  const std::string path = TempPath("instance-file-out-of-range");
+  auto writer = InstanceFileWriter::Create(path);
+  ASSERT_NE(writer, nullptr);
+  const double costs[] = {1.0, 2.0};
+  ASSERT_TRUE(writer->AddCosts(costs));
+  const uint32_t sets[] = {2};
+  EXPECT_FALSE(writer->AddValue(sets));
+  EXPECT_FALSE(writer->Finish());
+
+  remove(path.c_str());
+}
+
+TEST(InstanceFile, RejectCorrupt) {
+  const std::string path = TempPath("instance-file-corrupt");
+  const std::vector<double> costs = {1.0, 2.0};
+  ASSERT_TRUE(WriteInstanceFile(path, costs, {{0, 1}, {1}}));
+
+  // Flip a set index out of range.
+  {
+    FILE* file = fopen(path.c_str(), "r+b");
+    ASSERT_NE(file, nullptr);
+    InstanceFileHeader header;
+    ASSERT_EQ(fread(&header, sizeof(header), 1, file), 1);
+    const uint32_t bad = 10;
+    fseek(file, header.value_sets_offset + sizeof(uint32_t), SEEK_SET);
+    ASSERT_EQ(fwrite(&bad, sizeof(bad), 1, file), 1);
+    fclose(file);
+  }
+
+  EXPECT_EQ(MappedInstance::Open(path), nullptr);
+  // Without verification, we only look at offsets.
+  EXPECT_NE(MappedInstance::Open(path, /*verify=*/false), nullptr);
+
+  remove(path.c_str());
+  EXPECT_EQ(MappedInstance::Open(path), nullptr);
+}
+}  // namespace
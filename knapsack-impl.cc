@@ -7,7 +7,6 @@
 #include <tuple>
 
 #include "absl/algorithm/container.h"
-#include "prng.h"
 
 #define NOINLINE __attribute__((__noinline__))
 
@@ -17,6 +16,37 @@ bool NormalizedEntry::operator==(const NormalizedEntry& other) const {
          std::tie(other.weight, other.value, other.index);
 }
 
+namespace {
+// Normalizes item `i`, and returns whether it must be added to the
+// entries to exclude.
+inline bool NormalizeItem(size_t i, double obj_value, double weight,
+                          absl::Span<double> candidates,
+                          NormalizedInstance* instance,
+                          NormalizedEntry* entry) {
+  const double value = -obj_value;  // flip for max
+
+  assert(weight <= 0);
+  if (weight == 0 && value < 0) {
+    candidates[i] = 0.0;
+    return false;
+  }
+
+  candidates[i] = 1.0;
+  instance->sum_candidate_values += value;
+  instance->sum_candidate_weights += weight;
+
+  // non-positive weight and positive value is always taken.
+  // otherwise, add to normalized knapsack.
+  if (value < 0) {
+    assert(weight < 0);
+    *entry = NormalizedEntry{-weight, -value, i};
+    return true;
+  }
+
+  return false;
+}
+}  // namespace
+
 NormalizedInstance NormalizeKnapsack(absl::Span<const double> obj_values,
                                      absl::Span<const double> weights,
                                      absl::Span<double> candidates,
@@ -30,29 +60,39 @@ NormalizedInstance NormalizeKnapsack(absl::Span<const double> obj_values,
 
   size_t num_to_exclude = 0;
   for (size_t i = 0, n = obj_values.size(); i < n; ++i) {
-    const double weight = weights[i];
-    const double value = -obj_values[i];  // flip for max
+    num_to_exclude += NormalizeItem(i, obj_values[i], weights[i], candidates,
+                                    &ret, &ret.to_exclude[num_to_exclude]);
+  }
 
-    assert(weight <= 0);
-    if (weight == 0 && value < 0) {
-      candidates[i] = 0.0;
-      continue;
-    }
+  ret.to_exclude = ret.to_exclude.first(num_to_exclude);
+  return ret;
+}
 
-    candidates[i] = 1.0;
-    ret.sum_candidate_values += value;
-    ret.sum_candidate_weights += weight;
+NormalizedInstance MakeNormalizedInstance(size_t num_items,
+                                          BigVecArena* arena) {
+  NormalizedInstance ret;
+  ret.backing_storage = arena->CreateUninit<NormalizedEntry>(num_items);
+  ret.to_exclude = absl::MakeSpan(ret.backing_storage).first(0);
+  return ret;
+}
 
-    // non-positive weight and positive value is always taken.
-    // otherwise, add to normalized knapsack.
-    if (value < 0) {
-      assert(weight < 0);
-      ret.to_exclude[num_to_exclude++] = NormalizedEntry{-weight, -value, i};
-    }
+void NormalizeKnapsackItems(absl::Span<const double> obj_values,
+                            absl::Span<const double> weights,
+                            absl::Span<const uint32_t> indices,
+                            absl::Span<double> candidates,
+                            NormalizedInstance* instance) {
+  assert(obj_values.size() == weights.size());
+  assert(obj_values.size() == candidates.size());
+  assert(instance->backing_storage.size() == obj_values.size());
+
+  NormalizedEntry* const entries = instance->backing_storage.data();
+  size_t num_to_exclude = instance->to_exclude.size();
+  for (const uint32_t i : indices) {
+    num_to_exclude += NormalizeItem(i, obj_values[i], weights[i], candidates,
+                                    instance, &entries[num_to_exclude]);
   }
 
-  ret.to_exclude = ret.to_exclude.first(num_to_exclude);
-  return ret;
+  instance->to_exclude = absl::MakeSpan(entries, num_to_exclude);
 }
 
 namespace {
@@ -195,4 +235,8 @@ PartitionResult PartitionEntries(PartitionInstance instance) {
   xs256 prng;
   return PartitionEntriesDispatch(instance, &prng);
 }
+
+PartitionResult PartitionEntries(PartitionInstance instance, xs256* prng) {
+  return PartitionEntriesDispatch(instance, prng);
+}
 }  // namespace internal
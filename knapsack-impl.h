@@ -1,10 +1,12 @@
 #ifndef KNAPSACK_IMPL_H
 #define KNAPSACK_IMPL_H
 #include <cstddef>
+#include <cstdint>
 #include <vector>
 
 #include "absl/types/span.h"
 #include "big-vec.h"
+#include "prng.h"
 
 namespace internal {
 struct NormalizedEntry {
@@ -40,6 +42,19 @@ NormalizedInstance NormalizeKnapsack(
     absl::Span<double> candidates,
     BigVecArena* arena = &BigVecArena::default_instance());
 
+// Same as `NormalizeKnapsack`, for the items in `indices` only:
+// appends their normalized entries to `instance->to_exclude`, and
+// updates the candidates and sums.  `instance` must come from
+// `MakeNormalizedInstance` for all the items, and each item must be
+// normalized at most once.
+NormalizedInstance MakeNormalizedInstance(
+    size_t num_items, BigVecArena* arena = &BigVecArena::default_instance());
+void NormalizeKnapsackItems(absl::Span<const double> obj_values,
+                            absl::Span<const double> weights,
+                            absl::Span<const uint32_t> indices,
+                            absl::Span<double> candidates,
+                            NormalizedInstance* instance);
+
 struct PartitionResult {
   size_t partition_index;
   double remaining_weight;
@@ -77,6 +92,11 @@ struct PartitionInstance {
 //
 // The partition index in the result is thw first element in the
 // (re-ordered) entries that does not fully fit in the knapsack.
+//
+// The pivots come from a fresh independent stream, or from `prng`:
+// the same stream yields the same pivots, and thus the same work and
+// the same order of entries, for the same instance.
 PartitionResult PartitionEntries(PartitionInstance instance);
+PartitionResult PartitionEntries(PartitionInstance instance, xs256* prng);
 }  // namespace internal
 #endif /*!KNAPSACK_IMPL_H */
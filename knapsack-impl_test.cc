@@ -452,6 +452,39 @@ TEST_P(PartitionEntriesLarge, EqualRanges) {
   }
 }
 
+// The same pivot stream does the same work, so it leaves the entries
+// in the same order; the result doesn't depend on the stream.
+TEST_P(PartitionEntriesLarge, SeededIsReproducible) {
+  const size_t n = GetParam();
+
+  std::vector<NormalizedEntry> init_entries;
+  for (size_t i = 0; i < n; ++i) {
+    init_entries.push_back({i + 1.0, (i % 7) + 0.5, i});
+  }
+
+  const double max_weight = n * (n + 1) / 4.0;
+  std::vector<NormalizedEntry> expected_entries = init_entries;
+  const PartitionResult expected = PartitionEntries(PartitionInstance(
+      absl::MakeSpan(expected_entries), max_weight, 1.0 * n * n));
+
+  std::vector<NormalizedEntry> entries[2] = {init_entries, init_entries};
+  PartitionResult results[2];
+  for (size_t i = 0; i < 2; ++i) {
+    xs256 prng(42);
+    results[i] = PartitionEntries(
+        PartitionInstance(absl::MakeSpan(entries[i]), max_weight, 1.0 * n * n),
+        &prng);
+    EXPECT_EQ(results[i].partition_index, expected.partition_index);
+    // Up to rounding in sums taken in a different order.
+    EXPECT_NEAR(results[i].remaining_weight, expected.remaining_weight, 1e-6);
+    EXPECT_NEAR(results[i].remaining_value, expected.remaining_value, 1e-6);
+  }
+
+  EXPECT_EQ(entries[0], entries[1]);
+  EXPECT_EQ(results[0].remaining_weight, results[1].remaining_weight);
+  EXPECT_EQ(results[0].remaining_value, results[1].remaining_value);
+}
+
 INSTANTIATE_TEST_SUITE_P(PartitionEntriesLarge, PartitionEntriesLarge,
                          Range<size_t>(1, 100));
 
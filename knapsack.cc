@@ -10,7 +10,9 @@
 
 using ::internal::NormalizedEntry;
 using ::internal::NormalizedInstance;
+using ::internal::MakeNormalizedInstance;
 using ::internal::NormalizeKnapsack;
+using ::internal::NormalizeKnapsackItems;
 using ::internal::PartitionEntries;
 using ::internal::PartitionInstance;
 using ::internal::PartitionResult;
@@ -43,27 +45,13 @@ std::ostream& operator<<(std::ostream& stream,
   return stream;
 }
 
-// The weights are all non-positive, so we want to flip the meaning of
-// the decision variables: we'll select items that should not be in
-// the knapsack.
-KnapsackSolution SolveKnapsack(absl::Span<const double> obj_values,
-                               absl::Span<const double> weights, double rhs,
-                               double eps, double best_bound,
-                               BigVecArena* arena) {
-  assert(std::isfinite(rhs));
-  assert(obj_values.size() == weights.size());
-  assert(eps >= 0);
-  for (double weight : weights) {
-    (void)weight;
-    assert(weight <= 0);
-  }
-
-  KnapsackSolution ret(arena->CreateUninit<double>(weights.size()));
-  // We obtain a regular max / <= knapsack by flipping the objective function.
-  // The weights are negative, so the goal is to exclude items.
-  NormalizedInstance knapsack = NormalizeKnapsack(
-      obj_values, weights, absl::MakeSpan(ret.solution), arena);
-
+namespace {
+// Solves the normalized `knapsack`, and stores the solution in `ret`,
+// which already holds the candidates.
+KnapsackSolution SolveNormalizedKnapsack(NormalizedInstance knapsack,
+                                         KnapsackSolution ret, double rhs,
+                                         double eps, double best_bound,
+                                         xs256* prng) {
   assert(std::isfinite(knapsack.sum_candidate_weights));
 
   // If we don't remove anything, the sum of weights is
@@ -101,10 +89,12 @@ KnapsackSolution SolveKnapsack(absl::Span<const double> obj_values,
   //  -> max_weight_increase >= 0;
   assert(max_value_increase >= 0);
 
-  PartitionResult partition =
-      PartitionEntries(PartitionInstance(absl::MakeSpan(knapsack.to_exclude),
-                                         /*max_weight_=*/max_weight_increase,
-                                         /*max_value_=*/max_value_increase));
+  const PartitionInstance instance(absl::MakeSpan(knapsack.to_exclude),
+                                   /*max_weight_=*/max_weight_increase,
+                                   /*max_value_=*/max_value_increase);
+  PartitionResult partition = (prng == nullptr)
+                                  ? PartitionEntries(instance)
+                                  : PartitionEntries(instance, prng);
 
   for (const auto& elem : absl::MakeConstSpan(knapsack.to_exclude)
                               .subspan(0, partition.partition_index)) {
@@ -139,3 +129,53 @@ KnapsackSolution SolveKnapsack(absl::Span<const double> obj_values,
   ret.feasible = true;
   return ret;
 }
+}  // namespace
+
+// The weights are all non-positive, so we want to flip the meaning of
+// the decision variables: we'll select items that should not be in
+// the knapsack.
+KnapsackSolution SolveKnapsack(absl::Span<const double> obj_values,
+                               absl::Span<const double> weights, double rhs,
+                               double eps, double best_bound,
+                               BigVecArena* arena, xs256* prng) {
+  assert(std::isfinite(rhs));
+  assert(obj_values.size() == weights.size());
+  assert(eps >= 0);
+  for (double weight : weights) {
+    (void)weight;
+    assert(weight <= 0);
+  }
+
+  KnapsackSolution ret(arena->CreateUninit<double>(weights.size()));
+  // We obtain a regular max / <= knapsack by flipping the objective function.
+  // The weights are negative, so the goal is to exclude items.
+  NormalizedInstance knapsack = NormalizeKnapsack(
+      obj_values, weights, absl::MakeSpan(ret.solution), arena);
+  return SolveNormalizedKnapsack(std::move(knapsack), std::move(ret), rhs, eps,
+                                 best_bound, prng);
+}
+
+KnapsackBuilder::KnapsackBuilder(absl::Span<const double> obj_values,
+                                 absl::Span<const double> weights,
+                                 BigVecArena* arena)
+    : obj_values_(obj_values),
+      weights_(weights),
+      solution_(arena->CreateUninit<double>(weights.size())),
+      knapsack_(MakeNormalizedInstance(weights.size(), arena)) {
+  assert(obj_values.size() == weights.size());
+}
+
+void KnapsackBuilder::AddItems(absl::Span<const uint32_t> indices) {
+  NormalizeKnapsackItems(obj_values_, weights_, indices,
+                         absl::MakeSpan(solution_.solution), &knapsack_);
+  num_added_ += indices.size();
+}
+
+KnapsackSolution KnapsackBuilder::Solve(double rhs, double eps,
+                                        double best_bound, xs256* prng) && {
+  assert(std::isfinite(rhs));
+  assert(eps >= 0);
+  assert(num_added_ == weights_.size());
+  return SolveNormalizedKnapsack(std::move(knapsack_), std::move(solution_),
+                                 rhs, eps, best_bound, prng);
+}
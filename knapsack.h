@@ -6,6 +6,8 @@
 
 #include "absl/types/span.h"
 #include "big-vec.h"
+#include "knapsack-impl.h"
+#include "prng.h"
 
 struct KnapsackSolution {
   explicit KnapsackSolution(BigVec<double> solution_,
@@ -37,8 +39,46 @@ struct KnapsackSolution {
 // eps is the allowed leeway on feasibility.
 //
 // `scratch` is used to pre-allocate the solution vector in the return value.
+//
+// If `prng` is non-null, the partitioning draws its pivots from it
+// instead of a fresh stream, so that the same stream yields the same
+// work; see `internal::PartitionEntries`.
 KnapsackSolution SolveKnapsack(
     absl::Span<const double> obj_values, absl::Span<const double> weights,
     double rhs, double eps, double best_bound,
-    BigVecArena* arena = &BigVecArena::default_instance());
+    BigVecArena* arena = &BigVecArena::default_instance(),
+    xs256* prng = nullptr);
+
+// Builds the knapsack for `SolveKnapsack` incrementally: items are
+// normalized as soon as their weights are final, e.g., while the
+// weights are accumulated one block of constraints at a time.
+//
+// Every item must be added exactly once before calling `Solve`.
+class KnapsackBuilder {
+ public:
+  // `obj_values` and `weights` must outlive the builder.
+  KnapsackBuilder(absl::Span<const double> obj_values,
+                  absl::Span<const double> weights,
+                  BigVecArena* arena = &BigVecArena::default_instance());
+
+  KnapsackBuilder(const KnapsackBuilder&) = delete;
+  KnapsackBuilder(KnapsackBuilder&&) = default;
+  KnapsackBuilder& operator=(const KnapsackBuilder&) = delete;
+  KnapsackBuilder& operator=(KnapsackBuilder&&) = default;
+
+  // Normalizes the items in `indices`, whose weights must be final.
+  void AddItems(absl::Span<const uint32_t> indices);
+
+  // Same as `SolveKnapsack` for the builder's objective and weights.
+  // Consumes the builder.
+  KnapsackSolution Solve(double rhs, double eps, double best_bound,
+                         xs256* prng = nullptr) &&;
+
+ private:
+  absl::Span<const double> obj_values_;
+  absl::Span<const double> weights_;
+  size_t num_added_{0};
+  KnapsackSolution solution_;
+  internal::NormalizedInstance knapsack_;
+};
 #endif /* !KNAPSACK_H */
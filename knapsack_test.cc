@@ -140,3 +140,23 @@ TEST(Knapsack, TrivialOnValue2) {
   EXPECT_EQ(result.objective_value, 2);
   EXPECT_EQ(result.feasibility, 5.5);
 }
+
+TEST(KnapsackBuilder, MatchesSolveKnapsack) {
+  BigVecArenaContext ctx;
+
+  const double obj_values[] = {1, 2, -1, 3, 0.5, 4};
+  const double weights[] = {-2, -1, 0, -4, 0, -1};
+  const KnapsackSolution expected =
+      SolveKnapsack(obj_values, weights, -5, kEps, 0);
+
+  // Items are added in arbitrary groups.
+  KnapsackBuilder builder(obj_values, weights);
+  const uint32_t first[] = {5, 1};
+  const uint32_t second[] = {0, 2, 4};
+  const uint32_t third[] = {3};
+  builder.AddItems(first);
+  builder.AddItems(second);
+  builder.AddItems({});
+  builder.AddItems(third);
+  EXPECT_EQ(std::move(builder).Solve(-5, kEps, 0), expected);
+}
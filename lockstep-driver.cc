@@ -0,0 +1,290 @@
+#include "lockstep-driver.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "weight-update.h"
+
+namespace {
+double Error(double expected, double actual) {
+  if (std::isnan(expected) || std::isnan(actual)) {
+    return (std::isnan(expected) && std::isnan(actual))
+               ? 0.0
+               : std::numeric_limits<double>::infinity();
+  }
+
+  if (expected == actual) {
+    // Also handles matching infinities.
+    return 0.0;
+  }
+
+  const double scale = std::max({1.0, std::abs(expected), std::abs(actual)});
+  return std::abs(expected - actual) / scale;
+}
+
+// Copies `src` into `dst`, reallocating from `arena` if the sizes
+// differ.
+void CopyBigVec(const BigVec<double>& src, BigVecArena* arena,
+                BigVec<double>* dst) {
+  if (dst->size() != src.size()) {
+    *dst = arena->CreateUninit<double>(src.size());
+  }
+
+  std::copy(src.begin(), src.end(), dst->begin());
+}
+
+// Tracks the time since construction or the last call.
+class PhaseTimer {
+ public:
+  PhaseTimer() : last_(absl::Now()) {}
+
+  absl::Duration Lap() {
+    const absl::Time now = absl::Now();
+    const absl::Duration ret = now - last_;
+    last_ = now;
+    return ret;
+  }
+
+ private:
+  absl::Time last_;
+};
+}  // namespace
+
+void Divergence::Add(size_t index, double expected, double actual,
+                     double tolerance) {
+  const double error = Error(expected, actual);
+  ++num_compared;
+  if (error > tolerance) {
+    ++num_diverged;
+  }
+
+  if (error > max_error) {
+    max_error = error;
+    worst_index = index;
+  }
+}
+
+void Divergence::Merge(const Divergence& other) {
+  num_compared += other.num_compared;
+  num_diverged += other.num_diverged;
+  if (other.max_error > max_error) {
+    max_error = other.max_error;
+    worst_index = other.worst_index;
+  }
+}
+
+void PhaseTimes::Merge(const PhaseTimes& other) {
+  prepare += other.prepare;
+  knapsack += other.knapsack;
+  observe += other.observe;
+  update += other.update;
+}
+
+bool LockstepReport::diverged() const {
+  return weights.num_diverged > 0 || subproblems.num_diverged > 0 ||
+         knapsack.num_diverged > 0 || losses.num_diverged > 0 ||
+         update.num_diverged > 0;
+}
+
+void LockstepReport::Merge(const LockstepReport& other) {
+  num_iterations += other.num_iterations;
+  weights.Merge(other.weights);
+  subproblems.Merge(other.subproblems);
+  knapsack.Merge(other.knapsack);
+  losses.Merge(other.losses);
+  update.Merge(other.update);
+  baseline_time.Merge(other.baseline_time);
+  test_time.Merge(other.test_time);
+}
+
+LockstepDriver::LockstepDriver(const Options& options) : options_(options) {}
+
+void LockstepDriver::MarkDiverged(size_t constraint) {
+  last_.diverged_constraints.push_back(constraint);
+}
+
+const LockstepReport& LockstepDriver::FinishIteration() {
+  std::vector<uint32_t>& diverged = last_.diverged_constraints;
+  std::sort(diverged.begin(), diverged.end());
+  diverged.erase(std::unique(diverged.begin(), diverged.end()),
+                 diverged.end());
+  for (uint32_t constraint : diverged) {
+    ++num_diverged_iterations_[constraint];
+  }
+
+  total_.Merge(last_);
+  return last_;
+}
+
+void LockstepDriver::SyncSubproblems(absl::Span<const CoverConstraint> baseline,
+                                     absl::Span<CoverConstraint> test) {
+  std::vector<double> losses;
+  for (size_t i = 0; i < baseline.size(); ++i) {
+    const size_t expected = baseline[i].last_solution();
+    const bool same = test[i].last_solution() == expected;
+    last_.subproblems.Add(i, 0.0, same ? 0.0 : 1.0, 0.0);
+    if (!same) {
+      MarkDiverged(i);
+      // `RestoreState` can't read from the constraint it overwrites.
+      losses.assign(test[i].loss().begin(), test[i].loss().end());
+      test[i].RestoreState(expected, losses);
+    }
+  }
+}
+
+void LockstepDriver::SyncKnapsack(const DriverState& baseline,
+                                  double baseline_observed_loss,
+                                  DriverState* test,
+                                  double test_observed_loss) {
+  const size_t num_sets = baseline.last_solution.size();
+  for (size_t j = 0; j < num_sets; ++j) {
+    last_.knapsack.Add(j, baseline.last_solution[j],
+                       (j < test->last_solution.size())
+                           ? test->last_solution[j]
+                           : std::numeric_limits<double>::quiet_NaN(),
+                       options_.knapsack_tolerance);
+  }
+
+  last_.knapsack.Add(num_sets, baseline.last_solution_value,
+                     test->last_solution_value, options_.knapsack_tolerance);
+  last_.knapsack.Add(num_sets + 1, baseline_observed_loss, test_observed_loss,
+                     options_.knapsack_tolerance);
+
+  CopyBigVec(baseline.last_solution, &test->arena, &test->last_solution);
+  CopyBigVec(baseline.sum_solutions, &test->arena, &test->sum_solutions);
+  test->num_iterations = baseline.num_iterations;
+  test->best_bound = baseline.best_bound;
+  test->sum_solution_value = baseline.sum_solution_value;
+  test->sum_solution_feasibility = baseline.sum_solution_feasibility;
+  test->last_solution_value = baseline.last_solution_value;
+  test->feasible = baseline.feasible;
+}
+
+void LockstepDriver::SyncLosses(absl::Span<const CoverConstraint> baseline,
+                                absl::Span<CoverConstraint> test) {
+  for (size_t i = 0; i < baseline.size(); ++i) {
+    const absl::Span<const double> expected = baseline[i].loss();
+    const absl::Span<const double> actual = test[i].loss();
+    Divergence divergence;
+    if (expected.size() != actual.size()) {
+      divergence.Add(0, 0.0, std::numeric_limits<double>::quiet_NaN(),
+                     options_.loss_tolerance);
+    } else {
+      for (size_t k = 0; k < expected.size(); ++k) {
+        divergence.Add(k, expected[k], actual[k], options_.loss_tolerance);
+      }
+    }
+
+    // One entry per constraint.
+    last_.losses.num_compared++;
+    if (divergence.max_error > last_.losses.max_error) {
+      last_.losses.max_error = divergence.max_error;
+      last_.losses.worst_index = i;
+    }
+
+    if (divergence.num_diverged > 0) {
+      last_.losses.num_diverged++;
+      MarkDiverged(i);
+      if (expected.size() == actual.size()) {
+        test[i].RestoreState(test[i].last_solution(), expected);
+      }
+    }
+  }
+}
+
+template <typename BaselineAlgorithm, typename TestAlgorithm>
+const LockstepReport& LockstepDriver::DriveOneIteration(
+    absl::Span<CoverConstraint> baseline_constraints,
+    BaselineAlgorithm* baseline_algorithm, DriverState* baseline,
+    absl::Span<CoverConstraint> test_constraints,
+    TestAlgorithm* test_algorithm, DriverState* test) {
+  assert(baseline_constraints.size() == test_constraints.size());
+  last_ = LockstepReport();
+  last_.num_iterations = 1;
+  num_diverged_iterations_.resize(baseline_constraints.size(), 0);
+
+  PhaseTimer timer;
+  const PrepareWeightsState baseline_weights =
+      baseline_algorithm->PrepareWeights(baseline_constraints, baseline);
+  last_.baseline_time.prepare = timer.Lap();
+  const PrepareWeightsState test_weights =
+      test_algorithm->PrepareWeights(test_constraints, test);
+  last_.test_time.prepare = timer.Lap();
+
+  {
+    const double baseline_scale = 1.0 / baseline_weights.mix_loss.sum_weights;
+    const double test_scale = 1.0 / test_weights.mix_loss.sum_weights;
+    const size_t num_sets = baseline->obj_values.size();
+    for (size_t j = 0; j < num_sets; ++j) {
+      last_.weights.Add(j,
+                        baseline_scale * baseline_weights.knapsack_weights[j],
+                        test_scale * test_weights.knapsack_weights[j],
+                        options_.weight_tolerance);
+    }
+
+    last_.weights.Add(num_sets, baseline_scale * baseline_weights.knapsack_rhs,
+                      test_scale * test_weights.knapsack_rhs,
+                      options_.weight_tolerance);
+  }
+
+  SyncSubproblems(baseline_constraints, test_constraints);
+
+  timer.Lap();
+  const double observed_loss =
+      UpdateStateWithNewRelaxedSolution(baseline_weights, baseline);
+  last_.baseline_time.knapsack = timer.Lap();
+  const double test_observed_loss =
+      UpdateStateWithNewRelaxedSolution(test_weights, test);
+  last_.test_time.knapsack = timer.Lap();
+
+  SyncKnapsack(*baseline, observed_loss, test, test_observed_loss);
+  if (!baseline->feasible) {
+    return FinishIteration();
+  }
+
+  timer.Lap();
+  const ObserveLossState observe_state =
+      ObserveAllLosses(baseline_constraints, baseline);
+  last_.baseline_time.observe = timer.Lap();
+  ObserveAllLosses(test_constraints, test);
+  last_.test_time.observe = timer.Lap();
+
+  SyncLosses(baseline_constraints, test_constraints);
+  test->prev_min_loss = baseline->prev_min_loss;
+  test->prev_max_loss = baseline->prev_max_loss;
+  test->max_last_solution_infeasibility =
+      baseline->max_last_solution_infeasibility;
+
+  timer.Lap();
+  baseline_algorithm->UpdateWeights(baseline_constraints, baseline_weights,
+                                    observe_state, observed_loss, baseline);
+  last_.baseline_time.update = timer.Lap();
+  test_algorithm->UpdateWeights(test_constraints, test_weights, observe_state,
+                                observed_loss, test);
+  last_.test_time.update = timer.Lap();
+
+  last_.update.Add(0, baseline->sum_mix_gap, test->sum_mix_gap,
+                   options_.update_tolerance);
+  last_.update.Add(1, baseline->prev_num_non_zero, test->prev_num_non_zero,
+                   options_.update_tolerance);
+  test->sum_mix_gap = baseline->sum_mix_gap;
+  test->prev_num_non_zero = baseline->prev_num_non_zero;
+
+  return FinishIteration();
+}
+
+template const LockstepReport& LockstepDriver::DriveOneIteration(
+    absl::Span<CoverConstraint>, AdaHedge*, DriverState*,
+    absl::Span<CoverConstraint>, AdaHedge*, DriverState*);
+template const LockstepReport& LockstepDriver::DriveOneIteration(
+    absl::Span<CoverConstraint>, AdaHedge*, DriverState*,
+    absl::Span<CoverConstraint>, NormalHedge*, DriverState*);
+template const LockstepReport& LockstepDriver::DriveOneIteration(
+    absl::Span<CoverConstraint>, NormalHedge*, DriverState*,
+    absl::Span<CoverConstraint>, AdaHedge*, DriverState*);
+template const LockstepReport& LockstepDriver::DriveOneIteration(
+    absl::Span<CoverConstraint>, NormalHedge*, DriverState*,
+    absl::Span<CoverConstraint>, NormalHedge*, DriverState*);
@@ -0,0 +1,148 @@
+#ifndef LOCKSTEP_DRIVER_H
+#define LOCKSTEP_DRIVER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "driver.h"
+
+// Differential validation for changes to the iteration's phases (see
+// EVAL.md): a baseline and a solver under test run the same instance
+// in lockstep, and the baseline's decisions are copied into the
+// solver under test at each phase, so nondeterminism and small
+// numerical differences don't compound over iterations.  Each phase's
+// outputs are compared before they're overwritten.
+//
+// Both sides start from the same state (e.g., fresh `DriverState`s
+// for the same costs, and copies of the same constraints), and only
+// differ in their weight update algorithm (see weight-update.h),
+// e.g., an optimised implementation of the baseline's.
+//
+// Only algorithms with separate `PrepareWeights` and `UpdateWeights`
+// phases (`AdaHedge` and `NormalHedge`) can run in lockstep.
+// `PipelinedDriver`'s schedules (`kPipelinedAdaHedge` and
+// `kFusedAdaHedge`) build the next iteration's knapsack while they
+// update (and, when fused, observe) the losses, so there are no phase
+// boundaries at which to compare and resync: validate them end to end
+// instead, e.g., fused against separate passes as in
+// pipelined-driver_test.
+
+// Summarises the comparison of a family of values.
+struct Divergence {
+  // Compares the baseline's `expected` value with the solver under
+  // test's `actual` one, for entry `index`.  The error is relative
+  // to max(1, |expected|, |actual|), and infinite when only one of the
+  // values is NaN.
+  void Add(size_t index, double expected, double actual, double tolerance);
+  void Merge(const Divergence& other);
+
+  size_t num_compared{0};
+  // The number of entries whose error exceeds the tolerance.
+  size_t num_diverged{0};
+  double max_error{0};
+  // The entry with the largest error.
+  size_t worst_index{0};
+};
+
+// Wall-clock time for each phase of one side's iteration.
+struct PhaseTimes {
+  void Merge(const PhaseTimes& other);
+
+  absl::Duration prepare;
+  absl::Duration knapsack;
+  absl::Duration observe;
+  absl::Duration update;
+};
+
+struct LockstepReport {
+  // Whether any phase diverged.
+  bool diverged() const;
+  // Accumulates `other`'s divergences and times, and iterations.
+  // `diverged_constraints` are not merged.
+  void Merge(const LockstepReport& other);
+
+  size_t num_iterations{0};
+
+  // Knapsack weights and rhs, normalised by the sum of weights: index
+  // `i` is set `i`'s weight, and index `num_sets` the rhs.
+  Divergence weights;
+  // One entry per constraint, with an error of 1 when the subproblem
+  // solutions differ.
+  Divergence subproblems;
+  // The knapsack solution, per set, its objective value at index
+  // `num_sets`, and the observed loss at `num_sets + 1`.
+  Divergence knapsack;
+  // The cumulative losses, per constraint: each constraint's entry is
+  // its largest error.
+  Divergence losses;
+  // The `DriverState` scalars written by the weight update:
+  // `sum_mix_gap` and `prev_num_non_zero`.
+  Divergence update;
+
+  // The constraints whose subproblem solution or losses diverged, in
+  // increasing order, for the last iteration only.
+  std::vector<uint32_t> diverged_constraints;
+
+  PhaseTimes baseline_time;
+  PhaseTimes test_time;
+};
+
+// This class is thread-compatible.
+class LockstepDriver {
+ public:
+  struct Options {
+    double weight_tolerance{1e-9};
+    double knapsack_tolerance{1e-9};
+    double loss_tolerance{1e-9};
+    double update_tolerance{1e-9};
+  };
+
+  explicit LockstepDriver(const Options& options);
+  LockstepDriver() : LockstepDriver(Options()) {}
+
+  // Runs one iteration on both sides, and returns its report.  The
+  // solver under test ends the iteration with the baseline's
+  // subproblem solutions, knapsack solution, and (if they diverged)
+  // cumulative losses.  Returns early, like `DriveOneIteration`, if
+  // the baseline's knapsack is infeasible.
+  template <typename BaselineAlgorithm, typename TestAlgorithm>
+  const LockstepReport& DriveOneIteration(
+      absl::Span<CoverConstraint> baseline_constraints,
+      BaselineAlgorithm* baseline_algorithm, DriverState* baseline,
+      absl::Span<CoverConstraint> test_constraints,
+      TestAlgorithm* test_algorithm, DriverState* test);
+
+  const LockstepReport& last_report() const { return last_; }
+  // All iterations so far, merged.
+  const LockstepReport& total() const { return total_; }
+  // The number of iterations in which each constraint diverged.
+  absl::Span<const size_t> num_diverged_iterations() const {
+    return num_diverged_iterations_;
+  }
+
+ private:
+  // Compares the subproblem solutions, and resyncs the solver under
+  // test's constraints with the baseline's where they differ.
+  void SyncSubproblems(absl::Span<const CoverConstraint> baseline,
+                       absl::Span<CoverConstraint> test);
+  // Same for the knapsack solution and related `DriverState` fields.
+  void SyncKnapsack(const DriverState& baseline,
+                    double baseline_observed_loss, DriverState* test,
+                    double test_observed_loss);
+  // Same for cumulative losses.
+  void SyncLosses(absl::Span<const CoverConstraint> baseline,
+                  absl::Span<CoverConstraint> test);
+
+  void MarkDiverged(size_t constraint);
+  // Finalises `last_`, and merges it into the totals.
+  const LockstepReport& FinishIteration();
+
+  const Options options_;
+  LockstepReport last_;
+  LockstepReport total_;
+  std::vector<size_t> num_diverged_iterations_;
+};
+#endif /* !LOCKSTEP_DRIVER_H */
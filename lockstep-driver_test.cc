@@ -0,0 +1,98 @@
+#include "lockstep-driver.h"
+
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+#include "weight-update.h"
+
+using ::testing::ElementsAre;
+
+namespace {
+// Same instance and algorithm on both sides: nothing should diverge.
+TEST(LockstepDriver, IdenticalSidesAgree) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/500, /*num_values=*/100,
+                             /*min_set_per_value=*/2,
+                             /*max_set_per_value=*/20, /*seed=*/7);
+  std::vector<CoverConstraint> test_constraints(instance.constraints);
+  DriverState baseline(instance.obj_values);
+  DriverState test(instance.obj_values);
+  AdaHedge baseline_algorithm;
+  AdaHedge test_algorithm;
+
+  LockstepDriver driver;
+  for (size_t i = 0; i < 30 && baseline.feasible; ++i) {
+    const LockstepReport& report = driver.DriveOneIteration(
+        absl::MakeSpan(instance.constraints), &baseline_algorithm, &baseline,
+        absl::MakeSpan(test_constraints), &test_algorithm, &test);
+    EXPECT_FALSE(report.diverged()) << "iteration " << i;
+    EXPECT_TRUE(report.diverged_constraints.empty());
+  }
+
+  const LockstepReport& total = driver.total();
+  EXPECT_EQ(total.num_iterations, 30);
+  EXPECT_EQ(total.subproblems.num_compared, 30 * 100);
+  EXPECT_EQ(total.weights.num_compared, 30 * 501);
+  EXPECT_EQ(total.weights.max_error, 0.0);
+  EXPECT_EQ(total.losses.max_error, 0.0);
+  EXPECT_GT(total.baseline_time.prepare, absl::ZeroDuration());
+  EXPECT_GT(total.test_time.knapsack, absl::ZeroDuration());
+  EXPECT_EQ(test.sum_mix_gap, baseline.sum_mix_gap);
+  EXPECT_TRUE(test.last_solution == baseline.last_solution);
+}
+
+// Perturbing one constraint's losses in the solver under test
+// diverges for one iteration, until the losses are resynced.
+TEST(LockstepDriver, ReportsAndResyncsDivergence) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/500, /*num_values=*/100,
+                             /*min_set_per_value=*/2,
+                             /*max_set_per_value=*/20, /*seed=*/7);
+  std::vector<CoverConstraint> test_constraints(instance.constraints);
+  DriverState baseline(instance.obj_values);
+  DriverState test(instance.obj_values);
+  AdaHedge baseline_algorithm;
+  AdaHedge test_algorithm;
+
+  LockstepDriver driver;
+  const auto iterate = [&] {
+    return driver.DriveOneIteration(
+        absl::MakeSpan(instance.constraints), &baseline_algorithm, &baseline,
+        absl::MakeSpan(test_constraints), &test_algorithm, &test);
+  };
+
+  for (size_t i = 0; i < 10; ++i) {
+    ASSERT_FALSE(iterate().diverged());
+  }
+
+  {
+    CoverConstraint& constraint = test_constraints[3];
+    std::vector<double> loss(constraint.loss().begin(),
+                             constraint.loss().end());
+    for (double& x : loss) {
+      x += 0.25;
+    }
+
+    constraint.RestoreState(constraint.last_solution(), loss);
+  }
+
+  {
+    const LockstepReport& report = iterate();
+    EXPECT_TRUE(report.diverged());
+    EXPECT_GT(report.weights.num_diverged, 0);
+    EXPECT_EQ(report.losses.num_diverged, 1);
+    EXPECT_EQ(report.losses.worst_index, 3);
+    EXPECT_THAT(report.diverged_constraints, ElementsAre(3));
+  }
+
+  for (size_t i = 0; i < 5; ++i) {
+    EXPECT_FALSE(iterate().diverged());
+  }
+
+  EXPECT_EQ(driver.total().num_iterations, 16);
+  EXPECT_EQ(driver.num_diverged_iterations()[3], 1);
+  EXPECT_EQ(driver.num_diverged_iterations()[4], 0);
+}
+}  // namespace
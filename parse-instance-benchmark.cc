@@ -0,0 +1,75 @@
+// Measures the throughput of `ParseInstanceFile`, in MB/s of input
+// text, for a range of thread counts, e.g.,
+// `--instance_file=rail4284 --instance_format=rail --threads=1,2,4,8`.
+#include <sys/stat.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_split.h"
+#include "absl/time/clock.h"
+#include "absl/time/time.h"
+#include "parse-instance.h"
+#include "random-set-cover-flags.h"
+
+ABSL_FLAG(std::string, threads, "1,2,4",
+          "Comma-separated list of thread counts to benchmark");
+ABSL_FLAG(size_t, repetitions, 5,
+          "Number of times to parse the instance for each thread count");
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const std::string path = absl::GetFlag(FLAGS_instance_file);
+  InstanceFormat format;
+  if (path.empty() ||
+      !ParseInstanceFormat(absl::GetFlag(FLAGS_instance_format), &format)) {
+    std::cerr << "--instance_file and a valid --instance_format are "
+                 "required.\n";
+    return 1;
+  }
+
+  struct stat st;
+  if (stat(path.c_str(), &st) != 0) {
+    perror("stat");
+    return 1;
+  }
+
+  const double megabytes = st.st_size / 1e6;
+  for (absl::string_view threads_str :
+       absl::StrSplit(absl::GetFlag(FLAGS_threads), ',')) {
+    size_t num_threads;
+    if (!absl::SimpleAtoi(threads_str, &num_threads)) {
+      std::cerr << "Invalid thread count " << threads_str << ".\n";
+      return 1;
+    }
+
+    std::vector<double> durations;
+    for (size_t i = 0; i < absl::GetFlag(FLAGS_repetitions); ++i) {
+      const absl::Time begin = absl::Now();
+      const auto instance = ParseInstanceFile(path, format, num_threads);
+      durations.push_back(absl::ToDoubleSeconds(absl::Now() - begin));
+      if (!instance.has_value()) {
+        return 1;
+      }
+    }
+
+    if (durations.empty()) {
+      continue;
+    }
+
+    std::sort(durations.begin(), durations.end());
+    const double median = durations[durations.size() / 2];
+    std::cout << "threads=" << num_threads << " size=" << megabytes
+              << "MB median=" << median << "s min=" << durations.front()
+              << "s throughput=" << megabytes / median << "MB/s\n";
+  }
+
+  return 0;
+}
@@ -0,0 +1,340 @@
+#include "parse-instance.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "absl/types/span.h"
+
+namespace {
+// Don't bother spawning threads for less than this many bytes.
+constexpr size_t kMinChunkSize = 1 << 16;
+// Longest non-integer token we accept.
+constexpr size_t kMaxTokenSize = 64;
+// Integers with at most that many digits fit in a uint64_t.
+constexpr ptrdiff_t kMaxFastDigits = 19;
+
+constexpr size_t kNoError = SIZE_MAX;
+
+bool IsSpace(char c) {
+  return c == ' ' || c == '\n' || c == '\t' || c == '\r' || c == '\f' ||
+         c == '\v';
+}
+
+bool IsDigit(char c) { return static_cast<unsigned>(c - '0') < 10; }
+
+// The tokens parsed from one chunk of the text.
+struct Chunk {
+  std::vector<double> tokens;
+  // Offset of the first invalid token in the text, if any.
+  size_t error_offset{kNoError};
+};
+
+// Parses tokens that aren't plain integers (signs, decimals,
+// exponents, very long integers) with strtod.
+bool ParseSlow(const char* begin, const char* end, double* out) {
+  const size_t size = end - begin;
+  if (size >= kMaxTokenSize) {
+    return false;
+  }
+
+  char token[kMaxTokenSize];
+  memcpy(token, begin, size);
+  token[size] = '\0';
+
+  char* parse_end;
+  *out = strtod(token, &parse_end);
+  return parse_end == token + size;
+}
+
+// Tokenises `text[begin, end)`, where `begin` and `end` are at
+// whitespace boundaries.
+void TokenizeChunk(absl::string_view text, size_t begin, size_t end,
+                   Chunk* out) {
+  const char* p = text.data() + begin;
+  const char* const limit = text.data() + end;
+
+  // Most tokens are short integers: "1 " takes two bytes.
+  out->tokens.reserve((end - begin) / 3);
+  for (;;) {
+    while (p < limit && IsSpace(*p)) {
+      ++p;
+    }
+
+    if (p == limit) {
+      return;
+    }
+
+    const char* const token = p;
+    uint64_t acc = 0;
+    while (p < limit && IsDigit(*p) && p - token < kMaxFastDigits) {
+      acc = 10 * acc + (*p - '0');
+      ++p;
+    }
+
+    if (p != token && (p == limit || IsSpace(*p))) {
+      out->tokens.push_back(acc);
+      continue;
+    }
+
+    while (p < limit && !IsSpace(*p)) {
+      ++p;
+    }
+
+    double value;
+    if (!ParseSlow(token, p, &value)) {
+      out->error_offset = token - text.data();
+      return;
+    }
+
+    out->tokens.push_back(value);
+  }
+}
+
+// Splits `text` in up to `num_threads` chunks and tokenises them in
+// parallel.
+std::vector<Chunk> Tokenize(absl::string_view text, size_t num_threads) {
+  if (num_threads == 0) {
+    num_threads = std::max(1U, std::thread::hardware_concurrency());
+  }
+
+  const size_t num_chunks = std::max<size_t>(
+      1, std::min(num_threads, text.size() / kMinChunkSize));
+
+  std::vector<size_t> boundaries;
+  boundaries.push_back(0);
+  for (size_t i = 1; i < num_chunks; ++i) {
+    size_t boundary =
+        std::max(boundaries.back(), i * (text.size() / num_chunks));
+    while (boundary < text.size() && !IsSpace(text[boundary])) {
+      ++boundary;
+    }
+
+    boundaries.push_back(boundary);
+  }
+  boundaries.push_back(text.size());
+
+  std::vector<Chunk> chunks(num_chunks);
+  std::vector<std::thread> workers;
+  for (size_t i = 1; i < num_chunks; ++i) {
+    workers.emplace_back([text, &boundaries, &chunks, i] {
+      TokenizeChunk(text, boundaries[i], boundaries[i + 1], &chunks[i]);
+    });
+  }
+
+  TokenizeChunk(text, boundaries[0], boundaries[1], &chunks[0]);
+  for (std::thread& worker : workers) {
+    worker.join();
+  }
+
+  return chunks;
+}
+
+// Iterates over the tokens in a sequence of chunks.
+class TokenCursor {
+ public:
+  explicit TokenCursor(absl::Span<const Chunk> chunks) : chunks_(chunks) {}
+
+  bool Next(double* out) {
+    while (chunk_ < chunks_.size() && index_ >= chunks_[chunk_].tokens.size()) {
+      ++chunk_;
+      index_ = 0;
+    }
+
+    if (chunk_ == chunks_.size()) {
+      return false;
+    }
+
+    *out = chunks_[chunk_].tokens[index_++];
+    return true;
+  }
+
+  // Reads an integer in [0, limit).
+  bool NextIndex(uint64_t limit, uint64_t* out) {
+    double value;
+    if (!Next(&value) ||
+        !(value >= 0 && value < limit && value == std::floor(value))) {
+      return false;
+    }
+
+    *out = static_cast<uint64_t>(value);
+    return true;
+  }
+
+  // Reads a 1-based index in [1, limit], and returns it 0-based.
+  bool NextOneBased(uint64_t limit, uint64_t* out) {
+    if (!NextIndex(limit + 1, out) || *out == 0) {
+      return false;
+    }
+
+    --*out;
+    return true;
+  }
+
+ private:
+  absl::Span<const Chunk> chunks_;
+  size_t chunk_{0};
+  size_t index_{0};
+};
+
+bool ParseOrLibrary(TokenCursor* cursor, uint64_t num_rows,
+                    uint64_t num_columns, RandomSetCoverInstance* out) {
+  for (double& cost : out->obj_values) {
+    if (!cursor->Next(&cost)) {
+      std::cerr << "Failed to parse column costs.\n";
+      return false;
+    }
+  }
+
+  for (uint64_t row = 0; row < num_rows; ++row) {
+    std::vector<uint32_t>& sets = out->sets_per_value[row];
+    uint64_t count;
+    if (!cursor->NextIndex(num_columns + 1, &count)) {
+      std::cerr << "Failed to parse size of row " << row + 1 << ".\n";
+      return false;
+    }
+
+    sets.reserve(count);
+    for (uint64_t i = 0; i < count; ++i) {
+      uint64_t column;
+      if (!cursor->NextOneBased(num_columns, &column)) {
+        std::cerr << "Failed to parse column in row " << row + 1 << ".\n";
+        return false;
+      }
+
+      sets.push_back(column);
+    }
+  }
+
+  return true;
+}
+
+bool ParseRail(TokenCursor* cursor, uint64_t num_rows, uint64_t num_columns,
+               RandomSetCoverInstance* out) {
+  for (uint64_t column = 0; column < num_columns; ++column) {
+    uint64_t count;
+    if (!cursor->Next(&out->obj_values[column]) ||
+        !cursor->NextIndex(num_rows + 1, &count)) {
+      std::cerr << "Failed to parse header of column " << column + 1
+                << ".\n";
+      return false;
+    }
+
+    for (uint64_t i = 0; i < count; ++i) {
+      uint64_t row;
+      if (!cursor->NextOneBased(num_rows, &row)) {
+        std::cerr << "Failed to parse row in column " << column + 1 << ".\n";
+        return false;
+      }
+
+      // Columns are visited in order, so each row stays sorted.
+      out->sets_per_value[row].push_back(column);
+    }
+  }
+
+  return true;
+}
+}  // namespace
+
+bool ParseInstanceFormat(absl::string_view name, InstanceFormat* out) {
+  if (name == "orlib") {
+    *out = InstanceFormat::kOrLibrary;
+    return true;
+  }
+
+  if (name == "rail") {
+    *out = InstanceFormat::kRail;
+    return true;
+  }
+
+  return false;
+}
+
+absl::optional<RandomSetCoverInstance> ParseInstanceText(
+    absl::string_view text, InstanceFormat format, size_t num_threads) {
+  const std::vector<Chunk> chunks = Tokenize(text, num_threads);
+  for (const Chunk& chunk : chunks) {
+    if (chunk.error_offset != kNoError) {
+      std::cerr << "Invalid token at byte " << chunk.error_offset << ".\n";
+      return absl::nullopt;
+    }
+  }
+
+  TokenCursor cursor(chunks);
+  uint64_t num_rows;
+  uint64_t num_columns;
+  if (!cursor.NextIndex(UINT32_MAX, &num_rows) ||
+      !cursor.NextIndex(UINT32_MAX, &num_columns)) {
+    std::cerr << "Failed to parse instance size.\n";
+    return absl::nullopt;
+  }
+
+  RandomSetCoverInstance ret;
+  ret.obj_values.resize(num_columns);
+  ret.sets_per_value.resize(num_rows);
+
+  const bool ok = (format == InstanceFormat::kRail)
+                      ? ParseRail(&cursor, num_rows, num_columns, &ret)
+                      : ParseOrLibrary(&cursor, num_rows, num_columns, &ret);
+  if (!ok) {
+    return absl::nullopt;
+  }
+
+  double extra;
+  if (cursor.Next(&extra)) {
+    std::cerr << "Trailing data after instance.\n";
+    return absl::nullopt;
+  }
+
+  ret.constraints.reserve(num_rows);
+  for (const std::vector<uint32_t>& sets : ret.sets_per_value) {
+    ret.constraints.emplace_back(sets);
+  }
+
+  return ret;
+}
+
+absl::optional<RandomSetCoverInstance> ParseInstanceFile(
+    const std::string& path, InstanceFormat format, size_t num_threads) {
+  const int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    perror("open");
+    return absl::nullopt;
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) != 0) {
+    perror("fstat");
+    close(fd);
+    return absl::nullopt;
+  }
+
+  const size_t size = st.st_size;
+  if (size == 0) {
+    close(fd);
+    return ParseInstanceText(absl::string_view(), format, num_threads);
+  }
+
+  void* const base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (base == MAP_FAILED) {
+    perror("mmap");
+    return absl::nullopt;
+  }
+
+  madvise(base, size, MADV_WILLNEED);
+  absl::optional<RandomSetCoverInstance> ret = ParseInstanceText(
+      absl::string_view(static_cast<const char*>(base), size), format,
+      num_threads);
+  munmap(base, size);
+  return ret;
+}
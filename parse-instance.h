@@ -0,0 +1,40 @@
+#ifndef PARSE_INSTANCE_H
+#define PARSE_INSTANCE_H
+#include <cstddef>
+#include <string>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/optional.h"
+#include "random-set-cover-instance.h"
+
+// Text formats for public set covering benchmarks.  Both start with
+// the number of rows (values to cover) m and the number of columns
+// (sets) n, and all indices are 1-based.
+enum class InstanceFormat {
+  // OR-Library scp* files: the cost of each column, then, for each
+  // row, the number of columns that cover it followed by these
+  // columns.
+  kOrLibrary,
+  // OR-Library rail* files: for each column, its cost, the number of
+  // rows it covers, and these rows.
+  kRail,
+};
+
+// Parses "orlib" or "rail" into `out`.
+bool ParseInstanceFormat(absl::string_view name, InstanceFormat* out);
+
+// Parses the instance in `text`, with up to `num_threads` threads (0
+// for the hardware concurrency).  The text is split in chunks at
+// whitespace boundaries, and each chunk is tokenised in parallel
+// before a sequential pass assembles the instance.
+//
+// Returns nullopt (and logs to stderr) on parse errors or
+// out-of-range indices.
+absl::optional<RandomSetCoverInstance> ParseInstanceText(
+    absl::string_view text, InstanceFormat format, size_t num_threads = 0);
+
+// Memory-maps the file at `path` and parses it with
+// `ParseInstanceText`.
+absl::optional<RandomSetCoverInstance> ParseInstanceFile(
+    const std::string& path, InstanceFormat format, size_t num_threads = 0);
+#endif /* !PARSE_INSTANCE_H */
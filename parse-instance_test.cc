@@ -0,0 +1,143 @@
+#include "parse-instance.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::ElementsAre;
+
+namespace {
+std::string WriteTemp(const std::string& name, const std::string& contents) {
+  const char* dir = getenv("TEST_TMPDIR");
+  const std::string path =
+      std::string(dir != nullptr ? dir : "/tmp") + "/" + name;
+  FILE* file = fopen(path.c_str(), "w");
+  fwrite(contents.data(), 1, contents.size(), file);
+  fclose(file);
+  return path;
+}
+
+TEST(ParseInstance, Format) {
+  InstanceFormat format;
+  ASSERT_TRUE(ParseInstanceFormat("orlib", &format));
+  EXPECT_EQ(format, InstanceFormat::kOrLibrary);
+  ASSERT_TRUE(ParseInstanceFormat("rail", &format));
+  EXPECT_EQ(format, InstanceFormat::kRail);
+  EXPECT_FALSE(ParseInstanceFormat("scp", &format));
+}
+
+TEST(ParseInstance, OrLibrary) {
+  auto instance =
+      ParseInstanceText(" 3 4\n 1 2 3.5 4\n2\n 1 4\n1\n3\n 3 1 2 3\n",
+                        InstanceFormat::kOrLibrary);
+  ASSERT_TRUE(instance.has_value());
+  EXPECT_THAT(instance->obj_values, ElementsAre(1.0, 2.0, 3.5, 4.0));
+  EXPECT_THAT(instance->sets_per_value,
+              ElementsAre(ElementsAre(0, 3), ElementsAre(2),
+                          ElementsAre(0, 1, 2)));
+  EXPECT_EQ(instance->constraints.size(), 3);
+}
+
+TEST(ParseInstance, Rail) {
+  // 3 rows, 2 columns: column 1 covers rows 1 and 3, column 2 covers
+  // rows 2 and 3.
+  auto instance =
+      ParseInstanceText("3 2\n1 2 1 3\n2 2 2 3\n", InstanceFormat::kRail);
+  ASSERT_TRUE(instance.has_value());
+  EXPECT_THAT(instance->obj_values, ElementsAre(1.0, 2.0));
+  EXPECT_THAT(instance->sets_per_value,
+              ElementsAre(ElementsAre(0), ElementsAre(1), ElementsAre(0, 1)));
+}
+
+TEST(ParseInstance, Errors) {
+  // Truncated.
+  EXPECT_FALSE(
+      ParseInstanceText("2 2\n1 1\n2 1", InstanceFormat::kOrLibrary));
+  // Out of range column.
+  EXPECT_FALSE(ParseInstanceText("1 2\n1 1\n1 3", InstanceFormat::kOrLibrary));
+  // Column 0.
+  EXPECT_FALSE(ParseInstanceText("1 2\n1 1\n1 0", InstanceFormat::kOrLibrary));
+  // Out of range row.
+  EXPECT_FALSE(ParseInstanceText("1 1\n1 1 2", InstanceFormat::kRail));
+  // Garbage.
+  EXPECT_FALSE(ParseInstanceText("1 1\n1 1 x", InstanceFormat::kOrLibrary));
+  // Trailing data.
+  EXPECT_FALSE(ParseInstanceText("1 1\n1 1 1 1", InstanceFormat::kOrLibrary));
+  EXPECT_FALSE(ParseInstanceText("", InstanceFormat::kOrLibrary));
+}
+
+// Parsing with many threads must split chunks at token boundaries
+// and yield the same instance as a sequential parse.
+TEST(ParseInstance, Parallel) {
+  const size_t kNumRows = 100000;
+  const size_t kNumColumns = 1000;
+  std::string text =
+      std::to_string(kNumRows) + " " + std::to_string(kNumColumns) + "\n";
+  for (size_t i = 0; i < kNumColumns; ++i) {
+    text += std::to_string(i + 1) + (i % 10 == 9 ? "\n" : " ");
+  }
+
+  for (size_t i = 0; i < kNumRows; ++i) {
+    text += "3\n" + std::to_string(1 + i % kNumColumns) + " " +
+            std::to_string(1 + (7 * i + 1) % kNumColumns) + " 1000\n";
+  }
+
+  auto sequential = ParseInstanceText(text, InstanceFormat::kOrLibrary, 1);
+  auto parallel = ParseInstanceText(text, InstanceFormat::kOrLibrary, 7);
+  ASSERT_TRUE(sequential.has_value());
+  ASSERT_TRUE(parallel.has_value());
+  EXPECT_EQ(sequential->obj_values, parallel->obj_values);
+  EXPECT_EQ(sequential->sets_per_value, parallel->sets_per_value);
+  EXPECT_EQ(parallel->obj_values.back(), kNumColumns);
+  EXPECT_THAT(parallel->sets_per_value[12], ElementsAre(12, 85, 999));
+}
+TEST(ParseInstance, File) {
+  const std::string path = WriteTemp(
+      "parse-instance-file", " 3 4\n 1 2 3.5 4\n2\n 1 4\n1\n3\n 3 1 2 3");
+
+  auto instance = ParseInstanceFile(path, InstanceFormat::kOrLibrary);
+  ASSERT_TRUE(instance.has_value());
+  EXPECT_THAT(instance->obj_values, ElementsAre(1.0, 2.0, 3.5, 4.0));
+  EXPECT_THAT(instance->sets_per_value,
+              ElementsAre(ElementsAre(0, 3), ElementsAre(2),
+                          ElementsAre(0, 1, 2)));
+  remove(path.c_str());
+
+  EXPECT_FALSE(ParseInstanceFile(path, InstanceFormat::kOrLibrary));
+}
+
+TEST(ParseInstance, FileErrors) {
+  const std::string truncated =
+      WriteTemp("parse-instance-truncated", "2 2\n1 1\n2 1");
+  EXPECT_FALSE(ParseInstanceFile(truncated, InstanceFormat::kOrLibrary));
+  remove(truncated.c_str());
+
+  const std::string range =
+      WriteTemp("parse-instance-range", "1 2\n1 1\n1 3");
+  EXPECT_FALSE(ParseInstanceFile(range, InstanceFormat::kOrLibrary));
+  remove(range.c_str());
+}
+
+// Large files are split in many chunks; tokens must not straddle them.
+TEST(ParseInstance, LargeFile) {
+  const size_t kNumRows = 200000;
+  std::string contents = std::to_string(kNumRows) + " 3\n 1 2 3\n";
+  for (size_t i = 0; i < kNumRows; ++i) {
+    contents += "2 " + std::to_string(1 + i % 3) + " 3\n";
+  }
+
+  const std::string path = WriteTemp("parse-instance-large", contents);
+  auto instance = ParseInstanceFile(path, InstanceFormat::kOrLibrary, 8);
+  remove(path.c_str());
+  ASSERT_TRUE(instance.has_value());
+  ASSERT_EQ(instance->sets_per_value.size(), kNumRows);
+  for (size_t i = 0; i < kNumRows; ++i) {
+    ASSERT_THAT(instance->sets_per_value[i], ElementsAre(i % 3, 2));
+  }
+}
+}  // namespace
@@ -0,0 +1,185 @@
+#include "perf-counters.h"
+
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <iostream>
+#include <string>
+
+#include "absl/strings/str_cat.h"
+
+namespace {
+struct EventSpec {
+  const char* name;
+  uint32_t type;
+  uint64_t config;
+};
+
+// In the order of `PerfCounts`' fields.
+constexpr EventSpec kEvents[] = {
+    {"cycles", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+    {"instructions", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+    {"LLC misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+    {"branch misses", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES},
+    {"dTLB misses", PERF_TYPE_HW_CACHE,
+     PERF_COUNT_HW_CACHE_DTLB | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+         (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)},
+};
+
+uint64_t* Field(size_t i, PerfCounts* counts) {
+  uint64_t* const fields[] = {&counts->cycles, &counts->instructions,
+                              &counts->llc_misses, &counts->branch_misses,
+                              &counts->dtlb_misses};
+  return fields[i];
+}
+
+int OpenEvent(const EventSpec& spec, int group_fd) {
+  struct perf_event_attr attr;
+  memset(&attr, 0, sizeof(attr));
+  attr.size = sizeof(attr);
+  attr.type = spec.type;
+  attr.config = spec.config;
+  // Only the leader's flags matter for the group's scheduling.
+  attr.disabled = group_fd == -1;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv = 1;
+  attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                     PERF_FORMAT_TOTAL_TIME_RUNNING;
+  return syscall(__NR_perf_event_open, &attr, /*pid=*/0, /*cpu=*/-1,
+                 group_fd, /*flags=*/0);
+}
+
+// Only complain once per process: solvers may open a group for each
+// `Drive`.
+bool ShouldLog() {
+  static std::atomic<bool> logged{false};
+  return !logged.exchange(true, std::memory_order_relaxed);
+}
+}  // namespace
+
+PerfCounts& PerfCounts::operator+=(const PerfCounts& other) {
+  cycles += other.cycles;
+  instructions += other.instructions;
+  llc_misses += other.llc_misses;
+  branch_misses += other.branch_misses;
+  dtlb_misses += other.dtlb_misses;
+  return *this;
+}
+
+PerfCounts& PerfCounts::operator-=(const PerfCounts& other) {
+  cycles -= other.cycles;
+  instructions -= other.instructions;
+  llc_misses -= other.llc_misses;
+  branch_misses -= other.branch_misses;
+  dtlb_misses -= other.dtlb_misses;
+  return *this;
+}
+
+void PrintPerfCounts(const PerfCounts& counts, size_t num_iterations,
+                     std::ostream* out) {
+  const double iterations = std::max<size_t>(1, num_iterations);
+  const double instructions = std::max<uint64_t>(1, counts.instructions);
+  *out << 1e-3 * counts.cycles / iterations << " Kcycles/iter "
+       << (counts.cycles > 0 ? 1.0 * counts.instructions / counts.cycles : 0.0)
+       << " IPC " << 1000 * counts.llc_misses / instructions << " LLC "
+       << 1000 * counts.branch_misses / instructions << " branch "
+       << 1000 * counts.dtlb_misses / instructions << " dTLB misses/Kinsn";
+}
+
+std::unique_ptr<PerfCounterGroup> PerfCounterGroup::Open() {
+  std::unique_ptr<PerfCounterGroup> ret(new PerfCounterGroup());
+  ret->fds_.fill(-1);
+  ret->positions_.fill(-1);
+
+  std::string unavailable;
+  int first_error = 0;
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    const int fd = OpenEvent(kEvents[i], ret->leader_fd_);
+    if (fd < 0) {
+      if (first_error == 0) {
+        first_error = errno;
+      }
+
+      absl::StrAppend(&unavailable, unavailable.empty() ? "" : ", ",
+                      kEvents[i].name);
+      continue;
+    }
+
+    if (ret->leader_fd_ == -1) {
+      ret->leader_fd_ = fd;
+    }
+
+    ret->fds_[i] = fd;
+    ret->positions_[i] = ret->num_open_++;
+  }
+
+  if (ret->leader_fd_ == -1) {
+    if (ShouldLog()) {
+      std::cerr << "Hardware performance counters unavailable: "
+                << strerror(first_error)
+                << " (check /proc/sys/kernel/perf_event_paranoid).\n";
+    }
+
+    return nullptr;
+  }
+
+  if (!unavailable.empty() && ShouldLog()) {
+    std::cerr << "Not counting " << unavailable << ": "
+              << strerror(first_error) << ".\n";
+  }
+
+  if (ioctl(ret->leader_fd_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP) != 0 ||
+      ioctl(ret->leader_fd_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP) !=
+          0) {
+    if (ShouldLog()) {
+      std::cerr << "Failed to enable performance counters: "
+                << strerror(errno) << ".\n";
+    }
+
+    return nullptr;
+  }
+
+  return ret;
+}
+
+PerfCounterGroup::~PerfCounterGroup() {
+  for (int fd : fds_) {
+    if (fd >= 0) {
+      close(fd);
+    }
+  }
+}
+
+PerfCounts PerfCounterGroup::Read() const {
+  // nr, time_enabled, time_running, then one value per event.
+  uint64_t buf[3 + kNumEvents];
+  PerfCounts ret;
+  const ssize_t expected = (3 + num_open_) * sizeof(uint64_t);
+  if (read(leader_fd_, buf, sizeof(buf)) != expected || buf[0] != num_open_) {
+    return ret;
+  }
+
+  const uint64_t enabled = buf[1];
+  const uint64_t running = buf[2];
+  for (size_t i = 0; i < kNumEvents; ++i) {
+    if (positions_[i] < 0) {
+      continue;
+    }
+
+    uint64_t value = buf[3 + positions_[i]];
+    if (running > 0 && running < enabled) {
+      value = static_cast<uint64_t>(static_cast<double>(value) * enabled /
+                                    running);
+    }
+
+    *Field(i, &ret) = value;
+  }
+
+  return ret;
+}
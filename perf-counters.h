@@ -0,0 +1,74 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+// Hardware performance counters for the calling thread, from
+// perf_event_open(2), to tell whether a phase is bound on compute,
+// memory bandwidth, branch prediction or address translation.
+
+// Counts are deltas or sums, depending on context.
+struct PerfCounts {
+  PerfCounts& operator+=(const PerfCounts& other);
+  PerfCounts& operator-=(const PerfCounts& other);
+
+  uint64_t cycles{0};
+  uint64_t instructions{0};
+  // Last-level cache misses.
+  uint64_t llc_misses{0};
+  uint64_t branch_misses{0};
+  // Data TLB read misses.
+  uint64_t dtlb_misses{0};
+};
+
+inline PerfCounts operator-(PerfCounts x, const PerfCounts& y) {
+  x -= y;
+  return x;
+}
+
+// Prints `counts` averaged over `num_iterations`: thousands of
+// cycles per iteration, instructions per cycle, and misses per
+// thousand instructions.
+void PrintPerfCounts(const PerfCounts& counts, size_t num_iterations,
+                     std::ostream* out);
+
+// A group of counters that's scheduled on the PMU as a unit, so all
+// counts cover the same instructions.  Only counts user-space events,
+// which is what unprivileged processes may count by default.
+//
+// This class is thread-compatible, but only counts events for the
+// thread that called `Open`.
+class PerfCounterGroup {
+ public:
+  // Opens and starts the counters.  Returns nullptr if no counter
+  // is available (e.g., perf_event_paranoid forbids them, or in a
+  // container without a PMU), and logs why to stderr, once per
+  // process.  Events that can't be counted individually always
+  // read as 0.
+  static std::unique_ptr<PerfCounterGroup> Open();
+
+  ~PerfCounterGroup();
+
+  PerfCounterGroup(const PerfCounterGroup&) = delete;
+  PerfCounterGroup& operator=(const PerfCounterGroup&) = delete;
+
+  // Returns the counts since `Open`, scaled up if the group was
+  // multiplexed with other users of the PMU.
+  PerfCounts Read() const;
+
+ private:
+  static constexpr size_t kNumEvents = 5;
+
+  PerfCounterGroup() = default;
+
+  int leader_fd_{-1};
+  std::array<int, kNumEvents> fds_;
+  // The position of each open event in the group's read format, in
+  // the order of `PerfCounts`' fields; -1 if unavailable.
+  std::array<int, kNumEvents> positions_;
+  size_t num_open_{0};
+};
+#endif /* !PERF_COUNTERS_H */
@@ -0,0 +1,55 @@
+#include "perf-counters.h"
+
+#include <memory>
+#include <sstream>
+
+#include "gtest/gtest.h"
+
+namespace {
+TEST(PerfCounts, Arithmetic) {
+  PerfCounts x;
+  x.cycles = 10;
+  x.instructions = 20;
+  x.llc_misses = 3;
+  x.branch_misses = 4;
+  x.dtlb_misses = 5;
+
+  PerfCounts y = x;
+  y += x;
+  EXPECT_EQ(y.cycles, 20);
+  EXPECT_EQ(y.dtlb_misses, 10);
+
+  const PerfCounts z = y - x;
+  EXPECT_EQ(z.cycles, 10);
+  EXPECT_EQ(z.instructions, 20);
+  EXPECT_EQ(z.llc_misses, 3);
+  EXPECT_EQ(z.branch_misses, 4);
+  EXPECT_EQ(z.dtlb_misses, 5);
+
+  std::ostringstream out;
+  PrintPerfCounts(z, 10, &out);
+  EXPECT_EQ(out.str(),
+            "0.001 Kcycles/iter 2 IPC 150 LLC 200 branch 250 dTLB "
+            "misses/Kinsn");
+}
+
+// Counters are often unavailable (e.g., in containers), so only check
+// that they are monotonic when they are.
+TEST(PerfCounterGroup, CountsWhenAvailable) {
+  std::unique_ptr<PerfCounterGroup> group = PerfCounterGroup::Open();
+  if (group == nullptr) {
+    return;
+  }
+
+  const PerfCounts before = group->Read();
+  volatile double sum = 0;
+  for (int i = 0; i < 1000000; ++i) {
+    sum += i;
+  }
+
+  const PerfCounts after = group->Read();
+  EXPECT_GE(after.cycles, before.cycles);
+  EXPECT_GE(after.instructions, before.instructions);
+  EXPECT_GE(after.branch_misses, before.branch_misses);
+}
+}  // namespace
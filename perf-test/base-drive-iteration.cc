@@ -0,0 +1,169 @@
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "bench/timing-function.h"
+#include "checkpoint.h"
+#include "cover-constraint.h"
+#include "driver.h"
+#include "perf-test/drive-iteration.h"
+#include "weight-update.h"
+
+namespace {
+using Snapshot = bench::StableUniquePtr<const DriveIterationSnapshot>;
+
+// The solver state for a snapshot, rebuilt with this library's
+// version of the driver, along with the results of the phases that
+// ran before the timed one.
+struct DriveIterationContext {
+  explicit DriveIterationContext(const DriveIterationSnapshot& snapshot)
+      : snapshot(&snapshot),
+        state(absl::MakeConstSpan(snapshot.obj_values, snapshot.num_sets)) {
+    constraints.reserve(snapshot.num_constraints);
+    for (size_t i = 0; i < snapshot.num_constraints; ++i) {
+      const size_t begin = snapshot.tour_offsets[i];
+      const size_t end = snapshot.tour_offsets[i + 1];
+      constraints.push_back(CoverConstraint::BorrowSorted(
+          absl::MakeConstSpan(snapshot.tours + begin, end - begin)));
+    }
+
+    if (!DeserializeCheckpoint(
+            absl::MakeConstSpan(snapshot.checkpoint, snapshot.checkpoint_size),
+            absl::MakeSpan(constraints), &state)) {
+      std::cerr << "Failed to restore the driver snapshot.\n";
+      abort();
+    }
+
+    if (snapshot.knapsack_seed != 0) {
+      state.knapsack_prng.emplace(snapshot.knapsack_seed);
+    }
+
+    for (size_t i = 0; i < snapshot.num_warmup_iterations; ++i) {
+      DriveOneIteration(absl::MakeSpan(constraints), &algorithm, &state);
+    }
+  }
+
+  const DriveIterationSnapshot* snapshot;
+  DriverState state;
+  std::vector<CoverConstraint> constraints;
+  AdaHedge algorithm;
+
+  absl::optional<PrepareWeightsState> prepare_weights;
+  double observed_loss{0};
+  absl::optional<ObserveLossState> observe_state;
+};
+
+using Context = std::unique_ptr<DriveIterationContext>;
+
+// Each phase's `Prep` runs the phases before it, outside the timed
+// region.  The timed functions store their results in the context,
+// so that nothing is destroyed before the clock stops.
+Context PrepIteration(const Snapshot& snapshot) {
+  return absl::make_unique<DriveIterationContext>(*snapshot);
+}
+
+Context PrepKnapsack(const Snapshot& snapshot) {
+  Context ret = PrepIteration(snapshot);
+  ret->prepare_weights.emplace(ret->algorithm.PrepareWeights(
+      absl::MakeSpan(ret->constraints), &ret->state));
+  return ret;
+}
+
+Context PrepObserve(const Snapshot& snapshot) {
+  Context ret = PrepKnapsack(snapshot);
+  ret->observed_loss =
+      UpdateStateWithNewRelaxedSolution(*ret->prepare_weights, &ret->state);
+  return ret;
+}
+
+Context PrepUpdate(const Snapshot& snapshot) {
+  Context ret = PrepObserve(snapshot);
+  ret->observe_state.emplace(
+      ObserveAllLosses(absl::MakeSpan(ret->constraints), &ret->state));
+  return ret;
+}
+
+const auto ProtoDriveIterationSnapshot = [] {
+  return MakeDriveIterationSnapshot(1000, 100, 1, 10, 1, 10, 1);
+};
+
+const auto TimedIteration = [](const Context& context) {
+  DriveOneIteration(absl::MakeSpan(context->constraints), &context->algorithm,
+                    &context->state);
+  return context->state.last_solution_value;
+};
+
+const auto TimedPrepareWeights = [](const Context& context) {
+  context->prepare_weights.emplace(context->algorithm.PrepareWeights(
+      absl::MakeSpan(context->constraints), &context->state));
+  return context->prepare_weights->knapsack_rhs;
+};
+
+const auto TimedSolveKnapsack = [](const Context& context) {
+  return UpdateStateWithNewRelaxedSolution(*context->prepare_weights,
+                                           &context->state);
+};
+
+const auto TimedObserveLosses = [](const Context& context) {
+  context->observe_state.emplace(
+      ObserveAllLosses(absl::MakeSpan(context->constraints), &context->state));
+  return context->observe_state->min_loss;
+};
+
+const auto TimedUpdateWeights = [](const Context& context) {
+  context->algorithm.UpdateWeights(
+      absl::MakeSpan(context->constraints), *context->prepare_weights,
+      *context->observe_state, context->observed_loss, &context->state);
+  return context->state.sum_mix_gap;
+};
+
+// Returns the number of iterations until the average solution's
+// maximum violation is less than `eps` (the main stopping criterion
+// in `SetCoverSolver::Drive`), or `max_iterations` if it never is.
+const auto TimedSolveToEps = [](const Context& context) {
+  DriverState& state = context->state;
+  const DriveIterationSnapshot& snapshot = *context->snapshot;
+  while (state.num_iterations < snapshot.max_iterations) {
+    DriveOneIteration(absl::MakeSpan(context->constraints),
+                      &context->algorithm, &state);
+    if (!state.feasible ||
+        -state.prev_min_loss / state.num_iterations < snapshot.eps) {
+      break;
+    }
+  }
+
+  return static_cast<double>(state.num_iterations);
+};
+}  // namespace
+
+// Expose MakeTimingFunction callbacks to time a whole
+// `DriveOneIteration` with AdaHedge weights, each of its phases, and
+// whole solves (see `MakeSolveToEpsSnapshot`), in the current
+// implementation.
+DEFINE_MAKE_TIMING_FUNCTION(MakeDriveIteration,
+                            decltype(ProtoDriveIterationSnapshot),
+                            PrepIteration, TimedIteration);
+
+DEFINE_MAKE_TIMING_FUNCTION(MakePrepareWeights,
+                            decltype(ProtoDriveIterationSnapshot),
+                            PrepIteration, TimedPrepareWeights);
+
+DEFINE_MAKE_TIMING_FUNCTION(MakeSolveKnapsack,
+                            decltype(ProtoDriveIterationSnapshot),
+                            PrepKnapsack, TimedSolveKnapsack);
+
+DEFINE_MAKE_TIMING_FUNCTION(MakeObserveLosses,
+                            decltype(ProtoDriveIterationSnapshot),
+                            PrepObserve, TimedObserveLosses);
+
+DEFINE_MAKE_TIMING_FUNCTION(MakeUpdateWeights,
+                            decltype(ProtoDriveIterationSnapshot),
+                            PrepUpdate, TimedUpdateWeights);
+
+DEFINE_MAKE_TIMING_FUNCTION(MakeSolveToEps,
+                            decltype(ProtoDriveIterationSnapshot),
+                            PrepIteration, TimedSolveToEps);
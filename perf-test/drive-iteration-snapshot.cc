@@ -0,0 +1,99 @@
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "absl/memory/memory.h"
+#include "absl/types/span.h"
+#include "bench/stable-unique-ptr.h"
+#include "checkpoint.h"
+#include "cover-constraint.h"
+#include "driver.h"
+#include "perf-test/drive-iteration.h"
+#include "random-set-cover-instance.h"
+
+namespace {
+bench::StableUniquePtr<const DriveIterationSnapshot> MakeSnapshot(
+    size_t num_sets, size_t num_values, size_t min_set_per_value,
+    size_t max_set_per_value, uint64_t seed, size_t num_iterations,
+    size_t num_warmup_iterations, double eps, size_t max_iterations) {
+  struct Backing {
+    DriveIterationSnapshot snapshot;
+    std::vector<double> obj_values;
+    std::vector<size_t> tour_offsets;
+    std::vector<uint32_t> tours;
+    std::vector<char> checkpoint;
+  };
+
+  RandomSetCoverInstance instance = GenerateRandomInstance(
+      num_sets, num_values, min_set_per_value, max_set_per_value, seed);
+  auto ret = absl::make_unique<Backing>();
+  ret->obj_values = std::move(instance.obj_values);
+
+  {
+    DriverState state(ret->obj_values);
+    for (size_t i = 0; i < num_iterations && state.feasible; ++i) {
+      DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+    }
+
+    SerializeCheckpoint(state, instance.constraints, &ret->checkpoint);
+  }
+
+  ret->tour_offsets.push_back(0);
+  for (const CoverConstraint& constraint : instance.constraints) {
+    const absl::Span<const uint32_t> tours = constraint.potential_tours();
+    ret->tours.insert(ret->tours.end(), tours.begin(), tours.end());
+    ret->tour_offsets.push_back(ret->tours.size());
+  }
+
+  DriveIterationSnapshot& snapshot = ret->snapshot;
+  snapshot.obj_values = ret->obj_values.data();
+  snapshot.num_sets = ret->obj_values.size();
+  snapshot.tour_offsets = ret->tour_offsets.data();
+  snapshot.tours = ret->tours.data();
+  snapshot.num_constraints = instance.constraints.size();
+  snapshot.checkpoint = ret->checkpoint.data();
+  snapshot.checkpoint_size = ret->checkpoint.size();
+  snapshot.num_warmup_iterations = num_warmup_iterations;
+  snapshot.eps = eps;
+  snapshot.max_iterations = max_iterations;
+  snapshot.knapsack_seed = 0;
+  return bench::MakeStableUniquePtr(&ret->snapshot, std::move(ret));
+}
+}  // namespace
+
+bench::StableUniquePtr<const DriveIterationSnapshot> MakeDriveIterationSnapshot(
+    size_t num_sets, size_t num_values, size_t min_set_per_value,
+    size_t max_set_per_value, uint64_t seed, size_t num_iterations,
+    size_t num_warmup_iterations) {
+  return MakeSnapshot(num_sets, num_values, min_set_per_value,
+                      max_set_per_value, seed, num_iterations,
+                      num_warmup_iterations, /*eps=*/0,
+                      /*max_iterations=*/0);
+}
+
+bench::StableUniquePtr<const DriveIterationSnapshot> MakeSolveToEpsSnapshot(
+    size_t num_sets, size_t num_values, size_t min_set_per_value,
+    size_t max_set_per_value, uint64_t seed, double eps,
+    size_t max_iterations) {
+  return MakeSnapshot(num_sets, num_values, min_set_per_value,
+                      max_set_per_value, seed, /*num_iterations=*/0,
+                      /*num_warmup_iterations=*/0, eps, max_iterations);
+}
+
+bench::StableUniquePtr<const DriveIterationSnapshot>
+ShareDriveIterationSnapshot(
+    const std::shared_ptr<
+        const bench::StableUniquePtr<const DriveIterationSnapshot>>& snapshot,
+    uint64_t knapsack_seed) {
+  struct Backing {
+    DriveIterationSnapshot snapshot;
+    std::shared_ptr<const bench::StableUniquePtr<const DriveIterationSnapshot>>
+        owner;
+  };
+
+  auto ret = absl::make_unique<Backing>();
+  ret->snapshot = **snapshot;
+  ret->snapshot.knapsack_seed = knapsack_seed;
+  ret->owner = snapshot;
+  return bench::MakeStableUniquePtr(&ret->snapshot, std::move(ret));
+}
@@ -0,0 +1,257 @@
+#include "perf-test/drive-iteration.h"
+
+#include <algorithm>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "bench/bounded-mean-test.h"
+#include "bench/cache-state.h"
+#include "bench/compare-functions.h"
+#include "bench/extract-timing-function.h"
+#include "bench/kolmogorov-smirnov-test.h"
+#include "bench/quantile-test.h"
+#include "bench/stable-unique-ptr.h"
+#include "bench/timing-function.h"
+
+using ::bench::BoundedMeanTest;
+using ::bench::CompareFunctions;
+using ::bench::ComparisonResult;
+using ::bench::KolmogorovSmirnovTest;
+using ::bench::QuantileTest;
+using ::bench::TestParams;
+
+ABSL_FLAG(std::string, lib_a, "perf-test/libbase-drive-iteration.so",
+          "Path to the shared object for version A.");
+
+ABSL_FLAG(std::string, fn_a, "MakeDriveIteration",
+          "Name of the function to generate the timing function for version "
+          "A: MakeDriveIteration for a whole iteration, or one of "
+          "MakePrepareWeights, MakeSolveKnapsack, MakeObserveLosses and "
+          "MakeUpdateWeights for a single phase.");
+
+ABSL_FLAG(std::string, lib_b, "perf-test/libbase-drive-iteration.so",
+          "Path to the shared object for version B.");
+
+ABSL_FLAG(std::string, fn_b, "MakeDriveIteration",
+          "Name of the function to generate the timing function for version "
+          "B.");
+
+ABSL_FLAG(size_t, num_sets, 20000, "Number of sets in the random instances.");
+
+ABSL_FLAG(size_t, num_values, 1000,
+          "Number of values in the random instances.");
+
+ABSL_FLAG(size_t, min_set_per_value, 1,
+          "Minimum number of sets that cover each value.");
+
+ABSL_FLAG(size_t, max_set_per_value, 210,
+          "Maximum number of sets that cover each value.");
+
+ABSL_FLAG(uint64_t, seed, 1,
+          "Seed for the first random instance; the others use the next "
+          "seeds.");
+
+ABSL_FLAG(size_t, num_snapshots, 4,
+          "Number of random instances (and driver snapshots) to sample "
+          "from.");
+
+ABSL_FLAG(size_t, num_iterations, 200,
+          "Number of iterations before snapshotting the driver.");
+
+ABSL_FLAG(size_t, num_warmup_iterations, 1,
+          "Number of untimed iterations after restoring each snapshot.");
+
+ABSL_FLAG(double, min_relative_effect, 0.01,
+          "Minimum effect size, as a fraction of the median time for A.");
+
+ABSL_FLAG(absl::Duration, timeout, absl::Minutes(10),
+          "Time limit for each statistical test.");
+
+ABSL_FLAG(bool, fn_a_lte, false,
+          "If true, tests whether A is not worse than B. If false (default), "
+          "tests for equality.");
+
+ABSL_FLAG(bool, load_a_first, true,
+          "If true, load fn a first, otherwise load fn b first. This flag has "
+          "no impact on the analysis, but helps control for accidental "
+          "effects of dlopen ordering on performance.");
+
+ABSL_FLAG(size_t, num_threads, 2,
+          "Number of worker threads. Defaults to two (one + the main thread), "
+          "to guarantee that we never spend more than half of our CPU time on "
+          "statistical analysis: only the main thread runs the analysis code, "
+          "while worker threads generate more data non-stop.");
+
+ABSL_FLAG(bool, paired_pivots, true,
+          "If true, A and B draw the knapsack's pivots from the same stream "
+          "for each comparison (a new one for each comparison), so that pivot "
+          "luck cancels out.  Libraries built before knapsack seeds existed "
+          "ignore this flag.");
+
+ABSL_FLAG(bool, pin_threads, false,
+          "If true, pin the main thread and each worker thread to its own "
+          "physical core (never SMT siblings); see --cpuset.");
+
+ABSL_FLAG(std::string, cpuset, "",
+          "With --pin_threads, only pin to CPUs in this list (e.g., 2-7), "
+          "ideally isolated from the rest of the host's load.");
+
+ABSL_FLAG(std::string, cache_state, "hot",
+          "State of the caches before each timed call: hot, or evict_llc to "
+          "time the iteration as if the instance were far bigger than the "
+          "last level cache.");
+
+ABSL_FLAG(uint32_t, bandwidth_pressure, 0,
+          "Number of co-runner threads that compete for memory bandwidth "
+          "while we time A and B.");
+
+namespace {
+using Snapshot = bench::StableUniquePtr<const DriveIterationSnapshot>;
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const absl::optional<bench::CacheState> cache_state =
+      bench::ParseCacheState(absl::GetFlag(FLAGS_cache_state));
+  if (!cache_state.has_value()) {
+    std::cerr << "Unknown --cache_state " << absl::GetFlag(FLAGS_cache_state)
+              << ".\n";
+    return 1;
+  }
+
+  // Snapshots are expensive to generate, so we only make a few
+  // upfront, and each comparison picks one at random.  Both versions
+  // always rebuild their state from the same snapshot.
+  const size_t num_snapshots =
+      std::max<size_t>(1, absl::GetFlag(FLAGS_num_snapshots));
+  std::vector<std::shared_ptr<const Snapshot>> snapshots;
+  for (size_t i = 0; i < num_snapshots; ++i) {
+    snapshots.push_back(std::make_shared<const Snapshot>(
+        MakeDriveIterationSnapshot(
+            absl::GetFlag(FLAGS_num_sets), absl::GetFlag(FLAGS_num_values),
+            absl::GetFlag(FLAGS_min_set_per_value),
+            absl::GetFlag(FLAGS_max_set_per_value),
+            absl::GetFlag(FLAGS_seed) + i, absl::GetFlag(FLAGS_num_iterations),
+            absl::GetFlag(FLAGS_num_warmup_iterations))));
+  }
+
+  const bool paired_pivots = absl::GetFlag(FLAGS_paired_pivots);
+  const auto generator = [&snapshots, paired_pivots] {
+    static thread_local std::unique_ptr<std::mt19937_64> rng;
+    if (rng == nullptr) {
+      std::random_device dev;
+      rng.reset(new std::mt19937_64(dev()));
+    }
+
+    std::uniform_int_distribution<size_t> u(0, snapshots.size() - 1);
+    const std::shared_ptr<const Snapshot>& snapshot = snapshots[u(*rng)];
+    // Seeds must be non-zero.
+    return ShareDriveIterationSnapshot(snapshot,
+                                       paired_pivots ? (*rng)() | 1 : 0);
+  };
+
+  using GenResult = std::tuple<decltype(generator())>;
+  auto fns = [&] {
+    if (absl::GetFlag(FLAGS_load_a_first)) {
+      auto fn_a = bench::ExtractTimingFunction<std::tuple<double>, GenResult>(
+          absl::GetFlag(FLAGS_lib_a), absl::GetFlag(FLAGS_fn_a));
+      auto fn_b = bench::ExtractTimingFunction<std::tuple<double>, GenResult>(
+          absl::GetFlag(FLAGS_lib_b), absl::GetFlag(FLAGS_fn_b));
+      return std::make_pair(std::move(fn_a), std::move(fn_b));
+    }
+
+    auto fn_b = bench::ExtractTimingFunction<std::tuple<double>, GenResult>(
+        absl::GetFlag(FLAGS_lib_b), absl::GetFlag(FLAGS_fn_b));
+    auto fn_a = bench::ExtractTimingFunction<std::tuple<double>, GenResult>(
+        absl::GetFlag(FLAGS_lib_a), absl::GetFlag(FLAGS_fn_a));
+    return std::make_pair(std::move(fn_a), std::move(fn_b));
+  }();
+
+  auto fn_a = std::move(fns.first.first);
+  auto fn_b = std::move(fns.second.first);
+
+  // Iterations take anywhere from microseconds to seconds, depending
+  // on the instance, so effect sizes and the outlier limit are
+  // relative to A's median cycle count.
+  double median_cycles;
+  {
+    std::vector<uint64_t> cycles;
+    for (size_t i = 0; i < 16; ++i) {
+      const GenResult work_unit(generator());
+      const auto timed = fn_a(&work_unit);
+      cycles.push_back(timed.end - timed.begin);
+    }
+
+    std::nth_element(cycles.begin(), cycles.begin() + cycles.size() / 2,
+                     cycles.end());
+    median_cycles = cycles[cycles.size() / 2];
+  }
+
+  const double min_effect =
+      absl::GetFlag(FLAGS_min_relative_effect) * median_cycles;
+  std::clog << "Median for A: " << median_cycles
+            << " cycles; min effect: " << min_effect << " cycles.\n";
+
+  auto params = TestParams()
+                    .SetMaxComparisons(1000 * 1000ULL)
+                    .SetTimeout(absl::GetFlag(FLAGS_timeout))
+                    .SetOutlierLimit(10 * median_cycles, 5e-4)
+                    .SetMinDfEffect(2.5e-3);
+
+  if (absl::GetFlag(FLAGS_num_threads) > 1) {
+    params.SetNumThreads(absl::GetFlag(FLAGS_num_threads));
+  }
+
+  params.SetPinThreads(absl::GetFlag(FLAGS_pin_threads),
+                       absl::GetFlag(FLAGS_cpuset))
+      .SetCacheState(*cache_state)
+      .SetBandwidthPressure(absl::GetFlag(FLAGS_bandwidth_pressure));
+
+  if (absl::GetFlag(FLAGS_fn_a_lte)) {
+    std::clog << "Testing if A <= B.\n";
+    params.SetStopOnFirst(ComparisonResult::kAHigher);
+  } else {
+    std::clog << "Testing if A ~= B.\n";
+  }
+
+  // Same sequence of tests as find-min-value.cc: mean and KS to
+  // decide, and quantiles only to explain a difference.
+  const auto mean_result = CompareFunctions<BoundedMeanTest>(
+      params.SetMinEffect(min_effect), generator, fn_a, fn_b);
+
+  const auto ks_result = CompareFunctions<KolmogorovSmirnovTest>(
+      params.SetMinEffect(min_effect), generator, fn_a, fn_b);
+
+  if (mean_result.mean_result == ComparisonResult::kTie &&
+      ks_result.result == ComparisonResult::kTie) {
+    return 0;
+  }
+
+  QuantileTest quantile({0.01, 0.5, 0.9, 0.99},
+                        params.SetMinEffect(min_effect));
+  auto results = CompareFunctions(generator, fn_a, fn_b, &quantile);
+  for (const auto& result : results) {
+    if (absl::GetFlag(FLAGS_fn_a_lte)) {
+      if (result.result != ComparisonResult::kALower &&
+          result.result != ComparisonResult::kTie) {
+        return 1;
+      }
+    } else {
+      if (result.result != ComparisonResult::kTie) {
+        return 1;
+      }
+    }
+  }
+
+  return 0;
+}
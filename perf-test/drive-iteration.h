@@ -0,0 +1,73 @@
+#ifndef REGRESSION_DRIVE_ITERATION_H
+#define REGRESSION_DRIVE_ITERATION_H
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "bench/stable-unique-ptr.h"
+
+// A mid-solve snapshot of the driver, for A/B comparisons of
+// `DriveOneIteration` (or of one of its phases) built from different
+// commits.  Everything is in plain arrays, and the driver state and
+// losses are a serialised checkpoint (see checkpoint.h), so each
+// version of the driver can rebuild its own `DriverState` and
+// `CoverConstraint`s from the same data.
+struct DriveIterationSnapshot {
+  const double* obj_values;
+  size_t num_sets;
+
+  // The sets that cover value `i` are
+  // `tours[tour_offsets[i], tour_offsets[i + 1])`, sorted.
+  const size_t* tour_offsets;
+  const uint32_t* tours;
+  size_t num_constraints;
+
+  const char* checkpoint;
+  size_t checkpoint_size;
+
+  // Untimed iterations to run after restoring the checkpoint, and
+  // before the timed work: restored constraints compute weights for
+  // all their tours until the first iteration rebuilds their active
+  // sets.
+  size_t num_warmup_iterations;
+
+  // For `MakeSolveToEps`: solve until the average solution violates
+  // no constraint by `eps` or more, for at most `max_iterations`.
+  // Appended last, so that libraries built from older commits still
+  // read the fields above.
+  double eps;
+  size_t max_iterations;
+
+  // If non-zero, the driver draws the knapsack's pivots from a stream
+  // seeded with this value (see `DriverState::knapsack_prng`), so
+  // that A and B do the same partitioning work for the same snapshot.
+  uint64_t knapsack_seed;
+};
+
+// Generates a random instance from `seed` (see
+// random-set-cover-instance.h), and snapshots the driver after
+// `num_iterations` AdaHedge iterations.
+bench::StableUniquePtr<const DriveIterationSnapshot> MakeDriveIterationSnapshot(
+    size_t num_sets, size_t num_values, size_t min_set_per_value,
+    size_t max_set_per_value, uint64_t seed, size_t num_iterations,
+    size_t num_warmup_iterations);
+
+// Generates a random instance like `MakeDriveIterationSnapshot`, and
+// snapshots the initial driver state, to time (and count the
+// iterations of) whole solves to `eps`.
+bench::StableUniquePtr<const DriveIterationSnapshot> MakeSolveToEpsSnapshot(
+    size_t num_sets, size_t num_values, size_t min_set_per_value,
+    size_t max_set_per_value, uint64_t seed, double eps,
+    size_t max_iterations);
+
+// Returns a view of `*snapshot` with its `knapsack_seed` replaced,
+// that shares ownership of `snapshot`.  Generators give each pair of
+// calls to A and B the same fresh seed: each pair then consumes the
+// same pivot stream, so that pivot luck cancels out of the
+// comparisons, while different pairs still sample different streams.
+bench::StableUniquePtr<const DriveIterationSnapshot>
+ShareDriveIterationSnapshot(
+    const std::shared_ptr<
+        const bench::StableUniquePtr<const DriveIterationSnapshot>>& snapshot,
+    uint64_t knapsack_seed);
+#endif /* !REGRESSION_DRIVE_ITERATION_H */
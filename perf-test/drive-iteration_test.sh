@@ -0,0 +1,66 @@
+#!/bin/bash
+
+set -e
+
+# Compares whole iterations by default; set FN to MakePrepareWeights,
+# MakeSolveKnapsack, MakeObserveLosses or MakeUpdateWeights to compare
+# a single phase.
+FN="${FN:-MakeDriveIteration}"
+
+CHECKOUT_A="$1"
+CHECKOUT_B="${2:-$(git rev-parse HEAD)}"
+
+if [ $# -ge 1 ];
+then
+    shift;
+fi
+if [ $# -ge 1 ];
+then
+    shift;
+fi
+
+bazel build -c opt "$@" perf-test:drive-iteration_test
+
+rm -r perf-test-worktrees/drive-iteration-a || true;
+mkdir -p perf-test-worktrees/drive-iteration-a;
+
+if [ -z "$CHECKOUT_A" -o "z$CHECKOUT_A" = 'z-' ];
+then
+    CHECKOUT_A="current"
+    bazel build -c opt "$@" perf-test:libbase-drive-iteration.so
+    LIB_A=$(readlink -f bazel-bin/perf-test/libbase-drive-iteration.so)
+else
+    git clone --shared . perf-test-worktrees/drive-iteration-a;
+
+    pushd perf-test-worktrees/drive-iteration-a
+    git reset --hard "$CHECKOUT_A"
+    bazel --batch build -c opt "$@" perf-test:libbase-drive-iteration.so
+    LIB_A=$(readlink -f bazel-bin/perf-test/libbase-drive-iteration.so)
+    popd
+fi
+
+rm -r perf-test-worktrees/drive-iteration-b || true;
+mkdir -p perf-test-worktrees/drive-iteration-b;
+git clone --shared . perf-test-worktrees/drive-iteration-b
+
+pushd perf-test-worktrees/drive-iteration-b
+git reset --hard "$CHECKOUT_B"
+bazel --batch build -c opt "$@" perf-test:libbase-drive-iteration.so
+LIB_B=$(readlink -f bazel-bin/perf-test/libbase-drive-iteration.so)
+popd
+
+bazel shutdown;
+
+echo "A: ${CHECKOUT_A} B: ${CHECKOUT_B}"
+
+(set -x; time bazel-bin/perf-test/drive-iteration_test \
+              --lib_a="$LIB_A" \
+              --fn_a=${FN} \
+              --lib_b="$LIB_B" \
+              --fn_b=${FN} \
+              --fn_a_lte=true)
+RET=$?
+
+rm -r perf-test-worktrees/drive-iteration-a perf-test-worktrees/drive-iteration-b;
+
+exit $RET
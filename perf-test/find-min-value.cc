@@ -1,5 +1,6 @@
 #include "perf-test/find-min-value.h"
 
+#include <iostream>
 #include <memory>
 #include <random>
 #include <string>
@@ -10,14 +11,17 @@
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
 #include "absl/memory/memory.h"
+#include "bench/best-arm-test.h"
 #include "bench/bounded-mean-test.h"
 #include "bench/compare-functions.h"
+#include "bench/compare-libraries.h"
 #include "bench/extract-timing-function.h"
 #include "bench/kolmogorov-smirnov-test.h"
 #include "bench/quantile-test.h"
 #include "bench/stable-unique-ptr.h"
 #include "bench/timing-function.h"
 
+using ::bench::BestArmTest;
 using ::bench::BoundedMeanTest;
 using ::bench::CompareFunctions;
 using ::bench::ComparisonResult;
@@ -39,6 +43,10 @@ ABSL_FLAG(
     std::string, fn_b, "MakeBaseFindMinValue",
     "Name of the function to generate the timing function for version B.");
 
+ABSL_FLAG(std::vector<std::string>, arms, {},
+          "Comma-separated list of path:function arms.  If non-empty, "
+          "ignores the A/B flags and looks for the fastest arm instead.");
+
 ABSL_FLAG(size_t, num_values, 10,
           "Number of values in the arguments to FindMinValue");
 
@@ -79,6 +87,32 @@ bench::StableUniquePtr<const FindMinValueInstance> MakeFindMinValueInstance(
   return bench::MakeStableUniquePtr(&ret->first, std::move(ret));
 }
 
+// Finds the fastest of the `path:function` arms in `specs`.  Returns
+// 0 when there's a clear winner or a tie, 1 otherwise.
+template <typename Generator>
+int FindBestArm(TestParams params, Generator generator,
+                const std::vector<std::string>& specs) {
+  std::vector<std::pair<std::string, std::string>> path_funs;
+  for (const std::string& spec : specs) {
+    const size_t colon = spec.rfind(':');
+    if (colon == std::string::npos) {
+      std::cerr << "Arm " << spec << " should be path:function.\n";
+      return 2;
+    }
+
+    path_funs.emplace_back(spec.substr(0, colon), spec.substr(colon + 1));
+  }
+
+  BestArmTest test(path_funs.size(), params.SetMinEffect(2));
+  const auto result = bench::CompareLibraries<std::tuple<size_t>>(
+      std::move(generator), path_funs, &test);
+  for (size_t i = 0; i < specs.size(); ++i) {
+    std::clog << "Arm " << i << ": " << specs[i] << "\n";
+  }
+
+  return result.mean_result == ComparisonResult::kInconclusive ? 1 : 0;
+}
+
 int main(int argc, char** argv) {
   absl::ParseCommandLine(argc, argv);
 
@@ -104,6 +138,11 @@ int main(int argc, char** argv) {
     return MakeFindMinValueInstance(num_values);
   };
 
+  const std::vector<std::string> arms = absl::GetFlag(FLAGS_arms);
+  if (!arms.empty()) {
+    return FindBestArm(params, generator, arms);
+  }
+
   auto fns = [&] {
     if (absl::GetFlag(FLAGS_load_a_first)) {
       auto fn_a =
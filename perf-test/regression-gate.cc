@@ -0,0 +1,358 @@
+// Compares the solver libraries (`libbase-drive-iteration.so`) built
+// from a baseline and a candidate commit on the standard instance
+// matrix from EVAL.md (see scaling-matrix.h), with a bounded-mean
+// sequential test of the time per iteration and of the number of
+// iterations to converge for each instance, and fails when the
+// candidate is definitely slower than the baseline by more than the
+// allowed ratio.  See regression-gate_test.sh to build both libraries.
+#include <algorithm>
+#include <cstddef>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "bench/bounded-mean-test.h"
+#include "bench/compare-libraries.h"
+#include "bench/environment.h"
+#include "bench/extract-timing-function.h"
+#include "bench/stable-unique-ptr.h"
+#include "bench/test-params.h"
+#include "perf-test/drive-iteration.h"
+#include "scaling-matrix.h"
+
+using ::bench::BoundedMeanTest;
+using ::bench::CompareLibraries;
+using ::bench::ComparisonResult;
+using ::bench::TestParams;
+
+ABSL_FLAG(std::string, baseline_lib, "perf-test/libbase-drive-iteration.so",
+          "Path to the shared object built from the baseline commit (A).");
+
+ABSL_FLAG(std::string, candidate_lib, "perf-test/libbase-drive-iteration.so",
+          "Path to the shared object built from the candidate commit (B).");
+
+ABSL_FLAG(size_t, matrix_num_values, 200,
+          "Number of values in each instance of the matrix.");
+
+ABSL_FLAG(uint64_t, matrix_seed, 1,
+          "Seed for the first instance of the matrix.");
+
+ABSL_FLAG(std::vector<std::string>, instances, {},
+          "Only compare on these instances (e.g., dense-1:1,sparse-100:1); "
+          "defaults to the whole matrix.");
+
+ABSL_FLAG(size_t, num_snapshots, 4,
+          "Number of random instances (seeds) per instance family.");
+
+ABSL_FLAG(size_t, num_iterations, 100,
+          "Number of iterations before snapshotting the driver, for the time "
+          "per iteration.");
+
+ABSL_FLAG(double, max_iteration_slowdown, 1.05,
+          "Fail if the candidate's mean time per iteration is definitely more "
+          "than this many times the baseline's.");
+
+ABSL_FLAG(bool, convergence, true,
+          "Whether to also compare the number of iterations to --eps.  The "
+          "baseline must be recent enough to export MakeSolveToEps.");
+
+ABSL_FLAG(double, eps, 0.05,
+          "Solve until the average solution's maximum violation is less than "
+          "this.");
+
+ABSL_FLAG(size_t, max_iterations, 2000,
+          "Stop solves that haven't converged after this many iterations.");
+
+ABSL_FLAG(double, max_convergence_slowdown, 1.1,
+          "Fail if the candidate's mean number of iterations to --eps is "
+          "definitely more than this many times the baseline's.");
+
+ABSL_FLAG(double, min_relative_effect, 0.01,
+          "Minimum effect size, as a fraction of the baseline's median.");
+
+ABSL_FLAG(absl::Duration, timeout, absl::Minutes(2),
+          "Time limit for each statistical test.");
+
+ABSL_FLAG(bool, fail_on_inconclusive, false,
+          "Whether tests that time out without a conclusion fail the gate.");
+
+ABSL_FLAG(std::string, report, "",
+          "Also write the report to this CSV file.");
+
+ABSL_FLAG(bool, paired_pivots, true,
+          "If true, the baseline and the candidate draw the knapsack's pivots "
+          "from the same stream for each comparison; see drive-iteration.cc.");
+
+ABSL_FLAG(size_t, num_threads, 2,
+          "Number of worker threads; see drive-iteration.cc.");
+
+ABSL_FLAG(bool, pin_threads, false,
+          "If true, pin each thread to its own physical core; see "
+          "drive-iteration.cc.");
+
+ABSL_FLAG(std::string, cpuset, "",
+          "With --pin_threads, only pin to CPUs in this list.");
+
+namespace {
+using Snapshot = bench::StableUniquePtr<const DriveIterationSnapshot>;
+using SnapshotPool = std::vector<std::shared_ptr<const Snapshot>>;
+
+enum class Verdict { kPass, kFail, kInconclusive };
+
+const char* VerdictName(Verdict verdict) {
+  switch (verdict) {
+    case Verdict::kPass:
+      return "PASS";
+    case Verdict::kFail:
+      return "FAIL";
+    case Verdict::kInconclusive:
+      return "INCONCLUSIVE";
+  }
+
+  return "unknown";
+}
+
+// One line of the report.
+struct GateRow {
+  std::string instance;
+  std::string metric;
+  double baseline{0};
+  double candidate{0};
+  double max_ratio{0};
+  BoundedMeanTest::Result result;
+  Verdict verdict{Verdict::kInconclusive};
+  // A verdict under an unstable frequency deserves a rerun.
+  bench::EnvironmentReport environment;
+};
+
+// Returns a generator that picks a random snapshot in `pool` for each
+// comparison, and shares ownership with the pool.  With
+// --paired_pivots, each comparison also gets its own knapsack seed.
+auto MakeGenerator(const SnapshotPool* pool) {
+  const bool paired_pivots = absl::GetFlag(FLAGS_paired_pivots);
+  return [pool, paired_pivots] {
+    static thread_local std::unique_ptr<std::mt19937_64> rng;
+    if (rng == nullptr) {
+      std::random_device dev;
+      rng.reset(new std::mt19937_64(dev()));
+    }
+
+    std::uniform_int_distribution<size_t> u(0, pool->size() - 1);
+    const std::shared_ptr<const Snapshot>& snapshot = (*pool)[u(*rng)];
+    // Seeds must be non-zero.
+    return ShareDriveIterationSnapshot(snapshot,
+                                       paired_pivots ? (*rng)() | 1 : 0);
+  };
+}
+
+// Compares the iteration counts returned by `MakeSolveToEps`, rather
+// than cycles, with A scaled like `BoundedMeanTest::Comparator` does.
+class IterationComparator {
+ public:
+  explicit IterationComparator(double scale) : scale_(scale) {}
+
+  template <typename... V>
+  std::pair<double, double> operator()(
+      const std::tuple<uint64_t, double>& a,
+      const std::tuple<uint64_t, double>& b, const V&...) const {
+    return {scale_ * std::get<1>(a), std::get<1>(b)};
+  }
+
+ private:
+  double scale_;
+};
+
+// Returns the baseline's median cycle count and result on a few
+// comparisons, to scale the minimum effect and the outlier limit.
+template <typename Generator>
+std::pair<double, double> BaselineMedians(const std::string& function,
+                                          Generator generator) {
+  using GenResult = std::tuple<decltype(generator())>;
+  auto fn = bench::ExtractTimingFunction<std::tuple<double>, GenResult>(
+      absl::GetFlag(FLAGS_baseline_lib), function);
+  std::vector<double> cycles;
+  std::vector<double> results;
+  for (size_t i = 0; i < 16; ++i) {
+    const GenResult work_unit(generator());
+    const auto timed = fn.first(&work_unit);
+    cycles.push_back(timed.end - timed.begin);
+    results.push_back(std::get<0>(timed.result));
+  }
+
+  const auto median = [](std::vector<double>* values) {
+    std::nth_element(values->begin(), values->begin() + values->size() / 2,
+                     values->end());
+    return (*values)[values->size() / 2];
+  };
+
+  return {median(&cycles), median(&results)};
+}
+
+// A = the baseline, with its observations scaled by `max_ratio`, and
+// B = the candidate: the candidate regressed if A is definitely
+// lower, either in mean or in outlier rate.
+// `make_comparator(analysis)` returns the comparator.
+template <typename Generator, typename MakeComparator>
+GateRow Compare(const std::string& instance, const std::string& metric,
+                const std::string& function, Generator generator,
+                double median, double max_ratio,
+                MakeComparator make_comparator) {
+  TestParams params;
+  params.SetMaxComparisons(1000 * 1000ULL)
+      .SetTimeout(absl::GetFlag(FLAGS_timeout))
+      .SetScale(max_ratio)
+      .SetMinEffect(absl::GetFlag(FLAGS_min_relative_effect) * median)
+      .SetOutlierLimit(10 * max_ratio * median, 5e-4)
+      .SetStopOnFirst(ComparisonResult::kALower);
+  if (absl::GetFlag(FLAGS_num_threads) > 1) {
+    params.SetNumThreads(absl::GetFlag(FLAGS_num_threads));
+  }
+
+  GateRow ret;
+  params.SetPinThreads(absl::GetFlag(FLAGS_pin_threads),
+                       absl::GetFlag(FLAGS_cpuset))
+      .SetEnvironmentReport(&ret.environment);
+
+  std::clog << instance << " " << metric << ": ";
+  BoundedMeanTest analysis(params);
+  ret.instance = instance;
+  ret.metric = metric;
+  ret.max_ratio = max_ratio;
+  ret.result = CompareLibraries<std::tuple<double>>(
+      params, generator, {absl::GetFlag(FLAGS_baseline_lib), function},
+      {absl::GetFlag(FLAGS_candidate_lib), function},
+      make_comparator(analysis), &analysis);
+  ret.baseline = ret.result.a_mean / max_ratio;
+  ret.candidate = ret.result.b_mean;
+  if (ret.result.mean_result == ComparisonResult::kALower ||
+      ret.result.outlier_result == ComparisonResult::kALower) {
+    ret.verdict = Verdict::kFail;
+  } else if (ret.result.mean_result == ComparisonResult::kInconclusive ||
+             ret.result.outlier_result == ComparisonResult::kInconclusive) {
+    ret.verdict = Verdict::kInconclusive;
+  } else {
+    ret.verdict = Verdict::kPass;
+  }
+
+  return ret;
+}
+
+void WriteReport(const std::vector<GateRow>& rows, std::ostream* out) {
+  *out << "instance,metric,baseline,candidate,ratio,max_ratio,mean_result,"
+          "outlier_result,stable_frequency,verdict\n";
+  for (const GateRow& row : rows) {
+    *out << row.instance << "," << row.metric << "," << row.baseline << ","
+         << row.candidate << "," << row.candidate / row.baseline << ","
+         << row.max_ratio << "," << row.result.mean_result << ","
+         << row.result.outlier_result << ","
+         << row.environment.frequency_stable << ","
+         << VerdictName(row.verdict) << "\n";
+  }
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const absl::optional<std::vector<MatrixInstance>> matrix =
+      FilterInstanceMatrix(
+          StandardInstanceMatrix(absl::GetFlag(FLAGS_matrix_num_values),
+                                 absl::GetFlag(FLAGS_matrix_seed)),
+          absl::GetFlag(FLAGS_instances));
+  if (!matrix.has_value()) {
+    return 1;
+  }
+
+  const size_t num_snapshots =
+      std::max<size_t>(1, absl::GetFlag(FLAGS_num_snapshots));
+  const double max_iteration_slowdown =
+      absl::GetFlag(FLAGS_max_iteration_slowdown);
+  const double max_convergence_slowdown =
+      absl::GetFlag(FLAGS_max_convergence_slowdown);
+
+  std::vector<GateRow> rows;
+  for (const MatrixInstance& spec : *matrix) {
+    // Snapshots are expensive to generate, so we only make a few per
+    // instance family; see drive-iteration.cc.
+    SnapshotPool iteration_pool;
+    SnapshotPool solve_pool;
+    for (size_t i = 0; i < num_snapshots; ++i) {
+      // The families' seeds are consecutive: offset the others by
+      // multiples of 2^32 to keep them all distinct.
+      const uint64_t seed = spec.seed + i * (uint64_t{1} << 32);
+      iteration_pool.push_back(
+          std::make_shared<const Snapshot>(MakeDriveIterationSnapshot(
+              spec.num_sets, spec.num_values, spec.min_set_per_value,
+              spec.max_set_per_value, seed,
+              absl::GetFlag(FLAGS_num_iterations),
+              /*num_warmup_iterations=*/1)));
+      if (absl::GetFlag(FLAGS_convergence)) {
+        solve_pool.push_back(
+            std::make_shared<const Snapshot>(MakeSolveToEpsSnapshot(
+                spec.num_sets, spec.num_values, spec.min_set_per_value,
+                spec.max_set_per_value, seed, absl::GetFlag(FLAGS_eps),
+                absl::GetFlag(FLAGS_max_iterations))));
+      }
+    }
+
+    {
+      const auto generator = MakeGenerator(&iteration_pool);
+      const double median_cycles =
+          BaselineMedians("MakeDriveIteration", generator).first;
+      rows.push_back(Compare(
+          spec.name, "iteration_cycles", "MakeDriveIteration", generator,
+          median_cycles, max_iteration_slowdown,
+          [](const BoundedMeanTest& analysis) {
+            return analysis.comparator();
+          }));
+    }
+
+    if (absl::GetFlag(FLAGS_convergence)) {
+      const auto generator = MakeGenerator(&solve_pool);
+      const double median_iterations =
+          BaselineMedians("MakeSolveToEps", generator).second;
+      rows.push_back(Compare(
+          spec.name, "iterations_to_eps", "MakeSolveToEps", generator,
+          std::max(1.0, median_iterations), max_convergence_slowdown,
+          [max_convergence_slowdown](const BoundedMeanTest&) {
+            return IterationComparator(max_convergence_slowdown);
+          }));
+    }
+  }
+
+  bool fail = false;
+  std::cout << "\nRegression gate: baseline "
+            << absl::GetFlag(FLAGS_baseline_lib) << ", candidate "
+            << absl::GetFlag(FLAGS_candidate_lib) << ".\n";
+  for (const GateRow& row : rows) {
+    fail = fail || row.verdict == Verdict::kFail ||
+           (row.verdict == Verdict::kInconclusive &&
+            absl::GetFlag(FLAGS_fail_on_inconclusive));
+    std::cout << VerdictName(row.verdict) << " " << row.instance << " "
+              << row.metric << ": " << row.baseline << " -> " << row.candidate
+              << " (" << row.candidate / row.baseline << "x, max "
+              << row.max_ratio << "x) " << row.result << ".\n";
+  }
+
+  std::cout << (fail ? "FAIL" : "PASS") << "\n";
+  if (!absl::GetFlag(FLAGS_report).empty()) {
+    std::ofstream out(absl::GetFlag(FLAGS_report));
+    WriteReport(rows, &out);
+    out.close();
+    if (!out) {
+      std::cerr << absl::GetFlag(FLAGS_report) << ": failed to write.\n";
+      return 1;
+    }
+  }
+
+  return fail ? 1 : 0;
+}
@@ -0,0 +1,53 @@
+#!/bin/bash
+
+set -e
+
+# Compares the solver libraries built from a baseline commit (A,
+# defaults to HEAD~) and a candidate commit (B, defaults to HEAD) on
+# the standard instance matrix, and fails on regressions.  Set
+# GATE_FLAGS to pass flags to the gate, e.g.,
+# GATE_FLAGS="--max_iteration_slowdown=1.1 --report=gate.csv".
+
+CHECKOUT_A="${1:-$(git rev-parse HEAD~)}"
+CHECKOUT_B="${2:-$(git rev-parse HEAD)}"
+
+if [ $# -ge 1 ];
+then
+    shift;
+fi
+if [ $# -ge 1 ];
+then
+    shift;
+fi
+
+bazel build -c opt "$@" perf-test:regression-gate_test
+
+build_lib() {
+    rm -r "perf-test-worktrees/regression-gate-$1" || true;
+    mkdir -p perf-test-worktrees;
+    git clone --shared . "perf-test-worktrees/regression-gate-$1";
+
+    pushd "perf-test-worktrees/regression-gate-$1" > /dev/null
+    git reset --hard "$2"
+    bazel --batch build -c opt "${@:3}" perf-test:libbase-drive-iteration.so
+    popd > /dev/null
+}
+
+build_lib a "$CHECKOUT_A" "$@"
+LIB_A=$(readlink -f perf-test-worktrees/regression-gate-a/bazel-bin/perf-test/libbase-drive-iteration.so)
+build_lib b "$CHECKOUT_B" "$@"
+LIB_B=$(readlink -f perf-test-worktrees/regression-gate-b/bazel-bin/perf-test/libbase-drive-iteration.so)
+
+bazel shutdown;
+
+echo "Baseline: ${CHECKOUT_A} Candidate: ${CHECKOUT_B}"
+
+RET=0
+(set -x; time bazel-bin/perf-test/regression-gate_test \
+              --baseline_lib="$LIB_A" \
+              --candidate_lib="$LIB_B" \
+              $GATE_FLAGS) || RET=$?
+
+rm -r perf-test-worktrees/regression-gate-a perf-test-worktrees/regression-gate-b;
+
+exit $RET
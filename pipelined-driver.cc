@@ -0,0 +1,240 @@
+#include "pipelined-driver.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+#include "absl/time/clock.h"
+#include "weight-update.h"
+
+namespace {
+// Fuse the observation pass only when the common factor on weights
+// relative to the lower bound on the minimum loss is at least
+// exp(-kMaxFusedExponent).  The vectorised exp flushes to 0 around
+// exp(-87), so this leaves plenty of room for meaningful weights.
+constexpr double kMaxFusedExponent = 32;
+}  // namespace
+
+PipelinedDriver::PipelinedDriver(size_t tours_per_block, bool fuse_observe)
+    : tours_per_block_(std::max<size_t>(1, tours_per_block)),
+      fuse_observe_(fuse_observe) {}
+
+void PipelinedDriver::MaybeUpdateSchedule(
+    absl::Span<const CoverConstraint> constraints, size_t num_sets) {
+  bool up_to_date = num_sets == schedule_num_sets_ &&
+                    constraints.size() == schedule_tours_.size();
+  for (size_t i = 0; up_to_date && i < constraints.size(); ++i) {
+    up_to_date = constraints[i].potential_tours().data() == schedule_tours_[i];
+  }
+
+  if (up_to_date) {
+    return;
+  }
+
+  schedule_num_sets_ = num_sets;
+  schedule_tours_.clear();
+  block_ends_.clear();
+  size_t num_tours = 0;
+  for (size_t i = 0, n = constraints.size(); i < n; ++i) {
+    schedule_tours_.push_back(constraints[i].potential_tours().data());
+    num_tours += constraints[i].potential_tours().size();
+    if (num_tours >= tours_per_block_ || i + 1 == n) {
+      block_ends_.push_back(i + 1);
+      num_tours = 0;
+    }
+  }
+
+  // completion[j] is 1 + the last block that touches item j, or 0.
+  std::vector<uint32_t> completion(num_sets, 0);
+  size_t begin = 0;
+  for (size_t block = 0; block < block_ends_.size(); ++block) {
+    for (size_t i = begin; i < block_ends_[block]; ++i) {
+      for (const uint32_t tour : constraints[i].potential_tours()) {
+        completion[tour] = block + 1;
+      }
+    }
+
+    begin = block_ends_[block];
+  }
+
+  // Counting sort, so each group of items is sorted.
+  completed_offsets_.assign(block_ends_.size() + 2, 0);
+  for (const uint32_t group : completion) {
+    ++completed_offsets_[group + 1];
+  }
+
+  for (size_t i = 1; i < completed_offsets_.size(); ++i) {
+    completed_offsets_[i] += completed_offsets_[i - 1];
+  }
+
+  completed_items_.resize(num_sets);
+  std::vector<size_t> next(completed_offsets_.begin(),
+                           completed_offsets_.end() - 1);
+  for (size_t j = 0; j < num_sets; ++j) {
+    completed_items_[next[completion[j]]++] = j;
+  }
+}
+
+PipelinedDriver::Prepared PipelinedDriver::PrepareNextIteration(
+    absl::Span<CoverConstraint> constraints, double min_loss, double eta,
+    UpdateMixLossState* update, ObserveLossState* observe,
+    DriverState* state) {
+  MaybeUpdateSchedule(constraints, state->obj_values.size());
+
+  PrepareWeightsState weights(
+      state->arena.CreateUninit<double>(state->obj_values.size(),
+                                        /*zero_fill=*/true),
+      min_loss, eta);
+  KnapsackBuilder knapsack(state->obj_values, weights.knapsack_weights,
+                           &state->arena);
+
+  const auto completed_items = [this](size_t group) {
+    return absl::MakeConstSpan(completed_items_)
+        .subspan(completed_offsets_[group],
+                 completed_offsets_[group + 1] - completed_offsets_[group]);
+  };
+
+  // The mix loss for the current iteration uses the same weights
+  // when the step size doesn't change, e.g., while it's infinite.
+  const bool same_weights = update != nullptr && update->mix_loss.eta == eta;
+  const HedgeWeights prepare_fn{min_loss, eta};
+  const HedgeWeights update_fn{min_loss,
+                               update != nullptr ? update->mix_loss.eta : eta};
+
+  knapsack.AddItems(completed_items(0));
+  size_t begin = 0;
+  for (size_t block = 0; block < block_ends_.size(); ++block) {
+    for (size_t i = begin, end = block_ends_[block]; i < end; ++i) {
+      CoverConstraint& constraint = constraints[i];
+      if (observe != nullptr) {
+        constraint.ObserveLoss(observe);
+      }
+
+      if (update != nullptr && !same_weights) {
+        constraint.UpdateMixLoss(update_fn, update);
+      }
+
+      constraint.PrepareWeights(prepare_fn, &weights);
+    }
+
+    knapsack.AddItems(completed_items(block + 1));
+    begin = block_ends_[block];
+  }
+
+  if (same_weights) {
+    update->mix_loss.Merge(weights.mix_loss);
+  }
+
+  Prepared ret(std::move(weights), std::move(knapsack));
+  ret.num_iterations = state->num_iterations;
+  ret.obj_values = state->obj_values.data();
+  ret.num_sets = state->obj_values.size();
+  return ret;
+}
+
+void PipelinedDriver::DriveOneIteration(absl::Span<CoverConstraint> constraints,
+                                        DriverState* state) {
+  PhaseTracker tracker(state);
+
+  if (!prepared_.has_value() ||
+      prepared_->num_iterations != state->num_iterations ||
+      prepared_->obj_values != state->obj_values.data() ||
+      prepared_->num_sets != state->obj_values.size()) {
+    prepared_.reset();
+    double eta = AdaHedgeStepSize(*state);
+    double min_loss = state->prev_min_loss;
+    const absl::optional<PipelinedStep>& step = state->pipelined_step;
+    if (step.has_value() && step->iteration == state->num_iterations) {
+      // Follow the schedule of the driver that left off here, e.g.,
+      // before a checkpoint.
+      eta = step->eta;
+      if (step->min_loss != min_loss && std::isfinite(eta) &&
+          eta * (min_loss - step->min_loss) <= kMaxFusedExponent) {
+        min_loss = step->min_loss;
+      }
+    }
+
+    prepared_.emplace(PrepareNextIteration(constraints, min_loss, eta,
+                                           /*update=*/nullptr,
+                                           /*observe=*/nullptr, state));
+    if (min_loss != state->prev_min_loss) {
+      prepared_->weight_scale =
+          std::exp(eta * (state->prev_min_loss - min_loss));
+    }
+  }
+  tracker.Prepare();
+
+  Prepared prepared = std::move(*prepared_);
+  prepared_.reset();
+  const double eta = prepared.weights.mix_loss.eta;
+  const double prev_mix_loss = ComputeMixLoss(prepared.weights.mix_loss);
+  const double observed_loss = SolveRelaxedKnapsack(
+      std::move(prepared.knapsack), prepared.weights.knapsack_rhs,
+      prepared.weights.mix_loss.sum_weights, prepared.weight_scale, state);
+  tracker.Knapsack();
+
+  if (!state->feasible) {
+    tracker.Finish();
+    return;
+  }
+
+  // The next step size only depends on the mix gaps so far, and
+  // this iteration's mix gap is only known after the fused pass.
+  const double next_eta = AdaHedgeStepSize(*state);
+  // Losses decrease by at most 1 per iteration (for the subproblem's
+  // solution), so this is a lower bound on the new minimum loss.
+  const double min_loss_lb = state->prev_min_loss - 1;
+  const bool fuse =
+      fuse_observe_ && std::isfinite(eta) && std::isfinite(next_eta);
+  absl::optional<UpdateMixLossState> update_state;
+  if (fuse) {
+    ObserveLossState observe_state(state->last_solution);
+    update_state.emplace(min_loss_lb, eta);
+    prepared_.emplace(PrepareNextIteration(constraints, min_loss_lb, next_eta,
+                                           &*update_state, &observe_state,
+                                           state));
+    RecordObservedLosses(observe_state, state);
+
+    const double exponent =
+        std::max(eta, next_eta) * (state->prev_min_loss - min_loss_lb);
+    if (exponent <= kMaxFusedExponent) {
+      // The weights relative to the actual minimum loss are this
+      // factor times those relative to `min_loss_lb`.
+      prepared_->weight_scale =
+          std::exp(next_eta * (state->prev_min_loss - min_loss_lb));
+    } else {
+      // Weights could have underflowed: recompute them relative to
+      // the actual minimum loss.
+      prepared_.reset();
+      update_state.reset();
+    }
+  }
+
+  if (!update_state.has_value()) {
+    if (!fuse) {
+      ObserveAllLosses(constraints, state);
+    }
+
+    ++num_unfused_iterations_;
+    tracker.Observe();
+    update_state.emplace(state->prev_min_loss, eta);
+    prepared_.emplace(PrepareNextIteration(constraints, state->prev_min_loss,
+                                           next_eta, &*update_state,
+                                           /*observe=*/nullptr, state));
+  } else {
+    // The fused pass counts as an update.
+    state->last_observe_time = absl::ZeroDuration();
+  }
+
+  state->prev_num_non_zero = update_state->mix_loss.num_weights;
+  const double mix_loss = ComputeMixLoss(update_state->mix_loss);
+  state->sum_mix_gap +=
+      std::max(0.0, observed_loss - (mix_loss - prev_mix_loss));
+  state->pipelined_step = PipelinedStep{
+      state->num_iterations, prepared_->weights.mix_loss.eta,
+      prepared_->weights.mix_loss.min_loss};
+  tracker.Update();
+  tracker.Finish();
+}
@@ -0,0 +1,118 @@
+#ifndef PIPELINED_DRIVER_H
+#define PIPELINED_DRIVER_H
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "driver.h"
+#include "knapsack.h"
+
+// Drives AdaHedge iterations with the schedule from STRUCTURE.md:
+// instead of separate passes to update the mix loss at the end of
+// iteration k and to prepare the weights for iteration k + 1, a
+// single pass over the constraints does both while each
+// constraint's cumulative losses are in cache.  When both use the
+// same step size, the weights are only computed once.
+//
+// The pass goes over blocks of constraints, and normalizes the
+// knapsack items for iteration k + 1 as soon as the last block that
+// touches them is done, so the knapsack's linear pass is spread over
+// the weight computation rather than waiting for the last block.
+//
+// Fusing the passes means iteration k + 1's step size must be known
+// before iteration k's mix gap: the step size lags by one iteration,
+// i.e., eta_{k+1} = log(N) / (sum of mix gaps up to k - 1).  The mix
+// gaps are still computed with the step size that was actually used,
+// so `DriverState` and checkpoints are the same as for `AdaHedge`.
+//
+// With `fuse_observe`, the same pass also observes the iteration's
+// losses, so each constraint's losses are only read once per
+// iteration.  The weights are then relative to a lower bound on the
+// new minimum loss (losses decrease by at most 1 per iteration)
+// instead of the minimum itself.  That's only a common factor on all
+// weights, which cancels out in the mix loss and the knapsack, and
+// is applied to the knapsack's tolerance and feasibility.  When the
+// factor is so small that weights could underflow (e.g., while the
+// step size is infinite), the iteration falls back to a separate
+// observation pass.
+//
+// This class is thread-compatible.
+class PipelinedDriver {
+ public:
+  static constexpr size_t kDefaultToursPerBlock = 1 << 14;
+
+  // Blocks hold about `tours_per_block` potential tours.
+  explicit PipelinedDriver(size_t tours_per_block = kDefaultToursPerBlock,
+                           bool fuse_observe = false);
+
+  PipelinedDriver(const PipelinedDriver&) = delete;
+  PipelinedDriver& operator=(const PipelinedDriver&) = delete;
+
+  // Runs one iteration.  The weights for the next iteration are kept
+  // in this instance, and recomputed if the instance changes (e.g.,
+  // after `AddSets`) or `state` isn't the one from the last call.
+  void DriveOneIteration(absl::Span<CoverConstraint> constraints,
+                         DriverState* state);
+
+  // The number of constraint blocks in the current schedule.
+  size_t num_blocks() const { return block_ends_.size(); }
+  // The number of iterations that observed their losses in a
+  // separate pass, despite `fuse_observe`.
+  size_t num_unfused_iterations() const { return num_unfused_iterations_; }
+
+ private:
+
+  // The next iteration's weights, and its knapsack, complete with
+  // normalized items.
+  struct Prepared {
+    Prepared(PrepareWeightsState weights_in, KnapsackBuilder knapsack_in)
+        : weights(std::move(weights_in)), knapsack(std::move(knapsack_in)) {}
+
+    PrepareWeightsState weights;
+    KnapsackBuilder knapsack;
+    // The actual weights are `weight_scale` times `weights`.
+    double weight_scale{1};
+    // Identifies the `DriverState` and instance these are for.
+    size_t num_iterations;
+    const double* obj_values;
+    size_t num_sets;
+  };
+
+  // Recomputes the blocks, and the items that are complete after
+  // each block, if the instance changed.
+  void MaybeUpdateSchedule(absl::Span<const CoverConstraint> constraints,
+                           size_t num_sets);
+
+  // Computes the weights for the next iteration with step size `eta`,
+  // relative to `min_loss`, and streams them into a new knapsack.  If
+  // `update` is non-null, also recomputes the mix loss for the
+  // current iteration's step size `update->mix_loss.eta`.  If
+  // `observe` is non-null, first observes each constraint's losses
+  // for `observe->knapsack_solution`.
+  Prepared PrepareNextIteration(absl::Span<CoverConstraint> constraints,
+                                double min_loss, double eta,
+                                UpdateMixLossState* update,
+                                ObserveLossState* observe, DriverState* state);
+
+  size_t tours_per_block_;
+  bool fuse_observe_;
+  size_t num_unfused_iterations_{0};
+
+  // The schedule is for constraints with these potential tours (any
+  // change allocates fresh storage), and `schedule_num_sets_` sets.
+  size_t schedule_num_sets_{0};
+  std::vector<const uint32_t*> schedule_tours_;
+  // Block `b` ends before constraint `block_ends_[b]`.
+  std::vector<size_t> block_ends_;
+  // The items that are complete after block `b - 1` (or that no
+  // constraint touches, for `b = 0`) are
+  // `completed_items_[completed_offsets_[b], completed_offsets_[b + 1])`.
+  std::vector<uint32_t> completed_items_;
+  std::vector<size_t> completed_offsets_;
+
+  absl::optional<Prepared> prepared_;
+};
+#endif /* !PIPELINED_DRIVER_H */
@@ -0,0 +1,163 @@
+#include "pipelined-driver.h"
+
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+#include "weight-update.h"
+
+using ::testing::DoubleEq;
+using ::testing::ElementsAre;
+
+namespace {
+// Two constraints; see driver_test.
+//
+//   min x0 + x1 + x2
+// s.t.
+//   x0    + x2 >= 1
+//      x1 + x2 >= 1
+TEST(PipelinedDriver, FirstIterationMatchesAdaHedge) {
+  CoverConstraint constraints[] = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+  std::vector<CoverConstraint> copy(std::begin(constraints),
+                                    std::end(constraints));
+
+  const double costs[] = {1.0, 1.0, 1.0};
+  DriverState state(costs);
+  DriverState expected(costs);
+  PipelinedDriver driver;
+  AdaHedge ada_hedge;
+
+  driver.DriveOneIteration(absl::MakeSpan(constraints), &state);
+  DriveOneIteration(absl::MakeSpan(copy), &ada_hedge, &expected);
+
+  EXPECT_EQ(state.num_iterations, 1);
+  EXPECT_THAT(state.sum_solutions, ElementsAre(0.0, 0.0, DoubleEq(1.0)));
+  EXPECT_EQ(state.sum_mix_gap, expected.sum_mix_gap);
+  EXPECT_EQ(state.prev_num_non_zero, expected.prev_num_non_zero);
+  EXPECT_EQ(state.prev_min_loss, expected.prev_min_loss);
+  EXPECT_THAT(constraints[0].loss(), ElementsAre(-1.0, 1.0));
+}
+
+TEST(PipelinedDriver, Converges) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/2000, /*num_values=*/200,
+                             /*min_set_per_value=*/5,
+                             /*max_set_per_value=*/50, /*seed=*/11);
+  std::vector<CoverConstraint> copy(instance.constraints);
+  DriverState state(instance.obj_values);
+  DriverState expected(instance.obj_values);
+
+  // Small blocks, to exercise the streaming.
+  PipelinedDriver driver(/*tours_per_block=*/100);
+  AdaHedge ada_hedge;
+  for (size_t i = 0; i < 200; ++i) {
+    driver.DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+    DriveOneIteration(absl::MakeSpan(copy), &ada_hedge, &expected);
+  }
+
+  EXPECT_GT(driver.num_blocks(), 10);
+  ASSERT_TRUE(state.feasible);
+  // The lagged step size barely affects convergence.
+  const double violation = -state.prev_min_loss / state.num_iterations;
+  const double expected_violation =
+      -expected.prev_min_loss / expected.num_iterations;
+  EXPECT_LT(violation, 0.2);
+  EXPECT_LT(violation, 1.5 * expected_violation);
+}
+
+// Fusing the observation pass only changes the weights by a common
+// factor, so the iterates match up to rounding.
+TEST(PipelinedDriver, FusedObserveMatchesSeparatePasses) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/2000, /*num_values=*/200,
+                             /*min_set_per_value=*/5,
+                             /*max_set_per_value=*/50, /*seed=*/11);
+  std::vector<CoverConstraint> copy(instance.constraints);
+  DriverState state(instance.obj_values);
+  DriverState expected(instance.obj_values);
+
+  PipelinedDriver fused(/*tours_per_block=*/100, /*fuse_observe=*/true);
+  PipelinedDriver pipelined(/*tours_per_block=*/100);
+  constexpr size_t kNumIterations = 50;
+  for (size_t i = 0; i < kNumIterations; ++i) {
+    fused.DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+    pipelined.DriveOneIteration(absl::MakeSpan(copy), &expected);
+  }
+
+  // The step size is infinite until the first mix gap.
+  EXPECT_GE(fused.num_unfused_iterations(), 1);
+  EXPECT_LT(fused.num_unfused_iterations(), kNumIterations / 2);
+  EXPECT_EQ(pipelined.num_unfused_iterations(), kNumIterations);
+
+  ASSERT_TRUE(state.feasible);
+  EXPECT_NEAR(state.sum_mix_gap, expected.sum_mix_gap,
+              1e-6 * expected.sum_mix_gap);
+  EXPECT_EQ(state.prev_num_non_zero, expected.prev_num_non_zero);
+  EXPECT_NEAR(state.sum_solution_value, expected.sum_solution_value,
+              1e-6 * std::abs(expected.sum_solution_value));
+  EXPECT_NEAR(state.prev_min_loss, expected.prev_min_loss, 1e-6);
+}
+
+// The fused pass's weights are relative to a lower bound on the
+// minimum loss; once rescaled, the knapsack's weights, feasibility and
+// bound must match those of separate passes, up to rounding.  The
+// feasibility is a difference of weights, so it's only accurate
+// relative to their sum.
+TEST(PipelinedDriver, FusedObserveScalesWeights) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/2000, /*num_values=*/200,
+                             /*min_set_per_value=*/5,
+                             /*max_set_per_value=*/50, /*seed=*/11);
+  std::vector<CoverConstraint> copy(instance.constraints);
+  DriverState state(instance.obj_values);
+  DriverState expected(instance.obj_values);
+
+  PipelinedDriver fused(/*tours_per_block=*/100, /*fuse_observe=*/true);
+  PipelinedDriver pipelined(/*tours_per_block=*/100);
+  for (size_t i = 0; i < 50; ++i) {
+    fused.DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+    pipelined.DriveOneIteration(absl::MakeSpan(copy), &expected);
+
+    ASSERT_TRUE(state.feasible);
+    EXPECT_NEAR(state.last_sum_weights, expected.last_sum_weights,
+                1e-6 * expected.last_sum_weights)
+        << i;
+    EXPECT_NEAR(state.last_solution_feasibility,
+                expected.last_solution_feasibility,
+                1e-6 * expected.last_sum_weights)
+        << i;
+    EXPECT_NEAR(state.best_bound, expected.best_bound,
+                1e-6 * std::abs(expected.best_bound))
+        << i;
+  }
+
+  EXPECT_LT(fused.num_unfused_iterations(), 25);
+}
+
+TEST(PipelinedDriver, AddSets) {
+  CoverConstraint constraints[] = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+
+  const double costs[] = {1.0, 1.0, 3.0, 1.0};
+  DriverState state(absl::MakeConstSpan(costs, 3));
+  PipelinedDriver driver;
+  for (size_t i = 0; i < 2; ++i) {
+    driver.DriveOneIteration(absl::MakeSpan(constraints), &state);
+  }
+
+  // The prepared knapsack is stale, and must be recomputed.
+  const std::vector<uint32_t> values_per_new_set[] = {{0, 1}};
+  AddSets(costs, values_per_new_set, absl::MakeSpan(constraints), &state);
+  for (size_t i = 0; i < 100; ++i) {
+    driver.DriveOneIteration(absl::MakeSpan(constraints), &state);
+  }
+
+  EXPECT_EQ(state.last_solution.size(), 4);
+  EXPECT_GT(state.sum_solutions[3], state.sum_solutions[2]);
+}
+}  // namespace
@@ -0,0 +1,76 @@
+#include "portfolio.h"
+
+#include <atomic>
+#include <limits>
+#include <thread>
+
+#include "absl/memory/memory.h"
+
+Portfolio::Portfolio(absl::Span<const double> obj_values,
+                     absl::Span<const CoverConstraint> constraints,
+                     absl::Span<const Config> configs)
+    : obj_values_(obj_values) {
+  workers_.reserve(configs.size());
+  for (const Config& config : configs) {
+    auto worker = absl::make_unique<Worker>();
+    worker->config = config;
+    worker->constraints.reserve(constraints.size());
+    for (const CoverConstraint& constraint : constraints) {
+      worker->constraints.push_back(constraint);
+    }
+
+    worker->solver = absl::make_unique<SetCoverSolver>(
+        obj_values_, absl::MakeSpan(worker->constraints));
+    worker->solver->ShareBestBound(&shared_bound_);
+    if (!config.name.empty()) {
+      worker->solver->SetLogPrefix("[" + config.name + "] ");
+    }
+
+    workers_.push_back(std::move(worker));
+  }
+}
+
+absl::optional<size_t> Portfolio::Run(size_t max_iter, bool check_feasible) {
+  constexpr size_t kNoWinner = std::numeric_limits<size_t>::max();
+  std::atomic<size_t> winner{kNoWinner};
+
+  const auto run_worker = [&](size_t i) {
+    Worker& worker = *workers_[i];
+    worker.solver->SetWeightUpdate(worker.config.weight_update);
+    worker.solver->Drive(max_iter, worker.config.eps, check_feasible,
+                         /*populate_solution_concurrently=*/false);
+
+    // This thread is the only snapshot reader until `Run` joins it.
+    worker.solver->RefreshSnapshot();
+    const SetCoverSolver::ScalarState& scalar = worker.solver->scalar();
+    if (!scalar.done && !scalar.infeasible && !scalar.relaxation_optimal) {
+      return;
+    }
+
+    size_t expected = kNoWinner;
+    if (!winner.compare_exchange_strong(expected, i)) {
+      return;
+    }
+
+    for (const std::unique_ptr<Worker>& other : workers_) {
+      other->solver->Stop();
+    }
+  };
+
+  std::vector<std::thread> threads;
+  threads.reserve(workers_.size());
+  for (size_t i = 0; i < workers_.size(); ++i) {
+    threads.emplace_back(run_worker, i);
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  const size_t ret = winner.load();
+  if (ret == kNoWinner) {
+    return absl::nullopt;
+  }
+
+  return ret;
+}
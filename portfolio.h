@@ -0,0 +1,83 @@
+#ifndef PORTFOLIO_H
+#define PORTFOLIO_H
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "set-cover-solver.h"
+#include "shared-bound.h"
+#include "weight-update.h"
+
+// Solves one instance with several solver configurations in
+// parallel, one thread each, and stops them all as soon as the first
+// is done.
+//
+// The workers share the instance: the costs, and the sets that cover
+// each value (copies of a `CoverConstraint` share its sets).  Each
+// worker only owns its mutable state: losses, `DriverState`, and
+// whatever its weight update keeps.  Workers also share their best
+// lower bound, so the knapsack targets of every worker benefit from
+// the best bound found by any.
+//
+// This class is thread-compatible.
+class Portfolio {
+ public:
+  struct Config {
+    // Prefixes the worker's progress lines.
+    std::string name;
+    WeightUpdateKind weight_update{WeightUpdateKind::kAdaHedge};
+    // The worker is done once its average solution is `eps`-feasible.
+    double eps{5e-3};
+  };
+
+  // Both spans must outlive this instance, and `constraints` must not
+  // change while it exists.
+  Portfolio(absl::Span<const double> obj_values,
+            absl::Span<const CoverConstraint> constraints,
+            absl::Span<const Config> configs);
+
+  Portfolio(const Portfolio&) = delete;
+  Portfolio& operator=(const Portfolio&) = delete;
+
+  size_t size() const { return workers_.size(); }
+  const Config& config(size_t i) const { return workers_[i]->config; }
+
+  // Worker `i`'s solver, e.g., to enable the primal heuristic before
+  // `Run`, or to read its solution afterwards.  `Run` applies the
+  // configured weight update, and owns the solvers until it returns.
+  SetCoverSolver* solver(size_t i) { return workers_[i]->solver.get(); }
+  // Worker `i`'s copy of the constraints.
+  absl::Span<const CoverConstraint> constraints(size_t i) const {
+    return workers_[i]->constraints;
+  }
+
+  // Drives every solver for at most `max_iter` iterations, in
+  // parallel.  The first worker that finds its average solution
+  // feasible, the relaxation optimal (with `check_feasible`), or the
+  // instance infeasible stops all the others, and wins.  Returns the
+  // index of the winner, or nullopt if all hit `max_iter`.  Stopped
+  // solvers stay stopped, so this may only be called once.
+  absl::optional<size_t> Run(size_t max_iter, bool check_feasible);
+
+  // The best lower bound found by any worker on the original
+  // instance.
+  double best_bound() const { return shared_bound_.Get(); }
+
+ private:
+  struct Worker {
+    Config config;
+    std::vector<CoverConstraint> constraints;
+    std::unique_ptr<SetCoverSolver> solver;
+  };
+
+  absl::Span<const double> obj_values_;
+  // Each solver refers to its worker's `constraints`, so workers
+  // stay put.
+  std::vector<std::unique_ptr<Worker>> workers_;
+  SharedBound shared_bound_;
+};
+#endif /* !PORTFOLIO_H */
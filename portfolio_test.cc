@@ -0,0 +1,74 @@
+#include "portfolio.h"
+
+#include <limits>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+
+using ::testing::Each;
+using ::testing::Eq;
+
+namespace {
+TEST(SharedBound, OnlyRaises) {
+  SharedBound bound;
+  EXPECT_EQ(bound.Get(), -std::numeric_limits<double>::infinity());
+  bound.Raise(2.0);
+  bound.Raise(1.0);
+  EXPECT_EQ(bound.Get(), 2.0);
+  bound.Raise(3.0);
+  EXPECT_EQ(bound.Get(), 3.0);
+}
+
+TEST(Portfolio, FirstDoneStopsOthers) {
+  const RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/2000, /*num_values=*/200,
+                             /*min_set_per_value=*/2,
+                             /*max_set_per_value=*/50, /*seed=*/11);
+
+  Portfolio::Config configs[3];
+  configs[0].name = "adahedge";
+  configs[1].name = "normalhedge";
+  configs[1].weight_update = WeightUpdateKind::kNormalHedge;
+  configs[2].name = "fused";
+  configs[2].weight_update = WeightUpdateKind::kFusedAdaHedge;
+  for (Portfolio::Config& config : configs) {
+    config.eps = 0.05;
+  }
+
+  Portfolio portfolio(instance.obj_values, instance.constraints, configs);
+  ASSERT_EQ(portfolio.size(), 3);
+
+  // The workers share the sets in each constraint.
+  for (size_t i = 0; i < portfolio.size(); ++i) {
+    const absl::Span<const CoverConstraint> constraints =
+        portfolio.constraints(i);
+    ASSERT_EQ(constraints.size(), instance.constraints.size());
+    for (size_t c = 0; c < constraints.size(); ++c) {
+      EXPECT_EQ(constraints[c].potential_tours().data(),
+                instance.constraints[c].potential_tours().data());
+    }
+  }
+
+  const size_t kMaxIter = 100000;
+  const absl::optional<size_t> winner =
+      portfolio.Run(kMaxIter, /*check_feasible=*/false);
+  ASSERT_TRUE(winner.has_value());
+
+  SetCoverSolver* solver = portfolio.solver(*winner);
+  const SetCoverSolver::ScalarState& scalar = solver->scalar();
+  EXPECT_TRUE(scalar.done);
+  EXPECT_GE(portfolio.best_bound(), scalar.best_bound);
+
+  for (size_t i = 0; i < portfolio.size(); ++i) {
+    EXPECT_LT(portfolio.solver(i)->num_iterations(), kMaxIter);
+  }
+
+  // The shared instance is unchanged.
+  for (const CoverConstraint& constraint : instance.constraints) {
+    EXPECT_THAT(constraint.loss(), Each(Eq(0.0)));
+  }
+}
+}  // namespace
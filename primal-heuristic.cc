@@ -0,0 +1,240 @@
+#include "primal-heuristic.h"
+
+#include <assert.h>
+
+#include <algorithm>
+#include <utility>
+
+namespace {
+// Transposes `num_rows` rows of column indices into `offsets` and
+// `indices`, with a counting sort.
+template <typename RowFn>
+void Transpose(size_t num_rows, size_t num_columns, const RowFn& row,
+               std::vector<size_t>* offsets, std::vector<uint32_t>* indices) {
+  offsets->assign(num_columns + 1, 0);
+  for (size_t r = 0; r < num_rows; ++r) {
+    row(r, [&](uint32_t column) { ++(*offsets)[column + 1]; });
+  }
+
+  for (size_t c = 0; c < num_columns; ++c) {
+    (*offsets)[c + 1] += (*offsets)[c];
+  }
+
+  indices->resize(offsets->back());
+  std::vector<size_t> next(offsets->begin(), offsets->end() - 1);
+  for (size_t r = 0; r < num_rows; ++r) {
+    row(r, [&](uint32_t column) { (*indices)[next[column]++] = r; });
+  }
+}
+
+// Returns a uniform double in [0, 1).
+double UniformDouble(xs256* prng) { return ((*prng)() >> 11) * 0x1.0p-53; }
+}  // namespace
+
+CoverRounder::CoverRounder(absl::Span<const double> costs,
+                           absl::Span<const CoverConstraint> constraints,
+                           absl::Span<const uint32_t> original_set)
+    : costs_(costs.begin(), costs.end()) {
+  const auto set_index = [original_set](uint32_t set) {
+    return original_set.empty() ? set : original_set[set];
+  };
+
+  value_offsets_.reserve(constraints.size() + 1);
+  value_offsets_.push_back(0);
+  for (const CoverConstraint& constraint : constraints) {
+    for (const uint32_t set : constraint.potential_tours()) {
+      value_sets_.push_back(set_index(set));
+    }
+
+    value_offsets_.push_back(value_sets_.size());
+  }
+
+  Transpose(
+      constraints.size(), costs_.size(),
+      [this](size_t value, const auto& fn) {
+        for (size_t k = value_offsets_[value]; k < value_offsets_[value + 1];
+             ++k) {
+          fn(value_sets_[k]);
+        }
+      },
+      &set_offsets_, &set_values_);
+
+  cover_count_.resize(constraints.size());
+}
+
+bool CoverRounder::Round(absl::Span<const double> unscaled, double scale,
+                         size_t num_trials, xs256* prng, IntegerCover* best) {
+  assert(unscaled.size() == costs_.size());
+  bool improved = false;
+  for (size_t trial = 0; trial < num_trials; ++trial) {
+    std::fill(cover_count_.begin(), cover_count_.end(), 0);
+    chosen_.clear();
+    // Later trials rely less on the repair.
+    RandomizedRounding(unscaled, scale * (1 + trial), prng);
+    if (!Repair()) {
+      return false;
+    }
+
+    RemoveRedundant();
+    double cost = 0;
+    for (const uint32_t set : chosen_) {
+      cost += costs_[set];
+    }
+
+    if (cost < best->cost) {
+      best->cost = cost;
+      best->sets.assign(chosen_.begin(), chosen_.end());
+      std::sort(best->sets.begin(), best->sets.end());
+      improved = true;
+    }
+  }
+
+  return improved;
+}
+
+bool CoverRounder::IsCover(absl::Span<const uint32_t> sets) const {
+  std::vector<uint8_t> covered(cover_count_.size(), 0);
+  for (const uint32_t set : sets) {
+    for (size_t k = set_offsets_[set]; k < set_offsets_[set + 1]; ++k) {
+      covered[set_values_[k]] = 1;
+    }
+  }
+
+  return std::all_of(covered.begin(), covered.end(),
+                     [](uint8_t x) { return x != 0; });
+}
+
+void CoverRounder::Choose(uint32_t set) {
+  chosen_.push_back(set);
+  for (size_t k = set_offsets_[set]; k < set_offsets_[set + 1]; ++k) {
+    ++cover_count_[set_values_[k]];
+  }
+}
+
+void CoverRounder::RandomizedRounding(absl::Span<const double> unscaled,
+                                      double scale, xs256* prng) {
+  for (size_t j = 0, n = unscaled.size(); j < n; ++j) {
+    const double p = scale * unscaled[j];
+    if (p > 0 && (p >= 1 || UniformDouble(prng) < p)) {
+      Choose(j);
+    }
+  }
+}
+
+bool CoverRounder::Repair() {
+  for (size_t v = 0, n = cover_count_.size(); v < n; ++v) {
+    if (cover_count_[v] > 0) {
+      continue;
+    }
+
+    // The cheapest set per newly covered value; each candidate
+    // covers at least `v`.
+    uint32_t best_set = 0;
+    double best_ratio = std::numeric_limits<double>::infinity();
+    for (size_t k = value_offsets_[v]; k < value_offsets_[v + 1]; ++k) {
+      const uint32_t set = value_sets_[k];
+      size_t num_new = 0;
+      for (size_t l = set_offsets_[set]; l < set_offsets_[set + 1]; ++l) {
+        num_new += cover_count_[set_values_[l]] == 0;
+      }
+
+      const double ratio = costs_[set] / num_new;
+      if (ratio < best_ratio) {
+        best_ratio = ratio;
+        best_set = set;
+      }
+    }
+
+    if (!(best_ratio < std::numeric_limits<double>::infinity())) {
+      return false;
+    }
+
+    Choose(best_set);
+  }
+
+  return true;
+}
+
+void CoverRounder::RemoveRedundant() {
+  std::sort(chosen_.begin(), chosen_.end(), [this](uint32_t x, uint32_t y) {
+    return costs_[x] > costs_[y];
+  });
+
+  size_t num_kept = 0;
+  for (const uint32_t set : chosen_) {
+    bool redundant = costs_[set] >= 0;
+    for (size_t k = set_offsets_[set]; redundant && k < set_offsets_[set + 1];
+         ++k) {
+      redundant = cover_count_[set_values_[k]] > 1;
+    }
+
+    if (!redundant) {
+      chosen_[num_kept++] = set;
+      continue;
+    }
+
+    for (size_t k = set_offsets_[set]; k < set_offsets_[set + 1]; ++k) {
+      --cover_count_[set_values_[k]];
+    }
+  }
+
+  chosen_.resize(num_kept);
+}
+
+PrimalHeuristic::PrimalHeuristic(absl::Span<const double> costs,
+                                 absl::Span<const CoverConstraint> constraints,
+                                 absl::Span<const uint32_t> original_set,
+                                 const Options& options)
+    : options_(options),
+      num_sets_(costs.size()),
+      rounder_(costs, constraints, original_set),
+      worker_([this] { WorkerLoop(); }) {}
+
+PrimalHeuristic::~PrimalHeuristic() {
+  {
+    absl::MutexLock ml(&mu_);
+    shutdown_ = true;
+  }
+
+  worker_.join();
+}
+
+void PrimalHeuristic::WorkerLoop() {
+  xs256 prng;
+  IntegerCover best;
+  for (;;) {
+    {
+      absl::MutexLock ml(&mu_);
+      mu_.AwaitWithTimeout(absl::Condition(&shutdown_), options_.period);
+      if (shutdown_) {
+        return;
+      }
+    }
+
+    if (!input_.Acquire()) {
+      continue;
+    }
+
+    const FractionalSolution& solution = input_.front();
+    const uint64_t begin = TraceRecorder::Now();
+    const bool rounded = rounder_.Round(solution.unscaled, solution.scale,
+                                        options_.num_trials, &prng, &best);
+    if (options_.trace != nullptr) {
+      options_.trace->RecordSpan(TraceSpan::kPrimalRounding,
+                                 solution.num_iterations, begin,
+                                 TraceRecorder::Now());
+    }
+
+    if (!rounded) {
+      continue;
+    }
+
+    best.num_iterations = solution.num_iterations;
+    IntegerCover* out = output_.back();
+    out->num_iterations = best.num_iterations;
+    out->cost = best.cost;
+    out->sets.assign(best.sets.begin(), best.sets.end());
+    output_.Publish();
+    best_cost_.store(best.cost, std::memory_order_relaxed);
+  }
+}
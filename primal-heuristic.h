@@ -0,0 +1,162 @@
+#ifndef PRIMAL_HEURISTIC_H
+#define PRIMAL_HEURISTIC_H
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <thread>
+#include <vector>
+
+#include "absl/base/thread_annotations.h"
+#include "absl/synchronization/mutex.h"
+#include "absl/time/time.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "prng.h"
+#include "trace-recorder.h"
+#include "triple-buffer.h"
+
+// Primal heuristics turn the fractional solutions computed by the
+// driver into integer set covers: randomised rounding, then a greedy
+// repair of uncovered values, then redundancy elimination.
+
+struct IntegerCover {
+  // The iteration of the fractional solution that was rounded.
+  size_t num_iterations{0};
+  double cost{std::numeric_limits<double>::infinity()};
+  // The sets in the cover, in increasing order.
+  std::vector<uint32_t> sets;
+};
+
+// A fractional solution to round, `scale * unscaled`, over the
+// original sets.
+struct FractionalSolution {
+  size_t num_iterations{0};
+  double scale{0.0};
+  std::vector<double> unscaled;
+};
+
+// Rounds fractional solutions with a private copy of the instance,
+// indexed both by value and by set, and scratch space that's reused
+// across calls.
+//
+// This class is thread-compatible.
+class CoverRounder {
+ public:
+  // Copies the instance: `costs` for each set, and the sets that
+  // cover each value in `constraints`.  If `original_set` isn't
+  // empty, the constraints refer to set `i` as `original_set[i]`
+  // (e.g., after column fixing).
+  CoverRounder(absl::Span<const double> costs,
+               absl::Span<const CoverConstraint> constraints,
+               absl::Span<const uint32_t> original_set = {});
+
+  CoverRounder(const CoverRounder&) = delete;
+  CoverRounder& operator=(const CoverRounder&) = delete;
+
+  size_t num_sets() const { return costs_.size(); }
+
+  // Rounds `scale * unscaled` `num_trials` times, with rounding
+  // probabilities scaled up at each trial, and overwrites `best` with
+  // the cheapest cover if it improves on `best->cost`.  Returns
+  // whether it did.  Returns false if some value can't be covered.
+  bool Round(absl::Span<const double> unscaled, double scale,
+             size_t num_trials, xs256* prng, IntegerCover* best);
+
+  // Returns whether `sets` covers every value.
+  bool IsCover(absl::Span<const uint32_t> sets) const;
+
+ private:
+  // Picks each set with probability `scale * unscaled[j]` into
+  // `chosen_`, and updates `cover_count_`.
+  void RandomizedRounding(absl::Span<const double> unscaled, double scale,
+                          xs256* prng);
+  // Adds sets to `chosen_` until every value is covered, greedily by
+  // cost per newly covered value.  Returns false if impossible.
+  bool Repair();
+  // Removes sets in `chosen_` whose values are all covered by other
+  // chosen sets, most expensive first.
+  void RemoveRedundant();
+
+  void Choose(uint32_t set);
+
+  std::vector<double> costs_;
+  // The sets that cover value `v` are
+  // `value_sets_[value_offsets_[v], value_offsets_[v + 1])`.
+  std::vector<size_t> value_offsets_;
+  std::vector<uint32_t> value_sets_;
+  // The values covered by set `j` are
+  // `set_values_[set_offsets_[j], set_offsets_[j + 1])`.
+  std::vector<size_t> set_offsets_;
+  std::vector<uint32_t> set_values_;
+
+  // Scratch space.
+  std::vector<uint32_t> cover_count_;
+  std::vector<uint32_t> chosen_;
+};
+
+// Runs a `CoverRounder` on a background thread.  The solver offers
+// fractional solutions with `Submit`, which never blocks: the worker
+// only ever rounds the latest one, and publishes improved covers.
+//
+// This class is thread-safe, as long as only one thread submits
+// solutions and only one thread reads covers.
+class PrimalHeuristic {
+ public:
+  struct Options {
+    // The worker checks for new solutions this often.
+    absl::Duration period{absl::Milliseconds(100)};
+    // Rounding trials per solution.
+    size_t num_trials{8};
+    // If non-null, the worker records a span for each solution it
+    // rounds.  Not owned.
+    TraceRecorder* trace{nullptr};
+  };
+
+  PrimalHeuristic(absl::Span<const double> costs,
+                  absl::Span<const CoverConstraint> constraints,
+                  absl::Span<const uint32_t> original_set,
+                  const Options& options);
+
+  // Stops the worker, once it's done with any rounding in progress.
+  ~PrimalHeuristic();
+
+  PrimalHeuristic(const PrimalHeuristic&) = delete;
+  PrimalHeuristic& operator=(const PrimalHeuristic&) = delete;
+
+  size_t num_sets() const { return num_sets_; }
+
+  // Submitter-side.  Fill `next_solution()`, then `Submit()` it.
+  // The buffer is recycled, so filling it with `assign` stops
+  // allocating after the first few solutions.
+  FractionalSolution* next_solution() { return input_.back(); }
+  void Submit() { input_.Publish(); }
+
+  // The cost of the best cover so far; infinite until the first.
+  // May be called from any thread.
+  double best_cost() const {
+    return best_cost_.load(std::memory_order_relaxed);
+  }
+
+  // Reader-side, like `TripleBuffer`: switches `best_cover()` to the
+  // latest published cover, and returns whether it changed.
+  bool Acquire() { return output_.Acquire(); }
+  const IntegerCover& best_cover() const { return output_.front(); }
+
+ private:
+  void WorkerLoop();
+
+  const Options options_;
+  const size_t num_sets_;
+  CoverRounder rounder_;
+
+  TripleBuffer<FractionalSolution> input_;
+  TripleBuffer<IntegerCover> output_;
+  std::atomic<double> best_cost_{std::numeric_limits<double>::infinity()};
+
+  absl::Mutex mu_;
+  bool shutdown_ GUARDED_BY(mu_){false};
+
+  std::thread worker_;
+};
+#endif /* !PRIMAL_HEURISTIC_H */
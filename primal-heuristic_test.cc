@@ -0,0 +1,107 @@
+#include "primal-heuristic.h"
+
+#include <vector>
+
+#include "absl/time/clock.h"
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+
+using ::testing::ElementsAre;
+
+namespace {
+// Sets 0 and 1 each cover one value; set 2 covers both, for less.
+TEST(CoverRounder, RepairsAndRemovesRedundantSets) {
+  const CoverConstraint constraints[] = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+  const double costs[] = {1.0, 1.0, 1.5};
+  CoverRounder rounder(costs, constraints);
+  xs256 prng;
+
+  // Rounding set 0 leaves value 1 uncovered; set 1 is the cheapest
+  // repair per newly covered value.
+  IntegerCover best;
+  {
+    const double solution[] = {1.0, 0.0, 0.0};
+    ASSERT_TRUE(rounder.Round(solution, 1.0, 1, &prng, &best));
+    EXPECT_THAT(best.sets, ElementsAre(0, 1));
+    EXPECT_EQ(best.cost, 2.0);
+  }
+
+  // With all sets, the most expensive one is redundant, and removed
+  // first: no improvement.
+  {
+    const double solution[] = {1.0, 1.0, 1.0};
+    EXPECT_FALSE(rounder.Round(solution, 1.0, 1, &prng, &best));
+    EXPECT_THAT(best.sets, ElementsAre(0, 1));
+  }
+
+  {
+    const double solution[] = {0.0, 0.0, 1.0};
+    ASSERT_TRUE(rounder.Round(solution, 1.0, 1, &prng, &best));
+    EXPECT_THAT(best.sets, ElementsAre(2));
+    EXPECT_EQ(best.cost, 1.5);
+  }
+
+  EXPECT_TRUE(rounder.IsCover({2}));
+  EXPECT_FALSE(rounder.IsCover({0}));
+}
+
+TEST(CoverRounder, OriginalSets) {
+  // After fixing set 1 at 0, reduced sets {0, 1} are original {0, 2}.
+  const CoverConstraint constraints[] = {
+      CoverConstraint({0, 1}), CoverConstraint({1}),
+  };
+  const double costs[] = {1.0, 1.0, 1.5};
+  const uint32_t original_set[] = {0, 2};
+  CoverRounder rounder(costs, constraints, original_set);
+  xs256 prng;
+
+  const double solution[] = {0.0, 1.0, 0.0};
+  IntegerCover best;
+  ASSERT_TRUE(rounder.Round(solution, 1.0, 1, &prng, &best));
+  EXPECT_THAT(best.sets, ElementsAre(2));
+}
+
+TEST(CoverRounder, Infeasible) {
+  const CoverConstraint constraints[] = {CoverConstraint({})};
+  const double costs[] = {1.0};
+  CoverRounder rounder(costs, constraints);
+  xs256 prng;
+
+  const double solution[] = {1.0};
+  IntegerCover best;
+  EXPECT_FALSE(rounder.Round(solution, 1.0, 4, &prng, &best));
+}
+
+TEST(PrimalHeuristic, RoundsInBackground) {
+  const RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/500, /*num_values=*/100,
+                             /*min_set_per_value=*/2,
+                             /*max_set_per_value=*/20, /*seed=*/5);
+  PrimalHeuristic::Options options;
+  options.period = absl::Milliseconds(1);
+  PrimalHeuristic heuristic(instance.obj_values, instance.constraints, {},
+                            options);
+
+  FractionalSolution* next = heuristic.next_solution();
+  next->num_iterations = 3;
+  next->scale = 0.5;
+  next->unscaled.assign(instance.obj_values.size(), 0.0);
+  heuristic.Submit();
+
+  const absl::Time deadline = absl::Now() + absl::Seconds(10);
+  while (!heuristic.Acquire() && absl::Now() < deadline) {
+    absl::SleepFor(absl::Milliseconds(1));
+  }
+
+  const IntegerCover& cover = heuristic.best_cover();
+  ASSERT_FALSE(cover.sets.empty());
+  EXPECT_EQ(cover.num_iterations, 3);
+  EXPECT_EQ(cover.cost, heuristic.best_cost());
+
+  CoverRounder rounder(instance.obj_values, instance.constraints);
+  EXPECT_TRUE(rounder.IsCover(cover.sets));
+}
+}  // namespace
@@ -105,3 +105,11 @@ xs256::xs256() {
   state_ = local_state.value();
   AdvanceLocalState(&local_state.value());
 }
+
+xs256::xs256(uint64_t seed) {
+  // Expand the seed with SplitMix64, as recommended by Vigna.
+  for (uint64_t& x : state_) {
+    x = SplitMix(seed);
+    seed += 0x9e3779b97f4a7c15;
+  }
+}
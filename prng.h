@@ -7,10 +7,18 @@
 class xs256 {
  public:
   using result_type = uint64_t;
+  using State = std::array<uint64_t, 4>;
 
   // Constructs an independent stream.
   xs256();
 
+  // Constructs a stream that only depends on `seed`, e.g., to replay
+  // the same random choices in two runs.
+  explicit xs256(uint64_t seed);
+
+  // Resumes the stream at `state()`, e.g., from a checkpoint.
+  explicit xs256(const State& state) : state_(state) {}
+
   // Copyable.
   xs256(const xs256&) = default;
   xs256& operator=(const xs256&) = default;
@@ -31,6 +39,8 @@ class xs256 {
     return result_plus;
   }
 
+  const State& state() const { return state_; }
+
   double entropy() const { return 0.0; }
   static uint64_t min() { return 0; }
   static uint64_t max() { return std::numeric_limits<uint64_t>::max(); }
@@ -49,8 +59,6 @@ class xs256 {
   }
 
  private:
-  using State = std::array<uint64_t, 4>;
-
   static uint64_t rotl(const uint64_t x, int k) {
     return (x << k) | (x >> (64 - k));
   }
@@ -1,6 +1,10 @@
 #include "random-set-cover-flags.h"
 
+#include <iostream>
+
 #include "absl/flags/flag.h"
+#include "absl/time/time.h"
+#include "parse-instance.h"
 
 ABSL_FLAG(double, feas_eps, 5e-3,
           "Allowed error for the clone linking constraints");
@@ -15,9 +19,141 @@ ABSL_FLAG(size_t, max_set_per_value, 2100,
 ABSL_FLAG(size_t, min_set_per_value, 1,
           "Minimum number of set that may cover any value");
 
+ABSL_FLAG(uint64_t, instance_seed, 0,
+          "Seed for the random instance (0 for a random seed)");
+
 ABSL_FLAG(size_t, max_iter, 100000, "Iteration limit");
 
 ABSL_FLAG(bool, check_feasible, false,
           "Whether the solver should look for and return solutions to "
           "relaxations that happen to be feasible and optimal for the "
           "original problem");
+
+ABSL_FLAG(std::string, instance_file, "",
+          "Path to a set covering instance to solve instead of a random "
+          "instance");
+
+ABSL_FLAG(std::string, instance_format, "orlib",
+          "Format of --instance_file: orlib (scp*) or rail");
+
+ABSL_FLAG(size_t, parse_threads, 0,
+          "Number of threads used to parse --instance_file (0 for all "
+          "hardware threads)");
+
+ABSL_FLAG(std::string, weight_update, "adahedge",
+          "Weight update algorithm: adahedge, normalhedge, "
+          "pipelined-adahedge, or fused-adahedge");
+
+ABSL_FLAG(size_t, column_fixing_period, 0,
+          "Fix sets at 0 with reduced costs every this many iterations (0 to "
+          "disable)");
+
+ABSL_FLAG(double, column_fixing_budget, 1e-3,
+          "Max total coverage fixed sets may remove from any value; the "
+          "relaxation's value increases by a factor of at most 1 / (1 - "
+          "budget)");
+
+ABSL_FLAG(size_t, primal_heuristic_period_ms, 0,
+          "Round the fractional solutions to integer covers in the "
+          "background every this many milliseconds (0 to disable)");
+
+ABSL_FLAG(double, initial_feas_eps, 0,
+          "Solve to this coarser --feas_eps first, then tighten it by "
+          "--feas_eps_decay whenever met (0 to disable)");
+
+ABSL_FLAG(double, feas_eps_decay, 2, "Tightening factor for --feas_eps");
+
+ABSL_FLAG(double, max_gap, 0,
+          "Also stop once the relative gap between the best bound and the "
+          "best feasible solution is at most this (0 to disable)");
+
+ABSL_FLAG(size_t, working_set_period, 0,
+          "Restrict the knapsack to a working set of sets, re-priced against "
+          "all sets every this many iterations (0 to disable)");
+
+ABSL_FLAG(size_t, working_set_initial_sets_per_value, 8,
+          "Seed the working set with this many of the cheapest sets for each "
+          "value");
+
+ABSL_FLAG(bool, perf_counters, false,
+          "Count hardware events (cycles, instructions, cache, branch and TLB "
+          "misses) for each phase, if perf events are permitted");
+
+ABSL_FLAG(uint64_t, knapsack_seed, 0,
+          "Seed for the knapsack's pivots, to reproduce the same work "
+          "across runs (0 for a fresh random stream per iteration)");
+
+absl::optional<RandomSetCoverInstance> MakeInstanceFromFlags() {
+  const std::string path = absl::GetFlag(FLAGS_instance_file);
+  if (path.empty()) {
+    return GenerateRandomInstance(absl::GetFlag(FLAGS_num_sets),
+                                  absl::GetFlag(FLAGS_num_values),
+                                  absl::GetFlag(FLAGS_min_set_per_value),
+                                  absl::GetFlag(FLAGS_max_set_per_value),
+                                  absl::GetFlag(FLAGS_instance_seed));
+  }
+
+  InstanceFormat format;
+  if (!ParseInstanceFormat(absl::GetFlag(FLAGS_instance_format), &format)) {
+    std::cerr << "Unknown instance format "
+              << absl::GetFlag(FLAGS_instance_format) << ".\n";
+    return absl::nullopt;
+  }
+
+  return ParseInstanceFile(path, format, absl::GetFlag(FLAGS_parse_threads));
+}
+
+bool ConfigureSolverFromFlags(SetCoverSolver* solver) {
+  WeightUpdateKind kind;
+  if (!ParseWeightUpdateKind(absl::GetFlag(FLAGS_weight_update), &kind)) {
+    std::cerr << "Unknown weight update algorithm "
+              << absl::GetFlag(FLAGS_weight_update) << ".\n";
+    return false;
+  }
+
+  solver->SetWeightUpdate(kind);
+
+  SetCoverSolver::ColumnFixingOptions column_fixing;
+  column_fixing.period = absl::GetFlag(FLAGS_column_fixing_period);
+  column_fixing.budget = absl::GetFlag(FLAGS_column_fixing_budget);
+  if (!(column_fixing.budget >= 0 && column_fixing.budget < 1)) {
+    std::cerr << "--column_fixing_budget must be in [0, 1).\n";
+    return false;
+  }
+
+  solver->SetColumnFixingOptions(column_fixing);
+
+  SetCoverSolver::WorkingSetOptions working_set;
+  working_set.period = absl::GetFlag(FLAGS_working_set_period);
+  working_set.initial_sets_per_value =
+      absl::GetFlag(FLAGS_working_set_initial_sets_per_value);
+  solver->SetWorkingSetOptions(working_set);
+
+  SetCoverSolver::TerminationOptions termination;
+  termination.initial_eps = absl::GetFlag(FLAGS_initial_feas_eps);
+  termination.eps_decay = absl::GetFlag(FLAGS_feas_eps_decay);
+  termination.max_gap = absl::GetFlag(FLAGS_max_gap);
+  if (!(termination.eps_decay > 1)) {
+    std::cerr << "--feas_eps_decay must be greater than 1.\n";
+    return false;
+  }
+
+  solver->SetTerminationOptions(termination);
+
+  const size_t primal_period = absl::GetFlag(FLAGS_primal_heuristic_period_ms);
+  if (primal_period > 0) {
+    PrimalHeuristic::Options primal_heuristic;
+    primal_heuristic.period = absl::Milliseconds(primal_period);
+    solver->EnablePrimalHeuristic(primal_heuristic);
+  }
+
+  if (absl::GetFlag(FLAGS_perf_counters)) {
+    solver->EnablePerfCounters();
+  }
+
+  if (absl::GetFlag(FLAGS_knapsack_seed) != 0) {
+    solver->SetKnapsackSeed(absl::GetFlag(FLAGS_knapsack_seed));
+  }
+
+  return true;
+}
@@ -1,8 +1,13 @@
 #ifndef RANDOM_SET_COVER_FLAGS_H
 #define RANDOM_SET_COVER_FLAGS_H
 #include <cstddef>
+#include <cstdint>
+#include <string>
 
 #include "absl/flags/declare.h"
+#include "absl/types/optional.h"
+#include "random-set-cover-instance.h"
+#include "set-cover-solver.h"
 
 ABSL_DECLARE_FLAG(double, feas_eps);
 
@@ -14,7 +19,45 @@ ABSL_DECLARE_FLAG(size_t, max_set_per_value);
 
 ABSL_DECLARE_FLAG(size_t, min_set_per_value);
 
+ABSL_DECLARE_FLAG(uint64_t, instance_seed);
+
 ABSL_DECLARE_FLAG(size_t, max_iter);
 
 ABSL_DECLARE_FLAG(bool, check_feasible);
+
+ABSL_DECLARE_FLAG(std::string, instance_file);
+
+ABSL_DECLARE_FLAG(std::string, instance_format);
+
+ABSL_DECLARE_FLAG(size_t, parse_threads);
+
+ABSL_DECLARE_FLAG(std::string, weight_update);
+
+ABSL_DECLARE_FLAG(size_t, column_fixing_period);
+
+ABSL_DECLARE_FLAG(double, column_fixing_budget);
+
+ABSL_DECLARE_FLAG(size_t, primal_heuristic_period_ms);
+
+ABSL_DECLARE_FLAG(double, initial_feas_eps);
+
+ABSL_DECLARE_FLAG(double, feas_eps_decay);
+
+ABSL_DECLARE_FLAG(double, max_gap);
+
+ABSL_DECLARE_FLAG(size_t, working_set_period);
+
+ABSL_DECLARE_FLAG(size_t, working_set_initial_sets_per_value);
+
+ABSL_DECLARE_FLAG(bool, perf_counters);
+
+ABSL_DECLARE_FLAG(uint64_t, knapsack_seed);
+
+// Parses the instance in `--instance_file` if set, and otherwise
+// generates a random instance.  Returns nullopt on failure.
+absl::optional<RandomSetCoverInstance> MakeInstanceFromFlags();
+
+// Applies the solver flags (e.g., `--weight_update`) to `solver`.
+// Returns false on invalid flag values.
+bool ConfigureSolverFromFlags(SetCoverSolver* solver);
 #endif /* !RANDOM_SET_COVER_FLAGS_H */
@@ -5,13 +5,18 @@
 RandomSetCoverInstance GenerateRandomInstance(size_t num_sets,
                                               size_t num_values,
                                               size_t min_set_per_value,
-                                              size_t max_set_per_value) {
+                                              size_t max_set_per_value,
+                                              uint64_t seed) {
   std::vector<double> obj_values;
   std::vector<std::vector<uint32_t>> sets_per_value;
 
   {
-    std::random_device dev;
-    std::mt19937 rng(dev());
+    if (seed == 0) {
+      std::random_device dev;
+      seed = dev();
+    }
+
+    std::mt19937 rng(seed);
 
     // First, generate all the sets.
     std::uniform_int_distribution<size_t> num_set_dist(min_set_per_value,
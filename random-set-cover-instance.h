@@ -12,8 +12,11 @@ struct RandomSetCoverInstance {
   std::vector<CoverConstraint> constraints;
 };
 
+// Generates a random instance from `seed`; a seed of 0 draws a fresh
+// seed from `std::random_device`.
 RandomSetCoverInstance GenerateRandomInstance(size_t num_sets,
                                               size_t num_values,
                                               size_t min_set_per_value,
-                                              size_t max_set_per_value);
+                                              size_t max_set_per_value,
+                                              uint64_t seed = 0);
 #endif /* !RANDOM_SET_COVER_INSTANCE_H */
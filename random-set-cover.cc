@@ -1,36 +1,51 @@
 #include "driver.h"
 
+#include <algorithm>
 #include <cstddef>
 #include <iostream>
+#include <string>
 #include <tuple>
+#include <utility>
+#include <vector>
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/strings/str_cat.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "portfolio.h"
 #include "random-set-cover-flags.h"
 #include "random-set-cover-instance.h"
 #include "set-cover-solver.h"
 #include "solution-stats.h"
 
-int main(int argc, char** argv) {
-  absl::ParseCommandLine(argc, argv);
-
-  const double kFeasEps = absl::GetFlag(FLAGS_feas_eps);
-
-  RandomSetCoverInstance instance = GenerateRandomInstance(
-      absl::GetFlag(FLAGS_num_sets), absl::GetFlag(FLAGS_num_values),
-      absl::GetFlag(FLAGS_min_set_per_value),
-      absl::GetFlag(FLAGS_max_set_per_value));
-
-  SetCoverSolver solver(instance.obj_values,
-                        absl::MakeSpan(instance.constraints));
-
-  solver.Drive(absl::GetFlag(FLAGS_max_iter), kFeasEps,
-               absl::GetFlag(FLAGS_check_feasible),
-               /*populate_solution_concurrently=*/false);
+ABSL_FLAG(std::string, checkpoint_file, "",
+          "Periodically write solver checkpoints to this file");
+ABSL_FLAG(size_t, checkpoint_every_iter, 1000,
+          "Checkpoint at least every this many iterations (0 to disable)");
+ABSL_FLAG(double, checkpoint_every_secs, 300,
+          "Checkpoint at least every this many seconds");
+ABSL_FLAG(bool, resume, false,
+          "Resume from --checkpoint_file; the instance must be the same as "
+          "when the checkpoint was written");
+ABSL_FLAG(std::string, trace_file, "",
+          "Record a trace of the solve to this file (with a suffix for each "
+          "--portfolio worker); see convert-trace to view it");
+ABSL_FLAG(size_t, trace_capacity, 1 << 20,
+          "Keep the last this many trace records (72 bytes each)");
+ABSL_FLAG(std::vector<std::string>, portfolio, {},
+          "Solve with these weight update algorithms in parallel, one thread "
+          "each, until the first is done (e.g., adahedge,normalhedge); the "
+          "other solver flags apply to every worker");
 
-  absl::MutexLock ml(&solver.state().mu);
-  absl::Span<const double> solution(solver.state().current_solution);
+namespace {
+// Prints statistics on `solver`'s final solution and integer cover.
+void ReportSolution(const RandomSetCoverInstance& instance,
+                    SetCoverSolver* solver, double feas_eps) {
+  solver->RefreshSnapshot();
+  std::vector<double> solution;
+  solver->solution().CopyTo(&solution);
 
   const double obj_value = ComputeObjectiveValue(solution, instance.obj_values);
 
@@ -40,18 +55,125 @@ int main(int argc, char** argv) {
     std::tie(max_infeas, infeas) =
         ComputeCoverInfeasibility(solution, instance.sets_per_value);
     std::cout << "Violation\n";
-    OutputHistogram(std::cout, BinValues(infeas, 25, kFeasEps),
+    OutputHistogram(std::cout, BinValues(infeas, 25, feas_eps),
                     /*step=*/2.5e-2, /*cumulative=*/true);
     std::cout << "\n";
   }
 
   {
     std::cout << "Solution\n";
-    OutputHistogram(std::cout, BinValues(solution, 25, kFeasEps));
+    OutputHistogram(std::cout, BinValues(solution, 25, feas_eps));
     std::cout << "\n";
   }
 
   std::cout << "Final solution: Z=" << obj_value << " infeas=" << max_infeas
             << "\n";
+
+  const IntegerCover& cover = solver->integer_cover();
+  if (!cover.sets.empty()) {
+    std::cout << "Best integer cover: Z=" << cover.cost
+              << " sets=" << cover.sets.size()
+              << " bound=" << solver->scalar().best_bound
+              << " (from iteration " << cover.num_iterations << ")\n";
+  }
+}
+
+int RunPortfolio(const RandomSetCoverInstance& instance,
+                 const std::vector<std::string>& names, double feas_eps) {
+  std::vector<Portfolio::Config> configs(names.size());
+  for (size_t i = 0; i < names.size(); ++i) {
+    configs[i].name = names[i];
+    configs[i].eps = feas_eps;
+    if (!ParseWeightUpdateKind(names[i], &configs[i].weight_update)) {
+      std::cerr << "Unknown weight update algorithm " << names[i] << ".\n";
+      return 1;
+    }
+  }
+
+  Portfolio portfolio(instance.obj_values, instance.constraints, configs);
+  const std::string trace_file = absl::GetFlag(FLAGS_trace_file);
+  for (size_t i = 0; i < portfolio.size(); ++i) {
+    if (!ConfigureSolverFromFlags(portfolio.solver(i))) {
+      return 1;
+    }
+
+    if (!trace_file.empty()) {
+      portfolio.solver(i)->EnableTracing(
+          absl::StrCat(trace_file, ".", i, ".", names[i]),
+          absl::GetFlag(FLAGS_trace_capacity));
+    }
+  }
+
+  const absl::optional<size_t> winner = portfolio.Run(
+      absl::GetFlag(FLAGS_max_iter), absl::GetFlag(FLAGS_check_feasible));
+  for (size_t i = 0; i < portfolio.size(); ++i) {
+    std::cout << portfolio.config(i).name << ": "
+              << portfolio.solver(i)->num_iterations() << " iterations"
+              << (winner == i ? " (winner)" : "") << "\n";
+  }
+
+  std::cout << "Shared best bound: " << portfolio.best_bound() << "\n";
+  ReportSolution(instance, portfolio.solver(winner.value_or(0)), feas_eps);
+  return 0;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const double kFeasEps = absl::GetFlag(FLAGS_feas_eps);
+
+  absl::optional<RandomSetCoverInstance> maybe_instance =
+      MakeInstanceFromFlags();
+  if (!maybe_instance.has_value()) {
+    return 1;
+  }
+
+  RandomSetCoverInstance& instance = *maybe_instance;
+
+  const std::vector<std::string> portfolio = absl::GetFlag(FLAGS_portfolio);
+  if (!portfolio.empty()) {
+    if (!absl::GetFlag(FLAGS_checkpoint_file).empty()) {
+      std::cerr << "--checkpoint_file is incompatible with --portfolio.\n";
+      return 1;
+    }
+
+    return RunPortfolio(instance, portfolio, kFeasEps);
+  }
+
+  SetCoverSolver solver(instance.obj_values,
+                        absl::MakeSpan(instance.constraints));
+  if (!ConfigureSolverFromFlags(&solver)) {
+    return 1;
+  }
+
+  size_t max_iter = absl::GetFlag(FLAGS_max_iter);
+  const std::string checkpoint_file = absl::GetFlag(FLAGS_checkpoint_file);
+  if (!checkpoint_file.empty()) {
+    if (absl::GetFlag(FLAGS_resume)) {
+      if (!solver.RestoreCheckpoint(checkpoint_file)) {
+        return 1;
+      }
+
+      std::cout << "Resuming after " << solver.num_iterations()
+                << " iterations.\n";
+      max_iter -= std::min(max_iter, solver.num_iterations());
+    }
+
+    CheckpointWriter::Options options;
+    options.every_iterations = absl::GetFlag(FLAGS_checkpoint_every_iter);
+    options.every = absl::Seconds(absl::GetFlag(FLAGS_checkpoint_every_secs));
+    solver.EnableCheckpoints(checkpoint_file, options);
+  }
+
+  if (!absl::GetFlag(FLAGS_trace_file).empty()) {
+    solver.EnableTracing(absl::GetFlag(FLAGS_trace_file),
+                         absl::GetFlag(FLAGS_trace_capacity));
+  }
+
+  solver.Drive(max_iter, kFeasEps, absl::GetFlag(FLAGS_check_feasible),
+               /*populate_solution_concurrently=*/false);
+
+  ReportSolution(instance, &solver, kFeasEps);
   return 0;
 }
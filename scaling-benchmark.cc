@@ -0,0 +1,283 @@
+// Runs the solver on the standard instance matrix from EVAL.md (see
+// scaling-matrix.h) and reports, for each instance and thread count,
+// the time per iteration and per phase over a fixed number of
+// iterations, the number of iterations to --feas_eps, and the peak
+// RSS, as CSV and JSON, e.g.,
+// `--threads=1,4 --csv_output=new.csv --baseline=old.csv`.
+//
+// With more than one thread, each thread solves its own copy of the
+// instance, so the per-iteration times show the effect of sharing
+// caches and memory bandwidth.  The solver flags in
+// random-set-cover-flags.h (e.g., --weight_update) apply to every
+// solve.
+#include <stdio.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/memory/memory.h"
+#include "absl/strings/ascii.h"
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+#include "absl/strings/strip.h"
+#include "absl/time/time.h"
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "random-set-cover-flags.h"
+#include "scaling-matrix.h"
+#include "set-cover-solver.h"
+
+ABSL_FLAG(size_t, matrix_num_values, 1000,
+          "Number of values in each instance of the matrix");
+ABSL_FLAG(uint64_t, matrix_seed, 1, "Seed for the first instance");
+ABSL_FLAG(std::vector<std::string>, instances, {},
+          "Only run these instances (e.g., dense-1:1,sparse-100:1); defaults "
+          "to the whole matrix");
+ABSL_FLAG(std::string, threads, "1",
+          "Comma-separated list of thread counts to benchmark");
+ABSL_FLAG(size_t, num_iterations, 200,
+          "Number of iterations in the fixed-length run that measures the "
+          "time per iteration");
+ABSL_FLAG(bool, iterations_to_eps, true,
+          "Whether to also solve until --feas_eps (or --max_iter)");
+ABSL_FLAG(std::string, csv_output, "",
+          "Write the results to this CSV file (defaults to stdout)");
+ABSL_FLAG(std::string, json_output, "", "Write the results to this JSON file");
+ABSL_FLAG(std::string, baseline, "",
+          "Compare with this CSV file, e.g., from an older commit, and fail "
+          "on regressions");
+ABSL_FLAG(double, max_slowdown, 1.1,
+          "Regressions are ratios (new / baseline) greater than this");
+
+namespace {
+// Resets the process's peak RSS (VmHWM), if the kernel allows it.
+void ResetPeakRss() {
+  FILE* file = fopen("/proc/self/clear_refs", "w");
+  if (file != nullptr) {
+    fputs("5", file);
+    fclose(file);
+  }
+}
+
+// Returns the process's peak RSS, in MB, or 0 if unknown.
+double PeakRssMb() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    absl::string_view value = line;
+    double kb;
+    if (absl::ConsumePrefix(&value, "VmHWM:") &&
+        absl::SimpleAtod(
+            absl::StripSuffix(absl::StripAsciiWhitespace(value), " kB"),
+            &kb)) {
+      return kb / 1024;
+    }
+  }
+
+  return 0;
+}
+
+struct SolveStats {
+  size_t num_iterations{0};
+  bool done{false};
+  SetCoverSolver::ScalarState scalar;
+};
+
+// Solves `instance` on `num_threads` threads, each with its own copy
+// of the constraints and its own solver.
+std::vector<SolveStats> SolveConcurrently(
+    const RandomSetCoverInstance& instance, const std::string& log_prefix,
+    size_t num_threads, size_t max_iter, double eps) {
+  std::vector<std::vector<CoverConstraint>> constraints(num_threads,
+                                                        instance.constraints);
+  std::vector<std::unique_ptr<SetCoverSolver>> solvers;
+  for (size_t i = 0; i < num_threads; ++i) {
+    solvers.push_back(absl::make_unique<SetCoverSolver>(
+        instance.obj_values, absl::MakeSpan(constraints[i])));
+    if (!ConfigureSolverFromFlags(solvers.back().get())) {
+      exit(1);
+    }
+
+    solvers.back()->SetLogPrefix(absl::StrCat(log_prefix, "#", i, " "));
+  }
+
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers.emplace_back([&solvers, i, max_iter, eps] {
+      solvers[i]->Drive(max_iter, eps, /*check_feasible=*/false,
+                        /*populate_solution_concurrently=*/false);
+    });
+  }
+
+  std::vector<SolveStats> ret(num_threads);
+  for (size_t i = 0; i < num_threads; ++i) {
+    workers[i].join();
+    solvers[i]->RefreshSnapshot();
+    ret[i].scalar = solvers[i]->scalar();
+    ret[i].num_iterations = solvers[i]->num_iterations();
+    ret[i].done = ret[i].scalar.done;
+  }
+
+  return ret;
+}
+
+ScalingResult RunCell(const MatrixInstance& spec,
+                      const RandomSetCoverInstance& instance,
+                      size_t num_threads) {
+  ScalingResult ret;
+  ret.instance = spec.name;
+  ret.num_sets = spec.num_sets;
+  ret.num_values = spec.num_values;
+  for (const std::vector<uint32_t>& sets : instance.sets_per_value) {
+    ret.num_nonzeros += sets.size();
+  }
+
+  ret.num_threads = num_threads;
+
+  const std::string log_prefix =
+      absl::StrCat("[", spec.name, " x", num_threads, "] ");
+  ResetPeakRss();
+  {
+    // eps = 0 runs all the iterations, unless the instance is solved
+    // exactly.
+    const std::vector<SolveStats> stats =
+        SolveConcurrently(instance, log_prefix, num_threads,
+                          absl::GetFlag(FLAGS_num_iterations), /*eps=*/0);
+    const auto micros_per_iteration = [](absl::Duration d, size_t n) {
+      return absl::ToDoubleMicroseconds(d) / std::max<size_t>(1, n);
+    };
+
+    for (const SolveStats& solve : stats) {
+      const size_t n = solve.num_iterations;
+      const SetCoverSolver::ScalarState& scalar = solve.scalar;
+      ret.num_iterations += n;
+      ret.iteration_us += micros_per_iteration(scalar.total_time, n);
+      ret.prepare_us += micros_per_iteration(scalar.prepare_time, n);
+      ret.knapsack_us += micros_per_iteration(scalar.knapsack_time, n);
+      ret.observe_us += micros_per_iteration(scalar.observe_time, n);
+      ret.update_us += micros_per_iteration(scalar.update_time, n);
+    }
+
+    ret.num_iterations /= num_threads;
+    ret.iteration_us /= num_threads;
+    ret.prepare_us /= num_threads;
+    ret.knapsack_us /= num_threads;
+    ret.observe_us /= num_threads;
+    ret.update_us /= num_threads;
+  }
+
+  if (absl::GetFlag(FLAGS_iterations_to_eps)) {
+    const std::vector<SolveStats> stats = SolveConcurrently(
+        instance, log_prefix, num_threads, absl::GetFlag(FLAGS_max_iter),
+        absl::GetFlag(FLAGS_feas_eps));
+    double sum = 0;
+    bool all_done = true;
+    for (const SolveStats& solve : stats) {
+      sum += solve.num_iterations;
+      all_done = all_done && solve.done;
+    }
+
+    ret.iterations_to_eps = all_done ? sum / num_threads : -1;
+  }
+
+  ret.peak_rss_mb = PeakRssMb();
+  return ret;
+}
+
+bool WriteResults(const std::string& path,
+                  absl::Span<const ScalingResult> results,
+                  void (*write)(absl::Span<const ScalingResult>,
+                                std::ostream*)) {
+  std::ofstream out(path);
+  write(results, &out);
+  out.close();
+  if (!out) {
+    std::cerr << path << ": failed to write.\n";
+    return false;
+  }
+
+  return true;
+}
+}  // namespace
+
+int main(int argc, char** argv) {
+  absl::ParseCommandLine(argc, argv);
+
+  const absl::optional<std::vector<MatrixInstance>> matrix =
+      FilterInstanceMatrix(
+          StandardInstanceMatrix(absl::GetFlag(FLAGS_matrix_num_values),
+                                 absl::GetFlag(FLAGS_matrix_seed)),
+          absl::GetFlag(FLAGS_instances));
+  if (!matrix.has_value()) {
+    return 1;
+  }
+
+  std::vector<size_t> thread_counts;
+  for (absl::string_view threads_str :
+       absl::StrSplit(absl::GetFlag(FLAGS_threads), ',')) {
+    size_t num_threads;
+    if (!absl::SimpleAtoi(threads_str, &num_threads) || num_threads == 0) {
+      std::cerr << "Invalid thread count " << threads_str << ".\n";
+      return 1;
+    }
+
+    thread_counts.push_back(num_threads);
+  }
+
+  absl::optional<std::vector<ScalingResult>> baseline;
+  if (!absl::GetFlag(FLAGS_baseline).empty()) {
+    baseline = ReadScalingCsv(absl::GetFlag(FLAGS_baseline));
+    if (!baseline.has_value()) {
+      return 1;
+    }
+  }
+
+  std::vector<ScalingResult> results;
+  for (const MatrixInstance& spec : *matrix) {
+    const RandomSetCoverInstance instance = spec.Generate();
+    for (size_t num_threads : thread_counts) {
+      results.push_back(RunCell(spec, instance, num_threads));
+    }
+  }
+
+  const std::string csv_output = absl::GetFlag(FLAGS_csv_output);
+  if (csv_output.empty()) {
+    WriteScalingCsv(results, &std::cout);
+  } else if (!WriteResults(csv_output, results, WriteScalingCsv)) {
+    return 1;
+  }
+
+  const std::string json_output = absl::GetFlag(FLAGS_json_output);
+  if (!json_output.empty() &&
+      !WriteResults(json_output, results, WriteScalingJson)) {
+    return 1;
+  }
+
+  if (!baseline.has_value()) {
+    return 0;
+  }
+
+  bool regressed = false;
+  for (const ScalingComparison& comparison : CompareScalingResults(
+           *baseline, results, absl::GetFlag(FLAGS_max_slowdown))) {
+    regressed = regressed || comparison.regressed;
+    std::cerr << (comparison.regressed ? "REGRESSION " : "improvement ")
+              << comparison.instance << " x" << comparison.num_threads << " "
+              << comparison.metric << ": " << comparison.baseline << " -> "
+              << comparison.current << " (" << comparison.ratio << "x)\n";
+  }
+
+  return regressed ? 1 : 0;
+}
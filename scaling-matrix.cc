@@ -0,0 +1,298 @@
+#include "scaling-matrix.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <utility>
+
+#include "absl/strings/numbers.h"
+#include "absl/strings/str_cat.h"
+#include "absl/strings/str_split.h"
+#include "absl/strings/string_view.h"
+
+namespace {
+// The numeric columns, in CSV order, after instance.
+struct Column {
+  const char* name;
+  double (*get)(const ScalingResult&);
+  void (*set)(double, ScalingResult*);
+};
+
+#define SCALING_COLUMN(FIELD)                                          \
+  Column {                                                             \
+    #FIELD, [](const ScalingResult& r) { return double(r.FIELD); },    \
+        [](double x, ScalingResult* r) {                               \
+          r->FIELD = static_cast<decltype(r->FIELD)>(x);               \
+        }                                                              \
+  }
+
+const Column kColumns[] = {
+    SCALING_COLUMN(num_sets),       SCALING_COLUMN(num_values),
+    SCALING_COLUMN(num_nonzeros),   SCALING_COLUMN(num_threads),
+    SCALING_COLUMN(num_iterations), SCALING_COLUMN(iteration_us),
+    SCALING_COLUMN(prepare_us),     SCALING_COLUMN(knapsack_us),
+    SCALING_COLUMN(observe_us),     SCALING_COLUMN(update_us),
+    SCALING_COLUMN(iterations_to_eps), SCALING_COLUMN(peak_rss_mb),
+};
+
+#undef SCALING_COLUMN
+
+// The lower-is-better metrics that `CompareScalingResults` checks.
+const char* const kComparedMetrics[] = {
+    "iteration_us", "prepare_us",        "knapsack_us", "observe_us",
+    "update_us",    "iterations_to_eps", "peak_rss_mb",
+};
+
+const Column& FindColumn(absl::string_view name) {
+  for (const Column& column : kColumns) {
+    if (name == column.name) {
+      return column;
+    }
+  }
+
+  // Only called with the names above.
+  std::abort();
+}
+}  // namespace
+
+RandomSetCoverInstance MatrixInstance::Generate() const {
+  return GenerateRandomInstance(num_sets, num_values, min_set_per_value,
+                                max_set_per_value, seed);
+}
+
+double MatrixInstance::density() const {
+  return 0.5 * (min_set_per_value + max_set_per_value) / num_sets;
+}
+
+std::vector<MatrixInstance> StandardInstanceMatrix(size_t num_values,
+                                                   uint64_t seed) {
+  struct Density {
+    const char* name;
+    double min;
+    double max;
+  };
+
+  struct Aspect {
+    const char* name;
+    size_t sets;
+    size_t values;
+  };
+
+  static constexpr Density kDensities[] = {
+      {"dense", 0.05, 0.10},
+      {"sparse", 0.001, 0.01},
+  };
+
+  static constexpr Aspect kAspects[] = {
+      {"1:1", 1, 1},
+      {"2:1", 2, 1},
+      {"1:2", 1, 2},
+      {"100:1", 100, 1},
+  };
+
+  std::vector<MatrixInstance> ret;
+  for (const Density& density : kDensities) {
+    for (const Aspect& aspect : kAspects) {
+      MatrixInstance instance;
+      instance.name = absl::StrCat(density.name, "-", aspect.name);
+      instance.num_values = num_values;
+      instance.num_sets =
+          std::max<size_t>(1, num_values * aspect.sets / aspect.values);
+      instance.min_set_per_value = std::max<size_t>(
+          1, std::ceil(density.min * instance.num_sets));
+      instance.max_set_per_value =
+          std::max<size_t>(instance.min_set_per_value,
+                           std::floor(density.max * instance.num_sets));
+      instance.seed = seed + ret.size();
+      ret.push_back(std::move(instance));
+    }
+  }
+
+  return ret;
+}
+
+absl::optional<std::vector<MatrixInstance>> FilterInstanceMatrix(
+    absl::Span<const MatrixInstance> matrix,
+    absl::Span<const std::string> names) {
+  if (names.empty()) {
+    return std::vector<MatrixInstance>(matrix.begin(), matrix.end());
+  }
+
+  std::vector<MatrixInstance> ret;
+  for (const std::string& name : names) {
+    const auto it = std::find_if(
+        matrix.begin(), matrix.end(),
+        [&name](const MatrixInstance& x) { return x.name == name; });
+    if (it == matrix.end()) {
+      std::cerr << "Unknown instance " << name << ".\n";
+      return absl::nullopt;
+    }
+
+    ret.push_back(*it);
+  }
+
+  return ret;
+}
+
+void WriteScalingCsv(absl::Span<const ScalingResult> results,
+                     std::ostream* out) {
+  // Enough for exact counts.
+  const std::streamsize precision = out->precision(12);
+  *out << "instance";
+  for (const Column& column : kColumns) {
+    *out << "," << column.name;
+  }
+
+  *out << "\n";
+  for (const ScalingResult& result : results) {
+    *out << result.instance;
+    for (const Column& column : kColumns) {
+      *out << "," << column.get(result);
+    }
+
+    *out << "\n";
+  }
+
+  out->precision(precision);
+}
+
+void WriteScalingJson(absl::Span<const ScalingResult> results,
+                      std::ostream* out) {
+  const std::streamsize precision = out->precision(12);
+  *out << "[";
+  const char* separator = "\n";
+  for (const ScalingResult& result : results) {
+    *out << separator << "  {\"instance\": \"" << result.instance << "\"";
+    for (const Column& column : kColumns) {
+      *out << ", \"" << column.name << "\": " << column.get(result);
+    }
+
+    *out << "}";
+    separator = ",\n";
+  }
+
+  *out << "\n]\n";
+  out->precision(precision);
+}
+
+absl::optional<std::vector<ScalingResult>> ReadScalingCsv(
+    const std::string& path) {
+  std::ifstream in(path);
+  if (!in) {
+    std::cerr << path << ": failed to open.\n";
+    return absl::nullopt;
+  }
+
+  std::string line;
+  if (!std::getline(in, line)) {
+    std::cerr << path << ": empty file.\n";
+    return absl::nullopt;
+  }
+
+  // Map columns by name, so files from older commits with other
+  // columns still parse.
+  const std::vector<std::string> header = absl::StrSplit(line, ',');
+  if (header.empty() || header[0] != "instance") {
+    std::cerr << path << ": missing header.\n";
+    return absl::nullopt;
+  }
+
+  std::vector<const Column*> columns;
+  for (size_t i = 1; i < header.size(); ++i) {
+    const Column* found = nullptr;
+    for (const Column& column : kColumns) {
+      if (header[i] == column.name) {
+        found = &column;
+      }
+    }
+
+    columns.push_back(found);
+  }
+
+  std::vector<ScalingResult> ret;
+  for (size_t line_number = 2; std::getline(in, line); ++line_number) {
+    if (line.empty()) {
+      continue;
+    }
+
+    const std::vector<absl::string_view> fields = absl::StrSplit(line, ',');
+    if (fields.size() != header.size()) {
+      std::cerr << path << ":" << line_number << ": expected "
+                << header.size() << " fields.\n";
+      return absl::nullopt;
+    }
+
+    ScalingResult result;
+    result.instance = std::string(fields[0]);
+    for (size_t i = 1; i < fields.size(); ++i) {
+      double value;
+      if (!absl::SimpleAtod(fields[i], &value)) {
+        std::cerr << path << ":" << line_number << ": invalid "
+                  << header[i] << ".\n";
+        return absl::nullopt;
+      }
+
+      if (columns[i - 1] != nullptr) {
+        columns[i - 1]->set(value, &result);
+      }
+    }
+
+    ret.push_back(std::move(result));
+  }
+
+  return ret;
+}
+
+std::vector<ScalingComparison> CompareScalingResults(
+    absl::Span<const ScalingResult> baseline,
+    absl::Span<const ScalingResult> current, double max_ratio) {
+  std::map<std::pair<std::string, size_t>, const ScalingResult*> by_cell;
+  for (const ScalingResult& result : baseline) {
+    by_cell[{result.instance, result.num_threads}] = &result;
+  }
+
+  std::vector<ScalingComparison> ret;
+  for (const ScalingResult& result : current) {
+    const auto it = by_cell.find({result.instance, result.num_threads});
+    if (it == by_cell.end()) {
+      continue;
+    }
+
+    for (const char* metric : kComparedMetrics) {
+      const Column& column = FindColumn(metric);
+      ScalingComparison comparison;
+      comparison.instance = result.instance;
+      comparison.num_threads = result.num_threads;
+      comparison.metric = metric;
+      comparison.baseline = column.get(*it->second);
+      comparison.current = column.get(result);
+      // Negative values mean "not reached" (iterations to eps).
+      if (comparison.baseline < 0 && comparison.current < 0) {
+        continue;
+      }
+
+      if (comparison.current < 0) {
+        comparison.ratio = std::numeric_limits<double>::infinity();
+      } else if (comparison.baseline < 0) {
+        comparison.ratio = 0;
+      } else if (comparison.baseline > 0) {
+        comparison.ratio = comparison.current / comparison.baseline;
+      } else {
+        comparison.ratio = (comparison.current > 0)
+                               ? std::numeric_limits<double>::infinity()
+                               : 1.0;
+      }
+
+      comparison.regressed = comparison.ratio > max_ratio;
+      if (comparison.regressed || comparison.ratio < 1 / max_ratio) {
+        ret.push_back(std::move(comparison));
+      }
+    }
+  }
+
+  return ret;
+}
@@ -0,0 +1,103 @@
+#ifndef SCALING_MATRIX_H
+#define SCALING_MATRIX_H
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+#include "absl/types/span.h"
+#include "random-set-cover-instance.h"
+
+// The standard matrix of instance families from EVAL.md, and the
+// machine-readable results of scaling-benchmark over it.
+
+// One seeded random instance family.
+struct MatrixInstance {
+  RandomSetCoverInstance Generate() const;
+  // The expected fraction of nonzeros.
+  double density() const;
+
+  // E.g., "dense-2:1", for a dense instance with twice as many sets
+  // as values.
+  std::string name;
+  size_t num_sets{0};
+  size_t num_values{0};
+  size_t min_set_per_value{0};
+  size_t max_set_per_value{0};
+  uint64_t seed{0};
+};
+
+// Returns the dense (5-10% nonzeros) and sparse (0.1-1% nonzeros)
+// instances with set:value aspect ratios of 1:1, 2:1, 1:2 and 100:1,
+// all with `num_values` values.  Each instance has its own seed,
+// derived from `seed`.
+std::vector<MatrixInstance> StandardInstanceMatrix(size_t num_values,
+                                                   uint64_t seed);
+
+// Returns the instances in `matrix` whose name is in `names`, or all
+// of them if `names` is empty.  Logs unknown names to stderr, and
+// returns nullopt.
+absl::optional<std::vector<MatrixInstance>> FilterInstanceMatrix(
+    absl::Span<const MatrixInstance> matrix,
+    absl::Span<const std::string> names);
+
+// One cell of the benchmark: an instance, solved concurrently by
+// `num_threads` independent solvers.
+struct ScalingResult {
+  std::string instance;
+  size_t num_sets{0};
+  size_t num_values{0};
+  uint64_t num_nonzeros{0};
+  size_t num_threads{0};
+
+  // Averages over the solvers of the fixed-length run.
+  size_t num_iterations{0};
+  double iteration_us{0};
+  double prepare_us{0};
+  double knapsack_us{0};
+  double observe_us{0};
+  double update_us{0};
+
+  // The average number of iterations until the solvers met the
+  // feasibility target, or -1 if any didn't.
+  double iterations_to_eps{-1};
+
+  // The process's peak resident set size during the cell.
+  double peak_rss_mb{0};
+};
+
+// One row per result, with a header.
+void WriteScalingCsv(absl::Span<const ScalingResult> results,
+                     std::ostream* out);
+// An array of objects, one per result.
+void WriteScalingJson(absl::Span<const ScalingResult> results,
+                      std::ostream* out);
+// Parses a file written by `WriteScalingCsv`, e.g., by an older
+// commit.  Returns nullopt (and logs to stderr) on failure.
+absl::optional<std::vector<ScalingResult>> ReadScalingCsv(
+    const std::string& path);
+
+// A metric that changed by more than the tolerance.
+struct ScalingComparison {
+  std::string instance;
+  size_t num_threads{0};
+  std::string metric;
+  double baseline{0};
+  double current{0};
+  // current / baseline; infinite if the current run no longer meets
+  // the feasibility target.
+  double ratio{0};
+  bool regressed{false};
+};
+
+// Compares the time per iteration (and per phase), iterations to eps
+// and peak RSS of the cells present in both `baseline` and
+// `current`, all lower-is-better, and returns the metrics whose ratio
+// exceeds `max_ratio` (regressions) or is less than `1 / max_ratio`
+// (improvements).
+std::vector<ScalingComparison> CompareScalingResults(
+    absl::Span<const ScalingResult> baseline,
+    absl::Span<const ScalingResult> current, double max_ratio);
+#endif /* !SCALING_MATRIX_H */
@@ -0,0 +1,166 @@
+#include "scaling-matrix.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::HasSubstr;
+
+namespace {
+TEST(StandardInstanceMatrix, CoversDensitiesAndAspectRatios) {
+  const std::vector<MatrixInstance> matrix =
+      StandardInstanceMatrix(/*num_values=*/1000, /*seed=*/1);
+  ASSERT_EQ(matrix.size(), 8);
+
+  std::vector<std::string> names;
+  for (size_t i = 0; i < matrix.size(); ++i) {
+    const MatrixInstance& instance = matrix[i];
+    names.push_back(instance.name);
+    EXPECT_EQ(instance.num_values, 1000);
+    EXPECT_EQ(instance.seed, 1 + i);
+    EXPECT_LE(instance.min_set_per_value, instance.max_set_per_value);
+    if (i < 4) {
+      EXPECT_GE(instance.density(), 0.05) << instance.name;
+      EXPECT_LE(instance.density(), 0.10) << instance.name;
+    } else {
+      EXPECT_GE(instance.density(), 0.001) << instance.name;
+      EXPECT_LE(instance.density(), 0.01) << instance.name;
+    }
+  }
+
+  EXPECT_THAT(names, ::testing::ElementsAre(
+                         "dense-1:1", "dense-2:1", "dense-1:2", "dense-100:1",
+                         "sparse-1:1", "sparse-2:1", "sparse-1:2",
+                         "sparse-100:1"));
+  EXPECT_EQ(matrix[1].num_sets, 2000);
+  EXPECT_EQ(matrix[2].num_sets, 500);
+  EXPECT_EQ(matrix[3].num_sets, 100000);
+}
+
+TEST(StandardInstanceMatrix, GeneratesTheSameInstance) {
+  const std::vector<MatrixInstance> matrix =
+      StandardInstanceMatrix(/*num_values=*/100, /*seed=*/3);
+  const RandomSetCoverInstance x = matrix[4].Generate();
+  const RandomSetCoverInstance y = matrix[4].Generate();
+  EXPECT_EQ(x.obj_values, y.obj_values);
+  EXPECT_EQ(x.sets_per_value, y.sets_per_value);
+  EXPECT_EQ(x.sets_per_value.size(), 100);
+}
+
+TEST(FilterInstanceMatrix, SelectsByName) {
+  const std::vector<MatrixInstance> matrix = StandardInstanceMatrix(100, 1);
+  const std::vector<std::string> names = {"sparse-2:1", "dense-1:1"};
+  const auto filtered = FilterInstanceMatrix(matrix, names);
+  ASSERT_TRUE(filtered.has_value());
+  ASSERT_EQ(filtered->size(), 2);
+  EXPECT_EQ((*filtered)[0].name, "sparse-2:1");
+  EXPECT_EQ((*filtered)[1].name, "dense-1:1");
+
+  const std::vector<std::string> unknown = {"dense-3:1"};
+  EXPECT_FALSE(FilterInstanceMatrix(matrix, unknown).has_value());
+  EXPECT_EQ(FilterInstanceMatrix(matrix, {})->size(), matrix.size());
+}
+
+ScalingResult MakeResult(const std::string& instance, size_t num_threads,
+                         double iteration_us, double iterations_to_eps) {
+  ScalingResult ret;
+  ret.instance = instance;
+  ret.num_sets = 2000;
+  ret.num_values = 1000;
+  ret.num_nonzeros = 123456789;
+  ret.num_threads = num_threads;
+  ret.num_iterations = 200;
+  ret.iteration_us = iteration_us;
+  ret.prepare_us = 0.25 * iteration_us;
+  ret.knapsack_us = 0.25 * iteration_us;
+  ret.observe_us = 0.25 * iteration_us;
+  ret.update_us = 0.25 * iteration_us;
+  ret.iterations_to_eps = iterations_to_eps;
+  ret.peak_rss_mb = 42.5;
+  return ret;
+}
+
+TEST(ScalingResults, CsvRoundTrip) {
+  const std::vector<ScalingResult> results = {
+      MakeResult("dense-1:1", 1, 123.5, 456),
+      MakeResult("sparse-100:1", 4, 0.125, -1),
+  };
+
+  char path[] = "/tmp/scaling-matrix_test.XXXXXX";
+  const int fd = mkstemp(path);
+  ASSERT_GE(fd, 0);
+  close(fd);
+  {
+    std::ofstream out(path);
+    WriteScalingCsv(results, &out);
+  }
+
+  const auto read = ReadScalingCsv(path);
+  remove(path);
+  ASSERT_TRUE(read.has_value());
+  ASSERT_EQ(read->size(), 2);
+  for (size_t i = 0; i < 2; ++i) {
+    const ScalingResult& x = results[i];
+    const ScalingResult& y = (*read)[i];
+    EXPECT_EQ(x.instance, y.instance);
+    EXPECT_EQ(x.num_nonzeros, y.num_nonzeros);
+    EXPECT_EQ(x.num_threads, y.num_threads);
+    EXPECT_EQ(x.iteration_us, y.iteration_us);
+    EXPECT_EQ(x.update_us, y.update_us);
+    EXPECT_EQ(x.iterations_to_eps, y.iterations_to_eps);
+    EXPECT_EQ(x.peak_rss_mb, y.peak_rss_mb);
+  }
+
+  std::ostringstream json;
+  WriteScalingJson(results, &json);
+  EXPECT_THAT(json.str(), HasSubstr("\"instance\": \"sparse-100:1\""));
+  EXPECT_THAT(json.str(), HasSubstr("\"num_nonzeros\": 123456789"));
+}
+
+TEST(ScalingResults, ComparesMatchingCells) {
+  const std::vector<ScalingResult> baseline = {
+      MakeResult("dense-1:1", 1, 100, 500),
+      MakeResult("dense-1:1", 2, 100, 500),
+      MakeResult("sparse-1:1", 1, 100, 500),
+  };
+
+  const std::vector<ScalingResult> current = {
+      // Slower iterations, and fewer of them.
+      MakeResult("dense-1:1", 1, 120, 400),
+      // Within tolerance.
+      MakeResult("dense-1:1", 2, 105, 510),
+      // No longer converges.
+      MakeResult("sparse-1:1", 1, 100, -1),
+      // Not in the baseline.
+      MakeResult("sparse-2:1", 1, 1000, 5000),
+  };
+
+  const std::vector<ScalingComparison> comparisons =
+      CompareScalingResults(baseline, current, /*max_ratio=*/1.1);
+  std::vector<std::string> regressions;
+  std::vector<std::string> improvements;
+  for (const ScalingComparison& comparison : comparisons) {
+    const std::string key = comparison.instance + " x" +
+                            std::to_string(comparison.num_threads) + " " +
+                            comparison.metric;
+    (comparison.regressed ? regressions : improvements).push_back(key);
+  }
+
+  EXPECT_THAT(regressions,
+              ::testing::UnorderedElementsAre(
+                  "dense-1:1 x1 iteration_us", "dense-1:1 x1 prepare_us",
+                  "dense-1:1 x1 knapsack_us", "dense-1:1 x1 observe_us",
+                  "dense-1:1 x1 update_us",
+                  "sparse-1:1 x1 iterations_to_eps"));
+  EXPECT_THAT(improvements, ::testing::UnorderedElementsAre(
+                                "dense-1:1 x1 iterations_to_eps"));
+}
+}  // namespace
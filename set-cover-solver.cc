@@ -1,85 +1,183 @@
 #include "set-cover-solver.h"
 
+#include <assert.h>
+
+#include <algorithm>
+#include <cmath>
 #include <iostream>
+#include <limits>
 
+#include "absl/memory/memory.h"
 #include "absl/time/time.h"
+#include "column-fixing.h"
+
+namespace {
+// The trivial lower bound: take every set with a negative cost.
+double TrivialBound(absl::Span<const double> obj_values) {
+  double acc = 0;
+  for (const double v : obj_values) {
+    acc += std::min(v, 0.0);
+  }
+
+  return acc;
+}
+}  // namespace
 
 SetCoverSolver::SetCoverSolver(absl::Span<const double> obj_values,
                                absl::Span<CoverConstraint> constraints)
-    : driver_(obj_values), obj_values_(obj_values), constraints_(constraints) {}
+    : driver_(obj_values),
+      obj_values_(obj_values),
+      constraints_(constraints),
+      best_bound_(TrivialBound(obj_values)) {}
 
 void SetCoverSolver::Drive(size_t max_iter, double eps, bool check_feasible,
                            bool populate_solution_concurrently) {
+  if (primal_heuristic_options_.has_value() &&
+      (primal_heuristic_ == nullptr ||
+       primal_heuristic_->num_sets() != obj_values_.size())) {
+    PrimalHeuristic::Options options = *primal_heuristic_options_;
+    options.trace = trace_.get();
+    primal_heuristic_.reset();
+    primal_heuristic_ = absl::make_unique<PrimalHeuristic>(
+        obj_values_, constraints_, original_set_, options);
+  }
+
+  // Checkpoints must match the original instance.
+  if (working_set_options_.period > 0 && set_status_.empty() &&
+      checkpoint_writer_ == nullptr && driver_.num_iterations == 0 &&
+      original_set_.empty()) {
+    InitWorkingSet();
+  }
+
+  // Counters only count events for the thread that opens them.
+  std::unique_ptr<PerfCounterGroup> perf_counters;
+  if (perf_counters_enabled_) {
+    perf_counters = PerfCounterGroup::Open();
+  }
+
+  driver_.perf_counters = perf_counters.get();
+  driver_.trace = trace_.get();
+
+  assert(termination_options_.eps_decay > 1);
+  current_eps_ = std::max(eps, termination_options_.initial_eps);
   for (size_t i = 0; i < max_iter; ++i) {
-    DriveOneIteration(constraints_, &driver_);
+    if (coverage_.num_sets() != driver_.obj_values.size() ||
+        coverage_.num_solutions() != driver_.num_iterations) {
+      // First call, or restored state.
+      coverage_.SetInstance(constraints_, driver_.obj_values.size());
+      coverage_.Reset(constraints_, driver_.sum_solutions,
+                      driver_.num_iterations);
+      violation_predictor_.Clear();
+      gap_predictor_.Clear();
+    }
 
-    const bool done = (-driver_.prev_min_loss / driver_.num_iterations) < eps;
-    const bool infeasible = !driver_.feasible;
-    const bool relaxation_optimal =
-        check_feasible && driver_.max_last_solution_infeasibility < eps &&
-        driver_.last_solution_value <= driver_.best_bound + eps;
-
-    const bool last_iteration =
-        done || infeasible || relaxation_optimal || (i + 1) >= max_iter;
-
-    std::vector<double> current_solution;
-    if (last_iteration || populate_solution_concurrently) {
-      // XXX: vectorize.
-      current_solution.reserve(driver_.sum_solutions.size());
-      double scale = 1.0 / driver_.num_iterations;
-      for (const double unscaled : driver_.sum_solutions) {
-        current_solution.push_back(scale * unscaled);
-      }
+    switch (weight_update_) {
+      case WeightUpdateKind::kAdaHedge:
+        DriveOneIteration(constraints_, &ada_hedge_, &driver_);
+        break;
+      case WeightUpdateKind::kNormalHedge:
+        DriveOneIteration(constraints_, &normal_hedge_, &driver_);
+        break;
+      case WeightUpdateKind::kPipelinedAdaHedge:
+        pipelined_.DriveOneIteration(constraints_, &driver_);
+        break;
+      case WeightUpdateKind::kFusedAdaHedge:
+        fused_.DriveOneIteration(constraints_, &driver_);
+        break;
     }
 
-    if (state_.mu.TryLock()) {
-      state_.current_solution.swap(current_solution);
+    coverage_.AddSolution(driver_.last_solution);
 
-      state_.scalar.num_iterations = driver_.num_iterations;
-      state_.scalar.done = done;
-      state_.scalar.infeasible = infeasible;
-      state_.scalar.relaxation_optimal = relaxation_optimal;
+    if (set_status_.empty()) {
+      // Otherwise, `driver_.best_bound` only bounds the working set's
+      // relaxation, and `RepriceWorkingSet` raises `best_bound_`.
+      best_bound_ =
+          std::max(best_bound_, OriginalInstanceBound(driver_.best_bound));
+    }
 
-      state_.scalar.sum_mix_gap = driver_.sum_mix_gap;
-      state_.scalar.min_loss = driver_.prev_min_loss;
-      state_.scalar.max_loss = driver_.prev_max_loss;
-      state_.scalar.best_bound = driver_.best_bound;
+    if (shared_bound_ != nullptr) {
+      shared_bound_->Raise(best_bound_);
+      // A bound on the original instance also bounds the reduced one.
+      const double shared = shared_bound_->Get();
+      best_bound_ = std::max(best_bound_, shared);
+      driver_.best_bound = std::max(driver_.best_bound, shared);
+    }
 
-      state_.scalar.sum_solution_value = driver_.sum_solution_value;
-      state_.scalar.sum_solution_feasibility = driver_.sum_solution_feasibility;
+    if (checkpoint_writer_ != nullptr) {
+      checkpoint_writer_->MaybeWrite(driver_, constraints_);
+    }
 
-      state_.scalar.last_solution_value = driver_.last_solution_value;
+    const double max_avg_violation =
+        -driver_.prev_min_loss / driver_.num_iterations;
+    bool stage_met = false;
+    while (current_eps_ > eps && (max_avg_violation < current_eps_ ||
+                                  coverage_.IsFeasible(current_eps_))) {
+      std::cout << log_prefix_ << "Met eps=" << current_eps_ << " after "
+                << driver_.num_iterations << " iterations.\n";
+      current_eps_ =
+          std::max(eps, current_eps_ / termination_options_.eps_decay);
+      stage_met = true;
+    }
+
+    UpdateTermination(max_avg_violation, eps);
 
-      state_.scalar.total_time = driver_.total_time;
-      state_.scalar.prepare_time = driver_.prepare_time;
-      state_.scalar.knapsack_time = driver_.knapsack_time;
-      state_.scalar.observe_time = driver_.observe_time;
-      state_.scalar.update_time = driver_.update_time;
+    const bool done = max_avg_violation < eps || coverage_.IsFeasible(eps) ||
+                      gap_closed_;
+    const bool infeasible = !driver_.feasible;
+    const bool relaxation_optimal =
+        check_feasible && driver_.max_last_solution_infeasibility < eps &&
+        driver_.last_solution_value <= best_bound_ + eps;
 
-      state_.scalar.last_iteration_time = driver_.last_iteration_time;
-      state_.scalar.last_prepare_time = driver_.last_prepare_time;
-      state_.scalar.last_knapsack_time = driver_.last_knapsack_time;
-      state_.scalar.last_observe_time = driver_.last_observe_time;
-      state_.scalar.last_update_time = driver_.last_update_time;
+    const bool stopped = stop_requested_.load(std::memory_order_relaxed);
+    const bool last_iteration = done || infeasible || relaxation_optimal ||
+                                stopped || (i + 1) >= max_iter;
 
-      state_.mu.Unlock();
+    PublishScalar(done, infeasible, relaxation_optimal);
+    if (trace_ != nullptr) {
+      TraceIteration scalars;
+      scalars.iteration = driver_.num_iterations;
+      scalars.mix_gap = driver_.sum_mix_gap;
+      scalars.min_loss = driver_.prev_min_loss / driver_.num_iterations;
+      scalars.max_loss = driver_.prev_max_loss / driver_.num_iterations;
+      scalars.best_bound = best_bound_;
+      scalars.solution_value =
+          driver_.sum_solution_value / driver_.num_iterations;
+      trace_->RecordIteration(scalars);
     }
 
+    if (relaxation_optimal) {
+      PublishSolution(driver_.last_solution, 1.0, /*include_fixed=*/false);
+    } else if (last_iteration || stage_met ||
+               (populate_solution_concurrently &&
+                driver_.num_iterations - last_snapshot_iteration_ >=
+                    snapshot_options_.min_iterations &&
+                absl::Now() - last_snapshot_time_ >=
+                    snapshot_options_.min_period)) {
+      PublishSolution(driver_.sum_solutions, 1.0 / driver_.num_iterations,
+                      /*include_fixed=*/true);
+    }
+
+    MaybeSubmitToPrimalHeuristic();
+
     if (i < 10 || ((i + 1) % 100) == 0 || last_iteration) {
       const size_t num_it = i + 1;
-      std::cout << "It " << num_it << ":"
+      std::cout << log_prefix_ << "It " << num_it << ":"
                 << " mix gap=" << driver_.sum_mix_gap << " max avg viol="
                 << -driver_.prev_min_loss / driver_.num_iterations
                 << " max avg feas="
                 << driver_.prev_max_loss / driver_.num_iterations
-                << " best bound=" << driver_.best_bound << " avg sol value="
+                << " best bound=" << best_bound_ << " avg sol value="
                 << driver_.sum_solution_value / driver_.num_iterations
                 << " avg sol feasibility="
                 << driver_.sum_solution_feasibility / driver_.num_iterations
                 << " max last vio=" << driver_.max_last_solution_infeasibility
+                << " avg sol max vio=" << coverage_.MaxViolation()
+                << " gap=" << duality_gap_
+                << " predicted iters left=" << predicted_remaining_iterations_
                 << "\n";
       std::cout
-          << "\t iter time=" << driver_.total_time / num_it << " prep time="
+          << log_prefix_ << "\t iter time=" << driver_.total_time / num_it
+          << " prep time="
           << 100 * absl::FDivDuration(driver_.prepare_time, driver_.total_time)
           << "% ks time="
           << 100 * absl::FDivDuration(driver_.knapsack_time, driver_.total_time)
@@ -88,26 +186,628 @@ void SetCoverSolver::Drive(size_t max_iter, double eps, bool check_feasible,
           << "% upd time="
           << 100 * absl::FDivDuration(driver_.update_time, driver_.total_time)
           << "%.\n";
+      if (driver_.perf_counters != nullptr) {
+        const PhasePerfCounts& counts = driver_.perf_counts;
+        const PerfCounts total = counts.Total();
+        const std::pair<const char*, const PerfCounts*> phases[] = {
+            {"iter", &total},
+            {"prep", &counts.prepare},
+            {"ks", &counts.knapsack},
+            {"obs", &counts.observe},
+            {"upd", &counts.update},
+        };
+
+        for (const auto& phase : phases) {
+          std::cout << log_prefix_ << "\t " << phase.first << " counters: ";
+          PrintPerfCounts(*phase.second, num_it, &std::cout);
+          std::cout << ".\n";
+        }
+      }
     }
 
     if (infeasible) {
-      std::cout << "Infeasible!?!\n";
+      std::cout << log_prefix_ << "Infeasible!?!\n";
       break;
     }
 
     if (relaxation_optimal) {
-      std::cout << "Feasible!\n";
-      std::vector<double> last_solution(driver_.last_solution.begin(),
-                                        driver_.last_solution.end());
-      absl::MutexLock ml(&state_.mu);
-      state_.current_solution.swap(last_solution);
+      std::cout << log_prefix_ << "Feasible!\n";
       break;
     }
 
-    if (done) {
+    if (done || stopped) {
       break;
     }
+
+    // Checkpoints must match the original instance.
+    if (column_fixing_options_.period > 0 && checkpoint_writer_ == nullptr &&
+        driver_.num_iterations % column_fixing_options_.period == 0 &&
+        !last_iteration) {
+      const uint64_t begin = TraceRecorder::Now();
+      switch (weight_update_) {
+        case WeightUpdateKind::kAdaHedge:
+        case WeightUpdateKind::kPipelinedAdaHedge:
+        case WeightUpdateKind::kFusedAdaHedge:
+          FixColumns(&ada_hedge_);
+          break;
+        case WeightUpdateKind::kNormalHedge:
+          FixColumns(&normal_hedge_);
+          break;
+      }
+
+      RecordSpan(TraceSpan::kColumnFixing, begin);
+    }
+
+    if (!set_status_.empty() && checkpoint_writer_ == nullptr &&
+        driver_.num_iterations % working_set_options_.period == 0 &&
+        !last_iteration) {
+      const uint64_t begin = TraceRecorder::Now();
+      switch (weight_update_) {
+        case WeightUpdateKind::kAdaHedge:
+        case WeightUpdateKind::kPipelinedAdaHedge:
+        case WeightUpdateKind::kFusedAdaHedge:
+          RepriceWorkingSet(&ada_hedge_);
+          break;
+        case WeightUpdateKind::kNormalHedge:
+          RepriceWorkingSet(&normal_hedge_);
+          break;
+      }
+
+      RecordSpan(TraceSpan::kWorkingSet, begin);
+    }
+  }
+
+  driver_.perf_counters = nullptr;
+  driver_.trace = nullptr;
+  if (checkpoint_writer_ != nullptr &&
+      !checkpoint_writer_->WriteNow(driver_, constraints_)) {
+    std::cerr << "Failed to write checkpoint.\n";
+  }
+
+  if (trace_ != nullptr && !trace_->WriteFile(trace_path_)) {
+    std::cerr << "Failed to write trace.\n";
+  }
+
+  // `Drive` may be called again after `AddSets`.
+  if (!done_.HasBeenNotified()) {
+    done_.Notify();
+  }
+}
+
+bool SetCoverSolver::RefreshSnapshot() {
+  const bool new_scalar = scalar_buffer_.Acquire();
+  const bool new_solution = solution_buffer_.Acquire();
+  const bool new_cover =
+      primal_heuristic_ != nullptr && primal_heuristic_->Acquire();
+  return new_scalar || new_solution || new_cover;
+}
+
+void SetCoverSolver::SolutionSnapshot::CopyTo(std::vector<double>* out) const {
+  out->resize(unscaled_solution.size());
+  const double* in = unscaled_solution.data();
+  double* dst = out->data();
+  for (size_t i = 0, n = unscaled_solution.size(); i < n; ++i) {
+    dst[i] = scale * in[i];
+  }
+}
+
+void SetCoverSolver::UpdateTermination(double max_avg_violation,
+                                       double eps) {
+  constexpr double kInfinity = std::numeric_limits<double>::infinity();
+  upper_bound_ = kInfinity;
+  const double max_violation = coverage_.MaxViolation();
+  if (max_violation < 1) {
+    // Scaling the average solution up by 1 / (1 - max_violation)
+    // covers every value.
+    upper_bound_ = driver_.sum_solution_value / driver_.num_iterations /
+                   (1 - max_violation);
+  }
+
+  if (primal_heuristic_ != nullptr) {
+    upper_bound_ = std::min(upper_bound_, primal_heuristic_->best_cost());
+  }
+
+  duality_gap_ = kInfinity;
+  if (std::isfinite(upper_bound_)) {
+    duality_gap_ = std::max(0.0, (upper_bound_ - best_bound_) /
+                                     std::max(std::abs(upper_bound_), 1e-9));
+  }
+
+  const double max_gap = termination_options_.max_gap;
+  gap_closed_ = max_gap > 0 && duality_gap_ <= max_gap;
+
+  violation_predictor_.AddSample(driver_.num_iterations, max_avg_violation);
+  if (std::isfinite(duality_gap_)) {
+    gap_predictor_.AddSample(driver_.num_iterations, duality_gap_);
+  }
+
+  predicted_remaining_iterations_ =
+      eps > 0 ? violation_predictor_.PredictRemaining(eps) : kInfinity;
+  if (max_gap > 0) {
+    predicted_remaining_iterations_ =
+        std::min(predicted_remaining_iterations_,
+                 gap_predictor_.PredictRemaining(max_gap));
+  }
+}
+
+double SetCoverSolver::OriginalInstanceBound(double bound) const {
+  // Fixing passes uncover each constraint by at most the budget they
+  // used, in total, so scaling the reduced instance's optimal cover
+  // by 1 / (1 - used) covers the original instance.
+  const double used =
+      column_fixing_options_.budget - remaining_fixing_budget_;
+  return bound > 0 ? bound * (1 - used) : bound;
+}
+
+void SetCoverSolver::PublishScalar(bool done, bool infeasible,
+                                   bool relaxation_optimal) {
+  ScalarState* scalar = scalar_buffer_.back();
+  scalar->num_iterations = driver_.num_iterations;
+  scalar->done = done;
+  scalar->infeasible = infeasible;
+  scalar->relaxation_optimal = relaxation_optimal;
+
+  scalar->sum_mix_gap = driver_.sum_mix_gap;
+  scalar->min_loss = driver_.prev_min_loss;
+  scalar->max_loss = driver_.prev_max_loss;
+  scalar->best_bound = best_bound_;
+
+  scalar->sum_solution_value = driver_.sum_solution_value;
+  scalar->sum_solution_feasibility = driver_.sum_solution_feasibility;
+
+  scalar->last_solution_value = driver_.last_solution_value;
+
+  if (primal_heuristic_ != nullptr) {
+    const double cost = primal_heuristic_->best_cost();
+    scalar->best_integer_cost = cost;
+    scalar->integer_gap = (cost - best_bound_) /
+                          std::max(std::abs(cost), 1e-9);
+  }
+
+  scalar->current_eps = current_eps_;
+  scalar->upper_bound = upper_bound_;
+  scalar->duality_gap = duality_gap_;
+  scalar->gap_closed = gap_closed_;
+  scalar->predicted_remaining_iterations = predicted_remaining_iterations_;
+
+  scalar->total_time = driver_.total_time;
+  scalar->prepare_time = driver_.prepare_time;
+  scalar->knapsack_time = driver_.knapsack_time;
+  scalar->observe_time = driver_.observe_time;
+  scalar->update_time = driver_.update_time;
+
+  scalar->last_iteration_time = driver_.last_iteration_time;
+  scalar->last_prepare_time = driver_.last_prepare_time;
+  scalar->last_knapsack_time = driver_.last_knapsack_time;
+  scalar->last_observe_time = driver_.last_observe_time;
+  scalar->last_update_time = driver_.last_update_time;
+
+  scalar->perf_counts = driver_.perf_counts;
+  scalar->last_perf_counts = driver_.last_perf_counts;
+  scalar_buffer_.Publish();
+}
+
+void SetCoverSolver::PublishSolution(absl::Span<const double> unscaled,
+                                     double scale, bool include_fixed) {
+  SolutionSnapshot* snapshot = solution_buffer_.back();
+  snapshot->num_iterations = driver_.num_iterations;
+  snapshot->scale = scale;
+  // The recycled buffer already has the right capacity after the
+  // first few snapshots, so this is a plain copy.
+  ExpandSolution(unscaled, include_fixed, &snapshot->unscaled_solution);
+  solution_buffer_.Publish();
+
+  last_snapshot_iteration_ = driver_.num_iterations;
+  last_snapshot_time_ = absl::Now();
+}
+
+void SetCoverSolver::ExpandSolution(absl::Span<const double> unscaled,
+                                    bool include_fixed,
+                                    std::vector<double>* out) const {
+  if (original_set_.empty()) {
+    out->assign(unscaled.begin(), unscaled.end());
+    return;
+  }
+
+  out->assign(obj_values_.size(), 0.0);
+  if (include_fixed) {
+    for (const auto& removed : removed_sums_) {
+      (*out)[removed.first] += removed.second;
+    }
+  }
+
+  for (size_t i = 0, n = unscaled.size(); i < n; ++i) {
+    (*out)[original_set_[i]] += unscaled[i];
+  }
+}
+
+void SetCoverSolver::MaybeSubmitToPrimalHeuristic() {
+  if (primal_heuristic_ == nullptr ||
+      absl::Now() - last_primal_submit_time_ <
+          primal_heuristic_options_->period) {
+    return;
+  }
+
+  // Alternate between the average solution, which is closer to
+  // feasible, and the last one, which is closer to integral.
+  const bool use_last =
+      (num_primal_submits_++ % 2) == 1 && driver_.last_solution.size() != 0;
+  FractionalSolution* next = primal_heuristic_->next_solution();
+  next->num_iterations = driver_.num_iterations;
+  if (use_last) {
+    next->scale = 1.0;
+    ExpandSolution(driver_.last_solution, /*include_fixed=*/false,
+                   &next->unscaled);
+  } else {
+    next->scale = 1.0 / driver_.num_iterations;
+    ExpandSolution(driver_.sum_solutions, /*include_fixed=*/true,
+                   &next->unscaled);
+  }
+
+  primal_heuristic_->Submit();
+  last_primal_submit_time_ = absl::Now();
+}
+
+template <typename WeightUpdateAlgorithm>
+void SetCoverSolver::FixColumns(WeightUpdateAlgorithm* algorithm) {
+  const double upper_bound = ComputeCoverUpperBound(
+      driver_.obj_values, driver_.sum_solutions, 1.0 / driver_.num_iterations,
+      constraints_);
+  if (!std::isfinite(upper_bound) || !(remaining_fixing_budget_ > 0)) {
+    return;
+  }
+
+  // These are the weights the next iteration would use.
+  const PrepareWeightsState prepare_weights =
+      algorithm->PrepareWeights(constraints_, &driver_);
+  const LagrangianBound bound = ComputeLagrangianBound(
+      driver_.obj_values, prepare_weights.knapsack_weights,
+      prepare_weights.knapsack_rhs);
+  const FixedColumns fixed =
+      FindFixedColumns(driver_.obj_values, prepare_weights.knapsack_weights,
+                       bound, upper_bound, constraints_,
+                       remaining_fixing_budget_);
+  if (fixed.sets.empty()) {
+    return;
+  }
+
+  remaining_fixing_budget_ -= fixed.max_uncovered;
+  if (!set_status_.empty()) {
+    for (const uint32_t set : fixed.sets) {
+      set_status_[original_set_[set]] = SetStatus::kFixed;
+    }
+  }
+
+  CompactSets(fixed.sets);
+
+  std::cout << log_prefix_ << "Fixed " << fixed.sets.size() << " sets at 0, "
+            << num_active_sets() << " left (bounds [" << bound.lower_bound
+            << ", " << upper_bound << "], max uncovered "
+            << fixed.max_uncovered << ").\n";
+}
+
+void SetCoverSolver::CompactSets(absl::Span<const uint32_t> sets) {
+  const size_t num_sets = driver_.obj_values.size();
+  std::vector<uint32_t> new_index(num_sets);
+  std::vector<double> obj_values;
+  std::vector<uint32_t> original_set;
+  obj_values.reserve(num_sets - sets.size());
+  original_set.reserve(num_sets - sets.size());
+  size_t next_removed = 0;
+  for (size_t i = 0; i < num_sets; ++i) {
+    const uint32_t original = original_set_.empty() ? i : original_set_[i];
+    if (next_removed < sets.size() && sets[next_removed] == i) {
+      ++next_removed;
+      new_index[i] = CoverConstraint::kRemovedTour;
+      if (driver_.sum_solutions[i] != 0) {
+        removed_sums_.emplace_back(original, driver_.sum_solutions[i]);
+      }
+
+      continue;
+    }
+
+    new_index[i] = obj_values.size();
+    obj_values.push_back(driver_.obj_values[i]);
+    original_set.push_back(original);
+  }
+
+  ::RemoveSets(obj_values, new_index, constraints_, &driver_);
+  if (coverage_.num_sets() != 0) {
+    coverage_.SetInstance(constraints_, num_active_sets());
+  }
+
+  // Moving preserves the buffer that `driver_` now refers to.
+  reduced_obj_values_ = std::move(obj_values);
+  original_set_ = std::move(original_set);
+}
+
+void SetCoverSolver::ReaddSets(absl::Span<const uint32_t> sets,
+                               absl::Span<const double> initial_loss) {
+  assert(!original_set_.empty());
+  std::vector<double> reduced(reduced_obj_values_);
+  std::vector<std::vector<uint32_t>> values_per_new_set;
+  values_per_new_set.reserve(sets.size());
+  for (const uint32_t set : sets) {
+    reduced.push_back(obj_values_[set]);
+    original_set_.push_back(set);
+    values_per_new_set.emplace_back(
+        set_values_.begin() + set_value_offsets_[set],
+        set_values_.begin() + set_value_offsets_[set + 1]);
+  }
+
+  ::AddSets(reduced, values_per_new_set, constraints_, &driver_,
+            initial_loss);
+  reduced_obj_values_ = std::move(reduced);
+  if (coverage_.num_sets() != 0) {
+    coverage_.SetInstance(constraints_, num_active_sets());
+  }
+}
+
+void SetCoverSolver::InitWorkingSet() {
+  const size_t num_sets = obj_values_.size();
+  // Counting sort of the entries by set.
+  set_value_offsets_.assign(num_sets + 1, 0);
+  for (const CoverConstraint& constraint : constraints_) {
+    for (const uint32_t set : constraint.potential_tours()) {
+      ++set_value_offsets_[set + 1];
+    }
+  }
+
+  for (size_t j = 0; j < num_sets; ++j) {
+    set_value_offsets_[j + 1] += set_value_offsets_[j];
+  }
+
+  set_values_.resize(set_value_offsets_.back());
+  {
+    std::vector<size_t> next(set_value_offsets_.begin(),
+                             set_value_offsets_.end() - 1);
+    for (size_t c = 0, n = constraints_.size(); c < n; ++c) {
+      for (const uint32_t set : constraints_[c].potential_tours()) {
+        set_values_[next[set]++] = c;
+      }
+    }
   }
 
-  done_.Notify();
+  // The cheapest sets for each value.
+  set_status_.assign(num_sets, SetStatus::kInactive);
+  const size_t k =
+      std::max<size_t>(1, working_set_options_.initial_sets_per_value);
+  std::vector<uint32_t> candidates;
+  for (const CoverConstraint& constraint : constraints_) {
+    const absl::Span<const uint32_t> sets = constraint.potential_tours();
+    candidates.assign(sets.begin(), sets.end());
+    const auto by_cost = [this](uint32_t x, uint32_t y) {
+      return obj_values_[x] < obj_values_[y];
+    };
+    if (candidates.size() > k) {
+      std::nth_element(candidates.begin(), candidates.begin() + (k - 1),
+                       candidates.end(), by_cost);
+      candidates.resize(k);
+    }
+
+    for (const uint32_t set : candidates) {
+      set_status_[set] = SetStatus::kActive;
+    }
+  }
+
+  std::vector<uint32_t> inactive;
+  for (size_t j = 0; j < num_sets; ++j) {
+    if (set_status_[j] == SetStatus::kInactive) {
+      inactive.push_back(j);
+    }
+  }
+
+  CompactSets(inactive);
+  std::cout << log_prefix_ << "Working set: " << num_active_sets() << " of "
+            << num_sets << " sets.\n";
+}
+
+namespace {
+// The weight functions for re-pricing, or nullopt while the weights
+// are degenerate (AdaHedge's step size is infinite before the first
+// mix gap, and all experts but the best get no weight).
+absl::optional<HedgeWeights> RepricingWeights(const AdaHedge&,
+                                              const DriverState& state) {
+  const double eta = AdaHedgeStepSize(state);
+  if (!std::isfinite(eta)) {
+    return absl::nullopt;
+  }
+
+  return HedgeWeights{state.prev_min_loss, eta};
+}
+
+absl::optional<NormalHedgeWeights> RepricingWeights(
+    const NormalHedge& algorithm, const DriverState& state) {
+  return NormalHedgeWeights{state.sum_solution_feasibility,
+                            algorithm.inv_2scale()};
+}
+
+}  // namespace
+
+template <typename WeightUpdateAlgorithm>
+void SetCoverSolver::RepriceWorkingSet(WeightUpdateAlgorithm* algorithm) {
+  // These are the weights the next iteration would use.
+  const PrepareWeightsState prepare_weights =
+      algorithm->PrepareWeights(constraints_, &driver_);
+  const auto maybe_weight_fn = RepricingWeights(*algorithm, driver_);
+  if (!maybe_weight_fn.has_value()) {
+    return;
+  }
+
+  const auto& weight_fn = *maybe_weight_fn;
+
+  // Keep the sets with a non-negligible weight in some constraint,
+  // and those in the last solution.  Also find each constraint's best
+  // expert: its max weight and min loss.
+  const size_t num_sets = num_active_sets();
+  std::vector<uint8_t> keep(num_sets, 0);
+  for (size_t j = 0; j < num_sets; ++j) {
+    keep[j] = driver_.last_solution.size() == num_sets &&
+              driver_.last_solution[j] > 0;
+  }
+
+  std::vector<double> max_weights(constraints_.size(), 0.0);
+  std::vector<double> min_losses(constraints_.size(), kNewTourLoss);
+  std::vector<double> weights;
+  for (size_t c = 0, n = constraints_.size(); c < n; ++c) {
+    const absl::Span<const double> losses = constraints_[c].loss();
+    if (losses.empty()) {
+      continue;
+    }
+
+    weights.resize((losses.size() + 7) & ~size_t{7});
+    weight_fn.Apply(losses, absl::MakeSpan(weights));
+    double max_weight = 0;
+    double min_loss = losses[0];
+    for (size_t i = 0; i < losses.size(); ++i) {
+      max_weight = std::max(max_weight, weights[i]);
+      min_loss = std::min(min_loss, losses[i]);
+    }
+
+    max_weights[c] = max_weight;
+    min_losses[c] = min_loss;
+    const double threshold =
+        working_set_options_.min_relative_weight * max_weight;
+    const absl::Span<const uint32_t> sets = constraints_[c].potential_tours();
+    for (size_t i = 0; i < losses.size(); ++i) {
+      keep[sets[i]] |= weights[i] >= threshold;
+    }
+  }
+
+  std::vector<uint32_t> leaving;
+  for (size_t j = 0; j < num_sets; ++j) {
+    if (!keep[j]) {
+      leaving.push_back(j);
+    }
+  }
+
+  // Price the sets outside optimistically: each of their experts
+  // would be as good as the best in its constraint.
+  const LagrangianBound bound = ComputeLagrangianBound(
+      driver_.obj_values, prepare_weights.knapsack_weights,
+      prepare_weights.knapsack_rhs);
+  std::vector<std::pair<double, uint32_t>> candidates;
+  double sum_negative_reduced_costs = 0;
+  for (size_t j = 0, n = set_status_.size(); j < n; ++j) {
+    if (set_status_[j] != SetStatus::kInactive) {
+      continue;
+    }
+
+    double weight = 0;
+    for (size_t k = set_value_offsets_[j]; k < set_value_offsets_[j + 1];
+         ++k) {
+      weight += max_weights[set_values_[k]];
+    }
+
+    const double reduced_cost = obj_values_[j] - bound.lambda * weight;
+    if (reduced_cost < 0) {
+      candidates.emplace_back(reduced_cost, j);
+      sum_negative_reduced_costs += reduced_cost;
+    }
+  }
+
+  // The most negative reduced costs first.
+  const size_t max_new_sets = working_set_options_.max_new_sets > 0
+                                  ? working_set_options_.max_new_sets
+                                  : constraints_.size();
+  if (candidates.size() > max_new_sets) {
+    std::nth_element(candidates.begin(), candidates.begin() + max_new_sets,
+                     candidates.end());
+    candidates.resize(max_new_sets);
+  }
+
+  std::vector<uint32_t> entering;
+  entering.reserve(candidates.size());
+  for (const auto& candidate : candidates) {
+    entering.push_back(candidate.second);
+  }
+
+  std::sort(entering.begin(), entering.end());
+
+  // The sets outside can only lower the working set's bound by their
+  // negative reduced costs.
+  const double all_sets_bound = bound.lower_bound + sum_negative_reduced_costs;
+  if (std::isfinite(all_sets_bound)) {
+    best_bound_ =
+        std::max(best_bound_, OriginalInstanceBound(all_sets_bound));
+  }
+
+  for (const uint32_t set : leaving) {
+    set_status_[original_set_[set]] = SetStatus::kInactive;
+  }
+
+  for (const uint32_t set : entering) {
+    set_status_[set] = SetStatus::kActive;
+  }
+
+  if (!leaving.empty()) {
+    CompactSets(leaving);
+  }
+
+  if (!entering.empty()) {
+    ReaddSets(entering, min_losses);
+  }
+
+  std::cout << log_prefix_ << "Working set: -" << leaving.size() << " +"
+            << entering.size() << ", " << num_active_sets()
+            << " sets (bound for all sets " << all_sets_bound << ").\n";
+}
+
+void SetCoverSolver::AddSets(
+    absl::Span<const double> obj_values,
+    absl::Span<const std::vector<uint32_t>> values_per_new_set) {
+  if (!set_status_.empty()) {
+    // New sets enter the working set.
+    set_status_.resize(obj_values.size(), SetStatus::kActive);
+    for (const std::vector<uint32_t>& values : values_per_new_set) {
+      set_values_.insert(set_values_.end(), values.begin(), values.end());
+      set_value_offsets_.push_back(set_values_.size());
+    }
+  }
+
+  if (original_set_.empty()) {
+    ::AddSets(obj_values, values_per_new_set, constraints_, &driver_);
+  } else {
+    // Append the new sets to the reduced instance.
+    std::vector<double> reduced(reduced_obj_values_);
+    for (size_t i = obj_values_.size(); i < obj_values.size(); ++i) {
+      reduced.push_back(obj_values[i]);
+      original_set_.push_back(i);
+    }
+
+    ::AddSets(reduced, values_per_new_set, constraints_, &driver_);
+    reduced_obj_values_ = std::move(reduced);
+  }
+
+  if (coverage_.num_sets() != 0) {
+    coverage_.SetInstance(constraints_, num_active_sets());
+  }
+
+  obj_values_ = obj_values;
+  if (!values_per_new_set.empty()) {
+    // New sets may lower the optimal value.
+    best_bound_ = TrivialBound(obj_values);
+  }
+}
+
+void SetCoverSolver::EnableCheckpoints(
+    const std::string& path, const CheckpointWriter::Options& options) {
+  checkpoint_writer_ = absl::make_unique<CheckpointWriter>(path, options);
+}
+
+void SetCoverSolver::EnableTracing(const std::string& path,
+                                   size_t capacity) {
+  trace_path_ = path;
+  trace_ = absl::make_unique<TraceRecorder>(capacity);
+}
+
+void SetCoverSolver::RecordSpan(TraceSpan span, uint64_t begin) const {
+  if (trace_ != nullptr) {
+    trace_->RecordSpan(span, driver_.num_iterations, begin,
+                       TraceRecorder::Now());
+  }
+}
+
+bool SetCoverSolver::RestoreCheckpoint(const std::string& path) {
+  return ::RestoreCheckpoint(path, constraints_, &driver_);
 }
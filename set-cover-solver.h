@@ -1,14 +1,29 @@
 #ifndef SET_COVER_SOLVER_H
 #define SET_COVER_SOLVER_H
+#include <atomic>
 #include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
 
-#include "absl/base/thread_annotations.h"
-#include "absl/synchronization/mutex.h"
 #include "absl/synchronization/notification.h"
 #include "absl/time/time.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
+#include "average-coverage.h"
+#include "checkpoint.h"
+#include "convergence-predictor.h"
 #include "cover-constraint.h"
 #include "driver.h"
+#include "pipelined-driver.h"
+#include "primal-heuristic.h"
+#include "shared-bound.h"
+#include "trace-recorder.h"
+#include "triple-buffer.h"
+#include "weight-update.h"
 
 // This class is thread-compatible.
 class SetCoverSolver {
@@ -22,6 +37,8 @@ class SetCoverSolver {
     double sum_mix_gap{0.0};
     double min_loss{0.0};
     double max_loss{0.0};
+    // A lower bound on the original instance's optimal value, even
+    // once `driver_` works on a reduced instance.
     double best_bound{0.0};
 
     double sum_solution_value{0.0};
@@ -29,6 +46,29 @@ class SetCoverSolver {
 
     double last_solution_value{0.0};
 
+    // The cost of the best integer cover found by the primal
+    // heuristic (infinite until the first), and its relative gap,
+    // (cost - best_bound) / |cost|.
+    double best_integer_cost{std::numeric_limits<double>::infinity()};
+    double integer_gap{std::numeric_limits<double>::infinity()};
+
+    // The feasibility target of the current continuation stage; see
+    // `TerminationOptions`.
+    double current_eps{0.0};
+    // The best upper bound on the relaxation's optimal value (the
+    // average solution, scaled up until feasible, or the best integer
+    // cover), and its relative gap with `best_bound`,
+    // (upper_bound - best_bound) / |upper_bound|.  Infinite until the
+    // first bound.
+    double upper_bound{std::numeric_limits<double>::infinity()};
+    double duality_gap{std::numeric_limits<double>::infinity()};
+    // Whether `done` because the duality gap closed.
+    bool gap_closed{false};
+    // The predicted number of iterations until done, from the
+    // convergence rate so far; infinite if unknown.
+    double predicted_remaining_iterations{
+        std::numeric_limits<double>::infinity()};
+
     absl::Duration total_time;
     absl::Duration prepare_time;
     absl::Duration knapsack_time;
@@ -40,13 +80,95 @@ class SetCoverSolver {
     absl::Duration last_knapsack_time;
     absl::Duration last_observe_time;
     absl::Duration last_update_time;
+
+    // Hardware event counts for each phase; all zero unless
+    // `EnablePerfCounters`.
+    PhasePerfCounts perf_counts;
+    PhasePerfCounts last_perf_counts;
+  };
+
+  // A published solution: the average solution is `scale *
+  // unscaled_solution`, which readers scale lazily, so the solver
+  // only copies `sum_solutions`.
+  struct SolutionSnapshot {
+    // The iteration at which this solution was published.
+    size_t num_iterations{0};
+    double scale{0.0};
+    std::vector<double> unscaled_solution;
+
+    size_t size() const { return unscaled_solution.size(); }
+    double operator[](size_t i) const { return scale * unscaled_solution[i]; }
+
+    // Overwrites `*out` with the scaled solution.
+    void CopyTo(std::vector<double>* out) const;
+  };
+
+  // Solution snapshots are rate-limited: copying `sum_solutions`
+  // every iteration would dominate small iterations.  The scalar
+  // state is always published after every iteration.
+  struct SnapshotOptions {
+    // Publish the solution at most every `min_iterations` iterations...
+    size_t min_iterations{1};
+    // ... and at most every `min_period` wall-clock time.
+    absl::Duration min_period{absl::Milliseconds(20)};
+  };
+
+  // Periodic reduced-cost column fixing; see column-fixing.h.  Sets
+  // that are fixed at 0 are compacted out of the knapsack and the
+  // constraints, and snapshots map the solution back to the original
+  // sets.
+  struct ColumnFixingOptions {
+    // Run a fixing pass every `period` iterations (0 to disable).
+    size_t period{0};
+    // The total coverage that fixed sets may remove from any
+    // constraint, over all passes.  The reduced instance's optimal
+    // value is at most 1 / (1 - budget) times the original's, so its
+    // bounds are scaled by (1 - budget used) before they're reported.
+    double budget{1e-3};
   };
 
-  struct SolverState {
-    mutable absl::Mutex mu;
-    std::vector<double> current_solution GUARDED_BY(mu);
+  // Adaptive termination, on top of the feasibility target `eps`
+  // given to `Drive`.
+  struct TerminationOptions {
+    // Eps continuation: when greater than `eps`, `Drive` first targets
+    // `initial_eps`, and divides the target by `eps_decay` each time
+    // the average solution meets it, down to `eps`.  The losses carry
+    // over, so every stage resumes warm, and publishes its solution
+    // snapshot as soon as it's met.
+    double initial_eps{0.0};
+    double eps_decay{2.0};
+    // Also stop once the relative duality gap is at most `max_gap` (0
+    // to disable); see `ScalarState::duality_gap`.
+    double max_gap{0.0};
+  };
 
-    ScalarState scalar GUARDED_BY(mu);
+  // Working-set (restricted master) mode, for instances with many
+  // more sets than values: the knapsack only sees a working set,
+  // seeded with the cheapest sets for each value, and the other sets
+  // are compacted away like fixed sets.  Every `period` iterations,
+  // sets whose experts all have negligible weight leave the working
+  // set, and the sets outside are re-priced, optimistically: as if
+  // each of their experts had the weight of the best expert in its
+  // constraint.  Sets with a negative reduced cost for the current
+  // knapsack's Lagrangian multiplier enter with such experts.
+  //
+  // The driver's bound only bounds the working set's relaxation, so
+  // `ScalarState::best_bound` is the re-pricing pass's bound for all
+  // sets instead, which adds the negative reduced costs of the sets
+  // outside (the trivial bound until the first pass).  Skipped while
+  // checkpoints are enabled, and only starts from a fresh solve.
+  struct WorkingSetOptions {
+    // Re-price every `period` iterations (0 to disable).
+    size_t period{0};
+    // The initial working set has this many of the cheapest sets
+    // for each value.
+    size_t initial_sets_per_value{8};
+    // Sets leave once each of their experts' weights is less than
+    // this fraction of the max weight in the expert's constraint.
+    double min_relative_weight{1e-6};
+    // At most this many sets enter per pass, those with the most
+    // negative reduced costs (0 for the number of values).
+    size_t max_new_sets{0};
   };
 
   // Both spans must outlive this instance.
@@ -58,29 +180,251 @@ class SetCoverSolver {
   SetCoverSolver& operator=(const SetCoverSolver&) = delete;
   SetCoverSolver& operator=(SetCoverSolver&&) = delete;
 
-  const SolverState& state() const { return state_; }
+  // Snapshot readers.  `RefreshSnapshot` switches `scalar()`,
+  // `solution()` and `integer_cover()` to the latest state published
+  // by `Drive` and the primal heuristic, and returns whether any
+  // changed.  The references they return are stable until the next
+  // call to `RefreshSnapshot`.
+  //
+  // Reading never blocks `Drive` (and vice versa), so it may happen
+  // concurrently with `Drive`, but only from one thread at a time.
+  // `solution()` may lag behind `scalar()`.
+  bool RefreshSnapshot();
+  const ScalarState& scalar() const { return scalar_buffer_.front(); }
+  const SolutionSnapshot& solution() const { return solution_buffer_.front(); }
+  // The best integer cover, over the original sets; empty until the
+  // primal heuristic finds one.
+  const IntegerCover& integer_cover() const {
+    return primal_heuristic_ != nullptr ? primal_heuristic_->best_cover()
+                                        : no_integer_cover_;
+  }
+
+  void SetSnapshotOptions(const SnapshotOptions& options) {
+    snapshot_options_ = options;
+  }
+
   bool IsDone() const { return done_.HasBeenNotified(); }
   void WaitUntilDone() const { done_.WaitForNotification(); }
 
-  // Solves until the average solution is `eps`-feasible, or
-  // `max_iter` iterations have elapsed, whichever happens first.
-  // Signals `done_` before returning.
+  // Selects the weight update algorithm for subsequent calls to
+  // `Drive`; defaults to AdaHedge.
+  void SetWeightUpdate(WeightUpdateKind kind) { weight_update_ = kind; }
+
+  // Solves until the average solution is `eps`-feasible, the duality
+  // gap closes (see `TerminationOptions`), or `max_iter` iterations
+  // have elapsed, whichever happens first.  Signals `done_` before
+  // returning.
   //
-  // Updates the `state()` after each iteration. The `state()`'s
-  // `current_solution` vector is only populated at the last
-  // iteration, or `populate_solution_concurrently` is true.
+  // Publishes the scalar state after each iteration. The solution
+  // snapshot is only published at the last iteration and at the end
+  // of continuation stages, or, subject to the `SnapshotOptions`,
+  // when `populate_solution_concurrently` is true.
   //
   // If `check_feasible` is true, also returns early whenever a
   // subproblem yields a solution that's both feasible and optimal.
   void Drive(size_t max_iter, double eps, bool check_feasible,
              bool populate_solution_concurrently = true);
 
+  void SetTerminationOptions(const TerminationOptions& options) {
+    termination_options_ = options;
+  }
+
+  // Makes `Drive` return after the iteration in progress, now or in
+  // any later call.  May be called from any thread.
+  void Stop() { stop_requested_.store(true, std::memory_order_relaxed); }
+
+  // Exchanges `best_bound` with solvers for the same instance after
+  // every iteration in `Drive`: raises `bound`, and tightens this
+  // solver's own bound to it.  The shared bound is always for the
+  // original instance (see `ScalarState::best_bound`).  `bound` must
+  // outlive calls to `Drive`, and sharing doesn't survive `AddSets`.
+  void ShareBestBound(SharedBound* bound) { shared_bound_ = bound; }
+
+  // Prefixes the progress lines that `Drive` prints to stdout.
+  void SetLogPrefix(std::string prefix) { log_prefix_ = std::move(prefix); }
+
+  // Counts hardware events (cycles, instructions, cache, branch and
+  // TLB misses) for each phase of the iterations in `Drive`, on its
+  // thread, and reports them with the phase times.  Does nothing if
+  // the counters are unavailable; see perf-counters.h.
+  void EnablePerfCounters() { perf_counters_enabled_ = true; }
+
+  // Draws the knapsack's pivots from one stream seeded with `seed`,
+  // rather than from a fresh stream for each iteration, so that solves
+  // of the same instance with the same seed do the same work.
+  void SetKnapsackSeed(uint64_t seed) { driver_.knapsack_prng.emplace(seed); }
+
+  // Column fixing is skipped while checkpoints are enabled:
+  // checkpoints must match the original instance.
+  void SetColumnFixingOptions(const ColumnFixingOptions& options) {
+    column_fixing_options_ = options;
+    remaining_fixing_budget_ = options.budget;
+  }
+
+  void SetWorkingSetOptions(const WorkingSetOptions& options) {
+    working_set_options_ = options;
+  }
+
+  // Rounds the fractional solutions to integer covers on a background
+  // thread while in `Drive`, which submits the average and last
+  // solutions, in turn, every `options.period`.  Submitting never
+  // waits for the heuristic.  The heuristic restarts from scratch
+  // after `AddSets`.
+  void EnablePrimalHeuristic(const PrimalHeuristic::Options& options) {
+    primal_heuristic_options_ = options;
+  }
+
+  // The number of sets that are still in the reduced instance.
+  size_t num_active_sets() const { return driver_.obj_values.size(); }
+
+  // Appends new sets to the instance between calls to `Drive`, and
+  // keeps the learned weights; see `AddSets` in driver.h.
+  // `obj_values` is the extended cost vector (the current costs
+  // followed by those of the new sets), and must outlive this
+  // instance.  `values_per_new_set[i]` lists the constraints covered
+  // by the `i`th new set.
+  //
+  // `Drive` may be called again afterwards to resume solving warm.
+  // Fixed sets remain fixed.
+  void AddSets(absl::Span<const double> obj_values,
+               absl::Span<const std::vector<uint32_t>> values_per_new_set);
+
+  // Periodically checkpoints the solver state to `path` from a
+  // background thread while in `Drive`, which also writes a final
+  // checkpoint before returning.
+  void EnableCheckpoints(const std::string& path,
+                         const CheckpointWriter::Options& options);
+
+  // Records a trace of the iterations in `Drive` (see
+  // trace-recorder.h): the spans of each phase on every thread, and
+  // the convergence scalars after each iteration.  `Drive` writes the
+  // last `capacity` records to `path` before returning.  Must be
+  // called before the first `Drive`.
+  void EnableTracing(const std::string& path, size_t capacity);
+
+  // Restores the solver state from a checkpoint written for the same
+  // instance.  Must be called before `Drive`, which then resumes
+  // where the checkpointed solve left off.  The checkpointed pivot
+  // stream replaces any from `SetKnapsackSeed`.
+  bool RestoreCheckpoint(const std::string& path);
+
+  // The total number of iterations, including restored ones.
+  size_t num_iterations() const { return driver_.num_iterations; }
+
  private:
-  SolverState state_;
+  void PublishScalar(bool done, bool infeasible, bool relaxation_optimal);
+  // Records a span from `begin` to now, if tracing.
+  void RecordSpan(TraceSpan span, uint64_t begin) const;
+  // Updates `upper_bound_`, `duality_gap_` and the convergence
+  // predictions after an iteration.
+  void UpdateTermination(double max_avg_violation, double eps);
+  // Converts `bound`, on the instance reduced by column fixing, to a
+  // bound on the original instance.
+  double OriginalInstanceBound(double bound) const;
+  // Publishes `scale * unscaled` as the solution snapshot.
+  // `unscaled` is indexed by the reduced instance's sets; with
+  // `include_fixed`, the sets that were compacted away (fixed, or
+  // out of the working set) get their sums from before then, and 0
+  // otherwise.
+  void PublishSolution(absl::Span<const double> unscaled, double scale,
+                       bool include_fixed);
+  // Overwrites `out` with `unscaled`, mapped back to the original
+  // sets as for `PublishSolution`.
+  void ExpandSolution(absl::Span<const double> unscaled, bool include_fixed,
+                      std::vector<double>* out) const;
+  // Submits the average or last solution to the primal heuristic, if
+  // it's enabled and due.
+  void MaybeSubmitToPrimalHeuristic();
+
+  // Runs a column fixing pass, and compacts the fixed sets away.
+  template <typename WeightUpdateAlgorithm>
+  void FixColumns(WeightUpdateAlgorithm* algorithm);
+
+  // Compacts the reduced sets in `sets` (sorted) out of the instance,
+  // and saves their `sum_solutions` entries in `removed_sums_`.
+  void CompactSets(absl::Span<const uint32_t> sets);
+  // Appends the original sets in `sets` (sorted) to the reduced
+  // instance, with fresh experts; see `AddSets` in driver.h.
+  void ReaddSets(absl::Span<const uint32_t> sets,
+                 absl::Span<const double> initial_loss);
+
+  // Indexes the instance by set, and restricts it to the initial
+  // working set.
+  void InitWorkingSet();
+  // Updates the working set; see `WorkingSetOptions`.
+  template <typename WeightUpdateAlgorithm>
+  void RepriceWorkingSet(WeightUpdateAlgorithm* algorithm);
+
+  SnapshotOptions snapshot_options_;
+  size_t last_snapshot_iteration_{0};
+  absl::Time last_snapshot_time_{absl::InfinitePast()};
+  TripleBuffer<ScalarState> scalar_buffer_;
+  TripleBuffer<SolutionSnapshot> solution_buffer_;
 
   DriverState driver_;
+  WeightUpdateKind weight_update_{WeightUpdateKind::kAdaHedge};
+  AdaHedge ada_hedge_;
+  NormalHedge normal_hedge_;
+  PipelinedDriver pipelined_;
+  PipelinedDriver fused_{PipelinedDriver::kDefaultToursPerBlock,
+                         /*fuse_observe=*/true};
   absl::Span<const double> obj_values_;
   absl::Span<CoverConstraint> constraints_;
   absl::Notification done_;
+  // How well the average solution (with fixed sets) covers each
+  // value, for the termination check.
+  AverageCoverage coverage_;
+
+  ColumnFixingOptions column_fixing_options_;
+  double remaining_fixing_budget_{ColumnFixingOptions().budget};
+  // The best lower bound on the original instance's optimal value:
+  // `driver_.best_bound` only bounds the reduced instance.
+  double best_bound_;
+  // Once sets are fixed (or restricted to a working set), `driver_`
+  // works on `reduced_obj_values_`, and reduced set `i` is the
+  // original set `original_set_[i]`.  `original_set_` is empty until
+  // then.
+  std::vector<double> reduced_obj_values_;
+  std::vector<uint32_t> original_set_;
+  // The original index and non-zero `sum_solutions` entry for each
+  // set compacted away.  Sets may leave the working set more than
+  // once, so their sums add up.
+  std::vector<std::pair<uint32_t, double>> removed_sums_;
+
+  enum class SetStatus : uint8_t { kActive, kInactive, kFixed };
+  WorkingSetOptions working_set_options_;
+  // In working-set mode, the status of each original set, and the
+  // values covered by set `j`, in
+  // `set_values_[set_value_offsets_[j], set_value_offsets_[j + 1])`.
+  // All empty otherwise.
+  std::vector<SetStatus> set_status_;
+  std::vector<size_t> set_value_offsets_;
+  std::vector<uint32_t> set_values_;
+
+  std::unique_ptr<CheckpointWriter> checkpoint_writer_;
+  std::string trace_path_;
+  std::unique_ptr<TraceRecorder> trace_;
+
+  absl::optional<PrimalHeuristic::Options> primal_heuristic_options_;
+  // Created by `Drive`, for the current instance.
+  std::unique_ptr<PrimalHeuristic> primal_heuristic_;
+  const IntegerCover no_integer_cover_;
+  absl::Time last_primal_submit_time_{absl::InfinitePast()};
+  size_t num_primal_submits_{0};
+
+  TerminationOptions termination_options_;
+  double current_eps_{0.0};
+  double upper_bound_{std::numeric_limits<double>::infinity()};
+  double duality_gap_{std::numeric_limits<double>::infinity()};
+  bool gap_closed_{false};
+  double predicted_remaining_iterations_{
+      std::numeric_limits<double>::infinity()};
+  ConvergencePredictor violation_predictor_;
+  ConvergencePredictor gap_predictor_;
+
+  std::atomic<bool> stop_requested_{false};
+  SharedBound* shared_bound_{nullptr};
+  std::string log_prefix_;
+  bool perf_counters_enabled_{false};
 };
 #endif /*!SET_COVER_SOLVER_H */
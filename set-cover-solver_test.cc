@@ -0,0 +1,118 @@
+#include "set-cover-solver.h"
+
+#include <limits>
+#include <tuple>
+#include <vector>
+
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+#include "solution-stats.h"
+
+namespace {
+TEST(SetCoverSolver, WorkingSet) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/5000, /*num_values=*/100,
+                             /*min_set_per_value=*/20,
+                             /*max_set_per_value=*/500, /*seed=*/13);
+  SetCoverSolver solver(instance.obj_values,
+                        absl::MakeSpan(instance.constraints));
+  SetCoverSolver::WorkingSetOptions options;
+  options.period = 10;
+  options.initial_sets_per_value = 2;
+  solver.SetWorkingSetOptions(options);
+
+  solver.Drive(/*max_iter=*/500, /*eps=*/1e-2, /*check_feasible=*/false,
+               /*populate_solution_concurrently=*/false);
+  EXPECT_LT(solver.num_active_sets(), 1000);
+
+  // Snapshots are over all sets.
+  ASSERT_TRUE(solver.RefreshSnapshot());
+  std::vector<double> solution;
+  solver.solution().CopyTo(&solution);
+  ASSERT_EQ(solution.size(), instance.obj_values.size());
+
+  double max_infeasibility;
+  std::tie(max_infeasibility, std::ignore) =
+      ComputeCoverInfeasibility(solution, instance.sets_per_value);
+  EXPECT_LT(max_infeasibility, 0.5);
+}
+
+// The working set's relaxation may have a higher optimal value than
+// the full instance's: here, the initial working set only has the
+// singletons, for a total of 4, while the set of all values costs
+// 1.5.  Until re-pricing adds that set, the reported bound must not
+// exceed 1.5, nor close the gap.
+TEST(SetCoverSolver, WorkingSetBoundsFullInstance) {
+  const std::vector<double> obj_values = {1, 1, 1, 1, 1.5};
+  std::vector<CoverConstraint> constraints;
+  for (uint32_t value = 0; value < 4; ++value) {
+    const std::vector<uint32_t> sets = {value, 4};
+    constraints.emplace_back(sets);
+  }
+
+  SetCoverSolver solver(obj_values, absl::MakeSpan(constraints));
+  SetCoverSolver::WorkingSetOptions options;
+  options.period = 1000;
+  options.initial_sets_per_value = 1;
+  solver.SetWorkingSetOptions(options);
+  SetCoverSolver::TerminationOptions termination;
+  termination.max_gap = 1e-2;
+  solver.SetTerminationOptions(termination);
+
+  solver.Drive(/*max_iter=*/100, /*eps=*/1e-4, /*check_feasible=*/false,
+               /*populate_solution_concurrently=*/false);
+  EXPECT_EQ(solver.num_active_sets(), 4);
+  ASSERT_TRUE(solver.RefreshSnapshot());
+  EXPECT_LE(solver.scalar().best_bound, 1.5);
+  EXPECT_FALSE(solver.scalar().gap_closed);
+}
+
+// Fixing columns may raise the reduced instance's optimal value by up
+// to a factor of 1 / (1 - budget); the reported bound must still bound
+// the original instance's relaxation.
+TEST(SetCoverSolver, ColumnFixingBoundsOriginalInstance) {
+  constexpr size_t kNumSets = 300;
+  constexpr size_t kNumValues = 30;
+  RandomSetCoverInstance instance = GenerateRandomInstance(
+      kNumSets, kNumValues, /*min_set_per_value=*/3,
+      /*max_set_per_value=*/30, /*seed=*/19);
+  SetCoverSolver reference(instance.obj_values,
+                           absl::MakeSpan(instance.constraints));
+  reference.Drive(/*max_iter=*/20000, /*eps=*/1e-4, /*check_feasible=*/false,
+                  /*populate_solution_concurrently=*/false);
+  ASSERT_TRUE(reference.RefreshSnapshot());
+  const double upper_bound = reference.scalar().upper_bound;
+  ASSERT_LT(upper_bound, std::numeric_limits<double>::infinity());
+
+  RandomSetCoverInstance fixed_instance = GenerateRandomInstance(
+      kNumSets, kNumValues, /*min_set_per_value=*/3,
+      /*max_set_per_value=*/30, /*seed=*/19);
+  SetCoverSolver solver(fixed_instance.obj_values,
+                        absl::MakeSpan(fixed_instance.constraints));
+  SetCoverSolver::ColumnFixingOptions options;
+  options.period = 10;
+  options.budget = 0.5;
+  solver.SetColumnFixingOptions(options);
+  solver.Drive(/*max_iter=*/20000, /*eps=*/1e-4, /*check_feasible=*/false,
+               /*populate_solution_concurrently=*/false);
+
+  ASSERT_TRUE(solver.RefreshSnapshot());
+  EXPECT_GT(solver.scalar().best_bound, 0);
+  EXPECT_LE(solver.scalar().best_bound, upper_bound);
+}
+
+TEST(SetCoverSolver, StopReturnsAfterOneIteration) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/100, /*num_values=*/20,
+                             /*min_set_per_value=*/2,
+                             /*max_set_per_value=*/10, /*seed=*/17);
+  SetCoverSolver solver(instance.obj_values,
+                        absl::MakeSpan(instance.constraints));
+  solver.Stop();
+  solver.Drive(/*max_iter=*/100, /*eps=*/0, /*check_feasible=*/false);
+  EXPECT_EQ(solver.num_iterations(), 1);
+  EXPECT_TRUE(solver.IsDone());
+}
+}  // namespace
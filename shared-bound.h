@@ -0,0 +1,31 @@
+#ifndef SHARED_BOUND_H
+#define SHARED_BOUND_H
+#include <atomic>
+#include <limits>
+
+// A lower bound on the optimal value of one instance, which several
+// solvers raise concurrently and read back.
+//
+// This class is thread-safe.
+class SharedBound {
+ public:
+  SharedBound() = default;
+
+  SharedBound(const SharedBound&) = delete;
+  SharedBound& operator=(const SharedBound&) = delete;
+
+  double Get() const { return bound_.load(std::memory_order_relaxed); }
+
+  // Raises the bound to `bound`, if that's an improvement.
+  void Raise(double bound) {
+    double current = bound_.load(std::memory_order_relaxed);
+    while (bound > current &&
+           !bound_.compare_exchange_weak(current, bound,
+                                         std::memory_order_relaxed)) {
+    }
+  }
+
+ private:
+  std::atomic<double> bound_{-std::numeric_limits<double>::infinity()};
+};
+#endif /* !SHARED_BOUND_H */
@@ -0,0 +1,253 @@
+#include "trace-recorder.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include <algorithm>
+#include <cmath>
+#include <iostream>
+#include <iterator>
+
+#include "absl/time/clock.h"
+
+namespace {
+constexpr char kMagic[8] = {'S', 'C', 'T', 'R', 'A', 'C', 'E', '\0'};
+constexpr uint32_t kVersion = 1;
+
+struct TraceFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t record_size;
+  uint64_t num_records;
+  uint64_t num_dropped;
+  // The TSC and wall-clock time when the recorder was created, and
+  // when the file was written.
+  uint64_t begin_tsc;
+  int64_t begin_ns;
+  uint64_t end_tsc;
+  int64_t end_ns;
+};
+
+uint32_t ThreadIndex() {
+  static std::atomic<uint32_t> next_thread{0};
+  static thread_local const uint32_t index =
+      next_thread.fetch_add(1, std::memory_order_relaxed);
+  return index;
+}
+
+size_t RoundUpToPowerOfTwo(size_t x) {
+  size_t ret = 1;
+  while (ret < x) {
+    ret *= 2;
+  }
+
+  return ret;
+}
+
+const char* const kIterationNames[] = {"mix_gap", "min_loss", "max_loss",
+                                       "best_bound", "solution_value"};
+}  // namespace
+
+const char* TraceSpanName(TraceSpan span) {
+  switch (span) {
+    case TraceSpan::kIteration:
+      return "iteration";
+    case TraceSpan::kPrepare:
+      return "prepare";
+    case TraceSpan::kKnapsack:
+      return "knapsack";
+    case TraceSpan::kObserve:
+      return "observe";
+    case TraceSpan::kUpdate:
+      return "update";
+    case TraceSpan::kColumnFixing:
+      return "column_fixing";
+    case TraceSpan::kWorkingSet:
+      return "working_set";
+    case TraceSpan::kPrimalRounding:
+      return "primal_rounding";
+  }
+
+  return "unknown";
+}
+
+TraceRecorder::TraceRecorder(size_t capacity)
+    : mask_(RoundUpToPowerOfTwo(std::max<size_t>(1, capacity)) - 1),
+      slots_(new Slot[mask_ + 1]),
+      begin_tsc_(Now()),
+      begin_ns_(absl::GetCurrentTimeNanos()) {}
+
+template <typename Fn>
+void TraceRecorder::Append(Fn fill) {
+  // A seqlock per slot: readers retry (or skip) slots whose sequence
+  // number changes while they copy the record.
+  const uint64_t index = next_.fetch_add(1, std::memory_order_relaxed);
+  Slot& slot = slots_[index & mask_];
+  slot.seq.store(2 * index + 1, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  fill(&slot.record);
+  slot.seq.store(2 * (index + 1), std::memory_order_release);
+}
+
+void TraceRecorder::RecordSpan(TraceSpan span, uint64_t iteration,
+                               uint64_t begin, uint64_t end) {
+  const uint32_t thread = ThreadIndex();
+  Append([&](TraceRecord* record) {
+    record->begin = begin;
+    record->end = end;
+    record->iteration = iteration;
+    record->thread = thread;
+    record->kind = TraceRecord::kSpan;
+    record->span = static_cast<uint16_t>(span);
+    // The slot may hold an older iteration record, or nothing yet.
+    std::fill(std::begin(record->values), std::end(record->values), 0.0);
+  });
+}
+
+void TraceRecorder::RecordIteration(const TraceIteration& scalars) {
+  const uint64_t now = Now();
+  const uint32_t thread = ThreadIndex();
+  Append([&](TraceRecord* record) {
+    record->begin = now;
+    record->end = now;
+    record->iteration = scalars.iteration;
+    record->thread = thread;
+    record->kind = TraceRecord::kIteration;
+    record->span = 0;
+    record->values[0] = scalars.mix_gap;
+    record->values[1] = scalars.min_loss;
+    record->values[2] = scalars.max_loss;
+    record->values[3] = scalars.best_bound;
+    record->values[4] = scalars.solution_value;
+  });
+}
+
+bool TraceRecorder::WriteFile(const std::string& path) const {
+  const uint64_t end = next_.load(std::memory_order_acquire);
+  const uint64_t begin = end - std::min<uint64_t>(end, mask_ + 1);
+
+  std::vector<TraceRecord> records;
+  records.reserve(end - begin);
+  for (uint64_t index = begin; index < end; ++index) {
+    const Slot& slot = slots_[index & mask_];
+    const uint64_t seq = slot.seq.load(std::memory_order_acquire);
+    if (seq != 2 * (index + 1)) {
+      // Still being written, or already overwritten.
+      continue;
+    }
+
+    TraceRecord record;
+    memcpy(&record, &slot.record, sizeof(record));
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (slot.seq.load(std::memory_order_relaxed) == seq) {
+      records.push_back(record);
+    }
+  }
+
+  TraceFileHeader header;
+  memcpy(header.magic, kMagic, sizeof(kMagic));
+  header.version = kVersion;
+  header.record_size = sizeof(TraceRecord);
+  header.num_records = records.size();
+  header.num_dropped = end - records.size();
+  header.begin_tsc = begin_tsc_;
+  header.begin_ns = begin_ns_;
+  header.end_tsc = Now();
+  header.end_ns = absl::GetCurrentTimeNanos();
+
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == nullptr) {
+    perror("fopen");
+    return false;
+  }
+
+  bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(records.data(), sizeof(TraceRecord), records.size(),
+                   file) == records.size();
+  if (!ok) {
+    perror("fwrite");
+  }
+
+  if (fclose(file) != 0) {
+    perror("fclose");
+    ok = false;
+  }
+
+  return ok;
+}
+
+double TraceFile::ToMicros(uint64_t tsc) const {
+  // Records may predate `begin_tsc` by a few ticks on other cores.
+  return (static_cast<double>(tsc) - static_cast<double>(begin_tsc)) /
+         ticks_per_us;
+}
+
+absl::optional<TraceFile> ReadTraceFile(const std::string& path) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (file == nullptr) {
+    perror("fopen");
+    return absl::nullopt;
+  }
+
+  TraceFile ret;
+  TraceFileHeader header;
+  bool ok = fread(&header, sizeof(header), 1, file) == 1 &&
+            memcmp(header.magic, kMagic, sizeof(kMagic)) == 0 &&
+            header.version == kVersion &&
+            header.record_size == sizeof(TraceRecord);
+  if (ok) {
+    ret.records.resize(header.num_records);
+    ok = fread(ret.records.data(), sizeof(TraceRecord), header.num_records,
+               file) == header.num_records;
+  }
+
+  fclose(file);
+  if (!ok) {
+    std::cerr << path << ": invalid trace file.\n";
+    return absl::nullopt;
+  }
+
+  ret.begin_tsc = header.begin_tsc;
+  ret.num_dropped = header.num_dropped;
+  const double elapsed_us = 1e-3 * (header.end_ns - header.begin_ns);
+  ret.ticks_per_us =
+      (header.end_tsc > header.begin_tsc && elapsed_us > 0)
+          ? (header.end_tsc - header.begin_tsc) / elapsed_us
+          : 1e3;  // Assume 1 GHz.
+  return ret;
+}
+
+void WriteChromeTrace(const TraceFile& trace, std::ostream* out) {
+  const std::streamsize precision = out->precision(15);
+  *out << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"num_dropped\":"
+       << trace.num_dropped << "},\"traceEvents\":[\n";
+  const char* separator = "";
+  for (const TraceRecord& record : trace.records) {
+    const double ts = trace.ToMicros(record.begin);
+    if (record.kind == TraceRecord::kSpan) {
+      *out << separator << "{\"ph\":\"X\",\"pid\":0,\"tid\":" << record.thread
+           << ",\"name\":\""
+           << TraceSpanName(static_cast<TraceSpan>(record.span))
+           << "\",\"ts\":" << ts
+           << ",\"dur\":" << trace.ToMicros(record.end) - ts
+           << ",\"args\":{\"iteration\":" << record.iteration << "}}";
+      separator = ",\n";
+      continue;
+    }
+
+    // One counter track per scalar, since their scales differ.
+    for (size_t i = 0; i < 5; ++i) {
+      if (!std::isfinite(record.values[i])) {
+        continue;
+      }
+
+      *out << separator << "{\"ph\":\"C\",\"pid\":0,\"name\":\""
+           << kIterationNames[i] << "\",\"ts\":" << ts << ",\"args\":{\""
+           << kIterationNames[i] << "\":" << record.values[i] << "}}";
+      separator = ",\n";
+    }
+  }
+
+  *out << "\n]}\n";
+  out->precision(precision);
+}
@@ -0,0 +1,142 @@
+#ifndef TRACE_RECORDER_H
+#define TRACE_RECORDER_H
+#include <x86intrin.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "absl/types/optional.h"
+
+// Low-overhead tracing for long solves: threads append fixed-size
+// records (phase spans with TSC timestamps, and per-iteration
+// convergence scalars) to a lock-free ring buffer, which is dumped
+// to a compact binary file, and converted offline to the Chrome
+// trace JSON format (for chrome://tracing or Perfetto) with
+// convert-trace.
+//
+// The ring keeps the most recent records: size it for the whole
+// solve to keep its full history (each iteration appends about 6
+// records of 72 bytes).
+
+// The spans that the solver records.
+enum class TraceSpan : uint16_t {
+  kIteration,
+  kPrepare,
+  kKnapsack,
+  kObserve,
+  kUpdate,
+  kColumnFixing,
+  kWorkingSet,
+  kPrimalRounding,
+};
+
+// Returns a short, stable name for `span` (e.g., "prepare").
+const char* TraceSpanName(TraceSpan span);
+
+// One record, in the binary file's (and the ring's) layout.
+struct TraceRecord {
+  enum Kind : uint16_t { kSpan, kIteration };
+
+  // TSC timestamps; equal for iteration records.
+  uint64_t begin;
+  uint64_t end;
+  uint64_t iteration;
+  // A small integer per thread, in order of each thread's first
+  // record.
+  uint32_t thread;
+  uint16_t kind;
+  // A `TraceSpan`, for spans.
+  uint16_t span;
+  // For iteration records: mix gap, min and max loss (both averaged
+  // over iterations), best bound, and average solution value.  0 for
+  // spans.
+  double values[5];
+};
+
+static_assert(sizeof(TraceRecord) == 72, "TraceRecord is a file format.");
+
+// The convergence scalars for one iteration.
+struct TraceIteration {
+  uint64_t iteration{0};
+  double mix_gap{0};
+  double min_loss{0};
+  double max_loss{0};
+  double best_bound{0};
+  double solution_value{0};
+};
+
+// This class is thread-safe: any number of threads may record
+// concurrently, without locks, and `WriteFile` may run concurrently
+// with them (it skips the records that are overwritten while it
+// copies them).
+class TraceRecorder {
+ public:
+  // Keeps the last `capacity` records, rounded up to a power of two.
+  explicit TraceRecorder(size_t capacity);
+
+  TraceRecorder(const TraceRecorder&) = delete;
+  TraceRecorder& operator=(const TraceRecorder&) = delete;
+
+  // The timestamps for `RecordSpan`.
+  static uint64_t Now() { return __rdtsc(); }
+
+  void RecordSpan(TraceSpan span, uint64_t iteration, uint64_t begin,
+                  uint64_t end);
+  void RecordIteration(const TraceIteration& scalars);
+
+  // Writes the records in the ring to `path`, oldest first.  Returns
+  // false (and logs to stderr) on failure.
+  bool WriteFile(const std::string& path) const;
+
+  // The number of records so far, including overwritten ones.
+  uint64_t num_recorded() const {
+    return next_.load(std::memory_order_relaxed);
+  }
+
+ private:
+  struct Slot {
+    // 2 * (index + 1) once the record for `index` is complete, and
+    // odd while it's being written.
+    std::atomic<uint64_t> seq{0};
+    TraceRecord record;
+  };
+
+  // Claims the next slot, and calls `fill` on its record.
+  template <typename Fn>
+  void Append(Fn fill);
+
+  const size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+  std::atomic<uint64_t> next_{0};
+  // To convert TSC timestamps to wall-clock time.
+  const uint64_t begin_tsc_;
+  const int64_t begin_ns_;
+};
+
+// A trace file, as written by `TraceRecorder::WriteFile`.
+struct TraceFile {
+  // Converts TSC ticks to microseconds since the recorder's creation.
+  double ToMicros(uint64_t tsc) const;
+
+  uint64_t begin_tsc{0};
+  double ticks_per_us{0};
+  // The number of records that were overwritten (or were being
+  // overwritten) in the ring.
+  uint64_t num_dropped{0};
+  std::vector<TraceRecord> records;
+};
+
+// Returns nullopt (and logs to stderr) if `path` isn't a valid trace
+// file.
+absl::optional<TraceFile> ReadTraceFile(const std::string& path);
+
+// Writes `trace` in the Chrome trace event JSON format: spans are
+// complete ("X") events, one track per thread, and iteration scalars
+// are counter ("C") events.  Non-finite scalars are skipped.
+void WriteChromeTrace(const TraceFile& trace, std::ostream* out);
+#endif /* !TRACE_RECORDER_H */
@@ -0,0 +1,168 @@
+#include "trace-recorder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <limits>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+
+using ::testing::HasSubstr;
+using ::testing::Not;
+
+namespace {
+std::string TempPath() {
+  char path[] = "/tmp/trace-recorder_test.XXXXXX";
+  const int fd = mkstemp(path);
+  EXPECT_GE(fd, 0);
+  close(fd);
+  return path;
+}
+
+TEST(TraceRecorder, RoundTripsAndConverts) {
+  TraceRecorder recorder(16);
+  const uint64_t begin = TraceRecorder::Now();
+  recorder.RecordSpan(TraceSpan::kPrepare, 3, begin, begin + 1000);
+
+  TraceIteration scalars;
+  scalars.iteration = 4;
+  scalars.mix_gap = 1.5;
+  scalars.min_loss = -0.25;
+  scalars.max_loss = std::numeric_limits<double>::infinity();
+  scalars.best_bound = 10;
+  scalars.solution_value = 12;
+  recorder.RecordIteration(scalars);
+  EXPECT_EQ(recorder.num_recorded(), 2);
+
+  const std::string path = TempPath();
+  ASSERT_TRUE(recorder.WriteFile(path));
+  const absl::optional<TraceFile> trace = ReadTraceFile(path);
+  remove(path.c_str());
+  ASSERT_TRUE(trace.has_value());
+  EXPECT_EQ(trace->num_dropped, 0);
+  EXPECT_GT(trace->ticks_per_us, 0);
+  ASSERT_EQ(trace->records.size(), 2);
+
+  const TraceRecord& span = trace->records[0];
+  EXPECT_EQ(span.kind, TraceRecord::kSpan);
+  EXPECT_EQ(span.span, static_cast<uint16_t>(TraceSpan::kPrepare));
+  EXPECT_EQ(span.iteration, 3);
+  EXPECT_EQ(span.end - span.begin, 1000);
+
+  const TraceRecord& iteration = trace->records[1];
+  EXPECT_EQ(iteration.kind, TraceRecord::kIteration);
+  EXPECT_EQ(iteration.iteration, 4);
+  EXPECT_EQ(iteration.values[0], 1.5);
+  EXPECT_EQ(iteration.values[3], 10);
+
+  std::ostringstream json;
+  WriteChromeTrace(*trace, &json);
+  EXPECT_THAT(json.str(), HasSubstr("\"name\":\"prepare\""));
+  EXPECT_THAT(json.str(), HasSubstr("\"mix_gap\":1.5"));
+  EXPECT_THAT(json.str(), HasSubstr("\"min_loss\":-0.25"));
+  // JSON has no infinity.
+  EXPECT_THAT(json.str(), Not(HasSubstr("max_loss")));
+}
+
+// The ring keeps the most recent records, oldest first.
+TEST(TraceRecorder, KeepsMostRecent) {
+  TraceRecorder recorder(5);  // Rounded up to 8.
+  for (uint64_t i = 0; i < 20; ++i) {
+    recorder.RecordSpan(TraceSpan::kIteration, i, i, i + 1);
+  }
+
+  const std::string path = TempPath();
+  ASSERT_TRUE(recorder.WriteFile(path));
+  const absl::optional<TraceFile> trace = ReadTraceFile(path);
+  remove(path.c_str());
+  ASSERT_TRUE(trace.has_value());
+  EXPECT_EQ(trace->num_dropped, 12);
+  ASSERT_EQ(trace->records.size(), 8);
+  for (size_t i = 0; i < 8; ++i) {
+    EXPECT_EQ(trace->records[i].iteration, 12 + i);
+  }
+}
+
+// Spans don't leak values, e.g., from the iteration record they
+// overwrite in the ring.
+TEST(TraceRecorder, SpansHaveZeroValues) {
+  TraceRecorder recorder(1);
+  TraceIteration scalars;
+  scalars.mix_gap = 1.5;
+  scalars.best_bound = 10;
+  recorder.RecordIteration(scalars);
+  recorder.RecordSpan(TraceSpan::kKnapsack, 1, 2, 3);
+
+  const std::string path = TempPath();
+  ASSERT_TRUE(recorder.WriteFile(path));
+  const absl::optional<TraceFile> trace = ReadTraceFile(path);
+  remove(path.c_str());
+  ASSERT_TRUE(trace.has_value());
+  ASSERT_EQ(trace->records.size(), 1);
+  EXPECT_EQ(trace->records[0].kind, TraceRecord::kSpan);
+  for (const double value : trace->records[0].values) {
+    EXPECT_EQ(value, 0);
+  }
+}
+
+TEST(TraceRecorder, ConcurrentWriters) {
+  constexpr size_t kNumThreads = 4;
+  constexpr size_t kPerThread = 1000;
+  TraceRecorder recorder(kNumThreads * kPerThread);
+  std::vector<std::thread> threads;
+  for (size_t t = 0; t < kNumThreads; ++t) {
+    threads.emplace_back([&recorder, t] {
+      for (size_t i = 0; i < kPerThread; ++i) {
+        recorder.RecordSpan(TraceSpan::kPrimalRounding, t, i, i);
+      }
+    });
+  }
+
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+
+  const std::string path = TempPath();
+  ASSERT_TRUE(recorder.WriteFile(path));
+  const absl::optional<TraceFile> trace = ReadTraceFile(path);
+  remove(path.c_str());
+  ASSERT_TRUE(trace.has_value());
+  ASSERT_EQ(trace->records.size(), kNumThreads * kPerThread);
+
+  // Each thread's records have their own thread index, and are in
+  // program order.
+  std::vector<std::vector<uint64_t>> per_iteration(kNumThreads);
+  std::vector<uint32_t> thread_index(kNumThreads, ~0U);
+  for (const TraceRecord& record : trace->records) {
+    per_iteration[record.iteration].push_back(record.begin);
+    if (thread_index[record.iteration] == ~0U) {
+      thread_index[record.iteration] = record.thread;
+    }
+
+    EXPECT_EQ(thread_index[record.iteration], record.thread);
+  }
+
+  for (const std::vector<uint64_t>& begins : per_iteration) {
+    ASSERT_EQ(begins.size(), kPerThread);
+    for (size_t i = 0; i < kPerThread; ++i) {
+      EXPECT_EQ(begins[i], i);
+    }
+  }
+}
+
+TEST(TraceRecorder, RejectsInvalidFiles) {
+  const std::string path = TempPath();
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(file, nullptr);
+  fputs("not a trace", file);
+  fclose(file);
+  EXPECT_FALSE(ReadTraceFile(path).has_value());
+  remove(path.c_str());
+}
+}  // namespace
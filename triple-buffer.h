@@ -0,0 +1,65 @@
+#ifndef TRIPLE_BUFFER_H
+#define TRIPLE_BUFFER_H
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// A wait-free single-producer single-consumer triple buffer.
+//
+// The writer fills `back()` and calls `Publish()`; the reader calls
+// `Acquire()` and then reads `front()`.  The writer and the reader
+// never touch the same buffer, so neither ever blocks, and the
+// reader always sees a complete value: the most recently published
+// one as of the last `Acquire()`.
+//
+// Buffers are recycled, so `back()` holds a stale value after
+// `Publish()`; writers that overwrite it in place (e.g., with
+// `std::vector::assign`) stop allocating once all three buffers have
+// grown to size.
+//
+// This class is thread-safe, as long as only one thread writes and
+// only one thread reads.
+template <typename T>
+class TripleBuffer {
+ public:
+  TripleBuffer() = default;
+
+  TripleBuffer(const TripleBuffer&) = delete;
+  TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+  // Writer-side.
+  T* back() { return &buffers_[back_]; }
+
+  // Makes the contents of `back()` available to the reader, and
+  // switches `back()` to a recycled buffer.
+  void Publish() {
+    back_ = middle_.exchange(back_ | kFresh, std::memory_order_acq_rel) &
+            kIndexMask;
+  }
+
+  // Reader-side.
+  //
+  // Switches `front()` to the last published value, if any was
+  // published since the previous call, and returns whether it did.
+  bool Acquire() {
+    if ((middle_.load(std::memory_order_relaxed) & kFresh) == 0) {
+      return false;
+    }
+
+    front_ = middle_.exchange(front_, std::memory_order_acq_rel) & kIndexMask;
+    return true;
+  }
+
+  const T& front() const { return buffers_[front_]; }
+
+ private:
+  static constexpr uint8_t kIndexMask = 3;
+  // Set when the middle buffer holds a value the reader hasn't seen.
+  static constexpr uint8_t kFresh = 4;
+
+  std::array<T, 3> buffers_;
+  uint8_t back_{0};
+  std::atomic<uint8_t> middle_{1};
+  uint8_t front_{2};
+};
+#endif /* !TRIPLE_BUFFER_H */
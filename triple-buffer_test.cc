@@ -0,0 +1,83 @@
+#include "triple-buffer.h"
+
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace {
+TEST(TripleBuffer, AcquireOnlyNewValues) {
+  TripleBuffer<int> buffer;
+
+  EXPECT_FALSE(buffer.Acquire());
+
+  *buffer.back() = 1;
+  buffer.Publish();
+  EXPECT_TRUE(buffer.Acquire());
+  EXPECT_EQ(buffer.front(), 1);
+  EXPECT_FALSE(buffer.Acquire());
+  EXPECT_EQ(buffer.front(), 1);
+}
+
+TEST(TripleBuffer, AcquireLatestValue) {
+  TripleBuffer<int> buffer;
+
+  for (int i = 1; i <= 10; ++i) {
+    *buffer.back() = i;
+    buffer.Publish();
+  }
+
+  EXPECT_TRUE(buffer.Acquire());
+  EXPECT_EQ(buffer.front(), 10);
+}
+
+TEST(TripleBuffer, WriterNeverOverwritesFront) {
+  TripleBuffer<int> buffer;
+
+  *buffer.back() = 1;
+  buffer.Publish();
+  ASSERT_TRUE(buffer.Acquire());
+
+  for (int i = 2; i <= 10; ++i) {
+    EXPECT_NE(buffer.back(), &buffer.front());
+    *buffer.back() = i;
+    buffer.Publish();
+    EXPECT_EQ(buffer.front(), 1);
+  }
+}
+
+// Each published vector is filled with a single value, so readers
+// can detect torn reads.
+TEST(TripleBuffer, ConcurrentReadsAreConsistent) {
+  constexpr size_t kSize = 1000;
+  constexpr size_t kNumPublish = 10000;
+
+  TripleBuffer<std::vector<size_t>> buffer;
+  std::thread writer([&buffer] {
+    for (size_t i = 1; i <= kNumPublish; ++i) {
+      buffer.back()->assign(kSize, i);
+      buffer.Publish();
+    }
+  });
+
+  size_t last = 0;
+  while (last < kNumPublish) {
+    if (!buffer.Acquire()) {
+      std::this_thread::yield();
+      continue;
+    }
+
+    const std::vector<size_t>& values = buffer.front();
+    ASSERT_EQ(values.size(), kSize);
+    ASSERT_GT(values[0], last);
+    for (size_t value : values) {
+      ASSERT_EQ(value, values[0]);
+    }
+
+    last = values[0];
+  }
+
+  writer.join();
+}
+}  // namespace
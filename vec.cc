@@ -3,8 +3,11 @@
 #include <assert.h>
 #include <immintrin.h>
 
+#include <algorithm>
 #include <array>
 #include <cstddef>
+#include <limits>
+#include <utility>
 
 #include "avx_mathfun.h"
 
@@ -57,6 +60,82 @@ v4df ChunkApplyHedgeLoss(absl::Span<const double> losses, double min_loss,
   return acc;
 }
 
+// Computes regrets = max(0, learner_loss - losses[i]) over a chunk of
+// values, and to_exp = inv_2scale * regrets^2, in single precision.
+void ChunkNormalHedgeRegrets(const double* losses, double learner_loss,
+                             double inv_2scale, v8sf* out_regrets,
+                             v8sf* out_to_exp) {
+  const v4df vlearner_loss = _mm256_set1_pd(learner_loss);
+  const v4df vinv_2scale = _mm256_set1_pd(inv_2scale);
+  const v4df zero = _mm256_setzero_pd();
+
+  v8sf regrets = {0};
+  v8sf to_exp = {0};
+  {
+    const v4df lo =
+        _mm256_max_pd(zero, vlearner_loss - _mm256_loadu_pd(losses));
+    regrets = _mm256_insertf128_ps(regrets, _mm256_cvtpd_ps(lo), 0);
+    to_exp = _mm256_insertf128_ps(to_exp,
+                                  _mm256_cvtpd_ps(vinv_2scale * lo * lo), 0);
+  }
+
+  {
+    const v4df hi =
+        _mm256_max_pd(zero, vlearner_loss - _mm256_loadu_pd(losses + 4));
+    regrets = _mm256_insertf128_ps(regrets, _mm256_cvtpd_ps(hi), 1);
+    to_exp = _mm256_insertf128_ps(to_exp,
+                                  _mm256_cvtpd_ps(vinv_2scale * hi * hi), 1);
+  }
+
+  *out_regrets = regrets;
+  *out_to_exp = to_exp;
+}
+
+// Computes the NormalHedge weights over a chunk of values; see
+// `ApplyNormalHedgeLoss`.
+v4df ChunkApplyNormalHedgeLoss(absl::Span<const double> losses,
+                               double learner_loss, double inv_2scale,
+                               absl::Span<double> weights, v4df acc) {
+  assert(losses.size() == kChunkSize);
+  assert(weights.size() >= kChunkSize);
+
+  v8sf regrets;
+  v8sf to_exp;
+  ChunkNormalHedgeRegrets(losses.data(), learner_loss, inv_2scale, &regrets,
+                          &to_exp);
+  const v8sf vfactor = _mm256_set1_ps(2 * inv_2scale);
+  const v8sf float_weights = vfactor * regrets * exp256_ps(to_exp);
+
+  {
+    v4df lo = _mm256_cvtps_pd(_mm256_extractf128_ps(float_weights, 0));
+    acc += lo;
+    _mm256_storeu_pd(weights.data(), lo);
+  }
+
+  {
+    v4df hi = _mm256_cvtps_pd(_mm256_extractf128_ps(float_weights, 1));
+    acc += hi;
+    _mm256_storeu_pd(weights.data() + 4, hi);
+  }
+
+  return acc;
+}
+
+// Accumulates the NormalHedge potential and its derivative over a
+// chunk of values; see `NormalHedgePotential`.
+void ChunkNormalHedgePotential(const double* losses, double learner_loss,
+                               double inv_2scale, v4df* acc, v4df* acc_diff) {
+  v8sf regrets;
+  v8sf to_exp;
+  ChunkNormalHedgeRegrets(losses, learner_loss, inv_2scale, &regrets, &to_exp);
+  const v8sf potential = exp256_ps(to_exp);
+  const v8sf diff = regrets * regrets * potential;
+
+  *acc += _mm256_cvtps_pd(_mm256_extractf128_ps(potential, 0));
+  *acc += _mm256_cvtps_pd(_mm256_extractf128_ps(potential, 1));
+  *acc_diff += _mm256_cvtps_pd(_mm256_extractf128_ps(diff, 0));
+  *acc_diff += _mm256_cvtps_pd(_mm256_extractf128_ps(diff, 1));
+}
 }  // namespace
 
 double ApplyHedgeLoss(absl::Span<const double> losses, double min_loss,
@@ -92,6 +171,76 @@ double ApplyHedgeLoss(absl::Span<const double> losses, double min_loss,
   return acc;
 }
 
+double ApplyNormalHedgeLoss(absl::Span<const double> losses,
+                            double learner_loss, double inv_2scale,
+                            absl::Span<double> weights) {
+  v4df vacc = {0};
+
+  while (losses.size() >= kChunkSize) {
+    vacc = ChunkApplyNormalHedgeLoss(losses.subspan(0, kChunkSize),
+                                     learner_loss, inv_2scale,
+                                     weights.subspan(0, kChunkSize), vacc);
+    losses.remove_prefix(kChunkSize);
+    weights.remove_prefix(kChunkSize);
+  }
+
+  double acc = vacc[0] + vacc[1] + vacc[2] + vacc[3];
+  if (!losses.empty()) {
+    // Pad with losses that yield a zero regret, and thus weight.
+    double padded_tail[kChunkSize];
+    std::fill(padded_tail, padded_tail + kChunkSize, learner_loss);
+
+    const size_t n = losses.size();
+    if (n > kChunkSize) {
+      __builtin_unreachable();
+    }
+
+    for (size_t i = 0; i < n; ++i) {
+      padded_tail[i] = losses[i];
+    }
+
+    ChunkApplyNormalHedgeLoss(padded_tail, learner_loss, inv_2scale, weights,
+                              vacc);
+    for (size_t i = 0; i < n; ++i) {
+      acc += weights[i];
+    }
+  }
+
+  return acc;
+}
+
+std::pair<double, double> NormalHedgePotential(absl::Span<const double> losses,
+                                               double learner_loss,
+                                               double inv_2scale) {
+  v4df vacc = {0};
+  v4df vacc_diff = {0};
+
+  while (losses.size() >= kChunkSize) {
+    ChunkNormalHedgePotential(losses.data(), learner_loss, inv_2scale, &vacc,
+                              &vacc_diff);
+    losses.remove_prefix(kChunkSize);
+  }
+
+  double acc = vacc[0] + vacc[1] + vacc[2] + vacc[3];
+  double acc_diff = vacc_diff[0] + vacc_diff[1] + vacc_diff[2] + vacc_diff[3];
+  if (!losses.empty()) {
+    double padded_tail[kChunkSize];
+    std::fill(padded_tail, padded_tail + kChunkSize, learner_loss);
+    std::copy(losses.begin(), losses.end(), padded_tail);
+
+    v4df tail = {0};
+    v4df tail_diff = {0};
+    ChunkNormalHedgePotential(padded_tail, learner_loss, inv_2scale, &tail,
+                              &tail_diff);
+    // Each padding entry contributes exp(0) = 1 to the potential.
+    acc += tail[0] + tail[1] + tail[2] + tail[3] -
+           (kChunkSize - losses.size());
+    acc_diff += tail_diff[0] + tail_diff[1] + tail_diff[2] + tail_diff[3];
+  }
+
+  return std::make_pair(acc, acc_diff);
+}
+
 std::pair<size_t, double> FindMinValue(absl::Span<const double> xs) {
   size_t index = 0;
   double min_val = xs[0];
@@ -105,4 +254,27 @@ std::pair<size_t, double> FindMinValue(absl::Span<const double> xs) {
 
   return std::make_pair(index, min_val);
 }
+
+double MinValue(absl::Span<const double> xs) {
+  const size_t n = xs.size();
+  const double* data = xs.data();
+  // Two accumulators hide the latency of `vminpd`.
+  v4df acc0 = _mm256_set1_pd(std::numeric_limits<double>::infinity());
+  v4df acc1 = acc0;
+  size_t i = 0;
+  for (; i + kChunkSize <= n; i += kChunkSize) {
+    acc0 = _mm256_min_pd(acc0, _mm256_loadu_pd(data + i));
+    acc1 = _mm256_min_pd(acc1, _mm256_loadu_pd(data + i + 4));
+  }
+
+  std::array<double, 4> lanes;
+  _mm256_storeu_pd(lanes.data(), _mm256_min_pd(acc0, acc1));
+  double ret = std::min(std::min(lanes[0], lanes[1]),
+                        std::min(lanes[2], lanes[3]));
+  for (; i < n; ++i) {
+    ret = std::min(ret, data[i]);
+  }
+
+  return ret;
+}
 }  // namespace internal
@@ -1,3 +1,5 @@
+#ifndef VEC_H
+#define VEC_H
 #include <cstddef>
 #include <utility>
 
@@ -12,11 +14,15 @@ namespace internal {
 double ApplyHedgeLoss(absl::Span<const double> losses, double min_loss,
                       double step_size, absl::Span<double> weights);
 
-template <typename Fn>
-double ApplyHedgeLossWithForEach(absl::Span<const double> losses,
-                                 const double min_loss, const double step_size,
-                                 const Fn& fn, absl::Span<double> weights,
-                                 const size_t block_size = 64) {
+// Calls `apply(losses, weights)` on tiles of `block_size` elements,
+// and `fn(i, weights[i])` on each tile right after `apply`, while
+// it's still hot in cache.  Returns the sum of `apply`'s return
+// values.
+template <typename Apply, typename Fn>
+double TiledApplyWithForEach(const Apply& apply,
+                             absl::Span<const double> losses, const Fn& fn,
+                             absl::Span<double> weights,
+                             const size_t block_size = 64) {
   double ret = 0;
 
   const size_t n = losses.size();
@@ -24,8 +30,7 @@ double ApplyHedgeLossWithForEach(absl::Span<const double> losses,
 
   // Tile calls 64 elements at a time (1 SIMD line ~= 8 elements).
   for (i = 0; i + block_size <= n; i += block_size) {
-    ret += ApplyHedgeLoss(losses.first(block_size), min_loss, step_size,
-                          weights.first(block_size));
+    ret += apply(losses.first(block_size), weights.first(block_size));
     for (size_t j = 0; j < block_size; ++j) {
       fn(i + j, weights[j]);
     }
@@ -34,7 +39,7 @@ double ApplyHedgeLossWithForEach(absl::Span<const double> losses,
     weights.remove_prefix(block_size);
   }
 
-  ret += ApplyHedgeLoss(losses, min_loss, step_size, weights);
+  ret += apply(losses, weights);
   for (size_t j = 0; j < losses.size(); ++j) {
     fn(i + j, weights[j]);
   }
@@ -42,7 +47,61 @@ double ApplyHedgeLossWithForEach(absl::Span<const double> losses,
   return ret;
 }
 
+template <typename Fn>
+double ApplyHedgeLossWithForEach(absl::Span<const double> losses,
+                                 const double min_loss, const double step_size,
+                                 const Fn& fn, absl::Span<double> weights,
+                                 const size_t block_size = 64) {
+  return TiledApplyWithForEach(
+      [min_loss, step_size](absl::Span<const double> losses,
+                            absl::Span<double> weights) {
+        return ApplyHedgeLoss(losses, min_loss, step_size, weights);
+      },
+      losses, fn, weights, block_size);
+}
+
+// NormalHedge weights, with regrets r[i] = max(0, learner_loss -
+// losses[i]) and scale c = 1 / (2 inv_2scale):
+//
+//   weights[i] = (r[i] / c) exp(r[i]^2 / (2c))
+//              = 2 inv_2scale r[i] exp(inv_2scale r[i]^2).
+//
+// weights.size() must be rounded up to a multiple of 8.
+//
+// Returns the sum of generated weights.
+double ApplyNormalHedgeLoss(absl::Span<const double> losses,
+                            double learner_loss, double inv_2scale,
+                            absl::Span<double> weights);
+
+template <typename Fn>
+double ApplyNormalHedgeLossWithForEach(absl::Span<const double> losses,
+                                       const double learner_loss,
+                                       const double inv_2scale, const Fn& fn,
+                                       absl::Span<double> weights,
+                                       const size_t block_size = 64) {
+  return TiledApplyWithForEach(
+      [learner_loss, inv_2scale](absl::Span<const double> losses,
+                                 absl::Span<double> weights) {
+        return ApplyNormalHedgeLoss(losses, learner_loss, inv_2scale,
+                                    weights);
+      },
+      losses, fn, weights, block_size);
+}
+
+// Evaluates the NormalHedge potential at `inv_2scale` for the same
+// regrets as `ApplyNormalHedgeLoss`: returns the sum of
+// exp(inv_2scale r[i]^2), and the sum of its derivative with respect
+// to `inv_2scale`, r[i]^2 exp(inv_2scale r[i]^2).
+std::pair<double, double> NormalHedgePotential(absl::Span<const double> losses,
+                                               double learner_loss,
+                                               double inv_2scale);
+
 // Returns the index and value of a minimum element in `xs`. `xs` must
 // not be empty.
 std::pair<size_t, double> FindMinValue(absl::Span<const double> xs);
+
+// Returns the minimum value in `xs`, or infinity if `xs` is empty.
+// `xs` must not contain NaNs.
+double MinValue(absl::Span<const double> xs);
 }  // namespace internal
+#endif /* !VEC_H */
@@ -13,6 +13,7 @@
 
 #include "absl/flags/flag.h"
 #include "absl/flags/parse.h"
+#include "absl/types/optional.h"
 #include "absl/types/span.h"
 #include "random-set-cover-flags.h"
 #include "random-set-cover-instance.h"
@@ -25,6 +26,8 @@ ABSL_FLAG(size_t, history_limit, 100,
 
 ABSL_FLAG(double, refresh_period_ms, 250,
           "Minimum time in milliseconds between slow data refreshes.");
+ABSL_FLAG(double, snapshot_period_ms, 50,
+          "Minimum time in milliseconds between solution snapshots.");
 
 ABSL_FLAG(size_t, window_width, 1280, "Width of the viewport in pixels");
 ABSL_FLAG(size_t, window_height, 720, "Height of the viewport in pixels");
@@ -257,10 +260,13 @@ int main(int argc, char** argv) {
   const size_t kWinHeight = absl::GetFlag(FLAGS_window_height);
   const double kFeasEps = absl::GetFlag(FLAGS_feas_eps);
 
-  RandomSetCoverInstance instance = GenerateRandomInstance(
-      absl::GetFlag(FLAGS_num_sets), absl::GetFlag(FLAGS_num_values),
-      absl::GetFlag(FLAGS_min_set_per_value),
-      absl::GetFlag(FLAGS_max_set_per_value));
+  absl::optional<RandomSetCoverInstance> maybe_instance =
+      MakeInstanceFromFlags();
+  if (!maybe_instance.has_value()) {
+    return 1;
+  }
+
+  RandomSetCoverInstance& instance = *maybe_instance;
 
   GLFWwindow* window;
   {
@@ -276,6 +282,16 @@ int main(int argc, char** argv) {
   // below.
   SetCoverSolver solver(instance.obj_values,
                         absl::MakeSpan(instance.constraints));
+  if (!ConfigureSolverFromFlags(&solver)) {
+    return 1;
+  }
+
+  {
+    SetCoverSolver::SnapshotOptions options;
+    options.min_period =
+        absl::Milliseconds(absl::GetFlag(FLAGS_snapshot_period_ms));
+    solver.SetSnapshotOptions(options);
+  }
 
   // XXX: add a way to cancel the thread and actually join it.
   std::thread solver_thread([kFeasEps, &solver] {
@@ -286,6 +302,7 @@ int main(int argc, char** argv) {
   bool text_summary_printed = false;
 
   struct StateCache last_state;
+  size_t last_solution_iteration = 0;
   absl::Time last_slow_update = absl::InfinitePast();
   int history_window = absl::GetFlag(FLAGS_history_limit);
 
@@ -296,23 +313,17 @@ int main(int argc, char** argv) {
     const bool done = solver.IsDone();
     bool any_change = false;
 
-    if (solver.state().mu.TryLock()) {
-      if (solver.state().scalar.num_iterations !=
-          last_state.scalar.num_iterations) {
-        any_change = true;
-        last_state.delta_num_iterations = solver.state().scalar.num_iterations -
-                                          last_state.scalar.num_iterations;
-        last_state.scalar = solver.state().scalar;
-
-        last_state.solution.clear();
-        last_state.solution.reserve(solver.state().current_solution.size());
-        // XXX: should SMR this up.
-        for (double x : solver.state().current_solution) {
-          last_state.solution.push_back(x);
-        }
+    if (solver.RefreshSnapshot() &&
+        solver.scalar().num_iterations != last_state.scalar.num_iterations) {
+      any_change = true;
+      last_state.delta_num_iterations =
+          solver.scalar().num_iterations - last_state.scalar.num_iterations;
+      last_state.scalar = solver.scalar();
+      // Only rescale the solution when the solver published a new one.
+      if (solver.solution().num_iterations != last_solution_iteration) {
+        last_solution_iteration = solver.solution().num_iterations;
+        solver.solution().CopyTo(&last_state.solution);
       }
-
-      solver.state().mu.Unlock();
     }
 
     if (any_change && last_state.scalar.num_iterations > 0) {
@@ -0,0 +1,168 @@
+#include "weight-update.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "vec.h"
+
+namespace {
+// Stop the NormalHedge scale search once the average potential is
+// within this relative distance of e.
+constexpr double kScaleTolerance = 1e-3;
+constexpr size_t kMaxScalePasses = 16;
+
+template <typename Weights>
+PrepareWeightsState PrepareAllWeights(const Weights& weight_fn, double eta,
+                                      absl::Span<CoverConstraint> constraints,
+                                      DriverState* state) {
+  PrepareWeightsState ret(
+      state->arena.CreateUninit<double>(state->obj_values.size(),
+                                        /*zero_fill=*/true),
+      state->prev_min_loss, eta);
+  for (auto& constraint : constraints) {
+    constraint.PrepareWeights(weight_fn, &ret);
+  }
+
+  return ret;
+}
+}  // namespace
+
+double ComputeMixLoss(const MixLossInfo& info) {
+  return info.min_loss -
+         std::log(info.sum_weights / info.num_weights) / info.eta;
+}
+
+double AdaHedgeStepSize(const DriverState& state) {
+  double eta = std::numeric_limits<double>::infinity();
+  if (state.sum_mix_gap > 0) {
+    eta = std::log(std::max<size_t>(2, state.prev_num_non_zero)) /
+          state.sum_mix_gap;
+  }
+
+  return eta;
+}
+
+PrepareWeightsState AdaHedge::PrepareWeights(
+    absl::Span<CoverConstraint> constraints, DriverState* state) {
+  const double eta = AdaHedgeStepSize(*state);
+  return PrepareAllWeights(HedgeWeights{state->prev_min_loss, eta}, eta,
+                           constraints, state);
+}
+
+void AdaHedge::UpdateWeights(absl::Span<CoverConstraint> constraints,
+                             const PrepareWeightsState& prepare_weights,
+                             const ObserveLossState& observe_state,
+                             double observed_loss, DriverState* state) {
+  const double prev_mix_loss = ComputeMixLoss(prepare_weights.mix_loss);
+
+  const double eta = prepare_weights.mix_loss.eta;
+  UpdateMixLossState update_state(observe_state.min_loss, eta);
+  const HedgeWeights weight_fn{observe_state.min_loss, eta};
+  for (auto& constraint : constraints) {
+    constraint.UpdateMixLoss(weight_fn, &update_state);
+  }
+
+  state->prev_num_non_zero = update_state.mix_loss.num_weights;
+
+  const double mix_loss = ComputeMixLoss(update_state.mix_loss);
+  state->sum_mix_gap +=
+      std::max(0.0, observed_loss - (mix_loss - prev_mix_loss));
+}
+
+PrepareWeightsState NormalHedge::PrepareWeights(
+    absl::Span<CoverConstraint> constraints, DriverState* state) {
+  // The learner's cumulative loss is the sum of the (normalised)
+  // observed losses, and the largest regret is against the expert
+  // with the minimum cumulative loss.
+  const double learner_loss = state->sum_solution_feasibility;
+  const double max_regret = learner_loss - state->prev_min_loss;
+
+  size_t num_experts = 0;
+  for (const auto& constraint : constraints) {
+    num_experts += constraint.loss().size();
+  }
+
+  last_num_scale_passes_ = 0;
+  if (!(max_regret > 0) || num_experts == 0) {
+    inv_2scale_ = 0;
+  } else {
+    // The average potential mean(exp(u r^2)), for u = 1 / 2c, is
+    // convex and increasing in u.  It's at most e when u = 1 /
+    // max_regret^2, and at least e when u = (1 + log n) /
+    // max_regret^2: the expert with the max regret alone contributes
+    // exp(1 + log n) / n = e.  Newton's method converges from either
+    // side, after at most one step that overshoots the root.
+    const double inv_sq = 1.0 / (max_regret * max_regret);
+    const double lo = inv_sq;
+    const double hi = (1.0 + std::log(num_experts)) * inv_sq;
+
+    const double warm = state->normal_hedge_inv_2scale;
+    double u = (warm > 0) ? std::min(hi, std::max(lo, warm)) : hi;
+    while (last_num_scale_passes_ < kMaxScalePasses) {
+      double potential = 0;
+      double diff = 0;
+      for (const auto& constraint : constraints) {
+        const auto p = internal::NormalHedgePotential(constraint.loss(),
+                                                      learner_loss, u);
+        potential += p.first;
+        diff += p.second;
+      }
+
+      ++last_num_scale_passes_;
+      const double excess = potential / num_experts - M_E;
+      if (std::abs(excess) <= kScaleTolerance * M_E || !(diff > 0)) {
+        break;
+      }
+
+      const double next =
+          std::min(hi, std::max(lo, u - excess * num_experts / diff));
+      const bool converged = std::abs(next - u) <= kScaleTolerance * u;
+      u = next;
+      if (converged) {
+        break;
+      }
+    }
+
+    inv_2scale_ = u;
+  }
+
+  state->normal_hedge_inv_2scale = inv_2scale_;
+
+  // NormalHedge has no step size; the mix loss is only tracked for
+  // the normalisation factor.
+  return PrepareAllWeights(NormalHedgeWeights{learner_loss, inv_2scale_},
+                           /*eta=*/0.0, constraints, state);
+}
+
+void NormalHedge::UpdateWeights(absl::Span<CoverConstraint>,
+                                const PrepareWeightsState&,
+                                const ObserveLossState&, double,
+                                DriverState*) {
+  // The regrets follow directly from the cumulative losses, which the
+  // constraints have already updated.
+}
+
+bool ParseWeightUpdateKind(absl::string_view name, WeightUpdateKind* out) {
+  if (name == "adahedge") {
+    *out = WeightUpdateKind::kAdaHedge;
+    return true;
+  }
+
+  if (name == "normalhedge") {
+    *out = WeightUpdateKind::kNormalHedge;
+    return true;
+  }
+
+  if (name == "pipelined-adahedge") {
+    *out = WeightUpdateKind::kPipelinedAdaHedge;
+    return true;
+  }
+
+  if (name == "fused-adahedge") {
+    *out = WeightUpdateKind::kFusedAdaHedge;
+    return true;
+  }
+
+  return false;
+}
@@ -0,0 +1,98 @@
+#ifndef WEIGHT_UPDATE_H
+#define WEIGHT_UPDATE_H
+#include <cstddef>
+
+#include "absl/strings/string_view.h"
+#include "absl/types/span.h"
+#include "cover-constraint.h"
+#include "driver.h"
+
+// Weight update algorithms decide how the experts' (cover
+// constraints' potential tours) cumulative losses turn into the
+// weights that define each iteration's surrogate knapsack.
+// `DriveOneIteration` is templated on the algorithm, which must
+// provide:
+//
+//   // Computes this iteration's weights for all constraints, and
+//   // returns the aggregated knapsack.  Usually calls
+//   // `CoverConstraint::PrepareWeights` with a weight function.
+//   PrepareWeightsState PrepareWeights(
+//       absl::Span<CoverConstraint> constraints, DriverState* state);
+//
+//   // Updates the algorithm's state once the constraints have
+//   // observed the iteration's losses.  `observed_loss` is the
+//   // learner's (normalised) loss for the iteration.
+//   void UpdateWeights(absl::Span<CoverConstraint> constraints,
+//                      const PrepareWeightsState& prepare_weights,
+//                      const ObserveLossState& observe_state,
+//                      double observed_loss, DriverState* state);
+//
+// Algorithms keep any state that affects the iterates, including warm
+// starts, in the `DriverState` and the constraints, so checkpoints
+// capture everything needed to resume a solve.
+
+// Returns the Hedge mix loss, min_loss - log(mean weight) / eta.
+double ComputeMixLoss(const MixLossInfo& info);
+
+// Returns AdaHedge's step size for `state`: log(num experts with
+// non-zero weight) / sum of mix gaps, or infinity before any gap.
+double AdaHedgeStepSize(const DriverState& state);
+
+// AdaHedge, with a single adaptive step size for all experts:
+// eta = log(num experts with non-zero weight) / sum of mix gaps.
+class AdaHedge {
+ public:
+  PrepareWeightsState PrepareWeights(absl::Span<CoverConstraint> constraints,
+                                     DriverState* state);
+
+  void UpdateWeights(absl::Span<CoverConstraint> constraints,
+                     const PrepareWeightsState& prepare_weights,
+                     const ObserveLossState& observe_state,
+                     double observed_loss, DriverState* state);
+};
+
+// NormalHedge (Chaudhuri, Freund and Hsu, 2009): parameter-free, with
+// weights proportional to (r / c) exp(r^2 / 2c), for each expert's
+// cumulative regret r (clamped to non-negative values).  Experts that
+// do worse than the learner get no weight at all.
+//
+// The scale c is such that the average of exp(r^2 / 2c) over all
+// experts is e.  Finding it takes a few Newton steps, each of which
+// is a vectorised pass over all cumulative losses; the previous
+// iteration's scale, in `DriverState::normal_hedge_inv_2scale`, is a
+// good warm start.  Where the search starts changes the scale it
+// stops at, within its tolerance, so the warm start is checkpointed.
+class NormalHedge {
+ public:
+  PrepareWeightsState PrepareWeights(absl::Span<CoverConstraint> constraints,
+                                     DriverState* state);
+
+  void UpdateWeights(absl::Span<CoverConstraint> constraints,
+                     const PrepareWeightsState& prepare_weights,
+                     const ObserveLossState& observe_state,
+                     double observed_loss, DriverState* state);
+
+  // 1 / 2c for the last iteration; 0 while the weights are uniform.
+  double inv_2scale() const { return inv_2scale_; }
+  // The number of passes over all losses in the last scale search.
+  size_t last_num_scale_passes() const { return last_num_scale_passes_; }
+
+ private:
+  double inv_2scale_{0};
+  size_t last_num_scale_passes_{0};
+};
+
+// `kPipelinedAdaHedge` is AdaHedge with a lagged step size, driven
+// by `PipelinedDriver` (see pipelined-driver.h); `kFusedAdaHedge`
+// also observes losses in the same pass.
+enum class WeightUpdateKind {
+  kAdaHedge,
+  kNormalHedge,
+  kPipelinedAdaHedge,
+  kFusedAdaHedge
+};
+
+// Parses "adahedge", "normalhedge", "pipelined-adahedge" or
+// "fused-adahedge".
+bool ParseWeightUpdateKind(absl::string_view name, WeightUpdateKind* out);
+#endif /* !WEIGHT_UPDATE_H */
@@ -0,0 +1,161 @@
+#include "weight-update.h"
+
+#include <cmath>
+#include <vector>
+
+#include "gmock/gmock.h"
+#include "gtest/gtest.h"
+#include "random-set-cover-instance.h"
+
+using ::testing::DoubleEq;
+using ::testing::DoubleNear;
+using ::testing::ElementsAre;
+
+namespace {
+TEST(NormalHedgeWeights, UniformWithoutRegret) {
+  const double losses[] = {0.0, 1.0, -1.0};
+  std::vector<double> weights(8, -1.0);
+
+  const NormalHedgeWeights weight_fn{0.0, 0.0};
+  EXPECT_EQ(weight_fn.Apply(losses, absl::MakeSpan(weights)), 3.0);
+  EXPECT_THAT(absl::MakeSpan(weights).first(3), ElementsAre(1.0, 1.0, 1.0));
+}
+
+TEST(NormalHedgeWeights, MatchesScalarFormula) {
+  std::vector<double> losses;
+  for (int i = 0; i < 21; ++i) {
+    losses.push_back(-1.0 + 0.1 * i);
+  }
+
+  const double learner_loss = 0.25;
+  const double inv_2scale = 1.5;
+  std::vector<double> weights(24);
+  std::vector<double> seen(losses.size());
+  const double sum = NormalHedgeWeights{learner_loss, inv_2scale}
+                         .ApplyWithForEach(
+                             losses,
+                             [&seen](size_t i, double w) { seen[i] = w; },
+                             absl::MakeSpan(weights));
+
+  double expected_sum = 0;
+  for (size_t i = 0; i < losses.size(); ++i) {
+    const double r = std::max(0.0, learner_loss - losses[i]);
+    const double expected = 2 * inv_2scale * r * std::exp(inv_2scale * r * r);
+    // Weights are computed in single precision.
+    EXPECT_THAT(weights[i], DoubleNear(expected, 1e-5 * (1 + expected)));
+    EXPECT_EQ(seen[i], weights[i]);
+    expected_sum += expected;
+  }
+
+  EXPECT_THAT(sum, DoubleNear(expected_sum, 1e-4 * expected_sum));
+}
+
+// Two constraints; see driver_test.
+//
+//   min x0 + x1 + x2
+// s.t.
+//   x0    + x2 >= 1
+//      x1 + x2 >= 1
+TEST(NormalHedge, TwoIterations) {
+  CoverConstraint constraints[] = {
+      CoverConstraint({0, 2}), CoverConstraint({1, 2}),
+  };
+
+  const double costs[] = {1.0, 1.0, 1.0};
+  DriverState state(costs);
+  NormalHedge normal_hedge;
+
+  // No regret yet: uniform weights, as with AdaHedge.  The master
+  // picks [0, 0, 1], so the learner's loss is 0, and the cumulative
+  // losses are [-1, 1] for both constraints.
+  DriveOneIteration(absl::MakeSpan(constraints), &normal_hedge, &state);
+  EXPECT_EQ(normal_hedge.inv_2scale(), 0.0);
+  EXPECT_THAT(state.sum_solutions, ElementsAre(0.0, 0.0, DoubleEq(1.0)));
+  EXPECT_THAT(state.sum_solution_feasibility, DoubleEq(0.0));
+
+  // The clones for x0 and x1 have regret 1, and those for x2 regret
+  // -1, so they get no weight at all.  The scale solves
+  //   (2 exp(u) + 2) / 4 = e,  i.e., u = log(2e - 1),
+  // and the weight for the regret 1 experts is 2 u exp(u).
+  const PrepareWeightsState prepare_weights =
+      normal_hedge.PrepareWeights(absl::MakeSpan(constraints), &state);
+  const double u = std::log(2 * M_E - 1);
+  const double w = 2 * u * std::exp(u);
+  EXPECT_THAT(normal_hedge.inv_2scale(), DoubleNear(u, 1e-3 * u));
+  EXPECT_THAT(prepare_weights.knapsack_weights,
+              ElementsAre(DoubleNear(-w, 1e-2 * w), DoubleNear(-w, 1e-2 * w),
+                          0.0));
+  // Both subproblems pick their zero-weight x2 clone.
+  EXPECT_EQ(prepare_weights.knapsack_rhs, 0.0);
+  EXPECT_EQ(constraints[0].last_solution(), 1);
+  EXPECT_EQ(constraints[1].last_solution(), 1);
+
+  DriveOneIteration(absl::MakeSpan(constraints), &normal_hedge, &state);
+  EXPECT_EQ(state.num_iterations, 2);
+}
+
+TEST(NormalHedge, ScaleSearchSolvesPotentialEquation) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/1000, /*num_values=*/100,
+                             /*min_set_per_value=*/5,
+                             /*max_set_per_value=*/50, /*seed=*/42);
+  DriverState state(instance.obj_values);
+  NormalHedge normal_hedge;
+
+  const auto constraints = absl::MakeSpan(instance.constraints);
+  for (size_t i = 0; i < 20; ++i) {
+    DriveOneIteration(constraints, &normal_hedge, &state);
+  }
+
+  // The next iteration's scale search, repeated by hand.
+  normal_hedge.PrepareWeights(constraints, &state);
+  const double u = normal_hedge.inv_2scale();
+  ASSERT_GT(u, 0.0);
+  EXPECT_GE(normal_hedge.last_num_scale_passes(), 1);
+
+  double potential = 0;
+  size_t num_experts = 0;
+  for (const CoverConstraint& constraint : instance.constraints) {
+    for (const double loss : constraint.loss()) {
+      const double r = std::max(0.0, state.sum_solution_feasibility - loss);
+      potential += std::exp(u * r * r);
+      ++num_experts;
+    }
+  }
+
+  EXPECT_THAT(potential / num_experts, DoubleNear(M_E, 1e-2));
+}
+
+TEST(AdaHedge, MatchesDefaultDriver) {
+  RandomSetCoverInstance instance =
+      GenerateRandomInstance(/*num_sets=*/500, /*num_values=*/50,
+                             /*min_set_per_value=*/1,
+                             /*max_set_per_value=*/20, /*seed=*/7);
+  std::vector<CoverConstraint> copy(instance.constraints);
+
+  DriverState state(instance.obj_values);
+  DriverState other(instance.obj_values);
+  AdaHedge ada_hedge;
+
+  DriveOneIteration(absl::MakeSpan(instance.constraints), &state);
+  DriveOneIteration(absl::MakeSpan(copy), &ada_hedge, &other);
+
+  EXPECT_EQ(state.sum_mix_gap, other.sum_mix_gap);
+  EXPECT_EQ(state.prev_num_non_zero, other.prev_num_non_zero);
+  EXPECT_EQ(state.prev_min_loss, other.prev_min_loss);
+  EXPECT_EQ(state.sum_solution_feasibility, other.sum_solution_feasibility);
+}
+
+TEST(WeightUpdateKind, Parse) {
+  WeightUpdateKind kind;
+  ASSERT_TRUE(ParseWeightUpdateKind("adahedge", &kind));
+  EXPECT_EQ(kind, WeightUpdateKind::kAdaHedge);
+  ASSERT_TRUE(ParseWeightUpdateKind("normalhedge", &kind));
+  EXPECT_EQ(kind, WeightUpdateKind::kNormalHedge);
+  ASSERT_TRUE(ParseWeightUpdateKind("pipelined-adahedge", &kind));
+  EXPECT_EQ(kind, WeightUpdateKind::kPipelinedAdaHedge);
+  ASSERT_TRUE(ParseWeightUpdateKind("fused-adahedge", &kind));
+  EXPECT_EQ(kind, WeightUpdateKind::kFusedAdaHedge);
+  EXPECT_FALSE(ParseWeightUpdateKind("hedge", &kind));
+}
+}  // namespace